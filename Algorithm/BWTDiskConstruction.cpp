@@ -0,0 +1,266 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// BWTDiskConstruction - Merge FM-indices that were built
+// independently into a single index
+//
+#include "BWTDiskConstruction.h"
+#include "BWTReader.h"
+#include "BWTWriterBinary.h"
+#include "LexicoIndex.h"
+#include "RankProcess.h"
+#include "SequenceProcessFramework.h"
+#include "SuffixArray.h"
+#include "Timer.h"
+#include <cstdio>
+
+// Write the partial index of the reads of pRT, which start at read start_index of the input
+static MergeItem buildBatchIndex(const BWTDiskParameters& parameters, ReadTable* pRT, size_t start_index, size_t batch)
+{
+    if(parameters.doReverse)
+        pRT->reverseAll();
+
+    std::stringstream batchPrefix;
+    batchPrefix << parameters.outPrefix << ".batch" << batch;
+
+    MergeItem item;
+    item.reads_filename = parameters.inFile;
+    item.start_index = start_index;
+    item.num_reads = pRT->getCount();
+    item.bwt_filename = batchPrefix.str() + parameters.bwtExtension;
+    item.sai_filename = batchPrefix.str() + parameters.saiExtension;
+
+    SuffixArray* pSA = new SuffixArray(pRT, parameters.numThreads);
+    if(parameters.bValidate)
+    {
+        std::cout << "Validating suffix array\n";
+        pSA->validate(pRT);
+    }
+    pSA->writeBWT(item.bwt_filename, pRT);
+    pSA->writeIndex(item.sai_filename);
+    delete pSA;
+    return item;
+}
+
+//
+void buildBWTDisk(const BWTDiskParameters& parameters)
+{
+    // Build the partial index of each batch of reads
+    std::vector<MergeItem> items;
+    SeqReader reader(parameters.inFile);
+    SeqRecord record;
+    size_t num_reads = 0;
+    bool done = false;
+    while(!done)
+    {
+        ReadTable* pRT = new ReadTable;
+        while((int)pRT->getCount() < parameters.numReadsPerBatch && (done = !reader.get(record)) == false)
+            pRT->addRead(record.toSeqItem());
+
+        if(pRT->getCount() > 0)
+        {
+            std::cout << "Building the index of reads " << num_reads << " to " << num_reads + pRT->getCount() - 1 << "\n";
+            items.push_back(buildBatchIndex(parameters, pRT, num_reads, items.size()));
+            num_reads += pRT->getCount();
+        }
+        delete pRT;
+    }
+
+    if(items.empty())
+    {
+        std::cerr << "Error: " << parameters.inFile << " has no reads to index\n";
+        exit(EXIT_FAILURE);
+    }
+
+    // Merge adjacent indices until one remains, so every read is ranked
+    // about log2(number of batches) times. The merged index of the left item
+    // is held in memory while the reads of the right item are ranked against it
+    std::string bwt_out = parameters.outPrefix + parameters.bwtExtension;
+    std::string sai_out = parameters.outPrefix + parameters.saiExtension;
+    for(size_t round = 1; items.size() > 1; ++round)
+    {
+        std::vector<MergeItem> merged;
+        for(size_t i = 0; i + 1 < items.size(); i += 2)
+        {
+            std::stringstream mergePrefix;
+            mergePrefix << parameters.outPrefix << ".merge" << round << "-" << i / 2;
+
+            MergeItem item;
+            item.reads_filename = parameters.inFile;
+            item.start_index = items[i].start_index;
+            item.num_reads = items[i].num_reads + items[i + 1].num_reads;
+            item.bwt_filename = items.size() == 2 ? bwt_out : mergePrefix.str() + parameters.bwtExtension;
+            item.sai_filename = items.size() == 2 ? sai_out : mergePrefix.str() + parameters.saiExtension;
+
+            mergeIndependentIndices(items[i], items[i + 1], item.bwt_filename, item.sai_filename,
+                                    parameters.doReverse, parameters.numThreads, parameters.storageLevel);
+
+            for(size_t j = i; j < i + 2; ++j)
+            {
+                remove(items[j].bwt_filename.c_str());
+                remove(items[j].sai_filename.c_str());
+            }
+            merged.push_back(item);
+        }
+
+        if(items.size() % 2 == 1)
+            merged.push_back(items.back());
+        items.swap(merged);
+    }
+
+    // A single batch is already the complete index
+    if(items.front().bwt_filename != bwt_out &&
+       (rename(items.front().bwt_filename.c_str(), bwt_out.c_str()) != 0 ||
+        rename(items.front().sai_filename.c_str(), sai_out.c_str()) != 0))
+    {
+        std::cerr << "Error: could not rename " << items.front().bwt_filename << " to " << bwt_out << "\n";
+        exit(EXIT_FAILURE);
+    }
+}
+
+//
+void computeGapArray(SeqReader* pReader, size_t n, const BWT* pBWT, bool doReverse, int numThreads,
+                     GapArray* pGapArray, size_t& num_strings_read, size_t& num_symbols_read)
+{
+    // Every suffix of the reads ranks between two suffixes of the index, or after all of them
+    size_t gap_array_size = pBWT->getBWLen() + 1;
+    pGapArray->resize(gap_array_size);
+
+    // The rank processor calculates the rank of every suffix of a given sequence
+    // and counts it in the gap array. The ranks that overflow the small counts
+    // of the gap array are returned and counted by the post processor
+    RankPostProcess postProcessor(pGapArray);
+    if(numThreads <= 1)
+    {
+        RankProcess processor(pBWT, pGapArray, doReverse, false);
+        SequenceProcessFramework::processSequencesSerial<SequenceWorkItem,
+                                                         RankResult,
+                                                         RankProcess,
+                                                         RankPostProcess>(*pReader, &processor, &postProcessor, n);
+    }
+    else
+    {
+        std::vector<RankProcess*> processorVector;
+        for(int i = 0; i < numThreads; ++i)
+            processorVector.push_back(new RankProcess(pBWT, pGapArray, doReverse, false));
+
+        SequenceProcessFramework::processSequencesParallel<SequenceWorkItem,
+                                                           RankResult,
+                                                           RankProcess,
+                                                           RankPostProcess>(*pReader, processorVector, &postProcessor, n);
+
+        for(size_t i = 0; i < processorVector.size(); ++i)
+            delete processorVector[i];
+    }
+
+    num_strings_read = postProcessor.getNumStringsProcessed();
+    num_symbols_read = postProcessor.getNumSymbolsProcessed();
+}
+
+//
+void mergeIndependentIndices(const MergeItem& internalItem, const MergeItem& externalItem,
+                             const std::string& bwt_out, const std::string& sai_out,
+                             bool doReverse, int numThreads, int storageLevel)
+{
+    std::cout << "Merging " << externalItem.bwt_filename << " into " << internalItem.bwt_filename << "\n";
+
+    // Rank the suffixes of the external reads in the internal index. Only the
+    // gap array is kept so the index is freed before the merged files are written
+    GapArray* pGapArray = createGapArray(storageLevel);
+    size_t num_strings_read = 0;
+    size_t num_symbols_read = 0;
+    {
+        BWT* pBWT = new BWT(internalItem.bwt_filename);
+        SeqReader reader(externalItem.reads_filename);
+        // The reads before those of the external index are read and discarded.
+        // The input may be compressed, so there is no byte offset to seek to
+        SeqRecord record;
+        for(size_t i = 0; i < externalItem.start_index; ++i)
+            reader.get(record);
+        computeGapArray(&reader, externalItem.num_reads, pBWT, doReverse, numThreads, pGapArray, num_strings_read, num_symbols_read);
+        delete pBWT;
+    }
+
+    // Sanity check that the reads are the ones the external index was built from
+    size_t num_strings_external = 0;
+    size_t num_symbols_external = 0;
+    size_t num_runs_external = 0;
+    if(!BWTReader::readBinaryHeader(externalItem.bwt_filename, num_strings_external, num_symbols_external, num_runs_external) ||
+       num_strings_read != num_strings_external || num_symbols_read != num_symbols_external)
+    {
+        std::cerr << "Error: " << externalItem.reads_filename << " (" << num_strings_read << " reads, "
+                  << num_symbols_read << " symbols) does not match the index " << externalItem.bwt_filename
+                  << " (" << num_strings_external << " reads, " << num_symbols_external << " symbols)\n";
+        exit(EXIT_FAILURE);
+    }
+
+    writeMergedIndex(internalItem, externalItem, bwt_out, sai_out, pGapArray);
+    delete pGapArray;
+}
+
+// The BWTs are streamed from their files. The gap count of internal row i
+// is the number of external rows that sort before it. A '$' in the BWT
+// marks a row holding a full-length read, whose ID is the next entry of
+// the lexicographic index of the BWT the symbol came from
+void writeMergedIndex(const MergeItem& internalItem, const MergeItem& externalItem,
+                      const std::string& bwt_out, const std::string& sai_out,
+                      const GapArray* pGapArray)
+{
+    IBWTReader* pInternalReader = BWTReader::createReader(internalItem.bwt_filename);
+    IBWTReader* pExternalReader = BWTReader::createReader(externalItem.bwt_filename);
+    size_t num_strings_internal, num_symbols_internal;
+    size_t num_strings_external, num_symbols_external;
+    BWFlag flag;
+    pInternalReader->readHeader(num_strings_internal, num_symbols_internal, flag);
+    pExternalReader->readHeader(num_strings_external, num_symbols_external, flag);
+    assert(pGapArray->size() == num_symbols_internal + 1);
+
+    LexicoIndex internalSAI(internalItem.sai_filename);
+    LexicoIndex externalSAI(externalItem.sai_filename);
+    if(internalSAI.getSize() != num_strings_internal || externalSAI.getSize() != num_strings_external)
+    {
+        std::cerr << "Error: the suffix array index does not match the bwt of " << internalItem.sai_filename
+                  << " or " << externalItem.sai_filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+
+    size_t num_strings = num_strings_internal + num_strings_external;
+    size_t num_symbols = num_symbols_internal + num_symbols_external;
+    BWTWriterBinary bwtWriter(bwt_out);
+    bwtWriter.writeHeader(num_strings, num_symbols, BWF_NOFMI);
+    LexicoIndexWriter saiWriter(sai_out, num_strings);
+
+    size_t internal_sai_idx = 0;
+    size_t external_sai_idx = 0;
+    for(size_t i = 0; i <= num_symbols_internal; ++i)
+    {
+        size_t gap = pGapArray->get(i);
+        for(size_t j = 0; j < gap; ++j)
+        {
+            char b = pExternalReader->readBWChar();
+            bwtWriter.writeBWChar(b);
+            if(b == '$')
+                saiWriter.writeID(externalSAI.getID(external_sai_idx++) + num_strings_internal);
+        }
+
+        if(i < num_symbols_internal)
+        {
+            char b = pInternalReader->readBWChar();
+            bwtWriter.writeBWChar(b);
+            if(b == '$')
+                saiWriter.writeID(internalSAI.getID(internal_sai_idx++));
+        }
+    }
+    bwtWriter.finalize();
+
+    if(internal_sai_idx != num_strings_internal || external_sai_idx != num_strings_external)
+    {
+        std::cerr << "Error: the gap array does not account for every read of the merged indices\n";
+        exit(EXIT_FAILURE);
+    }
+
+    delete pInternalReader;
+    delete pExternalReader;
+}
@@ -0,0 +1,74 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// BWTDiskConstruction - Merge FM-indices that were built
+// independently into a single index without re-indexing
+// their reads. The suffixes of the reads of one index are
+// ranked against the other index, which is loaded in memory,
+// and the counts of those ranks (the gap array) tell how the
+// two BWTs and lexicographic indices interleave.
+//
+#ifndef BWTDISKCONSTRUCTION_H
+#define BWTDISKCONSTRUCTION_H
+
+#include "Util.h"
+#include "BWT.h"
+#include "GapArray.h"
+#include "SeqReader.h"
+#include "ReadTable.h"
+
+// The files of one of the indices being merged. The index holds
+// num_reads reads of reads_filename, starting at read start_index
+struct MergeItem
+{
+    MergeItem() : start_index(0), num_reads(-1) {}
+
+    std::string reads_filename;
+    size_t start_index;
+    size_t num_reads;
+    std::string bwt_filename;
+    std::string sai_filename;
+};
+
+// Parameters of the disk-based construction
+struct BWTDiskParameters
+{
+    std::string inFile;
+    std::string outPrefix;
+    std::string bwtExtension;
+    std::string saiExtension;
+
+    int numReadsPerBatch;
+    int numThreads;
+    int storageLevel;
+    bool doReverse;
+    bool bValidate;
+};
+
+// Construct the BWT and lexicographic index of the reads of parameters.inFile
+// without holding the suffix array of all of them. The suffix arrays of batches
+// of numReadsPerBatch reads are built in memory and the partial indices written
+// to disk are merged pairwise, through gap arrays, into the final index
+void buildBWTDisk(const BWTDiskParameters& parameters);
+
+// Count the rank of every suffix of the first n reads of pReader in pBWT.
+// The reads are appended to the index so their sentinels rank after those of pBWT
+void computeGapArray(SeqReader* pReader, size_t n, const BWT* pBWT, bool doReverse, int numThreads,
+                     GapArray* pGapArray, size_t& num_strings_read, size_t& num_symbols_read);
+
+// Merge the index of externalItem into the index of internalItem, writing the BWT
+// and lexicographic index of the union to bwt_out and sai_out. The reads of the external
+// index follow those of the internal index in the merged one. storageLevel is the
+// number of bits of the gap array counts
+void mergeIndependentIndices(const MergeItem& internalItem, const MergeItem& externalItem,
+                             const std::string& bwt_out, const std::string& sai_out,
+                             bool doReverse, int numThreads, int storageLevel);
+
+// Interleave the BWTs and lexicographic indices of the two items as given by the gap array
+void writeMergedIndex(const MergeItem& internalItem, const MergeItem& externalItem,
+                      const std::string& bwt_out, const std::string& sai_out,
+                      const GapArray* pGapArray);
+
+#endif
@@ -88,6 +88,7 @@ ErrorCorrectResult ErrorCorrectProcess::overlapCorrectionNew(const SequenceWorkI
 	ErrorCorrectResult result;
 	std::string current_sequence = workItem.read.seq.toString();
 	std::string consensus;
+	SearchBudget budget(m_params.searchBudget);
 
 	/**************************************************************************************/
 	int parameterThreshold = CorrectionThresholds::Instance().getRequiredSupport(0)-1;
@@ -252,7 +253,12 @@ ErrorCorrectResult ErrorCorrectProcess::overlapCorrectionNew(const SequenceWorkI
 																				threshold,
 																				m_params.indices,
 																				ErrorIdx,	//targetidx holds error idx
-																				kc); 
+																				kc,
+																				&budget); 
+
+		//The alignment is incomplete, keep the read as corrected so far
+		if(budget.isExceeded())
+			break;
 
 		bool last_round = (round == num_rounds - 1);
 		if(last_round)
@@ -278,6 +284,7 @@ ErrorCorrectResult ErrorCorrectProcess::overlapCorrectionNew(const SequenceWorkI
 		result.correctSequence = current_sequence;
 		result.overlapQC = true;
 	}
+	result.searchBudgetExceeded = budget.isExceeded();
 
 	return result;
 }
@@ -291,7 +298,8 @@ ErrorCorrectResult ErrorCorrectProcess::kmerCorrection(const SequenceWorkItem& w
 
 	ErrorCorrectResult result;
 
-	typedef std::map<std::string, int> KmerCountMap;
+	// The cache lives as long as the work item, in the arena of the thread
+	typedef std::map<std::string, int, std::less<std::string>, ArenaAllocator<std::pair<const std::string, int> > > KmerCountMap;
 	KmerCountMap kmerCache;
 
 	SeqRecord currRead = workItem.read;
@@ -342,24 +350,25 @@ ErrorCorrectResult ErrorCorrectProcess::kmerCorrection(const SequenceWorkItem& w
 		std::vector<int> countVector(nk, 0);
 		std::vector<int> solidVector(n, 0);
 
+		// Find the kmers that are not in the cache yet and look up
+		// their counts in the fm-index as a single batch
+		std::vector<std::string> uncachedKmers;
 		for(int i = 0; i < nk; ++i)
 		{
 			std::string kmer = readSequence.substr(i, m_params.kmerLength);
+			if(kmerCache.insert(std::make_pair(kmer, 0)).second)
+				uncachedKmers.push_back(kmer);
+		}
 
-			// First check if this kmer is in the cache
-			// If its not, find its count from the fm-index and cache it
-			int count = 0;
-			KmerCountMap::iterator iter = kmerCache.find(kmer);
+		std::vector<size_t> uncachedCounts;
+		BWTAlgorithms::countSequenceOccurrences(uncachedKmers, m_params.indices, uncachedCounts);
+		for(size_t j = 0; j < uncachedKmers.size(); ++j)
+			kmerCache[uncachedKmers[j]] = uncachedCounts[j];
 
-			if(iter != kmerCache.end())
-			{
-				count = iter->second;
-			}
-			else
-			{
-				count = BWTAlgorithms::countSequenceOccurrences(kmer, m_params.indices);
-				kmerCache.insert(std::make_pair(kmer, count));
-			}
+		for(int i = 0; i < nk; ++i)
+		{
+			std::string kmer = readSequence.substr(i, m_params.kmerLength);
+			int count = kmerCache[kmer];
 
 			// Get the phred score for the last base of the kmer
 			int phred = minPhredVector[i];
@@ -453,11 +462,17 @@ bool ErrorCorrectProcess::attemptHeteroCorrection(size_t i, size_t k_idx, size_t
 
 	bool isAnotherAlleleExisted=false;
 	
+	// Count the kmers for all possible bases at once
+	std::vector<std::string> alleleKmers(DNA_ALPHABET::size, kmer);
+	for(int j = 0; j < DNA_ALPHABET::size; ++j)
+		alleleKmers[j][base_idx] = ALPHABET[j];
+	std::vector<size_t> alleleCounts;
+	BWTAlgorithms::countSequenceOccurrences(alleleKmers, m_params.indices, alleleCounts);
+
 	for(int j = 0; j < DNA_ALPHABET::size; ++j)
 	{
 		char currBase = ALPHABET[j];
-		kmer[base_idx] = currBase;
-		size_t count = BWTAlgorithms::countSequenceOccurrences(kmer, m_params.indices);
+		size_t count = alleleCounts[j];
 		//size_t count = BWTAlgorithms::countSequenceOccurrencesSingleStrand(kmer, m_params.indices);
 
 		//Another allele must have kmer freq < avgCount and > minCount
@@ -499,13 +514,19 @@ bool ErrorCorrectProcess::attemptKmerCorrection(size_t i, size_t k_idx, size_t m
 	std::cout << "i: " << i << " k-idx: " << k_idx << " " << kmer << " " << reverseComplement(kmer) << "\n";
 #endif
 
+	// Count the kmers for all possible bases at once
+	std::vector<std::string> candidateKmers(DNA_ALPHABET::size, kmer);
+	for(int j = 0; j < DNA_ALPHABET::size; ++j)
+		candidateKmers[j][base_idx] = ALPHABET[j];
+	std::vector<size_t> candidateCounts;
+	BWTAlgorithms::countSequenceOccurrences(candidateKmers, m_params.indices, candidateCounts);
+
 	for(int j = 0; j < DNA_ALPHABET::size; ++j)
 	{
 		char currBase = ALPHABET[j];
 		// if(currBase == originalBase)
 			// continue;
-		kmer[base_idx] = currBase;
-		size_t count = BWTAlgorithms::countSequenceOccurrences(kmer, m_params.indices);
+		size_t count = candidateCounts[j];
 		//size_t count = BWTAlgorithms::countSequenceOccurrencesSingleStrand(kmer, m_params.indices);
 
 // #if KMER_TESTING
@@ -587,7 +608,6 @@ void ErrorCorrectPostProcess::writeMetrics(std::ostream* pWriter)
 //
 void ErrorCorrectPostProcess::process(const SequenceWorkItem& item, const ErrorCorrectResult& result)
 {
-
 	// Determine if the read should be discarded
 	bool readQCPass = true;
 	if(result.kmerQC)
@@ -57,6 +57,9 @@ struct ErrorCorrectParameters
     int conflictCutoff;
     int depthFilter;
 
+    // The LF-mapping steps the overlap correction of a read may take, 0 is unlimited
+    size_t searchBudget;
+
     // k-mer based corrector params
     int numKmerRounds;
     int kmerLength;
@@ -74,7 +77,7 @@ class ErrorCorrectResult
     public:
         ErrorCorrectResult()
 		: num_prefix_overlaps(0), num_suffix_overlaps(0)
-		, kmerQC(false), overlapQC(false),kmerize(false),kmerize2(false),merge(false) {}
+		, kmerQC(false), overlapQC(false),kmerize(false),kmerize2(false),merge(false),searchBudgetExceeded(false) {}
 
         DNAString correctSequence;
 		DNAString correctSequence2;
@@ -90,6 +93,7 @@ class ErrorCorrectResult
 		bool kmerize;
 		bool kmerize2;
 		bool merge;
+		bool searchBudgetExceeded;
 
 		//std::vector<size_t> split ;
 
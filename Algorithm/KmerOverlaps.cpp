@@ -22,9 +22,10 @@ MultipleAlignment KmerOverlaps::buildMultipleAlignment(const std::string& query,
                                                        int kmerThreshod,
                                                        const BWTIndexSet& indices,
                                                        size_t erroridx,
-													   KmerContext& kc)
+													   KmerContext& kc,
+                                                       SearchBudget* pBudget)
 {
-    SequenceOverlapPairVector overlap_vector = retrieveMatches(query, k, min_overlap, min_identity, kmerThreshod, indices, erroridx,kc);
+    SequenceOverlapPairVector overlap_vector = retrieveMatches(query, k, min_overlap, min_identity, kmerThreshod, indices, erroridx,kc, pBudget);
     MultipleAlignment multiple_alignment;
     multiple_alignment.addBaseSequence("query", query, "");
     for(size_t i = 0; i < overlap_vector.size(); ++i)
@@ -73,7 +74,8 @@ SequenceOverlapPairVector KmerOverlaps::retrieveMatches(const std::string& query
                                                         int kmerThreshold,
                                                         const BWTIndexSet& indices,
                                                         size_t erroridx,
-														KmerContext& /*kc*/)
+														KmerContext& /*kc*/,
+                                                        SearchBudget* pBudget)
 {
     PROFILE_FUNC("KmerOverlaps::retrieveMatches")
     assert(indices.pBWT != NULL);
@@ -103,6 +105,10 @@ SequenceOverlapPairVector KmerOverlaps::retrieveMatches(const std::string& query
     size_t i=erroridx;	//erroridx is not always precise, shift left 5bp for safety
     for(; i < num_kmers; i++)
     {
+        // Each lookup takes k LF-mapping steps on each strand
+        if(pBudget != NULL && !pBudget->spend(2 * k))
+            break;
+
 		std::string kmer = query.substr(i, k);
 		BWTInterval interval = BWTAlgorithms::findInterval(indices, kmer);
 
@@ -133,10 +139,13 @@ SequenceOverlapPairVector KmerOverlaps::retrieveMatches(const std::string& query
 
     // Backtrack through the kmer indices to turn them into read indices.
     // This mirrors the calcSA function in SampledSuffixArray except we mark each entry
-    // as visited once it is processed.
+    // as visited once it is processed. The backtrack stops early at a sampled entry.
     KmerMatchSet matches;
     for(KmerMatchMap::iterator iter = prematchMap.begin(); iter != prematchMap.end(); ++iter)
     {
+        if(pBudget != NULL && pBudget->isExceeded())
+            break;
+
         // This index has been visited
         if(iter->second)
             continue;
@@ -148,8 +157,18 @@ SequenceOverlapPairVector KmerOverlaps::retrieveMatches(const std::string& query
         KmerMatch out_match = iter->first;
         while(1)
         {
+            SAElem elem;
+            if(indices.pSSA->getSample(out_match.index, elem))
+            {
+                out_match.index = elem.getID();
+                matches.insert(out_match);
+                break;
+            }
+
             char b = indices.pBWT->getChar(out_match.index);
             out_match.index = indices.pBWT->getPC(b) + indices.pBWT->getOcc(b, out_match.index - 1);
+            if(pBudget != NULL && !pBudget->spend(1))
+                break;
 
             // Check if the hash indicates we have visited this index. If so, stop the backtrack
             KmerMatchMap::iterator find_iter = prematchMap.find(out_match);
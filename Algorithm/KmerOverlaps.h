@@ -13,6 +13,7 @@
 #include "multiple_alignment.h"
 #include "BWTIndexSet.h"
 #include "SampledSuffixArray.h"
+#include "SearchBudget.h"
 
 // A pair of sequences and an overlap matching them
 struct SequenceOverlapPair
@@ -35,19 +36,22 @@ MultipleAlignment buildMultipleAlignment(const std::string& query,
                                          int min_overlap,
                                          double min_identity,
                                          int kmerThreshod,
-                                         const BWTIndexSet& indices,
+                                         const BWTIndexSet& indices,
                                          size_t erroridx,
-										 KmerContext& kc);
+										 KmerContext& kc,
+                                         SearchBudget* pBudget = NULL);
 
-// Retrieve matches to the query sequence
+// Retrieve matches to the query sequence. The LF-mapping steps of the search
+// are counted against pBudget, if given, and the search stops once it is exceeded
 SequenceOverlapPairVector retrieveMatches(const std::string& query,
                                           size_t k,
                                           int min_overlap,
                                           double min_identity,
                                           int bandwidth,
-                                          const BWTIndexSet& indices,
+                                          const BWTIndexSet& indices,
                                           size_t erroridx,
-										  KmerContext& kc);
+										  KmerContext& kc,
+                                          SearchBudget* pBudget = NULL);
 
 SequenceOverlapPairVector approximateMatch(const std::string& query,
                                            int min_overlap,
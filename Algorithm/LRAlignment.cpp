@@ -483,8 +483,8 @@ void initializeDAWGHash(BWT* pQueryBWT, LRHash& hashTable)
         stack.pop();
 
         BWTInterval interval(x >> 32, (uint32_t)x);
-        AlphaCount64 lower = pQueryBWT->getFullOcc(interval.lower - 1);
-        AlphaCount64 upper = pQueryBWT->getFullOcc(interval.upper);
+        AlphaCount64 lower, upper;
+        pQueryBWT->getFullOccPair(interval.lower - 1, interval.upper, lower, upper);
         for(int ci = 0; ci < DNA_ALPHABET::size; ++ci)
         {
             char b = DNA_ALPHABET::getBase(ci);    
@@ -17,21 +17,21 @@ static const AlignFlags preSufAF(true, true, false);
 //#define DEBUGOVERLAP 1
 
 // Perform the overlap
-OverlapResult OverlapAlgorithm::overlapRead(const SeqRecord& read, int minOverlap, OverlapBlockList* pOutList) const
+OverlapResult OverlapAlgorithm::overlapRead(const SeqRecord& read, int minOverlap, OverlapBlockList* pOutList, SearchBudget* pBudget) const
 {
     OverlapResult r;
     if(static_cast<int>(read.seq.length()) < minOverlap)
         return r;
 
     if(!m_exactModeOverlap)
-        r = overlapReadInexact(read, minOverlap, pOutList);
+        r = overlapReadInexact(read, minOverlap, pOutList, pBudget);
     else
         r = overlapReadExact(read, minOverlap, pOutList);
     return r;
 }
 
 //
-OverlapResult OverlapAlgorithm::overlapReadInexact(const SeqRecord& read, int minOverlap, OverlapBlockList* pOBOut) const
+OverlapResult OverlapAlgorithm::overlapReadInexact(const SeqRecord& read, int minOverlap, OverlapBlockList* pOBOut, SearchBudget* pBudget) const
 {
     OverlapResult result;
     OverlapBlockList obWorkingList;
@@ -47,11 +47,11 @@ OverlapResult OverlapAlgorithm::overlapReadInexact(const SeqRecord& read, int mi
     // case we dont run any of the subsequent commands and return no overlaps.
     bool valid = true;
     valid = findOverlapBlocksInexact(seq, m_pBWT, m_pRevBWT, sufPreAF, 
-                                     minOverlap, &obWorkingList, pOBOut, result);
+                                     minOverlap, &obWorkingList, pOBOut, result, pBudget);
 
     if(valid)
         valid = findOverlapBlocksInexact(complement(seq), m_pRevBWT, m_pBWT, prePreAF, 
-                                         minOverlap, &obWorkingList, pOBOut, result);
+                                         minOverlap, &obWorkingList, pOBOut, result, pBudget);
 
     if(valid)
     {
@@ -73,10 +73,10 @@ OverlapResult OverlapAlgorithm::overlapReadInexact(const SeqRecord& read, int mi
 
     // Match the prefix of seq to suffixes
     if(valid)
-        valid = findOverlapBlocksInexact(reverseComplement(seq), m_pBWT, m_pRevBWT, sufSufAF, minOverlap, &obWorkingList, pOBOut, result);
+        valid = findOverlapBlocksInexact(reverseComplement(seq), m_pBWT, m_pRevBWT, sufSufAF, minOverlap, &obWorkingList, pOBOut, result, pBudget);
     
     if(valid)
-        valid = findOverlapBlocksInexact(reverse(seq), m_pRevBWT, m_pBWT, preSufAF, minOverlap, &obWorkingList, pOBOut, result);
+        valid = findOverlapBlocksInexact(reverse(seq), m_pRevBWT, m_pBWT, preSufAF, minOverlap, &obWorkingList, pOBOut, result, pBudget);
 
     if(valid)
     {
@@ -97,6 +97,7 @@ OverlapResult OverlapAlgorithm::overlapReadInexact(const SeqRecord& read, int mi
         pOBOut->clear();
         result.isSubstring = false;
         result.searchAborted = true;
+        result.searchBudgetExceeded = pBudget != NULL && pBudget->isExceeded();
         return result;
     }
 
@@ -376,7 +377,7 @@ void OverlapAlgorithm::findOverlapBlocksExact(const std::string& w, const BWT* p
 bool OverlapAlgorithm::findOverlapBlocksInexact(const std::string& w, const BWT* pBWT, 
                                                 const BWT* pRevBWT, const AlignFlags& af, int minOverlap,
                                                 OverlapBlockList* pOverlapList, OverlapBlockList* pContainList, 
-                                                OverlapResult& result) const
+                                                OverlapResult& result, SearchBudget* pBudget) const
 {
     int len = w.length();
     int overlap_region_left = len - minOverlap;
@@ -416,6 +417,13 @@ bool OverlapAlgorithm::findOverlapBlocksInexact(const std::string& w, const BWT*
             break;
         }
 
+        // Each seed takes one LF-mapping step
+        if(pBudget != NULL && !pBudget->spend(pCurrVector->size()))
+        {
+            fail = true;
+            break;
+        }
+
         iter = pCurrVector->begin();
         while(iter != pCurrVector->end())
         {
@@ -688,8 +696,8 @@ void OverlapAlgorithm::extendSeedInexactRight(SearchSeed& seed, const std::strin
     {
         // Calculating the AlphaCounts is the heavy part of the computation so we cache
         // the value outside the loop, it is the same for all bases
-        AlphaCount64 lower = pRevBWT->getFullOcc(seed.ranges.interval[1].lower - 1);
-        AlphaCount64 upper = pRevBWT->getFullOcc(seed.ranges.interval[1].upper);
+        AlphaCount64 lower, upper;
+        pRevBWT->getFullOccPair(seed.ranges.interval[1].lower - 1, seed.ranges.interval[1].upper, lower, upper);
         for(int i = 0; i < 4; ++i)
         {
             char b = ALPHABET[i];    
@@ -731,8 +739,8 @@ void OverlapAlgorithm::extendSeedInexactLeft(SearchSeed& seed, const std::string
         {
             // Calculating the AlphaCounts is the heavy part of the computation so we cache
             // the value outside the loop, it is the same for all bases
-            AlphaCount64 lower = pBWT->getFullOcc(seed.ranges.interval[0].lower - 1);
-            AlphaCount64 upper = pBWT->getFullOcc(seed.ranges.interval[0].upper);
+            AlphaCount64 lower, upper;
+            pBWT->getFullOccPair(seed.ranges.interval[0].lower - 1, seed.ranges.interval[0].upper, lower, upper);
             for(int i = 0; i < 4; ++i)
             {
                 char b = ALPHABET[i];
@@ -11,10 +11,12 @@
 #define OVERLAPALGORITHM_H
 
 #include "BWT.h"
+#include "LexicoIndex.h"
 #include "OverlapBlock.h"
 #include "SearchSeed.h"
 #include "BWTAlgorithms.h"
 #include "Util.h"
+#include "SearchBudget.h"
 
 enum OverlapMode
 {
@@ -24,9 +26,10 @@ enum OverlapMode
 
 struct OverlapResult
 {
-    OverlapResult() : isSubstring(false), searchAborted(false) {}
+    OverlapResult() : isSubstring(false), searchAborted(false), searchBudgetExceeded(false) {}
     bool isSubstring;
     bool searchAborted;
+    bool searchBudgetExceeded;
 };
 
 class OverlapAlgorithm
@@ -35,7 +38,7 @@ class OverlapAlgorithm
 		
 		//exact overlap constructor
         OverlapAlgorithm(const BWT* pBWT, const BWT* pRevBWT,
-                         SuffixArray* pFwdSAI, SuffixArray* pRevSAI,
+                         LexicoIndex* pFwdSAI, LexicoIndex* pRevSAI,
 						 ReadInfoTable* pQueryRIT,ReadInfoTable* pTargetRIT) : 
 										m_pBWT(pBWT), 
                                         m_pRevBWT(pRevBWT),
@@ -77,7 +80,9 @@ class OverlapAlgorithm
 		
         // Perform the overlap
         // This function is threaded so everything must be const
-        OverlapResult overlapRead(const SeqRecord& read, int minOverlap, OverlapBlockList* pOutList) const;
+        // The inexact search counts its seed extensions against pBudget, if given,
+        // and is aborted once the budget is exceeded
+        OverlapResult overlapRead(const SeqRecord& read, int minOverlap, OverlapBlockList* pOutList, SearchBudget* pBudget = NULL) const;
     
         // Perform an irreducible overlap
         OverlapResult overlapReadExact(const SeqRecord& read, int minOverlap, OverlapBlockList* pOBOut) const;
@@ -86,7 +91,7 @@ class OverlapAlgorithm
         OverlapResult alignReadDuplicate(const SeqRecord& read, OverlapBlockList* pOBOut) const;
 
         // Perform an inexact overlap
-        OverlapResult overlapReadInexact(const SeqRecord& read, int minOverlap, OverlapBlockList* pOBOut) const;
+        OverlapResult overlapReadInexact(const SeqRecord& read, int minOverlap, OverlapBlockList* pOBOut, SearchBudget* pBudget = NULL) const;
 
         // Write the result of an overlap to an ASQG file
         void writeResultASQG(std::ostream& writer, const SeqRecord& read, const OverlapResult& result) const;
@@ -104,8 +109,8 @@ class OverlapAlgorithm
         //
         const BWT* getBWT() const { return m_pBWT; }
         const BWT* getRBWT() const { return m_pRevBWT; }
-        const SuffixArray* getFwdSAI() const { return m_pFwdSAI; }
-        const SuffixArray* getRevSAI() const { return m_pRevSAI; }
+        const LexicoIndex* getFwdSAI() const { return m_pFwdSAI; }
+        const LexicoIndex* getRevSAI() const { return m_pRevSAI; }
         const ReadInfoTable* getQueryRIT() const { return m_pQueryRIT; }
         const ReadInfoTable* getTargetRIT() const { return m_pTargetRIT; }
 		bool isSuperRepeatVertex(std::string vstr) const { 
@@ -130,7 +135,7 @@ class OverlapAlgorithm
         // Same as above while allowing mismatches
         bool findOverlapBlocksInexact(const std::string& w, const BWT* pBWT, const BWT* pRevBWT, 
                                       const AlignFlags& af, const int minOverlap, OverlapBlockList* pOBList, 
-                                      OverlapBlockList* pOBFinal, OverlapResult& result) const;
+                                      OverlapBlockList* pOBFinal, OverlapResult& result, SearchBudget* pBudget = NULL) const;
 
 		bool TrimOBLInterval(OverlapBlockList* pOverlapList, int MaxInterval) const;
 
@@ -210,8 +215,8 @@ class OverlapAlgorithm
 		//
         
 		//Direct ASQG Write
-		SuffixArray* m_pFwdSAI; 
-		SuffixArray* m_pRevSAI;
+		LexicoIndex* m_pFwdSAI; 
+		LexicoIndex* m_pRevSAI;
 		ReadInfoTable* m_pQueryRIT;
 		ReadInfoTable* m_pTargetRIT;
 
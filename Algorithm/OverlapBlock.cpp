@@ -120,7 +120,7 @@ EdgeDir OverlapBlock::getEdgeDir() const
 }
 
 //
-Overlap OverlapBlock::toOverlap(const std::string queryID, const std::string targetID, int queryLen, int targetLen) const
+Overlap OverlapBlock::toOverlap(const std::string& queryID, const std::string& targetID, int queryLen, int targetLen) const
 {
     // Compute the sequence coordinates
     int s1 = queryLen - overlapLen;
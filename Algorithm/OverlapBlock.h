@@ -18,6 +18,7 @@
 #include "SearchHistory.h"
 #include "GraphCommon.h"
 #include "MultiOverlap.h"
+#include "ThreadArena.h"
 
 // Flags indicating how a given read was aligned to the FM-index
 // Used for internal bookkeeping
@@ -130,7 +131,7 @@ struct OverlapBlock
     EdgeDir getEdgeDir() const;
 
     // Construct an overlap record from this overlap block
-    Overlap toOverlap(const std::string queryID, const std::string targetID, int queryLen, int targetLen) const;
+    Overlap toOverlap(const std::string& queryID, const std::string& targetID, int queryLen, int targetLen) const;
 
     // Construct an ID string describing this overlap block
     std::string toCanonicalID() const;
@@ -189,7 +190,7 @@ struct OverlapBlock
 };
 
 // Collections
-typedef std::list<OverlapBlock> OverlapBlockList;
+typedef std::list<OverlapBlock, ArenaAllocator<OverlapBlock> > OverlapBlockList;
 typedef OverlapBlockList::iterator OBLIter;
 
 // Global Functions
@@ -327,13 +327,19 @@ bool QCProcess::performHomopolymerCheck(const SequenceWorkItem& item)
         if(prefix.size() < m_params.hpMinContext || suffix.size() < m_params.hpMinContext)
             return true;
 
+        // Count the k-mers for all the run lengths in one batch
+        StringVector composites;
+        for(size_t l = maxRunLength - 2; l <= maxRunLength + 2; ++l)
+            composites.push_back(prefix + std::string(l, runChar) + suffix);
+        std::vector<size_t> compositeCounts;
+        BWTAlgorithms::countSequenceOccurrences(composites, m_params.pBWT, compositeCounts);
+
         size_t highestCountLength = 0;
         size_t highestCount = 0;
         size_t actualCount = 0;
         for(size_t l = maxRunLength - 2; l <= maxRunLength + 2; ++l)
         {
-            std::string composite = prefix + std::string(l, runChar) + suffix;
-            size_t count = BWTAlgorithms::countSequenceOccurrences(composite, m_params.pBWT);
+            size_t count = compositeCounts[l - (maxRunLength - 2)];
             if(l == maxRunLength)
                 actualCount = count;
 
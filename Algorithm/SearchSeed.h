@@ -14,6 +14,7 @@
 #include <list>
 #include "BWTInterval.h"
 #include "SearchHistory.h"
+#include "ThreadArena.h"
 
 // types
 enum ExtendDirection
@@ -87,7 +88,7 @@ struct SearchSeed
 };
 
 // Collections
-typedef std::vector<SearchSeed> SearchSeedVector;
-typedef std::queue<SearchSeed> SearchSeedQueue;
+typedef std::vector<SearchSeed, ArenaAllocator<SearchSeed> > SearchSeedVector;
+typedef std::queue<SearchSeed, std::deque<SearchSeed, ArenaAllocator<SearchSeed> > > SearchSeedQueue;
 
 #endif
@@ -11,6 +11,14 @@
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <limits>
+#include <algorithm>
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 #include "Bigraph.h"
 #include "Timer.h"
 #include "ASQG.h"
@@ -18,11 +26,17 @@
 //
 //
 //
-Bigraph::Bigraph() : m_hasContainment(false), m_hasTransitive(false), m_isExactMode(false), m_minOverlap(0), m_errorRate(0.0f)
+Bigraph::Bigraph() : m_numVertices(0), m_isIntegerIDMode(false), m_hasNameIndex(true), m_hasContainment(false), m_hasTransitive(false), 
+                     m_isExactMode(false), m_minOverlap(0), m_errorRate(0.0f)
 {
+	omp_init_lock(&m_vertexVecLock);
+	m_vertexLocks.resize(NUM_VERTEX_LOCKS);
+	for(size_t i = 0; i < NUM_VERTEX_LOCKS; ++i)
+		omp_init_lock(&m_vertexLocks[i]);
+
 	// Set up the memory pools for the graph
-	m_pEdgeAllocator = new SimpleAllocator<Edge>();
-	m_pVertexAllocator = new SimpleAllocator<Vertex>();
+	m_pEdgeAllocator = new SlabAllocator<Edge>();
+	m_pVertexAllocator = new SlabAllocator<Vertex>();
 
 	m_vertices.set_deleted_key("");
 	//WARN_ONCE("HARDCODED HASH TABLE MAX SIZE: 200000000");
@@ -34,12 +48,14 @@ Bigraph::Bigraph() : m_hasContainment(false), m_hasTransitive(false), m_isExactM
 //
 Bigraph::~Bigraph()
 {
-	VertexPtrMap::iterator iter = m_vertices.begin();
-	for(; iter != m_vertices.end(); ++iter)
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
 	{
-		delete iter->second;
-		iter->second = NULL;
+		delete m_vertexVec[i];
+		m_vertexVec[i] = NULL;
 	}
+	omp_destroy_lock(&m_vertexVecLock);
+	for(size_t i = 0; i < NUM_VERTEX_LOCKS; ++i)
+		omp_destroy_lock(&m_vertexLocks[i]);
 
 	// Clean up the memory pools
 	delete m_pEdgeAllocator;
@@ -51,15 +67,40 @@ Bigraph::~Bigraph()
 //
 void Bigraph::addVertex(Vertex* pVert)
 {
-	std::pair<VertexPtrMapIter, bool> result =
-	m_vertices.insert(std::make_pair(pVert->getID(), pVert));
-	if(!result.second)
+	if(m_hasNameIndex)
+	{
+		std::pair<VertexPtrMapIter, bool> result =
+		m_vertices.insert(std::make_pair(pVert->getID(), pVert));
+		if(!result.second)
+		{
+			std::cerr << "Error: Attempted to insert vertex into graph with a duplicate id: " <<
+			pVert->getID() << "\n";
+			std::cerr << "All reads must have a unique identifier\n";
+			exit(1);
+		}
+	}
+
+	omp_set_lock(&m_vertexVecLock);
+	if(m_vertexVec.size() > std::numeric_limits<uint32_t>::max())
 	{
-		std::cerr << "Error: Attempted to insert vertex into graph with a duplicate id: " <<
-		pVert->getID() << "\n";
-		std::cerr << "All reads must have a unique identifier\n";
+		std::cerr << "Error: the graph cannot hold more than " << std::numeric_limits<uint32_t>::max() << " vertices\n";
 		exit(1);
 	}
+	pVert->setIndex(m_vertexVec.size());
+	m_vertexVec.push_back(pVert);
+	++m_numVertices;
+	omp_unset_lock(&m_vertexVecLock);
+}
+
+// Free the slot of a vertex that is being removed
+void Bigraph::releaseVertex(Vertex* pVertex)
+{
+	if(m_hasNameIndex)
+		m_vertices.erase(pVertex->getID());
+	m_vertexVec[pVertex->getIndex()] = NULL;
+
+	#pragma omp atomic
+	--m_numVertices;
 }
 
 //
@@ -70,9 +111,8 @@ void Bigraph::removeIslandVertex(Vertex* pVertex)
 	assert(pVertex->countEdges() == 0);
 
 	// Remove the vertex from the collection
-	VertexID id = pVertex->getID();
+	releaseVertex(pVertex);
 	delete pVertex;
-	m_vertices.erase(id);
 }
 
 //
@@ -84,9 +124,8 @@ void Bigraph::removeConnectedVertex(Vertex* pVertex)
 	pVertex->deleteEdges();
 
 	// Remove the vertex from the collection
-	VertexID id = pVertex->getID();
+	releaseVertex(pVertex);
 	delete pVertex;
-	m_vertices.erase(id);
 }
 
 
@@ -95,8 +134,7 @@ void Bigraph::removeConnectedVertex(Vertex* pVertex)
 //
 bool Bigraph::hasVertex(VertexID id)
 {
-	VertexPtrMapIter iter = m_vertices.find(id);
-	return iter != m_vertices.end();
+	return getVertex(id) != NULL;
 }
 
 //
@@ -104,12 +142,47 @@ bool Bigraph::hasVertex(VertexID id)
 //
 Vertex* Bigraph::getVertex(VertexID id) const
 {
+	if(!m_hasNameIndex)
+		indexNames();
+
 	VertexPtrMapConstIter iter = m_vertices.find(id);
 	if(iter == m_vertices.end())
 	return NULL;
 	return iter->second;
 }
 
+// Index the vertices by name. In integer ID mode this is only done
+// once some vertex is looked up by name
+void Bigraph::indexNames() const
+{
+	#pragma omp critical(BigraphIndexNames)
+	{
+		if(!m_hasNameIndex)
+		{
+			for(size_t i = 0; i < m_vertexVec.size(); ++i)
+			{
+				if(m_vertexVec[i] != NULL)
+					m_vertices.insert(std::make_pair(m_vertexVec[i]->getID(), m_vertexVec[i]));
+			}
+			m_hasNameIndex = true;
+		}
+	}
+}
+
+//
+void Bigraph::setIntegerIDMode(bool b)
+{
+	assert(m_vertexVec.empty());
+	m_isIntegerIDMode = b;
+	m_hasNameIndex = !b;
+}
+
+//
+bool Bigraph::isIntegerIDMode() const
+{
+	return m_isIntegerIDMode;
+}
+
 //
 // Add an edge
 //
@@ -423,17 +496,13 @@ Vertex* Bigraph::buildVertex (EdgePtrVec & pathEdges,std::string vertexName)
 int Bigraph::sweepVertices(GraphColor c)
 {
 	int numRemoved = 0;
-	VertexPtrMapIter iter = m_vertices.begin();
-	while(iter != m_vertices.end())
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
 	{
-		VertexPtrMapIter next = iter;
-		++next;
-		if(iter->second->getColor() == c)
+		if(m_vertexVec[i] != NULL && m_vertexVec[i]->getColor() == c)
 		{
-			removeConnectedVertex(iter->second);
+			removeConnectedVertex(m_vertexVec[i]);
 			++numRemoved;
 		}
-		iter = next;
 	}
 	return numRemoved;
 }
@@ -443,8 +512,11 @@ int Bigraph::sweepVertices(GraphColor c)
 int Bigraph::sweepEdges(GraphColor c)
 {
 	int numRemoved = 0;
-	for(VertexPtrMapIter iter = m_vertices.begin(); iter != m_vertices.end(); ++iter)
-	numRemoved += iter->second->sweepEdges(c);
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
+	{
+		if(m_vertexVec[i] != NULL)
+			numRemoved += m_vertexVec[i]->sweepEdges(c);
+	}
 	return numRemoved;
 }
 
@@ -455,13 +527,12 @@ void Bigraph::simplify()
 	size_t mergeCount = 0 ;
 	
 	//Linear time implementation by YTH
-	VertexPtrMapIter iter = m_vertices.begin();
-
-	while(iter != m_vertices.end())
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
 	{
-		mergeCount += simplify(iter->second, ED_SENSE);
-		mergeCount += simplify(iter->second, ED_ANTISENSE);
-		++iter;
+		if(m_vertexVec[i] == NULL)
+			continue;
+		mergeCount += simplify(m_vertexVec[i], ED_SENSE);
+		mergeCount += simplify(m_vertexVec[i], ED_ANTISENSE);
 	}
 	
 	if(mergeCount>0)
@@ -568,26 +639,23 @@ void Bigraph::statsOverlapRatio(Vertex* pV1, Edge* pEdge)
 void Bigraph::renameVertices(const std::string& prefix)
 {
 	size_t currIdx = 0;
-	size_t numVertices = m_vertices.size();
-	std::vector<Vertex*> vertexPtrVec(numVertices, 0);
-
-	VertexPtrMapIter iter = m_vertices.begin();
-	while(iter != m_vertices.end())
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
 	{
+		if(m_vertexVec[i] == NULL)
+			continue;
 		std::stringstream ss;
 		ss << prefix << currIdx;
-		iter->second->setID(ss.str());
-		vertexPtrVec[currIdx] = iter->second;
-		++iter;
+		m_vertexVec[i]->setID(ss.str());
 		++currIdx;
 	}
 
-	// Clear the old graph
+	// Re-index the new names
 	m_vertices.clear();
-
-	// Re-add the vertices
-	for(size_t i = 0; i < numVertices; ++i)
-	addVertex(vertexPtrVec[i]);
+	if(m_hasNameIndex)
+	{
+		m_hasNameIndex = false;
+		indexNames();
+	}
 }
 
 //
@@ -595,9 +663,11 @@ void Bigraph::renameVertices(const std::string& prefix)
 //
 void Bigraph::sortVertexAdjListsByMatchLen()
 {
-	VertexPtrMapIter iter = m_vertices.begin();
-	for(; iter != m_vertices.end(); ++iter)
-	iter->second->sortAdjListByMatchLen();
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
+	{
+		if(m_vertexVec[i] != NULL)
+			m_vertexVec[i]->sortAdjListByMatchLen();
+	}
 }
 
 
@@ -606,9 +676,11 @@ void Bigraph::sortVertexAdjListsByMatchLen()
 //
 void Bigraph::sortVertexAdjListsByLen()
 {
-	VertexPtrMapIter iter = m_vertices.begin();
-	for(; iter != m_vertices.end(); ++iter)
-	iter->second->sortAdjListByLen();
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
+	{
+		if(m_vertexVec[i] != NULL)
+			m_vertexVec[i]->sortAdjListByLen();
+	}
 }
 
 
@@ -617,9 +689,11 @@ void Bigraph::sortVertexAdjListsByLen()
 //
 void Bigraph::sortVertexAdjListsByID()
 {
-	VertexPtrMapIter iter = m_vertices.begin();
-	for(; iter != m_vertices.end(); ++iter)
-	iter->second->sortAdjListByID();
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
+	{
+		if(m_vertexVec[i] != NULL)
+			m_vertexVec[i]->sortAdjListByID();
+	}
 }
 
 
@@ -629,10 +703,10 @@ void Bigraph::sortVertexAdjListsByID()
 //
 void Bigraph::validate()
 {
-	VertexPtrMapIter iter = m_vertices.begin();
-	for(; iter != m_vertices.end(); ++iter)
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
 	{
-		iter->second->validate();
+		if(m_vertexVec[i] != NULL)
+			m_vertexVec[i]->validate();
 	}
 }
 
@@ -673,14 +747,15 @@ void Bigraph::flip(VertexID /*id*/)
 VertexIDVec Bigraph::getNonBranchingVertices() const
 {
 	VertexIDVec out;
-	VertexPtrMapConstIter iter = m_vertices.begin();
-	for(; iter != m_vertices.end(); ++iter)
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
 	{
-		int senseEdges = iter->second->countEdges(ED_SENSE);
-		int antisenseEdges = iter->second->countEdges(ED_ANTISENSE);
+		if(m_vertexVec[i] == NULL)
+			continue;
+		int senseEdges = m_vertexVec[i]->countEdges(ED_SENSE);
+		int antisenseEdges = m_vertexVec[i]->countEdges(ED_ANTISENSE);
 		if(antisenseEdges <= 1 && senseEdges <= 1)
 		{
-			out.push_back(iter->second->getID());
+			out.push_back(m_vertexVec[i]->getID());
 		}
 	}
 	return out;
@@ -695,13 +770,12 @@ PathVector Bigraph::getLinearComponents()
 {
 	PathVector outPaths;
 	setColors(GC_WHITE);
-	VertexPtrMapIter iter = m_vertices.begin();
-	for(; iter != m_vertices.end(); ++iter)
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
 	{
 		// Output the linear path containing this vertex if it hasnt been visited already
-		if(iter->second->getColor() != GC_BLACK)
+		if(m_vertexVec[i] != NULL && m_vertexVec[i]->getColor() != GC_BLACK)
 		{
-			outPaths.push_back(constructLinearPath(iter->second->getID()));
+			outPaths.push_back(constructLinearPath(m_vertexVec[i]->getID()));
 		}
 	}
 	assert(checkColors(GC_BLACK));
@@ -762,19 +836,24 @@ Path Bigraph::reversePath(const Path& path)
 //
 Vertex* Bigraph::getFirstVertex() const
 {
-	if(m_vertices.empty())
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
+	{
+		if(m_vertexVec[i] != NULL)
+			return m_vertexVec[i];
+	}
 	return NULL;
-	else
-	return m_vertices.begin()->second;
 }
 
 // Returns a vector of pointers to the vertices
 VertexPtrVec Bigraph::getAllVertices() const
 {
 	VertexPtrVec out;
-	VertexPtrMapConstIter iter = m_vertices.begin();
-	for(; iter != m_vertices.end(); ++iter)
-	out.push_back(iter->second);
+	out.reserve(m_numVertices);
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
+	{
+		if(m_vertexVec[i] != NULL)
+			out.push_back(m_vertexVec[i]);
+	}
 	return out;
 }
 
@@ -782,9 +861,11 @@ VertexPtrVec Bigraph::getAllVertices() const
 // Append vertex sequences to the vector
 void Bigraph::getVertexSequences(std::vector<std::string>& outSequences) const
 {
-	VertexPtrMapConstIter iter = m_vertices.begin();
-	for(; iter != m_vertices.end(); ++iter)
-	outSequences.push_back(iter->second->getSeq().toString());
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
+	{
+		if(m_vertexVec[i] != NULL)
+			outSequences.push_back(m_vertexVec[i]->getSeq().toString());
+	}
 }
 
 //
@@ -792,27 +873,24 @@ void Bigraph::getVertexSequences(std::vector<std::string>& outSequences) const
 //
 void Bigraph::setColors(GraphColor c)
 {
-	VertexPtrMapIter iter = m_vertices.begin();
-	for(; iter != m_vertices.end(); ++iter)
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
 	{
-		iter->second->setColor(c);
-		iter->second->setEdgeColors(c);
+		if(m_vertexVec[i] == NULL)
+			continue;
+		m_vertexVec[i]->setColor(c);
+		m_vertexVec[i]->setEdgeColors(c);
 	}
 }
 
 void Bigraph::setColorsP(GraphColor c)
 {
-	VertexPtrMapIter iter = m_vertices.begin();
-	#pragma omp parallel private (iter)
+	#pragma omp parallel for
+	for(int64_t i = 0; i < (int64_t)m_vertexVec.size(); ++i)
 	{
-		for(; iter != m_vertices.end(); ++iter)
-		{
-			#pragma omp single nowait
-			{
-				iter->second->setColor(c);
-				iter->second->setEdgeColors(c);
-			}
-		}
+		if(m_vertexVec[i] == NULL)
+			continue;
+		m_vertexVec[i]->setColor(c);
+		m_vertexVec[i]->setEdgeColors(c);
 	}
 }
 
@@ -821,8 +899,11 @@ void Bigraph::setColorsP(GraphColor c)
 //
 void Bigraph::setVerticesColor(GraphColor c)
 {
-	VertexPtrMapIter iter = m_vertices.begin();
-	for(; iter != m_vertices.end(); ++iter) iter->second->setColor(c);
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
+	{
+		if(m_vertexVec[i] != NULL)
+			m_vertexVec[i]->setColor(c);
+	}
 }
 
 //
@@ -831,14 +912,15 @@ void Bigraph::setVerticesColor(GraphColor c)
 void Bigraph::setStraightVerticesColor(GraphColor straightColor,GraphColor branchColor , GraphColor deadColor )
 {
 	assert (straightColor!=GC_WHITE && straightColor != GC_BLACK);
-	VertexPtrMapIter iter = m_vertices.begin();
 	int num_straight = 0 ;
 	int num_dead = 0 ;
 	int num_branch = 0 ;
 
-	for(; iter != m_vertices.end(); ++iter)
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
 	{
-		Vertex * pVertex = iter->second;
+		Vertex * pVertex = m_vertexVec[i];
+		if(pVertex == NULL)
+			continue;
 		int s_count = pVertex->countEdges(ED_SENSE);
 		int as_count = pVertex->countEdges(ED_ANTISENSE);
 		if(s_count == 1 && as_count == 1) { pVertex->setColor(straightColor); ++num_straight;}
@@ -927,12 +1009,11 @@ double Bigraph::getErrorRate() const
 //
 bool Bigraph::checkColors(GraphColor c)
 {
-	VertexPtrMapIter iter = m_vertices.begin();
-	for(; iter != m_vertices.end(); ++iter)
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
 	{
-		if(iter->second->getColor() != c)
+		if(m_vertexVec[i] != NULL && m_vertexVec[i]->getColor() != c)
 		{
-			std::cerr << "Warning vertex " << iter->second->getID() << " is color " << iter->second->getColor() << " expected " << c << "\n";
+			std::cerr << "Warning vertex " << m_vertexVec[i]->getID() << " is color " << m_vertexVec[i]->getColor() << " expected " << c << "\n";
 			return false;
 		}
 	}
@@ -948,11 +1029,10 @@ void Bigraph::contigStats(size_t min_contig)  const
 {
 	std::vector<size_t> contigLengths;
 
-	VertexPtrMapConstIter iter = m_vertices.begin();
-	for(; iter != m_vertices.end(); ++iter)
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
 	{
-		if(iter->second->getSeqLen()>=min_contig)
-			contigLengths.push_back (iter->second->getSeqLen());
+		if(m_vertexVec[i] != NULL && m_vertexVec[i]->getSeqLen()>=min_contig)
+			contigLengths.push_back (m_vertexVec[i]->getSeqLen());
 	}
 
 	std::sort(contigLengths.begin(),contigLengths.end());
@@ -994,10 +1074,11 @@ void Bigraph::stats() const
 	int numVerts = 0;
 	int numEdges = 0;
 
-	VertexPtrMapConstIter iter = m_vertices.begin();
-	for(; iter != m_vertices.end(); ++iter)
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
 	{
-		numEdges += iter->second->countEdges();
+		if(m_vertexVec[i] == NULL)
+			continue;
+		numEdges += m_vertexVec[i]->countEdges();
 		++numVerts;
 	}
 
@@ -1009,7 +1090,7 @@ void Bigraph::stats() const
 //
 size_t Bigraph::getNumVertices() const
 {
-	return m_vertices.size();
+	return m_numVertices;
 }
 
 //
@@ -1023,13 +1104,14 @@ void Bigraph::printMemSize() const
 	size_t numEdges = 0;
 	size_t edgeMem = 0;
 
-	VertexPtrMapConstIter iter = m_vertices.begin();
-	for(; iter != m_vertices.end(); ++iter)
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
 	{
+		if(m_vertexVec[i] == NULL)
+			continue;
 		++numVerts;
-		vertMem += iter->second->getMemSize();
+		vertMem += m_vertexVec[i]->getMemSize();
 
-		EdgePtrVec edges = iter->second->getEdges();
+		EdgePtrVec edges = m_vertexVec[i]->getEdges();
 		for(EdgePtrVecIter edgeIter = edges.begin(); edgeIter != edges.end(); ++edgeIter)
 		{
 			++numEdges;
@@ -1041,6 +1123,23 @@ void Bigraph::printMemSize() const
 	printf("total: %zu\n", edgeMem + vertMem);
 }
 
+//
+void Bigraph::compactMemory()
+{
+	m_pVertexAllocator->compact();
+	m_pEdgeAllocator->compact();
+
+	// The sequences, names and edge lists of the removed vertices are freed to the heap
+#if defined(__GLIBC__)
+	malloc_trim(0);
+#endif
+
+	std::cout << "[Memory] ";
+	m_pVertexAllocator->printStats("vertices", std::cout);
+	std::cout << "[Memory] ";
+	m_pEdgeAllocator->printStats("edges", std::cout);
+}
+
 //
 // Write the graph to a dot file
 //
@@ -1051,21 +1150,23 @@ void Bigraph::writeDot(const std::string& filename, int dotFlags) const
 	std::string graphType = (dotFlags & DF_UNDIRECTED) ? "graph" : "digraph";
 
 	out << graphType << " G\n{\n";
-	VertexPtrMapConstIter iter = m_vertices.begin();
-	for(; iter != m_vertices.end(); ++iter)
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
 	{
-		VertexID id = iter->second->getID();
+		const Vertex* pVertex = m_vertexVec[i];
+		if(pVertex == NULL)
+			continue;
+		VertexID id = pVertex->getID();
 
 		std::stringstream ss;
-		ss << iter->second->getSeqLen();
+		ss << pVertex->getSeqLen();
 		std::string len = ss.str();
 		std::string label = (dotFlags & DF_NOID) ? "" : id+":"+len;
 
 		out << "\"" << id << "\" [ label=\"" << label << "\" ";
 		if(dotFlags & DF_COLORED)
-		out << " style=\"filled\" fillcolor=\"" << getColorString(iter->second->getColor()) << "\" ";
+		out << " style=\"filled\" fillcolor=\"" << getColorString(pVertex->getColor()) << "\" ";
 		out << "];\n";
-		iter->second->writeEdges(out, dotFlags);
+		pVertex->writeEdges(out, dotFlags);
 	}
 	out << "}\n";
 	out.close();
@@ -1087,19 +1188,21 @@ void Bigraph::writeASQG(const std::string& filename) const
 	headerRecord.write(*pWriter);
 
 
-	VertexPtrMapConstIter iter;
-
 	// Vertices
-	for(iter = m_vertices.begin(); iter != m_vertices.end(); ++iter)
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
 	{
-		ASQG::VertexRecord vertexRecord(iter->second->getID(), iter->second->getSeq().toString());
+		if(m_vertexVec[i] == NULL)
+			continue;
+		ASQG::VertexRecord vertexRecord(m_vertexVec[i]->getID(), m_vertexVec[i]->getSeq().toString());
 		vertexRecord.write(*pWriter);
 	}
 
 	// Edges
-	for(iter = m_vertices.begin(); iter != m_vertices.end(); ++iter)
+	for(size_t i = 0; i < m_vertexVec.size(); ++i)
 	{
-		EdgePtrVec edges = iter->second->getEdges();
+		if(m_vertexVec[i] == NULL)
+			continue;
+		EdgePtrVec edges = m_vertexVec[i]->getEdges();
 		for(EdgePtrVecIter edgeIter = edges.begin(); edgeIter != edges.end(); ++edgeIter)
 		{
 			// We write one record for every bidirectional edge so only write edges
@@ -1143,19 +1246,105 @@ std::string Bigraph::getColorString(GraphColor c)
 //Lock two vertices of the same edge with dead lock prevention
 void Bigraph::lockTwoVertices(Vertex *pV1, Vertex* pV2)
 {
-	if(pV1 < pV2){
-		pV1->setLock();
-		pV2->setLock();
+	// The locks are not recursive and are always taken in stripe order
+	size_t s1 = pV1->getIndex() % NUM_VERTEX_LOCKS;
+	size_t s2 = pV2->getIndex() % NUM_VERTEX_LOCKS;
+	if(s1 == s2)
+		omp_set_lock(&m_vertexLocks[s1]);
+	else if(s1 < s2){
+		omp_set_lock(&m_vertexLocks[s1]);
+		omp_set_lock(&m_vertexLocks[s2]);
 	}
 	else
 	{
-		pV2->setLock();
-		pV1->setLock();
+		omp_set_lock(&m_vertexLocks[s2]);
+		omp_set_lock(&m_vertexLocks[s1]);
 	}
 
 }
 void Bigraph::unlockTwoVertices(Vertex *pV1, Vertex* pV2)
 {
-	pV1->releaseLock();
-	pV2->releaseLock();
+	size_t s1 = pV1->getIndex() % NUM_VERTEX_LOCKS;
+	size_t s2 = pV2->getIndex() % NUM_VERTEX_LOCKS;
+	omp_unset_lock(&m_vertexLocks[s1]);
+	if(s1 != s2)
+		omp_unset_lock(&m_vertexLocks[s2]);
+}
+
+//
+bool Bigraph::tryLockTwoVertices(Vertex *pV1, Vertex* pV2)
+{
+	size_t s1 = std::min(pV1->getIndex(), pV2->getIndex()) % NUM_VERTEX_LOCKS;
+	size_t s2 = std::max(pV1->getIndex(), pV2->getIndex()) % NUM_VERTEX_LOCKS;
+	if(!omp_test_lock(&m_vertexLocks[s1]))
+		return false;
+	if(s1 != s2 && !omp_test_lock(&m_vertexLocks[s2]))
+	{
+		omp_unset_lock(&m_vertexLocks[s1]);
+		return false;
+	}
+	return true;
+}
+
+//
+void Bigraph::deferVisit(Vertex* pVertex)
+{
+	size_t tid = omp_get_thread_num();
+	assert(tid < m_deferredVertices.size());
+	m_deferredVertices[tid].push_back(pVertex);
+}
+
+//
+void Bigraph::recordVisit(const char* name, size_t numVisits, size_t numDeferred, double wallTime, const std::vector<double>& busyTimes)
+{
+	VisitStats& stats = m_visitStats[name];
+	++stats.numPasses;
+	stats.numVisits += numVisits;
+	stats.numDeferred += numDeferred;
+	stats.wallTime += wallTime;
+	stats.maxBusyTime += *std::max_element(busyTimes.begin(), busyTimes.end());
+	for(size_t i = 0; i < busyTimes.size(); ++i)
+		stats.sumBusyTime += busyTimes[i];
+	stats.numThreads = std::max(stats.numThreads, busyTimes.size());
+}
+
+// The imbalance is the busy time of the slowest thread over the mean busy time of the threads
+void Bigraph::printVisitStats() const
+{
+	printf("%-40s %8s %12s %10s %10s %10s\n", "visitor", "passes", "visits", "deferred", "wall(s)", "imbalance");
+	for(std::map<std::string, VisitStats>::const_iterator iter = m_visitStats.begin(); iter != m_visitStats.end(); ++iter)
+	{
+		std::string name = iter->first;
+#if defined(__GNUG__)
+		int status = 0;
+		char* pDemangled = abi::__cxa_demangle(name.c_str(), NULL, NULL, &status);
+		if(status == 0 && pDemangled != NULL)
+			name = pDemangled;
+		free(pDemangled);
+#endif
+		const VisitStats& stats = iter->second;
+		double meanBusyTime = stats.sumBusyTime / stats.numThreads;
+		printf("%-40s %8zu %12zu %10zu %10.2lf %10.2lf\n", name.c_str(), stats.numPasses, stats.numVisits, stats.numDeferred,
+		       stats.wallTime, meanBusyTime > 0 ? stats.maxBusyTime / meanBusyTime : 1.0);
+	}
+}
+
+// Print the progress bar when the chunk just done crosses a percent
+void Bigraph::printVisitProgress(size_t numDone, size_t chunkSize, size_t numTotal)
+{
+	int pos = 100 * (double) numDone / numTotal;
+	if(pos == (int)(100 * (double) (numDone - chunkSize) / numTotal))
+		return;
+
+	#pragma omp critical(BigraphVisitProgress)
+	{
+		std::cout << "[";
+		for (int i = 0; i < 100; ++i) {
+			if (i < pos) std::cout << "=";
+			else if (i == pos) std::cout << ">";
+			else std::cout << " ";
+		}
+		std::cout << "] " << pos << " %\r";
+		std::cout.flush();
+	}
 }
\ No newline at end of file
@@ -17,6 +17,10 @@
 #include "Vertex.h"
 #include "Edge.h"
 #include "HashMap.h"
+#include "ShardedVertexMap.h"
+#include "VisitScheduler.h"
+#include "NumaPolicy.h"
+#include <typeinfo>
 #include <omp.h>
 
 
@@ -26,7 +30,8 @@
 //typedef std::map<VertexID, Vertex*> VertexPtrMap;
 //typedef __gnu_cxx::hash_map<VertexID, Vertex*> VertexPtrMap;
 //typedef std::tr1::unordered_map<VertexID, Vertex*> VertexPtrMap;
-typedef SparseHashMap<VertexID, Vertex*, StringHasher> VertexPtrMap;
+//typedef SparseHashMap<VertexID, Vertex*, StringHasher> VertexPtrMap;
+typedef ShardedVertexMap VertexPtrMap;
 
 typedef VertexPtrMap::iterator VertexPtrMapIter;
 typedef VertexPtrMap::const_iterator VertexPtrMapConstIter;
@@ -57,7 +62,8 @@ class Bigraph
         Bigraph();
         ~Bigraph();
 
-        // Add a vertex
+        // Add a vertex. The vertex gets the next index of the graph, so the vertices
+        // of an ASQG file are indexed by the number of their read. Thread-safe
         void addVertex(Vertex* pVert);
         
         // Remove a vertex
@@ -72,6 +78,18 @@ class Bigraph
         // Get a vertex
         Vertex* getVertex(VertexID id) const;
 
+        // Get the vertex with the given index, NULL if it was removed
+        Vertex* getVertexByIndex(size_t idx) const { return m_vertexVec[idx]; }
+
+        // The number of indices given to vertices, including the removed ones
+        size_t getNumVertexIndices() const { return m_vertexVec.size(); }
+
+        // In integer ID mode the vertices are addressed by their index and the names
+        // are only kept for output. The names are indexed the first time a vertex
+        // is looked up by name. Must be set before any vertex is added
+        void setIntegerIDMode(bool b);
+        bool isIntegerIDMode() const;
+
         // Add an edge
         void addEdge(Vertex* pVertex, Edge* pEdge);
 
@@ -140,22 +158,44 @@ class Bigraph
         // Append each vertex sequence to the vector of strings
         void getVertexSequences(std::vector<std::string>& outSequences) const;
 
-		//Lock two vertices of the same edge with dead lock prevention
+		//Lock two vertices of the same edge with dead lock prevention. The locks
+		//are striped by vertex index, so two vertices may share one lock
 		void lockTwoVertices(Vertex *V1, Vertex* V2);
 		void unlockTwoVertices(Vertex *V1, Vertex* V2);
-		
+
+		//Take the locks of two vertices only if no other thread holds them
+		bool tryLockTwoVertices(Vertex *V1, Vertex* V2);
+
+		// Visit pVertex again once the parallel pass of the current visit is done and no other
+		// thread runs. Called by a visitor whose tryLockTwoVertices failed, instead of blocking
+		void deferVisit(Vertex* pVertex);
+
+		// Print the time taken by each type of visitor
+		void printVisitStats() const;
+
         // Visit each vertex in the graph and call the visit functor object
         template<typename VF>
         bool visit(VF& vf)
         {
+            double startTime = omp_get_wtime();
             bool modified = false;
             vf.previsit(this);
-            VertexPtrMapConstIter iter = m_vertices.begin(); 
-            for(; iter != m_vertices.end(); ++iter)
+            m_deferredVertices.assign(1, VertexPtrVec());
+            size_t numIndices = m_vertexVec.size();
+            size_t numVisits = 0;
+            for(size_t i = 0; i < numIndices; ++i)
             {
-                modified = vf.visit(this, iter->second) || modified;
+                if(m_vertexVec[i] != NULL)
+                {
+                    modified = vf.visit(this, m_vertexVec[i]) || modified;
+                    ++numVisits;
+                }
             }
+            double busyTime = omp_get_wtime() - startTime;
+            size_t numDeferred = 0;
+            modified = visitDeferred(vf, numDeferred) || modified;
             vf.postvisit(this);
+            recordVisit(typeid(VF).name(), numVisits, numDeferred, omp_get_wtime() - startTime, std::vector<double>(1, busyTime));
             return modified;
         }
 
@@ -163,95 +203,24 @@ class Bigraph
         template<typename VF>
         bool visitP(VF& vf)
         {
-			omp_set_dynamic(0); 
-            bool modified = false;
-            vf.previsit(this);
-			
-			//Copy iterators into vectors for use of openmp for
-			std::vector<Vertex*> itvector;
-			VertexPtrMapConstIter viter;
-			for(viter = m_vertices.begin(); viter != m_vertices.end(); ++viter)
-				itvector.push_back(viter->second);
-			
-			#pragma omp parallel for
-			for (unsigned int i=0 ; i< itvector.size() ; i++ )
-			{
-				bool isModified = vf.visit(this, itvector[i]);
-				if(isModified)
-					modified=true;
-			}//end of #pragma omp parallel
-
-			vf.postvisit(this);
-            return modified;			
+            return visitParallel(vf, typeid(VF).name(), false);
         }   
 		
-		// Parallel visit where each vertex may be visited multiple times, depending on the number of threads
-		// This visit is suited only for randomized visitors with protection of removal all edges
-		// , where multiple trials of visiting the same vertex may generate better results
+		// Parallel visit for the randomized visitors. Each vertex is visited once, by
+		// the thread reaching it first
         template<typename VF>
         bool visitMultiP(VF& vf)
         {
-			omp_set_dynamic(0); 
-            bool modified = false;
-            vf.previsit(this);
-			
-			VertexPtrMapConstIter iter;
-			#pragma omp parallel private(iter)
-			{
-				//Note that the same vertex/iter may be processed multiple times by different threads
-				for(iter = m_vertices.begin(); iter != m_vertices.end(); ++iter)
-				{
-					#pragma omp single nowait
-					{
-						bool isModified = vf.visit(this, iter->second);
-						if(isModified)
-							modified=true;
-					}
-				}
-			}//end of #pragma omp parallel
-
-			vf.postvisit(this);
-            return modified;			
+            return visitParallel(vf, typeid(VF).name(), false);
         }     
 
+		// Parallel visit printing a progress bar
 		template<typename VF>
         bool visitProgress(VF& vf)
 		{
-			bool modified = false;
-			vf.previsit(this);
-			
-			size_t count=0;
-			std::vector<Vertex*> itvector;
-			VertexPtrMapConstIter viter;
-			for(viter = m_vertices.begin(); viter != m_vertices.end(); ++viter)
-				itvector.push_back(viter->second);
-			
-			#pragma omp parallel for
-			for (unsigned int i=0 ; i< itvector.size() ; i++ )
-			{
-				bool isModified = vf.visit(this, itvector[i]);
-				if(isModified)
-					modified=true;
-
-				#pragma omp atomic
-				count++;
-				
-				if( (count % 1000) ==0)
-				{
-					std::cout << "[";
-					int pos = 100 * (double) count/m_vertices.size();
-					for (int i = 0; i < 100; ++i) {
-						if (i < pos) std::cout << "=";
-						else if (i == pos) std::cout << ">";
-						else std::cout << " ";
-					}
-					std::cout << "] " << int( ((double)count/m_vertices.size()) * 100.0) << " %\r";
-					std::cout.flush();
-				}
-			}
+			bool modified = visitParallel(vf, typeid(VF).name(), true);
 			std::cout << std::endl;
-			vf.postvisit(this);
-			return modified;			
+			return modified;
 		}
 
         // Set the colors for the entire graph
@@ -286,10 +255,14 @@ class Bigraph
         void writeASQG(const std::string& filename) const;
 
         // Returns an allocator for the edges of the graph
-        SimpleAllocator<Edge>* getEdgeAllocator() { return m_pEdgeAllocator; }
+        SlabAllocator<Edge>* getEdgeAllocator() { return m_pEdgeAllocator; }
 
         // Returns an allocator for the vertices of the graph
-        SimpleAllocator<Vertex>* getVertexAllocator() { return m_pVertexAllocator; }
+        SlabAllocator<Vertex>* getVertexAllocator() { return m_pVertexAllocator; }
+
+        // Release the memory of the removed vertices and edges to the OS and print the
+        // state of the memory pools. Must not be called from a parallel region
+        void compactMemory();
 
         // Return a string for a color code
         static std::string getColorString(GraphColor c);
@@ -310,11 +283,120 @@ class Bigraph
 
         void followLinear(VertexID id, EdgeDir dir, Path& outPath);
 
+        // Remove a vertex from the indices of the graph
+        void releaseVertex(Vertex* pVertex);
+        void indexNames() const;
+
+        // Visit the vertices in parallel. The threads take chunks of the vertices with
+        // work stealing, then the vertices deferred by the visitor are visited serially.
+        // In the NUMA mode the threads are pinned to the nodes in turn during the parallel
+        // pass, and the calling thread gets its CPUs back after it
+        template<typename VF>
+        bool visitParallel(VF& vf, const char* name, bool showProgress)
+        {
+			omp_set_dynamic(0); 
+            double startTime = omp_get_wtime();
+            bool modified = false;
+            vf.previsit(this);
+
+			//Copy the vertices, visitors may add vertices while they are visited
+			std::vector<Vertex*> vertices = getAllVertices();
+
+            size_t numThreads = omp_get_max_threads();
+            VisitScheduler scheduler(vertices.size(), numThreads, VISIT_CHUNK_SIZE);
+            std::vector<double> busyTimes(numThreads, 0.0);
+            m_deferredVertices.assign(numThreads, VertexPtrVec());
+            size_t numDone = 0;
+
+			#pragma omp parallel num_threads(numThreads) reduction(||:modified)
+			{
+                size_t tid = omp_get_thread_num();
+                NumaPolicy::WorkerPinScope pinScope(tid);
+                double threadStart = omp_get_wtime();
+                size_t begin, end;
+                while(scheduler.next(tid, begin, end))
+                {
+                    for(size_t i = begin; i < end; ++i)
+                        modified = vf.visit(this, vertices[i]) || modified;
+
+                    if(showProgress)
+                        printVisitProgress(__sync_add_and_fetch(&numDone, end - begin), end - begin, vertices.size());
+                }
+                busyTimes[tid] = omp_get_wtime() - threadStart;
+			}//end of #pragma omp parallel
+
+            size_t numDeferred = 0;
+            modified = visitDeferred(vf, numDeferred) || modified;
+			vf.postvisit(this);
+            recordVisit(name, vertices.size(), numDeferred, omp_get_wtime() - startTime, busyTimes);
+            return modified;
+        }
+
+        // Visit the deferred vertices until none is deferred again
+        template<typename VF>
+        bool visitDeferred(VF& vf, size_t& numDeferred)
+        {
+            bool modified = false;
+            VertexPtrVec deferred;
+            while(true)
+            {
+                deferred.clear();
+                for(size_t i = 0; i < m_deferredVertices.size(); ++i)
+                {
+                    deferred.insert(deferred.end(), m_deferredVertices[i].begin(), m_deferredVertices[i].end());
+                    m_deferredVertices[i].clear();
+                }
+                if(deferred.empty())
+                    return modified;
+
+                numDeferred += deferred.size();
+                for(size_t i = 0; i < deferred.size(); ++i)
+                    modified = vf.visit(this, deferred[i]) || modified;
+            }
+        }
+
+        void recordVisit(const char* name, size_t numVisits, size_t numDeferred, double wallTime, const std::vector<double>& busyTimes);
+        static void printVisitProgress(size_t numDone, size_t chunkSize, size_t numTotal);
+
         //
         // data
         //
-        VertexPtrMap m_vertices;
+        // The vertices by index. The slots of removed vertices are NULL
+        VertexPtrVec m_vertexVec;
+        size_t m_numVertices;
+        omp_lock_t m_vertexVecLock;
+
+        // The locks of the vertices, shared by the vertices of equal index modulo NUM_VERTEX_LOCKS
+        static const size_t NUM_VERTEX_LOCKS = 1 << 12;
+        std::vector<omp_lock_t> m_vertexLocks;
+
+        // The vertices by name, not kept in integer ID mode until needed
+        mutable VertexPtrMap m_vertices;
+        bool m_isIntegerIDMode;
+        mutable bool m_hasNameIndex;
 		VertexPtrVec itvector;	//for openmp usage
+
+        // The vertices deferred by each thread in the current visit
+        std::vector<VertexPtrVec> m_deferredVertices;
+
+        // The timing of the visits by the type name of the visitor
+        struct VisitStats
+        {
+            VisitStats() : numPasses(0), numVisits(0), numDeferred(0), wallTime(0.0), maxBusyTime(0.0), sumBusyTime(0.0), numThreads(0) {}
+
+            size_t numPasses;
+            size_t numVisits;
+            size_t numDeferred;
+            double wallTime;
+
+            // The busy time of the slowest thread and of all threads, summed over the passes
+            double maxBusyTime;
+            double sumBusyTime;
+            size_t numThreads;
+        };
+        std::map<std::string, VisitStats> m_visitStats;
+
+        static const size_t VISIT_CHUNK_SIZE = 32;
 		
 		//Stats simple path overlap length
 		std::map<size_t,int> m_simpleLenCount;
@@ -330,8 +412,8 @@ class Bigraph
         double m_errorRate;
 
         // Memory management
-        SimpleAllocator<Vertex>* m_pVertexAllocator;
-        SimpleAllocator<Edge>* m_pEdgeAllocator;
+        SlabAllocator<Vertex>* m_pVertexAllocator;
+        SlabAllocator<Edge>* m_pEdgeAllocator;
 		
 		
 		//std::vector<VertexPtrMapIter> itvector;
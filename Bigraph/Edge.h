@@ -17,7 +17,7 @@
 #include "EdgeDesc.h"
 #include "Vertex.h"
 #include "BitChar.h"
-#include "SimpleAllocator.h"
+#include "SlabAllocator.h"
 
 // Packed structure holding the direction and comp of an edge
 // The EdgeDir/EdgeComp enums (which only have values 0/1) are used 
@@ -135,17 +135,21 @@ class Edge
         inline void flipDir() { m_edgeData.flipDir(); }
         void flip() { flipComp(); flipDir(); }
 
-        // Self-memory management disabled by YTH due to not thread-safe
-        // void* operator new(size_t /*size*/, SimpleAllocator<Edge>* pAllocator)
-        // {
-            // return pAllocator->alloc();
-        // }
+        // Memory management
+        void* operator new(size_t /*size*/, SlabAllocator<Edge>* pAllocator)
+        {
+            return pAllocator->alloc();
+        }
+
+        void operator delete(void* target, SlabAllocator<Edge>* /*pAllocator*/)
+        {
+            SlabAllocator<Edge>::deallocate(target);
+        }
 
-        void operator delete(void* /*target*/, size_t /*size*/)
+        // The storage returns to the memory pool of the graph owning the edge
+        void operator delete(void* target, size_t /*size*/)
         {
-            // Deletions are handled at the graph/pool level. The lifetime of an edge
-            // is as long as the graph it belongs to, even if it is deleted before
-            // the graph.
+            SlabAllocator<Edge>::deallocate(target);
         }
 
         // Validate that the edge is sane
@@ -162,10 +166,9 @@ class Edge
 
 
     protected:
-        // Self-memory management disabled by YTH due to not thread-safe
         // Global new is not allowed, allocation must go through the memory pool
         // belonging to the graph.
-        //void* operator new(size_t size) { return malloc(size); } 
+        void* operator new(size_t size) { return malloc(size); } 
         
         Edge() {}; // Default constructor is not allowed
 
@@ -0,0 +1,172 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// ShardedVertexMap - Map from vertex ID to vertex, split
+// into shards by the hash of the ID. Each shard has a lock
+// so threads can insert vertices concurrently. Lookups do
+// not lock; they must not overlap insertions or erasures
+// in the same map, which the graph loaders guarantee by
+// adding every vertex before any edge.
+//
+#ifndef SHARDEDVERTEXMAP_H
+#define SHARDEDVERTEXMAP_H
+
+#include <vector>
+#include <utility>
+#include <omp.h>
+#include "GraphCommon.h"
+#include "HashMap.h"
+
+class Vertex;
+
+// Iterates over the entries of all shards in turn
+template<typename ShardVector, typename ShardIterator, typename Value>
+class ShardedMapIterator
+{
+    public:
+        ShardedMapIterator() : m_pShards(NULL), m_shard(0) {}
+        ShardedMapIterator(ShardVector* pShards, size_t shard, ShardIterator iter) : m_pShards(pShards), m_shard(shard), m_iter(iter)
+        {
+            skipEmptyShards();
+        }
+
+        // Conversion from an iterator to a const iterator
+        template<typename SV, typename SI, typename V>
+        ShardedMapIterator(const ShardedMapIterator<SV, SI, V>& other) : m_pShards(other.m_pShards), m_shard(other.m_shard), m_iter(other.m_iter) {}
+
+        Value& operator*() const { return *m_iter; }
+        Value* operator->() const { return &*m_iter; }
+
+        ShardedMapIterator& operator++()
+        {
+            ++m_iter;
+            skipEmptyShards();
+            return *this;
+        }
+
+        // The iterators past the last shard are all equal
+        bool operator==(const ShardedMapIterator& other) const
+        {
+            return m_shard == other.m_shard && (m_shard == m_pShards->size() || m_iter == other.m_iter);
+        }
+        bool operator!=(const ShardedMapIterator& other) const { return !(*this == other); }
+
+    private:
+        template<typename SV, typename SI, typename V> friend class ShardedMapIterator;
+
+        void skipEmptyShards()
+        {
+            while(m_shard < m_pShards->size() && m_iter == (*m_pShards)[m_shard].end())
+            {
+                if(++m_shard < m_pShards->size())
+                    m_iter = (*m_pShards)[m_shard].begin();
+            }
+        }
+
+        ShardVector* m_pShards;
+        size_t m_shard;
+        ShardIterator m_iter;
+};
+
+class ShardedVertexMap
+{
+    typedef SparseHashMap<VertexID, Vertex*, StringHasher> ShardMap;
+    typedef std::vector<ShardMap> ShardVector;
+
+    public:
+        typedef ShardMap::value_type value_type;
+        typedef ShardedMapIterator<ShardVector, ShardMap::iterator, value_type> iterator;
+        typedef ShardedMapIterator<const ShardVector, ShardMap::const_iterator, const value_type> const_iterator;
+
+        ShardedVertexMap() : m_shards(NUM_SHARDS), m_locks(NUM_SHARDS)
+        {
+            for(size_t i = 0; i < NUM_SHARDS; ++i)
+                omp_init_lock(&m_locks[i]);
+        }
+
+        ~ShardedVertexMap()
+        {
+            for(size_t i = 0; i < NUM_SHARDS; ++i)
+                omp_destroy_lock(&m_locks[i]);
+        }
+
+        void set_deleted_key(const VertexID& key)
+        {
+            for(size_t i = 0; i < NUM_SHARDS; ++i)
+                m_shards[i].set_deleted_key(key);
+        }
+
+        // Thread-safe
+        std::pair<iterator, bool> insert(const value_type& value)
+        {
+            size_t shard = getShard(value.first);
+            omp_set_lock(&m_locks[shard]);
+            std::pair<ShardMap::iterator, bool> result = m_shards[shard].insert(value);
+            omp_unset_lock(&m_locks[shard]);
+            return std::make_pair(iterator(&m_shards, shard, result.first), result.second);
+        }
+
+        // Thread-safe
+        size_t erase(const VertexID& key)
+        {
+            size_t shard = getShard(key);
+            omp_set_lock(&m_locks[shard]);
+            size_t numErased = m_shards[shard].erase(key);
+            omp_unset_lock(&m_locks[shard]);
+            return numErased;
+        }
+
+        iterator find(const VertexID& key)
+        {
+            size_t shard = getShard(key);
+            ShardMap::iterator iter = m_shards[shard].find(key);
+            return iter == m_shards[shard].end() ? end() : iterator(&m_shards, shard, iter);
+        }
+
+        const_iterator find(const VertexID& key) const
+        {
+            size_t shard = getShard(key);
+            ShardMap::const_iterator iter = m_shards[shard].find(key);
+            return iter == m_shards[shard].end() ? end() : const_iterator(&m_shards, shard, iter);
+        }
+
+        iterator begin() { return iterator(&m_shards, 0, m_shards[0].begin()); }
+        iterator end() { return iterator(&m_shards, NUM_SHARDS, ShardMap::iterator()); }
+        const_iterator begin() const { return const_iterator(&m_shards, 0, m_shards[0].begin()); }
+        const_iterator end() const { return const_iterator(&m_shards, NUM_SHARDS, ShardMap::const_iterator()); }
+
+        size_t size() const
+        {
+            size_t total = 0;
+            for(size_t i = 0; i < NUM_SHARDS; ++i)
+                total += m_shards[i].size();
+            return total;
+        }
+
+        bool empty() const { return size() == 0; }
+
+        void clear()
+        {
+            for(size_t i = 0; i < NUM_SHARDS; ++i)
+                m_shards[i].clear();
+        }
+
+    private:
+        ShardedVertexMap(const ShardedVertexMap&);
+        ShardedVertexMap& operator=(const ShardedVertexMap&);
+
+        // The shard is chosen by the high bits of the hash, the map of the shard uses the low bits
+        size_t getShard(const VertexID& key) const
+        {
+            return (StringHasher()(key) >> 24) % NUM_SHARDS;
+        }
+
+        static const size_t NUM_SHARDS = 64;
+
+        ShardVector m_shards;
+        std::vector<omp_lock_t> m_locks;
+};
+
+#endif
@@ -18,8 +18,6 @@ Vertex::~Vertex()
         delete *iter;
         *iter = NULL;
     }
-	//Added by YTH
-	omp_destroy_lock(&m_lock);
 }
 
 // Merging two string vertices has two parts
@@ -451,10 +449,18 @@ size_t Vertex::countEdges() const
 }
 
 //
-size_t Vertex::countEdges(EdgeDir dir)
+// The edges are counted in place, the visitors call this for every
+// vertex of a sweep and a copy of the edges would cost an allocation
+size_t Vertex::countEdges(EdgeDir dir) const
 {
-    EdgePtrVec ev = getEdges(dir);
-    return ev.size();
+    size_t count = 0;
+    EdgePtrVecConstIter iter = m_edges.begin();
+    for(; iter != m_edges.end(); ++iter)
+    {
+        if((*iter)->getDir() == dir)
+            ++count;
+    }
+    return count;
 }
 
 // Calculate the difference in overlap lengths between
@@ -21,12 +21,10 @@
 #include "GraphCommon.h"
 #include "QualityVector.h"
 #include "EncodedString.h"
-#include "SimpleAllocator.h"
+#include "SlabAllocator.h"
 #include "EdgeDesc.h"
 #include "MultiOverlap.h"
 
-#include <omp.h>
-
 // Forward declare
 class Edge;
 
@@ -66,16 +64,15 @@ class Vertex
 
         Vertex(VertexID id, const std::string& s) : m_id(id),
                                                     m_seq(s),
-                                                    m_color(GC_WHITE),
+                                                    m_index(0),
                                                     m_coverage(1),
+                                                    m_color(GC_WHITE),
                                                     m_isContained(false),
 													m_isSuperRepeat(false)
 													{
 														//Added by CFL, store original read length, used by EdgeRemove Visitors
 														m_originLength[ED_SENSE]=s.length();
 														m_originLength[ED_ANTISENSE]=s.length();
-														//Added by YTH, for parallel graph visitors
-														omp_init_lock (&m_lock);
 													}
         ~Vertex();
 
@@ -123,7 +120,7 @@ class Vertex
         Edge* getLongestOverlapEdge(EdgeDir dir) const;
 
         size_t countEdges() const;
-        size_t countEdges(EdgeDir dir);
+        size_t countEdges(EdgeDir dir) const;
 
         // Calculate the difference in overlap lengths between
         // the longest and second longest edge
@@ -140,6 +137,7 @@ class Vertex
         void setContained(bool c) { m_isContained = c; }
         void setSuperRepeat(bool b) { m_isSuperRepeat = b; }
 		void setOriginLength (size_t l,EdgeDir dir){ m_originLength[dir] = l;}
+        void setIndex(size_t idx) { m_index = idx; }
 
         // getters
         VertexID getID() const { return m_id; }
@@ -152,19 +150,24 @@ class Vertex
         bool isSuperRepeat() const { return m_isSuperRepeat; }
         uint16_t getCoverage() const { return m_coverage; }
 		size_t  getOriginLength(EdgeDir dir) const { return m_originLength[dir]; }
+        size_t getIndex() const { return m_index; }
 
 
         // Memory management
-        void* operator new(size_t /*size*/, SimpleAllocator<Vertex>* pAllocator)
+        void* operator new(size_t /*size*/, SlabAllocator<Vertex>* pAllocator)
         {
             return pAllocator->alloc();
         }
 
-        void operator delete(void* /*target*/, size_t /*size*/)
+        void operator delete(void* target, SlabAllocator<Vertex>* /*pAllocator*/)
+        {
+            SlabAllocator<Vertex>::deallocate(target);
+        }
+
+        // The storage returns to the memory pool of the graph owning the vertex
+        void operator delete(void* target, size_t /*size*/)
         {
-            // delete does nothing since all allocations go through the memory pool
-            // belonging to the graph. The memory allocated for the vertex will be
-            // cleaned up when the graph is destroyed.
+            SlabAllocator<Vertex>::deallocate(target);
         }
 
         // Output edges in graphviz format
@@ -177,26 +180,6 @@ class Vertex
 				<<  "\tcoverage : " << m_coverage  <<  "\tm_isContained : "  << m_isContained << "\tm_isSuperRepeat : " << m_isSuperRepeat << "\n";
 		}
 
-		//Added by YTH, for parallel graph simplify() implementation
-		void setLock()
-		{
-			omp_set_lock (&m_lock);
-		}
-		
-		void releaseLock()
-		{
-			omp_unset_lock (&m_lock);
-		}
-		
-		bool testLock()
-		{
-			return omp_test_lock (&m_lock);
-		}
-		
-		//Read IDs in SA index mapped to this vertex, used by IslandJoin Visitor
-		//[0,1,2,3]=AntisenseFwd, AntisenseRvc, SenseFwd, SenseRvc of pV
-		std::vector< std::vector<int64_t> > pVReadIDs;
-		
     private:
 
         // Global new is disallowed, all allocations must go through the pool
@@ -208,23 +191,24 @@ class Vertex
         // Ensure all the edges in DIR are unique
         bool markDuplicateEdges(EdgeDir dir, GraphColor dupColor);
 
+        // The fields after m_seq are ordered to pack into 16 bytes. The lock
+        // of a vertex is kept in the striped lock table of the graph
         VertexID m_id;
         EdgePtrVec m_edges;
         DNAEncodedString m_seq;
-        GraphColor m_color;
+
+		// The index of the vertex in the graph
+		uint32_t m_index;
+
+		//Added by CFL, store original read length, used by EdgeRemove Visitors
+		uint32_t m_originLength[ED_COUNT];
 
         // Counter of the number of vertices that have been merged into this one
         uint16_t m_coverage;
 
-        bool m_isContained;
-        bool m_isSuperRepeat;
-
-		//Added by CFL, store original read length, used by EdgeRemove Visitors
-		size_t m_originLength[ED_COUNT];
-		
-		//Added by YTH, for parallel visitor implementation
-		omp_lock_t m_lock;
-		
+        GraphColor m_color;
+        bool m_isContained : 1;
+        bool m_isSuperRepeat : 1;
 };
 
 #endif
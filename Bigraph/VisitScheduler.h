@@ -0,0 +1,109 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// VisitScheduler - Chunked work stealing over the
+// positions [0, n) of a parallel visit. Each thread
+// starts with an equal range of the positions and takes
+// chunks from its front. A thread that runs out steals
+// the back half of the range of another thread, so the
+// cost of islands and repeat hubs, which differs by orders
+// of magnitude, balances without a shared counter.
+//
+#ifndef VISITSCHEDULER_H
+#define VISITSCHEDULER_H
+
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+
+class VisitScheduler
+{
+    // Padded to a cache line so the threads do not share the line of their ranges
+    struct Range
+    {
+        size_t begin;
+        size_t end;
+        omp_lock_t lock;
+        char padding[64 - 2 * sizeof(size_t) - sizeof(omp_lock_t)];
+    };
+
+    public:
+        VisitScheduler(size_t numItems, size_t numThreads, size_t chunkSize) : m_ranges(numThreads), m_chunkSize(chunkSize)
+        {
+            for(size_t i = 0; i < numThreads; ++i)
+            {
+                m_ranges[i].begin = numItems * i / numThreads;
+                m_ranges[i].end = numItems * (i + 1) / numThreads;
+                omp_init_lock(&m_ranges[i].lock);
+            }
+        }
+
+        ~VisitScheduler()
+        {
+            for(size_t i = 0; i < m_ranges.size(); ++i)
+                omp_destroy_lock(&m_ranges[i].lock);
+        }
+
+        // Get the next chunk [begin, end) of thread tid. Returns false once no thread has work left
+        bool next(size_t tid, size_t& begin, size_t& end)
+        {
+            if(takeFront(tid, begin, end))
+                return true;
+
+            for(size_t i = 1; i < m_ranges.size(); ++i)
+            {
+                size_t victim = (tid + i) % m_ranges.size();
+                if(steal(tid, victim))
+                    return takeFront(tid, begin, end);
+            }
+            return false;
+        }
+
+    private:
+        VisitScheduler(const VisitScheduler&);
+        VisitScheduler& operator=(const VisitScheduler&);
+
+        bool takeFront(size_t tid, size_t& begin, size_t& end)
+        {
+            Range& range = m_ranges[tid];
+            omp_set_lock(&range.lock);
+            bool found = range.begin < range.end;
+            if(found)
+            {
+                begin = range.begin;
+                end = std::min(range.begin + m_chunkSize, range.end);
+                range.begin = end;
+            }
+            omp_unset_lock(&range.lock);
+            return found;
+        }
+
+        // Move the back half of the range of victim to thread tid, whose range is empty
+        bool steal(size_t tid, size_t victim)
+        {
+            Range& from = m_ranges[victim];
+            omp_set_lock(&from.lock);
+            size_t remaining = from.end - from.begin;
+            size_t stolenBegin = remaining > m_chunkSize ? from.end - remaining / 2 : from.begin;
+            size_t stolenEnd = from.end;
+            from.end = stolenBegin;
+            omp_unset_lock(&from.lock);
+
+            if(stolenBegin == stolenEnd)
+                return false;
+
+            Range& to = m_ranges[tid];
+            omp_set_lock(&to.lock);
+            to.begin = stolenBegin;
+            to.end = stolenEnd;
+            omp_unset_lock(&to.lock);
+            return true;
+        }
+
+        std::vector<Range> m_ranges;
+        size_t m_chunkSize;
+};
+
+#endif
@@ -0,0 +1,71 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// BoundedQueue - Blocking FIFO queue of bounded size
+// shared by the threads of a pipeline. The lock is only
+// held to move one element, which is a pointer to a batch
+// of work in the pipelines, so the threads waiting on the
+// queue sleep instead of spinning.
+//
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <deque>
+#include <pthread.h>
+
+template<class T>
+class BoundedQueue
+{
+    public:
+        BoundedQueue(size_t capacity) : m_capacity(capacity)
+        {
+            pthread_mutex_init(&m_mutex, NULL);
+            pthread_cond_init(&m_notEmpty, NULL);
+            pthread_cond_init(&m_notFull, NULL);
+        }
+
+        ~BoundedQueue()
+        {
+            pthread_mutex_destroy(&m_mutex);
+            pthread_cond_destroy(&m_notEmpty);
+            pthread_cond_destroy(&m_notFull);
+        }
+
+        // Block while the queue is full
+        void push(const T& value)
+        {
+            pthread_mutex_lock(&m_mutex);
+            while(m_queue.size() >= m_capacity)
+                pthread_cond_wait(&m_notFull, &m_mutex);
+            m_queue.push_back(value);
+            pthread_cond_signal(&m_notEmpty);
+            pthread_mutex_unlock(&m_mutex);
+        }
+
+        // Block while the queue is empty
+        T pop()
+        {
+            pthread_mutex_lock(&m_mutex);
+            while(m_queue.empty())
+                pthread_cond_wait(&m_notEmpty, &m_mutex);
+            T value = m_queue.front();
+            m_queue.pop_front();
+            pthread_cond_signal(&m_notFull);
+            pthread_mutex_unlock(&m_mutex);
+            return value;
+        }
+
+    private:
+        BoundedQueue(const BoundedQueue&);
+        BoundedQueue& operator=(const BoundedQueue&);
+
+        size_t m_capacity;
+        std::deque<T> m_queue;
+        pthread_mutex_t m_mutex;
+        pthread_cond_t m_notEmpty;
+        pthread_cond_t m_notFull;
+};
+
+#endif
@@ -14,16 +14,23 @@
 //
 OverlapProcess::OverlapProcess(const std::string& outFile, 
                                const OverlapAlgorithm* pOverlapper, 
-                               int minOverlap) : m_pOverlapper(pOverlapper), 
-                                                 m_minOverlap(minOverlap)
+                               int minOverlap,
+                               bool binaryEdges) : m_pWriter(NULL),
+                                                   m_pBinaryWriter(NULL),
+                                                   m_pOverlapper(pOverlapper), 
+                                                   m_minOverlap(minOverlap)
 {
-    m_pWriter = createWriter(outFile);
+    if(binaryEdges)
+        m_pBinaryWriter = new BinaryEdge::Writer(outFile, pOverlapper->getQueryRIT()->getCount());
+    else
+        m_pWriter = createWriter(outFile);
 }
 
 //
 OverlapProcess::~OverlapProcess()
 {
     delete m_pWriter;
+    delete m_pBinaryWriter;
 }
 
 //
@@ -33,58 +40,58 @@ OverlapResult OverlapProcess::process(const SequenceWorkItem& workItem)
     OverlapResult result = m_pOverlapper->overlapRead(workItem.read, m_minOverlap, &m_blockList);
 
 	//Convert list of overlap blocks into Edges
+    const ReadInfoTable* pQueryRIT = m_pOverlapper->getQueryRIT();
+    const ReadInfoTable* pTargetRIT = m_pOverlapper->getTargetRIT();
+
+    // When the reads are overlapped against themselves the reads are compared by the rank
+    // of their names instead of by name, so the names are only looked up for the text edge records
+    bool isSelfOverlap = pQueryRIT == pTargetRIT;
+    bool needIDs = !isSelfOverlap || m_pBinaryWriter == NULL;
+    std::string queryID = needIDs ? pQueryRIT->getReadID(workItem.idx) : "";
+    size_t queryLength = pQueryRIT->getReadLength(workItem.idx);
+
     OverlapBlockList::iterator it = m_blockList.begin();
 	for(; it != m_blockList.end(); it++)
     {
         // Read one block
-        OverlapBlock record = *it;
+        const OverlapBlock& record = *it;
+        const LexicoIndex* pCurrSAI = (record.flags.isTargetRev()) ? 
+											m_pOverlapper->getRevSAI() : m_pOverlapper->getFwdSAI();
 
         // Iterate through the SA interval range and write the overlaps
         for(int64_t j = record.ranges.interval[0].lower; j <= record.ranges.interval[0].upper; ++j)
         {
-            const SuffixArray* pCurrSAI = (record.flags.isTargetRev()) ? 
-												m_pOverlapper->getRevSAI() : m_pOverlapper->getFwdSAI();
-            const ReadInfo& queryInfo = m_pOverlapper->getQueryRIT()->getReadInfo(workItem.idx);
-
             int64_t saIdx = j;
 
             // The index of the second read is given as the position in the SuffixArray index
-            const ReadInfo& targetInfo = m_pOverlapper->getTargetRIT()->getReadInfo(pCurrSAI->get(saIdx).getID());
-
-            // Skip self alignments and non-canonical (where the query read has a lexo. higher name)
-            if(queryInfo.id != targetInfo.id)
-            {    
-                Overlap o = record.toOverlap(queryInfo.id, targetInfo.id, queryInfo.length, targetInfo.length);
-
-				//Don't push edges of target of super repeat vertices and small overlap
-				// bool isQuerySuperRepeat = m_pOverlapper->isSuperRepeatVertex(o.id[0]);
-				// bool isTargetSuperRepeat = m_pOverlapper->isSuperRepeatVertex(o.id[1]);
-
-                // The alignment logic above produce duplicated overlaps for each edge
-                // To avoid this, we skip overlaps where the id of the first coord is lexo. lower than 
-                // the second or the match is a containment and the query is reversed (containments can be 
-                // output up to 4 times total) or the query is super repeat or o.id[0] > o.id[1]
-				if(o.match.isContainment() && record.flags.isQueryRev())
-					continue;
-
-				if(o.id[0] < o.id[1])continue;
-
-				// //always create edges from super repeat vertex if target is super repeat
-				// if(!isQuerySuperRepeat && isTargetSuperRepeat)
-					// continue;	
-				
-				// if(isQuerySuperRepeat && isTargetSuperRepeat && o.id[0] < o.id[1])
-					// continue;
-
-				// However, the SuperRepeat of query may still produce duplicated edges while target is super repeat but not processed yet
-				// it's unknown why this lead to better results although subsequent duplicate visitor remove them 
-                // if(!isQuerySuperRepeat && !isTargetSuperRepeat && o.id[0] < o.id[1])
-					// continue;
-								
-				//assert(isQuerySuperRepeat || o.id[0] > o.id[1]);
-				
+            size_t targetIdx = pCurrSAI->get(saIdx).getID();
+
+            // The alignment logic produces duplicated overlaps for each edge.
+            // To avoid this, we skip self alignments and overlaps where the
+            // query read has the lower name of the two reads. The overlaps
+            // found from the two sides of an edge can differ, so the side
+            // must be chosen by name to give the same edges as before
+            if(isSelfOverlap && pQueryRIT->getNameRank(workItem.idx) <= pTargetRIT->getNameRank(targetIdx))
+                continue;
+
+            std::string targetID = needIDs ? pTargetRIT->getReadID(targetIdx) : "";
+            if(!isSelfOverlap && queryID <= targetID)
+                continue;
+
+            Overlap o = record.toOverlap(queryID, targetID, queryLength, pTargetRIT->getReadLength(targetIdx));
+
+            // Containments can be output up to 4 times total, skip those where the query is reversed
+            if(o.match.isContainment() && record.flags.isQueryRev())
+                continue;
+
+            if(m_pBinaryWriter != NULL)
+            {
+                m_pBinaryWriter->write(workItem.idx, targetIdx, o.match);
+            }
+            else
+            {
                 ASQG::EdgeRecord edgeRecord( o );
-				edgeRecord.write( *m_pWriter );
+                edgeRecord.write( *m_pWriter );
             }
         }
     }
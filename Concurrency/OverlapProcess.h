@@ -12,14 +12,18 @@
 #include "Util.h"
 #include "OverlapAlgorithm.h"
 #include "SequenceProcessFramework.h"
+#include "BinaryEdge.h"
 
 // Compute the overlap blocks for reads
 class OverlapProcess
 {
     public:
+        // If binaryEdges is set the edges are written as binary records
+        // naming the reads by their index, instead of ASQG edge records
         OverlapProcess(const std::string& outFile, 
                        const OverlapAlgorithm* pOverlapper, 
-                       int minOverlap);
+                       int minOverlap,
+                       bool binaryEdges = false);
 
         ~OverlapProcess();
 
@@ -27,6 +31,7 @@ class OverlapProcess
     
     private:
         std::ostream* m_pWriter;
+        BinaryEdge::Writer* m_pBinaryWriter;
         OverlapBlockList m_blockList;
         const OverlapAlgorithm* m_pOverlapper;
         const int m_minOverlap;
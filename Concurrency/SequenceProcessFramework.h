@@ -8,8 +8,12 @@
 // some operations on input data produced by a generator,
 // serially or in parallel.
 //
-#include "ThreadWorker.h"
+#include <map>
+#include <pthread.h>
+#include "BoundedQueue.h"
 #include "Timer.h"
+#include "ThreadArena.h"
+#include "NumaPolicy.h"
 #include "SequenceWorkItem.h"
 #include "config.h"
 
@@ -25,6 +29,10 @@ namespace SequenceProcessFramework
 
 const size_t BUFFER_SIZE = 1000;
 
+// The number of work items in a batch of the pipeline and the number of batches in flight per worker thread
+const size_t PIPELINE_BATCH_SIZE = 64;
+const size_t PIPELINE_BATCHES_PER_THREAD = 8;
+
 // Generic function to process n work items from a file.
 // With the default value of -1, n becomes the largest value representable for
 // a size_t and all values will be read
@@ -33,13 +41,18 @@ size_t processWorkSerial(Generator& generator, Processor* pProcessor, PostProces
 {
     Timer timer("SequenceProcess", true);
     Input workItem;
+    ThreadArena arena;
 
     // Generate work items using the generic generation class while the number
     // of sequences consumed from the SeqReader is less than n and there
     // are still sequences to consume from the reader
     while(generator.getNumConsumed() < n && generator.generate(workItem))
     {
-        Output output = pProcessor->process(workItem);
+        Output output;
+        {
+            ThreadArenaScope arenaScope(&arena);
+            output = pProcessor->process(workItem);
+        }
 
         pPostProcessor->process(workItem, output);
         if(generator.getNumConsumed() % 50000 == 0)
@@ -52,6 +65,7 @@ size_t processWorkSerial(Generator& generator, Processor* pProcessor, PostProces
     double proc_time_secs = timer.getElapsedWallTime();
     printf("Processed %zu sequences in %lfs (%lf sequences/s)\n",
             generator.getNumConsumed(), proc_time_secs, (double)generator.getNumConsumed() / proc_time_secs);
+    arena.getStats().print();
 
     return generator.getNumConsumed();
 }
@@ -83,6 +97,145 @@ size_t processSequencesSerial(const std::string& readsFile, Processor* pProcesso
 }
 
 
+// A batch of work items and their outputs. The batches are numbered in the order of the input
+template<class Input, class Output>
+struct WorkBatch
+{
+    size_t seq;
+    std::vector<Input> inputs;
+    std::vector<Output> outputs;
+};
+
+// The stages of processWorkParallelPthread. A reader thread fills batches from
+// the generator, a pool of workers processes them and the calling thread
+// post-processes them in the order of the input. The batches are recycled
+// through freeBatches, which bounds the work in flight
+template<class Input, class Output, class Generator, class Processor>
+struct WorkPipeline
+{
+    typedef WorkBatch<Input, Output> Batch;
+
+    struct Worker
+    {
+        WorkPipeline* pPipeline;
+        Processor* pProcessor;
+        size_t index;
+        pthread_t thread;
+        double busyTime;
+        ThreadArenaStats arenaStats;
+        NumaPolicy::NodeCounts nodeCounts;
+    };
+
+    WorkPipeline(Generator* pGen, size_t maxItems, size_t numWorkerThreads, size_t numBatches) : pGenerator(pGen),
+                                                                                                 n(maxItems),
+                                                                                                 numWorkers(numWorkerThreads),
+                                                                                                 freeBatches(numBatches),
+                                                                                                 inputBatches(numBatches),
+                                                                                                 outputBatches(numBatches),
+                                                                                                 numWorkItemsRead(0),
+                                                                                                 readerBusyTime(0.0) {}
+
+    // Fill batches until the generator is exhausted or n items are consumed,
+    // then send each worker a NULL batch to stop it
+    static void* runReader(void* pArg)
+    {
+        WorkPipeline* pPipeline = static_cast<WorkPipeline*>(pArg);
+        size_t seq = 0;
+        bool done = false;
+        while(!done)
+        {
+            Batch* pBatch = pPipeline->freeBatches.pop();
+            double startTime = getWallTime();
+            pBatch->seq = seq;
+
+            Input workItem;
+            while(pBatch->inputs.size() < PIPELINE_BATCH_SIZE)
+            {
+                if(pPipeline->pGenerator->getNumConsumed() >= pPipeline->n || !pPipeline->pGenerator->generate(workItem))
+                {
+                    done = true;
+                    break;
+                }
+                pBatch->inputs.push_back(workItem);
+                ++pPipeline->numWorkItemsRead;
+            }
+            pPipeline->readerBusyTime += getWallTime() - startTime;
+
+            if(pBatch->inputs.empty())
+            {
+                pPipeline->freeBatches.push(pBatch);
+            }
+            else
+            {
+                pPipeline->inputBatches.push(pBatch);
+                ++seq;
+            }
+        }
+
+        for(size_t i = 0; i < pPipeline->numWorkers; ++i)
+            pPipeline->inputBatches.push(NULL);
+        return NULL;
+    }
+
+    // Process batches until a NULL batch arrives, which is passed on to the writer.
+    // The temporaries of each work item come from the arena of the worker. The
+    // batches are counted on the NUMA node the worker runs on
+    static void* runWorker(void* pArg)
+    {
+        Worker* pWorker = static_cast<Worker*>(pArg);
+        WorkPipeline* pPipeline = pWorker->pPipeline;
+        NumaPolicy::pinWorker(pWorker->index);
+        ThreadArena arena;
+        while(true)
+        {
+            Batch* pBatch = pPipeline->inputBatches.pop();
+            if(pBatch == NULL)
+                break;
+
+            pWorker->nodeCounts.add(NumaPolicy::getCurrentNode(), pBatch->inputs.size());
+            double startTime = getWallTime();
+            for(size_t i = 0; i < pBatch->inputs.size(); ++i)
+            {
+                ThreadArenaScope arenaScope(&arena);
+                pBatch->outputs.push_back(pWorker->pProcessor->process(pBatch->inputs[i]));
+            }
+            pWorker->busyTime += getWallTime() - startTime;
+
+            pPipeline->outputBatches.push(pBatch);
+        }
+        pWorker->arenaStats = arena.getStats();
+        pPipeline->outputBatches.push(NULL);
+        return NULL;
+    }
+
+    static double getWallTime()
+    {
+        timeval now;
+        gettimeofday(&now, NULL);
+        return now.tv_sec + now.tv_usec / 1000000.0;
+    }
+
+    Generator* pGenerator;
+    size_t n;
+    size_t numWorkers;
+    BoundedQueue<Batch*> freeBatches;
+    BoundedQueue<Batch*> inputBatches;
+    BoundedQueue<Batch*> outputBatches;
+    size_t numWorkItemsRead;
+    double readerBusyTime;
+};
+
+// Start a thread of the pipeline
+static inline void createPipelineThread(pthread_t* pThread, void* (*pFunction)(void*), void* pArg)
+{
+    int ret = pthread_create(pThread, NULL, pFunction, pArg);
+    if(ret != 0)
+    {
+        std::cerr << "Thread creation failed with error " << ret << ", aborting" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
 // Design:
 // This function is a generic function to read some INPUT from a
 // generic generator object, then perform work on them.
@@ -91,11 +244,13 @@ size_t processSequencesSerial(const std::string& readsFile, Processor* pProcesso
 // created is determined by the size of the vector of processors -
 // one thread per processor.
 //
-// The function buffers batches of input data.
-// Once the buffers are full, the reads are dispatched to the thread
-// which run the actual processing independently. An optional post processor
-// can be specified to process the results that the threads return. If the n
-// parameter is used, at most n sequences will be read from the file.
+// The work flows through a three stage pipeline. A reader thread
+// fills small batches of input data and queues them. Each worker thread
+// takes the next queued batch as soon as it is free, so a batch of costly
+// reads does not hold up the others. The calling thread runs the optional
+// post processor over the results in the order of the input, while the
+// reader and the workers keep going. If the n parameter is used, at most
+// n sequences will be read from the file.
 //
 // This version is based on pthreads.
 template<class Input, class Output, class Generator, class Processor, class PostProcessor>
@@ -107,137 +262,107 @@ size_t processWorkParallelPthread(Generator& generator,
     Timer timer("SequenceProcess", true);
 
     // Helpful typedefs
-    typedef ThreadWorker<Input, Output, Processor> Thread;
-    typedef std::vector<Thread*> ThreadPtrVector;
-
-    typedef std::vector<Input> InputItemVector;
-    typedef std::vector<InputItemVector*> InputBufferVector;
-
-    typedef std::vector<Output> OutputVector;
-    typedef std::vector<OutputVector*> OutputBufferVector;
-    typedef std::vector<sem_t*> SemaphorePtrVector;
-
+    typedef WorkPipeline<Input, Output, Generator, Processor> Pipeline;
+    typedef typename Pipeline::Batch Batch;
+    typedef typename Pipeline::Worker Worker;
 
     // Initialize threads, one thread per processor that was passed in
-    int numThreads = processPtrVector.size();
-
-    ThreadPtrVector threadVec(numThreads);
-    InputBufferVector inputBuffers(numThreads);
-    OutputBufferVector outputBuffers(numThreads);
-    SemaphorePtrVector semVec(numThreads);
+    size_t numThreads = processPtrVector.size();
+    size_t numBatches = PIPELINE_BATCHES_PER_THREAD * numThreads;
+    Pipeline pipeline(&generator, n, numThreads, numBatches);
+    for(size_t i = 0; i < numBatches; ++i)
+    {
+        Batch* pBatch = new Batch;
+        pBatch->inputs.reserve(PIPELINE_BATCH_SIZE);
+        pBatch->outputs.reserve(PIPELINE_BATCH_SIZE);
+        pipeline.freeBatches.push(pBatch);
+    }
 
     // Create the threads
-    for(int i = 0; i < numThreads; ++i)
+    std::vector<Worker> workers(numThreads);
+    for(size_t i = 0; i < numThreads; ++i)
     {
-        semVec[i] = new sem_t;
-        int ret = sem_init( semVec[i], PTHREAD_PROCESS_PRIVATE, 0 );
-        if(ret != 0)
-        {
-            std::cerr << "Semaphore initialization failed with error " << ret << "\n";
-            std::cerr << "You are probably running on OSX which does not provide unnamed semaphores\n";
-            exit(EXIT_FAILURE);
-        }
-
-        // Create and start the thread
-        threadVec[i] = new Thread(semVec[i], processPtrVector[i], BUFFER_SIZE);
-        threadVec[i]->start();
-
-        inputBuffers[i] = new InputItemVector;
-        inputBuffers[i]->reserve(BUFFER_SIZE);
-
-        outputBuffers[i] = new OutputVector;
-        outputBuffers[i]->reserve(BUFFER_SIZE);
+        workers[i].pPipeline = &pipeline;
+        workers[i].pProcessor = processPtrVector[i];
+        workers[i].index = i;
+        workers[i].busyTime = 0.0;
+        createPipelineThread(&workers[i].thread, &Pipeline::runWorker, &workers[i]);
     }
+    pthread_t readerThread;
+    createPipelineThread(&readerThread, &Pipeline::runReader, &pipeline);
 
-    size_t numWorkItemsRead = 0;
+    // Post-process the batches in order. The batches finished ahead of their turn wait in pendingBatches
+    std::map<size_t, Batch*> pendingBatches;
+    size_t nextSeq = 0;
     size_t numWorkItemsWrote = 0;
-    bool done = false;
-    int next_thread = 0;
-    int num_buffers_full = 0;
-
-    while(!done)
+    size_t numWorkersDone = 0;
+    double writerBusyTime = 0.0;
+    size_t reportInterval = 10 * BUFFER_SIZE * numThreads;
+    while(numWorkersDone < numThreads)
     {
-        // Parse reads from the stream and add them into the incoming buffers
-        Input workItem;
-        bool valid = generator.generate(workItem);
-        if(valid)
+        Batch* pBatch = pipeline.outputBatches.pop();
+        if(pBatch == NULL)
         {
-            inputBuffers[next_thread]->push_back(workItem);
-            numWorkItemsRead += 1;
-
-            // Change buffers if this one is full
-            if(inputBuffers[next_thread]->size() == BUFFER_SIZE)
-            {
-                ++num_buffers_full;
-                ++next_thread;
-            }
+            ++numWorkersDone;
+            continue;
         }
+        pendingBatches[pBatch->seq] = pBatch;
 
-        done = !valid || generator.getNumConsumed() == n;
-
-        // Once all buffers are full or the input is finished, dispatch the reads to the threads
-        // by swapping work buffers.
-        if(num_buffers_full == numThreads || done)
+        while(!pendingBatches.empty() && pendingBatches.begin()->first == nextSeq)
         {
-            int numLoops = 0;
-            do
+            pBatch = pendingBatches.begin()->second;
+            pendingBatches.erase(pendingBatches.begin());
+
+            double startTime = Pipeline::getWallTime();
+            assert(pBatch->inputs.size() == pBatch->outputs.size());
+            for(size_t j = 0; j < pBatch->inputs.size(); ++j)
+                pPostProcessor->process(pBatch->inputs[j], pBatch->outputs[j]);
+            writerBusyTime += Pipeline::getWallTime() - startTime;
+
+            size_t numBefore = numWorkItemsWrote;
+            numWorkItemsWrote += pBatch->inputs.size();
+            pBatch->inputs.clear();
+            pBatch->outputs.clear();
+            pipeline.freeBatches.push(pBatch);
+            ++nextSeq;
+
+            if(numWorkItemsWrote / reportInterval != numBefore / reportInterval)
             {
-                // Wait for all threads to be ready to receive
-                for(int i = 0; i < numThreads; ++i)
-                {
-                    sem_wait(semVec[i]);
-                    Thread* pThread = threadVec[i];
-                    pThread->swapBuffers(*inputBuffers[i], *outputBuffers[i]);
-                }
-                num_buffers_full = 0;
-                next_thread = 0;
-
-                // Process the results and clear the buffers
-                for(int i = 0; i < numThreads; ++i)
-                {
-                    assert(inputBuffers[i]->size() == outputBuffers[i]->size());
-                    for(size_t j = 0; j < inputBuffers[i]->size(); ++j)
-                    {
-                        pPostProcessor->process((*inputBuffers[i])[j], (*outputBuffers[i])[j]);
-                        ++numWorkItemsWrote;
-                    }
-
-                    inputBuffers[i]->clear();
-                    outputBuffers[i]->clear();
-                }
-
                 double proc_time_secs = timer.getElapsedWallTime();
-                if(generator.getNumConsumed() % (10 * BUFFER_SIZE * numThreads) == 0)
-                    printf("Processed %zu sequences in %lfs (%lf sequences/s)\n", generator.getNumConsumed(), proc_time_secs, (double)generator.getNumConsumed() / proc_time_secs);
-
-                // This should never loop more than twice
-                assert(numLoops < 2);
-                ++numLoops;
-            } while(done && numWorkItemsWrote < numWorkItemsRead);
+                printf("Processed %zu sequences in %lfs (%lf sequences/s)\n", numWorkItemsWrote, proc_time_secs, (double)numWorkItemsWrote / proc_time_secs);
+            }
         }
     }
+    assert(pendingBatches.empty());
 
     // Cleanup
-    for(int i = 0; i < numThreads; ++i)
+    pthread_join(readerThread, NULL);
+    double workerBusyTime = 0.0;
+    ThreadArenaStats arenaStats;
+    NumaPolicy::NodeCounts nodeCounts;
+    for(size_t i = 0; i < numThreads; ++i)
     {
-        threadVec[i]->stop(); // Blocks until the thread joins
-        delete threadVec[i];
-
-        sem_destroy(semVec[i]);
-        delete semVec[i];
-
-        assert(inputBuffers[i]->empty());
-        delete inputBuffers[i];
-
-        assert(outputBuffers[i]->empty());
-        delete outputBuffers[i];
+        pthread_join(workers[i].thread, NULL);
+        workerBusyTime += workers[i].busyTime;
+        arenaStats += workers[i].arenaStats;
+        nodeCounts += workers[i].nodeCounts;
     }
+    for(size_t i = 0; i < numBatches; ++i)
+        delete pipeline.freeBatches.pop();
+
     assert(n == (size_t)-1 || generator.getNumConsumed() == n);
-    assert(numWorkItemsRead == numWorkItemsWrote);
+    assert(pipeline.numWorkItemsRead == numWorkItemsWrote);
 
     double proc_time_secs = timer.getElapsedWallTime();
     printf("Processed %zu sequences in %lfs (%lf sequences/s)\n",
             generator.getNumConsumed(), proc_time_secs, (double)generator.getNumConsumed() / proc_time_secs);
+    if(proc_time_secs > 0)
+        printf("Pipeline utilization: reader %.1lf%%, workers %.1lf%% of %zu threads, writer %.1lf%%\n",
+                100.0 * pipeline.readerBusyTime / proc_time_secs,
+                100.0 * workerBusyTime / (numThreads * proc_time_secs), numThreads,
+                100.0 * writerBusyTime / proc_time_secs);
+    nodeCounts.print("sequences", proc_time_secs);
+    arenaStats.print();
     return generator.getNumConsumed();
 }
 
@@ -389,6 +514,64 @@ size_t processSequencesParallelOpenMP(const std::string& readsFile, std::vector<
     return processSequencesParallelOpenMP<Input, Output, Processor, PostProcessor>(reader, processPtrVector, pPostProcessor);
 }
 
+// Wraps a processor that gives up on the work items over its search budget. Such an item is
+// processed again at once by the retry processor, which carries a larger budget, so its output
+// keeps its place in the stream. Without a retry processor the outputs are passed on as they are
+template<class Input, class Output, class Processor>
+class RetryProcess
+{
+    public:
+        RetryProcess(Processor* pProcessor, Processor* pRetryProcessor) : m_pProcessor(pProcessor),
+                                                                          m_pRetryProcessor(pRetryProcessor),
+                                                                          m_numItems(0),
+                                                                          m_numRetried(0),
+                                                                          m_retrySecs(0.0) {}
+
+        Output process(const Input& workItem)
+        {
+            ++m_numItems;
+            Output output = m_pProcessor->process(workItem);
+            if(!output.searchBudgetExceeded || m_pRetryProcessor == NULL)
+                return output;
+
+            Timer timer("RetryProcess", true);
+            output = m_pRetryProcessor->process(workItem);
+            ++m_numRetried;
+            m_retrySecs += timer.getElapsedWallTime();
+            return output;
+        }
+
+        size_t getNumItems() const { return m_numItems; }
+        size_t getNumRetried() const { return m_numRetried; }
+        double getRetrySecs() const { return m_retrySecs; }
+
+    private:
+        Processor* m_pProcessor;
+        Processor* m_pRetryProcessor;
+        size_t m_numItems;
+        size_t m_numRetried;
+        double m_retrySecs;
+};
+
+// Report the work items the processors retried and the share of the worker time, over a run
+// of wallSecs seconds, that the retries took
+template<class Input, class Output, class Processor>
+void printRetryStats(const std::vector<RetryProcess<Input, Output, Processor>*>& retryPtrVector, double wallSecs)
+{
+    size_t numItems = 0;
+    size_t numRetried = 0;
+    double retrySecs = 0.0;
+    for(size_t i = 0; i < retryPtrVector.size(); ++i)
+    {
+        numItems += retryPtrVector[i]->getNumItems();
+        numRetried += retryPtrVector[i]->getNumRetried();
+        retrySecs += retryPtrVector[i]->getRetrySecs();
+    }
+
+    double workerSecs = wallSecs * retryPtrVector.size();
+    printf("[Tail] %zu of %zu work items exceeded the search budget and were retried in %lfs (%.1lf%% of the worker time)\n",
+            numRetried, numItems, retrySecs, workerSecs > 0 ? 100.0 * retrySecs / workerSecs : 0.0);
+}
 
 };
 
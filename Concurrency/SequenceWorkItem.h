@@ -38,12 +38,10 @@ class WorkItemGenerator
         // Returns false when no more sequences could be consumed from the reader
         bool generate(SequenceWorkItem& out)
         {
-            SeqRecord read;
-            bool valid = m_pReader->get(read);
+            bool valid = m_pReader->get(out.read);
             if(valid)
             {
                 out.idx = m_numConsumedTotal;
-                out.read = read;
 
                 m_numConsumedLast = 1;
                 m_numConsumedTotal += 1;
@@ -58,19 +56,14 @@ class WorkItemGenerator
         // Template specialization for a SequenceWorkItemPair
         bool generate(SequenceWorkItemPair& out)
         {
-            SeqRecord read1;
-            SeqRecord read2;
-
-            bool valid1 = m_pReader->get(read1);
+            bool valid1 = m_pReader->get(out.first.read);
             if(valid1)
             {
-                bool valid2 = m_pReader->get(read2);
+                bool valid2 = m_pReader->get(out.second.read);
                 assert(valid2);
 
                 out.first.idx = m_numConsumedTotal;
                 out.second.idx = m_numConsumedTotal + 1;
-                out.first.read = read1;
-                out.second.read = read2;
 
                 m_numConsumedLast = 2;
                 m_numConsumedTotal += 2;
@@ -11,6 +11,7 @@
 #include "HashMap.h"
 #include <iomanip>
 #include "SAIntervalTree.h"
+#include "SearchBudget.h"
 
 
 //#define KMER_TESTING 1
@@ -50,16 +51,22 @@ FMIndexWalkResult FMIndexWalkProcess::MergeAndKmerize(const SequenceWorkItemPair
 											((workItemPair.first.read.seq.length()+workItemPair.second.read.seq.length())/2)*0.95;
 
 		std::string mergedseq1, mergedseq2;
-		//Walk from the 1st end to 2nd end											
-        SAIntervalTree SAITree1(&firstKRstr, m_params.minOverlap, maxOverlap, m_params.maxInsertSize, m_params.maxLeaves,
-                                            m_params.indices, reverseComplement(secondKRstr));
+		//Both walks share the search budget of the pair
+		SearchBudget budget(m_params.searchBudget);
+
+		//Walk from the 1st end to 2nd end											
+        SAIntervalTree SAITree1(&firstKRstr, m_params.minOverlap, maxOverlap, m_params.maxInsertSize, m_params.maxLeaves,
+                                            m_params.indices, reverseComplement(secondKRstr));
+        SAITree1.setSearchBudget(&budget);
         SAITree1.mergeTwoReads(mergedseq1);
 
 		//Walk from the 2nd end to 1st end using the other strand
 		SAIntervalTree SAITree2(&secondKRstr, m_params.minOverlap, maxOverlap, m_params.maxInsertSize, m_params.maxLeaves,
 											m_params.indices, reverseComplement(firstKRstr));
+		SAITree2.setSearchBudget(&budget);
 
 		SAITree2.mergeTwoReads(mergedseq2);
+		result.searchBudgetExceeded = budget.isExceeded();
 		
 		//Only one successful walk from first end, requiring maxUsedLeaves <=1 in order to avoid walking over chimera PE read.
 		if(!mergedseq1.empty() && mergedseq2.empty() && SAITree1.getMaxUsedLeaves()<=1 && SAITree2.getMaxUsedLeaves()<=1)
@@ -166,17 +173,23 @@ FMIndexWalkResult FMIndexWalkProcess::MergePairedReads(const SequenceWorkItemPai
 		//Walk from the 1st end to 2nd end
 		size_t maxOverlap = m_params.maxOverlap!=-1?m_params.maxOverlap:
 											((workItemPair.first.read.seq.length()+workItemPair.second.read.seq.length())/2)*0.9;
+
+		//Both walks share the search budget of the pair
+		SearchBudget budget(m_params.searchBudget);
 											
         SAIntervalTree SAITree(&firstKRstr, m_params.minOverlap, maxOverlap, m_params.maxInsertSize, m_params.maxLeaves,
                                             m_params.indices, reverseComplement(secondKRstr), threshold);
+        SAITree.setSearchBudget(&budget);
         std::string mergedseq;
         SAITree.mergeTwoReads(mergedseq);
 
 		//Walk from the 2nd end to 1st end 
 		SAIntervalTree SAITree2(&secondKRstr, m_params.minOverlap, maxOverlap, m_params.maxInsertSize, m_params.maxLeaves,
 											m_params.indices, reverseComplement(firstKRstr), threshold);
+		SAITree2.setSearchBudget(&budget);
 		std::string mergedseq2;
 		SAITree2.mergeTwoReads(mergedseq2);
+		result.searchBudgetExceeded = budget.isExceeded();
 			
 		//Unipath from 1st end but no path from 2nd end
 		if(!mergedseq.empty() && mergedseq2.empty() )
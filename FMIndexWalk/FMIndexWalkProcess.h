@@ -20,6 +20,7 @@
 #include "BWTAlgorithms.h"
 #include "BitVector.h"
 #include "KmerDistribution.h"
+#include "ThreadArena.h"
 
 enum FMIndexWalkAlgorithm
 {
@@ -51,12 +52,19 @@ struct FMIndexWalkParameters
 	int maxInsertSize;
     int minOverlap;
 	int maxOverlap;
+
+	// The leaves the walks of a read pair may expand, 0 is unlimited
+	size_t searchBudget;
 	
 	KmerDistribution	 kd;
 
 };
 
 
+// The k-mers of a read and their counts live as long as the work item
+typedef std::vector<std::string, ArenaAllocator<std::string> > ArenaStringVector;
+typedef std::vector<size_t, ArenaAllocator<size_t> > ArenaCountVector;
+
 struct KmerContext
 {
 	public:
@@ -79,15 +87,19 @@ struct KmerContext
 			kmerLength = kl ;
 			numKmer = readLength-kmerLength+1 ;
 			kmers.resize(numKmer);
-			kmerFreqs_same.resize(numKmer);
-			kmerFreqs_revc.resize(numKmer);
+			ArenaStringVector rcKmers(numKmer);
 
 			for (size_t i = 0 ; i < numKmer  ; i++)
 			{
 				kmers[i] = readSeq.substr (i,kmerLength);
-				kmerFreqs_same[i] = BWTAlgorithms::countSequenceOccurrencesSingleStrand(kmers[i], index) ;
-				kmerFreqs_revc[i] = BWTAlgorithms::countSequenceOccurrencesSingleStrand(reverseComplement(kmers[i]), index) ;
+				rcKmers[i] = reverseComplement(kmers[i]);
 			}
+
+			// Count all kmers of the read in one batch so the index lookups overlap
+			kmerFreqs_same.resize(numKmer);
+			kmerFreqs_revc.resize(numKmer);
+			BWTAlgorithms::countSequenceOccurrencesSingleStrand(&kmers[0], numKmer, index, &kmerFreqs_same[0]);
+			BWTAlgorithms::countSequenceOccurrencesSingleStrand(&rcKmers[0], numKmer, index, &kmerFreqs_revc[0]);
 		}
 		else
 		{
@@ -120,9 +132,9 @@ struct KmerContext
 
 	size_t readLength;
 	size_t numKmer ;
-	std::vector<std::string> kmers;
-	std::vector<size_t> kmerFreqs_same;
-	std::vector<size_t> kmerFreqs_revc;
+	ArenaStringVector kmers;
+	ArenaCountVector kmerFreqs_same;
+	ArenaCountVector kmerFreqs_revc;
 
 	bool empty(){ return readSeq.empty() ;}
 
@@ -132,7 +144,7 @@ class FMIndexWalkResult
 {
     public:
         FMIndexWalkResult()
-		: kmerize(false),kmerize2(false),merge(false),merge2(false) {}
+		: kmerize(false),kmerize2(false),merge(false),merge2(false),searchBudgetExceeded(false) {}
 
         DNAString correctSequence;
 		DNAString correctSequence2;
@@ -141,6 +153,7 @@ class FMIndexWalkResult
 		bool kmerize2;
 		bool merge;
 		bool merge2;
+		bool searchBudgetExceeded;
 
 		size_t kmerLength;
 		std::vector<DNAString> kmerizedReads ;
@@ -113,7 +113,7 @@ SAIntervalTree::SAIntervalTree(const std::string* pQuery,
                                m_pQuery(pQuery), m_minOverlap(minOverlap), m_maxOverlap(maxOverlap), m_MaxLength(MaxLength),
                                m_MaxLeaves(MaxLeaves), m_indices(indices), 
                                m_secondread(secondread), m_min_SA_threshold(SA_threshold),
-                                m_kmerMode(KmerMode), m_maxKmerCoverage(0), m_maxUsedLeaves(0), m_isBubbleCollapsed(false)
+                                m_kmerMode(KmerMode), m_maxKmerCoverage(0), m_maxUsedLeaves(0), m_isBubbleCollapsed(false), m_pBudget(NULL)
 {
     // Create the root node containing the seed string
     m_pRootNode = new SAIntervalNode(pQuery, NULL);
@@ -157,6 +157,9 @@ int SAIntervalTree::mergeTwoReads(std::string &mergedseq)
 	//BFS search from 1st to 2nd read via FM-index walk
     while(!m_leaves.empty() && m_leaves.size() <= m_MaxLeaves && m_currentLength <=m_MaxLength)
     {
+        if(m_pBudget != NULL && !m_pBudget->spend(m_leaves.size()))
+            break;
+
         // ACGT-extend the leaf nodes via updating existing SA interval
         extendLeaves();
 				
@@ -206,7 +209,9 @@ int SAIntervalTree::mergeTwoReads(std::string &mergedseq)
 	// }
 	
     //Did not reach the terminal kmer
-    if(m_leaves.empty())
+    if(m_pBudget != NULL && m_pBudget->isExceeded())
+        return -5;	//exceed search budget
+    else if(m_leaves.empty())
         return -1;	//high error
     else if(m_currentLength>m_MaxLength)
         return -2;	//exceed search depth
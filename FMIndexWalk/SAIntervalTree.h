@@ -15,11 +15,13 @@
 #include "BWT.h"
 #include "HashMap.h"
 #include "BWTAlgorithms.h"
+#include "SearchBudget.h"
+#include "ThreadArena.h"
 
 
 // Typedefs
 class SAIntervalNode;
-typedef std::list<SAIntervalNode*> STNodePtrList;
+typedef std::list<SAIntervalNode*, ArenaAllocator<SAIntervalNode*> > STNodePtrList;
 
 // Object to hold the result of the threading process
 struct SAIntervalNodeResult
@@ -40,6 +42,10 @@ class SAIntervalNode
         SAIntervalNode(const std::string* pQuery, SAIntervalNode* parent);
         ~SAIntervalNode();
 
+        // The nodes of a tree are temporaries of the work item
+        static void* operator new(size_t size) { return ThreadArena::allocate(size); }
+        static void operator delete(void* ptr, size_t size) { ThreadArena::deallocate(ptr, size); }
+
         // Add a child node to this node with the given label
         // Returns a pointer to the created node
         SAIntervalNode* createChild(const std::string& label);
@@ -115,6 +121,9 @@ class SAIntervalTree
 		size_t getMaxUsedLeaves(){return m_maxUsedLeaves;};
 		bool isBubbleCollapsed(){return m_isBubbleCollapsed;}
 
+		// Count the leaves expanded by mergeTwoReads against pBudget, which may be shared by several trees
+		void setSearchBudget(SearchBudget* pBudget){ m_pBudget = pBudget; }
+
         // Print all the strings represented by the tree
         void printAll();
 
@@ -157,6 +166,7 @@ class SAIntervalTree
 		size_t m_maxKmerCoverage;
 		size_t m_maxUsedLeaves;
 		bool m_isBubbleCollapsed;
+		SearchBudget* m_pBudget;
 
         BWTInterval m_fwdTerminatedInterval;   //in rBWT
         BWTInterval m_rvcTerminatedInterval;   //in BWT
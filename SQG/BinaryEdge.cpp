@@ -0,0 +1,134 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// BinaryEdge - Compact binary records of the edges found
+// by overlap
+//
+#include <string.h>
+#include "BinaryEdge.h"
+
+// The number of records buffered by a writer
+static const size_t WRITE_BUFFER_RECORDS = 1 << 14;
+
+//
+struct BinaryEdgeHeader
+{
+    uint16_t magic;
+    uint16_t version;
+    uint16_t recordBytes;
+    uint16_t reserved;
+    uint64_t numVertices;
+};
+
+namespace BinaryEdge
+{
+
+//
+Writer::Writer(const std::string& filename, size_t numVertices) : m_filename(filename)
+{
+    if(numVertices > (uint32_t)-1)
+    {
+        std::cerr << "Error: " << numVertices << " reads do not fit the binary edge format of " << filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+
+    m_pWriter = createWriter(filename, std::ios::out | std::ios::binary);
+    m_buffer.reserve(WRITE_BUFFER_RECORDS);
+
+    BinaryEdgeHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = BINARY_EDGE_FILE_MAGIC;
+    header.version = BINARY_EDGE_FILE_VERSION;
+    header.recordBytes = sizeof(Record);
+    header.numVertices = numVertices;
+    m_pWriter->write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+//
+Writer::~Writer()
+{
+    flush();
+    if(!m_pWriter->good())
+    {
+        std::cerr << "Error: could not write the edges " << m_filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+    delete m_pWriter;
+}
+
+//
+void Writer::write(size_t idx0, size_t idx1, const Match& match)
+{
+    Record record;
+    memset(&record, 0, sizeof(record));
+    record.idx[0] = idx0;
+    record.idx[1] = idx1;
+    for(size_t i = 0; i < 2; ++i)
+    {
+        record.start[i] = match.coord[i].interval.start;
+        record.end[i] = match.coord[i].interval.end;
+    }
+    record.numDiff = match.getNumDiffs();
+    record.flags = (match.isRC() ? BEF_REVERSE : 0) | (match.isContainment() ? BEF_CONTAINMENT : 0);
+
+    m_buffer.push_back(record);
+    if(m_buffer.size() == WRITE_BUFFER_RECORDS)
+        flush();
+}
+
+//
+void Writer::flush()
+{
+    if(!m_buffer.empty())
+        m_pWriter->write(reinterpret_cast<const char*>(&m_buffer[0]), m_buffer.size() * sizeof(Record));
+    m_buffer.clear();
+}
+
+//
+Reader::Reader(const std::string& filename) : m_filename(filename)
+{
+    m_pReader = createReader(filename, std::ios::in | std::ios::binary);
+
+    BinaryEdgeHeader header;
+    if(!m_pReader->read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+       header.magic != BINARY_EDGE_FILE_MAGIC || header.version != BINARY_EDGE_FILE_VERSION ||
+       header.recordBytes != sizeof(Record))
+    {
+        std::cerr << "Error: " << filename << " is not a binary edge file of this version\n";
+        exit(EXIT_FAILURE);
+    }
+    m_numVertices = header.numVertices;
+}
+
+//
+Reader::~Reader()
+{
+    delete m_pReader;
+}
+
+//
+bool Reader::isBinary(const std::string& filename)
+{
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    uint16_t magic = 0;
+    return in.read(reinterpret_cast<char*>(&magic), sizeof(magic)) && magic == BINARY_EDGE_FILE_MAGIC;
+}
+
+//
+bool Reader::read(RecordVector& records, size_t maxRecords)
+{
+    records.resize(maxRecords);
+    m_pReader->read(reinterpret_cast<char*>(&records[0]), maxRecords * sizeof(Record));
+    size_t numBytes = m_pReader->gcount();
+    if(numBytes % sizeof(Record) != 0)
+    {
+        std::cerr << "Error: the edge file " << m_filename << " is truncated\n";
+        exit(EXIT_FAILURE);
+    }
+    records.resize(numBytes / sizeof(Record));
+    return !records.empty();
+}
+
+};
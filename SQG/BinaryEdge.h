@@ -0,0 +1,87 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// BinaryEdge - Compact binary records of the edges found
+// by overlap. An edge names its reads by their index in the
+// reads file, which is also the order of the vertex records
+// of the ASQG file, so the records are loaded without any
+// parsing or lookup of the read names. The files hold a
+// short header followed by fixed-size records.
+//
+#ifndef BINARYEDGE_H
+#define BINARYEDGE_H
+
+#include "Util.h"
+#include "Match.h"
+
+const uint16_t BINARY_EDGE_FILE_MAGIC = 0xCAED;
+const uint16_t BINARY_EDGE_FILE_VERSION = 1;
+
+namespace BinaryEdge
+{
+    // Flags of a record
+    const uint8_t BEF_REVERSE = 1;
+    const uint8_t BEF_CONTAINMENT = 2;
+
+    // The overlap between reads idx[0] and idx[1]. The overlap covers
+    // [start[i], end[i]] of read idx[i], as in the SeqCoord of a Match
+    struct Record
+    {
+        uint32_t idx[2];
+        uint32_t start[2];
+        uint32_t end[2];
+        uint32_t numDiff;
+        uint8_t flags;
+        uint8_t reserved[3];
+
+        // Convert the record to the match of reads of the given lengths
+        Match toMatch(int seqlen0, int seqlen1) const
+        {
+            return Match(start[0], end[0], seqlen0, start[1], end[1], seqlen1, flags & BEF_REVERSE, numDiff);
+        }
+    };
+    typedef std::vector<Record> RecordVector;
+
+    //
+    class Writer
+    {
+        public:
+            // numVertices is the number of reads the indices refer to
+            Writer(const std::string& filename, size_t numVertices);
+            ~Writer();
+
+            void write(size_t idx0, size_t idx1, const Match& match);
+
+        private:
+            void flush();
+
+            std::string m_filename;
+            std::ostream* m_pWriter;
+            RecordVector m_buffer;
+    };
+
+    //
+    class Reader
+    {
+        public:
+            Reader(const std::string& filename);
+            ~Reader();
+
+            // Returns true if filename starts with the header of a binary edge file
+            static bool isBinary(const std::string& filename);
+
+            size_t getNumVertices() const { return m_numVertices; }
+
+            // Read up to maxRecords records into records. Returns false at the end of the file
+            bool read(RecordVector& records, size_t maxRecords);
+
+        private:
+            std::string m_filename;
+            std::istream* m_pReader;
+            size_t m_numVertices;
+    };
+};
+
+#endif
@@ -11,9 +11,11 @@
 #include <sstream>
 #include <iterator>
 #include "Util.h"
+#include "BGZFStream.h"
 #include "FMIndexWalk.h"
 #include "SuffixArray.h"
 #include "BWT.h"
+#include "NumaPolicy.h"
 #include "SGACommon.h"
 #include "OverlapCommon.h"
 #include "Timer.h"
@@ -46,6 +48,8 @@ static const char *CORRECT_USAGE_MESSAGE =
 "      -p, --prefix=PREFIX              use PREFIX for the names of the index files (default: prefix of the input file)\n"
 "      -o, --outfile=FILE               write the corrected reads to FILE (default: READSFILE.ec.fa)\n"
 "      -t, --threads=NUM                use NUM threads for the computation (default: 1)\n"
+"          --numa                       interleave the FM-index over the NUMA nodes and pin the worker threads to the nodes in turn\n"
+"          --gz-level=N                 compress the .gz outputs at level N, from 0 (fastest) to 9 (smallest) (default: 6)\n"
 "      -a, --algorithm=STR              specify the walking algorithm. STR must be hybrid (merge and kmerize) or merge. (default: hybrid)\n"
 "\nMerge parameters:\n"
 "      -k, --kmer-size=N                The length of the kmer to use. (default: 31)\n"
@@ -54,6 +58,10 @@ static const char *CORRECT_USAGE_MESSAGE =
 "      -I, --max-insertsize=N           the maximum insert size (i.e. search depth) (deault: 400)\n"
 "      -m, --min-overlap=N           the min overlap (default: 81)\n"
 "      -M, --max-overlap=N           the max overlap (default: avg read length*0.9)\n"
+"          --search-budget=N            walk a pair again with the retry budget when its walks expand more than N\n"
+"                                       leaves (default: 0, no budget)\n"
+"          --retry-budget=N             the search budget of the second attempt. The pairs still over it are not\n"
+"                                       merged (default: 0, no budget)\n"
 
 "\nReport bugs to " PACKAGE_BUGREPORT "\n\n";
 
@@ -64,6 +72,8 @@ namespace opt
 {
     static unsigned int verbose;
     static int numThreads = 1;
+    static bool useNuma = false;
+    static int gzLevel = 6;
     static std::string prefix;
     static std::string readsFile;
     static std::string outFile;
@@ -79,13 +89,15 @@ namespace opt
 	static int maxInsertSize=400;
 	static int minOverlap=81;
 	static int maxOverlap=-1;
+	static size_t searchBudget = 0;
+	static size_t retryBudget = 0;
 
     static FMIndexWalkAlgorithm algorithm = FMW_HYBRID;
 }
 
 static const char* shortopts = "p:t:o:a:k:x:L:I:m:M:v";
 
-enum { OPT_HELP = 1, OPT_VERSION, OPT_METRICS, OPT_DISCARD, OPT_LEARN };
+enum { OPT_HELP = 1, OPT_VERSION, OPT_METRICS, OPT_DISCARD, OPT_LEARN, OPT_GZLEVEL, OPT_SEARCHBUDGET, OPT_RETRYBUDGET, OPT_NUMA };
 
 static const struct option longopts[] = {
     { "verbose",       no_argument,       NULL, 'v' },
@@ -100,6 +112,10 @@ static const struct option longopts[] = {
     { "min-overlap"   ,required_argument, NULL, 'm' },
     { "learn",         no_argument,       NULL, OPT_LEARN },
     { "discard",       no_argument,       NULL, OPT_DISCARD },
+    { "gz-level",      required_argument, NULL, OPT_GZLEVEL },
+    { "search-budget", required_argument, NULL, OPT_SEARCHBUDGET },
+    { "retry-budget",  required_argument, NULL, OPT_RETRYBUDGET },
+    { "numa",          no_argument,       NULL, OPT_NUMA },
     { "help",          no_argument,       NULL, OPT_HELP },
     { "version",       no_argument,       NULL, OPT_VERSION },
     { "metrics",       required_argument, NULL, OPT_METRICS },
@@ -112,6 +128,8 @@ static const struct option longopts[] = {
 int FMindexWalkMain(int argc, char** argv)
 {
     parseFMWalkOptions(argc, argv);
+    if(opt::useNuma)
+        NumaPolicy::enable();
 
     // Set the error correction parameters
     FMIndexWalkParameters ecParams;
@@ -134,7 +152,7 @@ int FMindexWalkMain(int argc, char** argv)
 		#pragma omp single nowait
 		{
 			std::cout << "Loading Sampled Suffix Array: " << opt::prefix + SAI_EXT << "\n";
-			pSSA = new SampledSuffixArray(opt::prefix + SAI_EXT, SSA_FT_SAI);
+			pSSA = SampledSuffixArray::load(opt::prefix + SSA_EXT, opt::prefix + SAI_EXT);
 		}
 	}
 
@@ -165,9 +183,17 @@ int FMindexWalkMain(int argc, char** argv)
 	ecParams.maxInsertSize = opt::maxInsertSize;
     ecParams.minOverlap = opt::minOverlap;
     ecParams.maxOverlap = opt::maxOverlap;
+    ecParams.searchBudget = opt::searchBudget;
 	
     // Setup post-processor
     FMIndexWalkPostProcess postProcessor(pWriter, pDiscardWriter, ecParams);
+
+    // A pair over the search budget is walked again at once with the retry budget
+    typedef SequenceProcessFramework::RetryProcess<SequenceWorkItemPair, FMIndexWalkResult, FMIndexWalkProcess> PairRetryProcessor;
+    bool bPairs = ecParams.algorithm == FMW_HYBRID || ecParams.algorithm == FMW_MERGE;
+    FMIndexWalkParameters retryParams = ecParams;
+    retryParams.searchBudget = opt::retryBudget;
+    Timer passTimer(PROGRAM_IDENT, true);
 
     std::cout << "Merge paired end reads into long reads for " << opt::readsFile << " using \n" 
 				<< "min overlap=" <<  ecParams.minOverlap << "\t"
@@ -176,49 +202,56 @@ int FMindexWalkMain(int argc, char** argv)
 				<< "max Insert size=" << opt::maxInsertSize << "\t"
 				<< "kmer size=" << opt::kmerLength << "\n\n";
 
+    int numProcessors = opt::numThreads <= 1 ? 1 : opt::numThreads;
+    std::vector<FMIndexWalkProcess*> processorVector;
+    std::vector<FMIndexWalkProcess*> retryProcessorVector;
+    std::vector<PairRetryProcessor*> retryVector;
+    for(int i = 0; i < numProcessors; ++i)
+    {
+        processorVector.push_back(new FMIndexWalkProcess(ecParams));
+        retryProcessorVector.push_back(opt::searchBudget > 0 ? new FMIndexWalkProcess(retryParams) : NULL);
+        retryVector.push_back(new PairRetryProcessor(processorVector[i], retryProcessorVector[i]));
+    }
+
     if(opt::numThreads <= 1)
     {
         // Serial mode
-        FMIndexWalkProcess processor(ecParams);
-
-		if (ecParams.algorithm == FMW_HYBRID || ecParams.algorithm == FMW_MERGE )
+		if (bPairs)
         SequenceProcessFramework::processSequencesSerial<SequenceWorkItemPair,
                                                          FMIndexWalkResult,
-                                                         FMIndexWalkProcess,
-                                                         FMIndexWalkPostProcess>(opt::readsFile, &processor, &postProcessor);
+                                                         PairRetryProcessor,
+                                                         FMIndexWalkPostProcess>(opt::readsFile, retryVector.front(), &postProcessor);
 
 		else
         SequenceProcessFramework::processSequencesSerial<SequenceWorkItem,
                                                          FMIndexWalkResult,
                                                          FMIndexWalkProcess,
-                                                         FMIndexWalkPostProcess>(opt::readsFile, &processor, &postProcessor);
+                                                         FMIndexWalkPostProcess>(opt::readsFile, processorVector.front(), &postProcessor);
     }
     else
     {
         // Parallel mode
-        std::vector<FMIndexWalkProcess*> processorVector;
-        for(int i = 0; i < opt::numThreads; ++i)
-        {
-            FMIndexWalkProcess* pProcessor = new FMIndexWalkProcess(ecParams);
-            processorVector.push_back(pProcessor);
-        }
-
-		if (ecParams.algorithm == FMW_HYBRID || ecParams.algorithm == FMW_MERGE )
+		if (bPairs)
         SequenceProcessFramework::processSequencesParallel<SequenceWorkItemPair,
                                                            FMIndexWalkResult,
-                                                           FMIndexWalkProcess,
-                                                           FMIndexWalkPostProcess>(opt::readsFile, processorVector, &postProcessor);
+                                                           PairRetryProcessor,
+                                                           FMIndexWalkPostProcess>(opt::readsFile, retryVector, &postProcessor);
 
 		else
         SequenceProcessFramework::processSequencesParallel<SequenceWorkItem,
                                                            FMIndexWalkResult,
                                                            FMIndexWalkProcess,
                                                            FMIndexWalkPostProcess>(opt::readsFile, processorVector, &postProcessor);
+    }
 
-        for(int i = 0; i < opt::numThreads; ++i)
-        {
-            delete processorVector[i];
-        }
+    if(bPairs && opt::searchBudget > 0)
+        SequenceProcessFramework::printRetryStats(retryVector, passTimer.getElapsedWallTime());
+
+    for(int i = 0; i < numProcessors; ++i)
+    {
+        delete retryVector[i];
+        delete retryProcessorVector[i];
+        delete processorVector[i];
     }
 
     delete pBWT;
@@ -264,6 +297,10 @@ void parseFMWalkOptions(int argc, char** argv)
             case 'm': arg >> opt::minOverlap; break;
             case 'M': arg >> opt::maxOverlap; break;
             case OPT_LEARN: opt::bLearnKmerParams = true; break;
+            case OPT_GZLEVEL: arg >> opt::gzLevel; break;
+            case OPT_SEARCHBUDGET: arg >> opt::searchBudget; break;
+            case OPT_RETRYBUDGET: arg >> opt::retryBudget; break;
+            case OPT_NUMA: opt::useNuma = true; break;
             case OPT_HELP:
                 std::cout << CORRECT_USAGE_MESSAGE;
                 exit(EXIT_SUCCESS);
@@ -317,12 +354,26 @@ void parseFMWalkOptions(int argc, char** argv)
         }
     }
 
+    if(opt::retryBudget != 0 && opt::retryBudget <= opt::searchBudget)
+    {
+        std::cerr << SUBPROGRAM ": invalid retry budget: " << opt::retryBudget << ", must be greater than the search budget\n";
+        die = true;
+    }
+
+    if(opt::gzLevel < 0 || opt::gzLevel > 9)
+    {
+        std::cerr << SUBPROGRAM ": invalid compression level: " << opt::gzLevel << ", must be between 0 and 9\n";
+        die = true;
+    }
+
     if (die)
     {
         std::cout << "\n" << CORRECT_USAGE_MESSAGE;
         exit(EXIT_FAILURE);
     }
 
+    BGZFStreamBuf::setDefaultLevel(opt::gzLevel);
+
     // Parse the input filenames
     opt::readsFile = argv[optind++];
 
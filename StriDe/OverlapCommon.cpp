@@ -16,8 +16,8 @@
 void OverlapCommon::parseHitsString(const std::string& hitString, 
                                     const ReadInfoTable* pQueryRIT, 
                                     const ReadInfoTable* pTargetRIT, 
-                                    const SuffixArray* pFwdSAI, 
-                                    const SuffixArray* pRevSAI, 
+                                    const LexicoIndex* pFwdSAI, 
+                                    const LexicoIndex* pRevSAI, 
                                     bool bCheckIDs,
                                     size_t& readIdx,
                                     size_t& sumBlockSize,
@@ -45,7 +45,7 @@ void OverlapCommon::parseHitsString(const std::string& hitString,
         for(int64_t j = record.ranges.interval[0].lower; j <= record.ranges.interval[0].upper; ++j)
         {
             sumBlockSize += 1;
-            const SuffixArray* pCurrSAI = (record.flags.isTargetRev()) ? pRevSAI : pFwdSAI;
+            const LexicoIndex* pCurrSAI = (record.flags.isTargetRev()) ? pRevSAI : pFwdSAI;
             const ReadInfo& queryInfo = pQueryRIT->getReadInfo(readIdx);
 
             int64_t saIdx = j;
@@ -12,6 +12,7 @@
 #include "Util.h"
 #include "overlap.h"
 #include "SuffixArray.h"
+#include "LexicoIndex.h"
 #include "SGACommon.h"
 #include "Timer.h"
 #include "ReadInfoTable.h"
@@ -23,8 +24,8 @@ namespace OverlapCommon
 void parseHitsString(const std::string& hitString, 
                      const ReadInfoTable* pQueryRIT, 
                      const ReadInfoTable* pTargetRIT, 
-                     const SuffixArray* pFwdSAI, 
-                     const SuffixArray* pRevSAI,
+                     const LexicoIndex* pFwdSAI, 
+                     const LexicoIndex* pRevSAI,
                      bool bCheckIDs,
                      size_t& readIdx, 
                      size_t& sumBlockSize,
@@ -14,6 +14,7 @@
 // File extensions
 #define OVR_EXT ".ovr"
 #define HITS_EXT ".edges"
+#define BIN_EXT ".bin"
 #define RMDUPHITS_EXT ".rmhits"
 #define GMAPHITS_EXT ".gmhits"
 #define CTN_EXT ".ctn"
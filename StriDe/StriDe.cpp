@@ -17,10 +17,13 @@
 #include "subgraph.h"
 #include "filter.h"
 #include "fm-merge.h"
+#include "merge.h"
 #include "kmerfreq.h"
 #include "grep.h"
 #include "FMIndexWalk.h"
 #include "strideall.h"
+#include "bwtbench.h"
+#include "convert-sai.h"
 
 #define PROGRAM_BIN "stride"
 #define AUTHOR "Yao-Ting Huang"
@@ -47,7 +50,9 @@ static const char *STRIDE_USAGE_MESSAGE =
 "      overlap     compute overlaps between reads\n"
 "      assemble    generate contigs from an assembly graph\n"
 "\nOther Commands:\n"
-"      merge	merge multiple BWT/FM-index files into a single index\n"
+"      merge       merge multiple BWT/FM-index files into a single index\n"
+"      bwtbench    benchmark the rlbwt and rank FM-index backends on a .bwt file\n"
+"      convert-sai convert .sai/.rsai files written by earlier versions to the binary format\n"
 "\nReport bugs to " PACKAGE_BUGREPORT "\n\n";
 
 int main(int argc, char** argv)
@@ -79,6 +84,8 @@ int main(int argc, char** argv)
             indexMain(argc - 1, argv + 1);
         else if(command == "filter")
             filterMain(argc - 1, argv + 1);
+        else if(command == "merge")
+            mergeMain(argc - 1, argv + 1);
         else if(command == "fm-merge")
             FMMergeMain(argc - 1, argv + 1);
         else if(command == "overlap")
@@ -97,6 +104,10 @@ int main(int argc, char** argv)
             grepMain(argc - 1, argv + 1);
         else if(command == "fmwalk")
             FMindexWalkMain(argc - 1, argv + 1);
+        else if(command == "bwtbench")
+            bwtbenchMain(argc - 1, argv + 1);
+        else if(command == "convert-sai")
+            convertSAIMain(argc - 1, argv + 1);
 
         else
         {
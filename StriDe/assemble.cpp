@@ -20,6 +20,7 @@
 #include "EncodedString.h"
 #include "SuffixArray.h"
 #include "BWT.h"
+#include "NumaPolicy.h"
 #include "SGACommon.h"
 #include "BWTAlgorithms.h"
 #include "BWTIntervalCache.h"
@@ -55,6 +56,7 @@ static const char *ASSEMBLE_USAGE_MESSAGE =
 "      -m, --min-overlap=LEN            only use overlaps of at least LEN. This can be used to filter\n"
 "          --transitive-reduction       remove transitive edges from the graph. Off by default.\n"
 "          --max-edges=N                limit each vertex to a maximum of N edges. For highly repetitive regions\n"
+"          --numa                       interleave the FM-index over the NUMA nodes and pin the worker threads to the nodes in turn\n"
 "\nReport bugs to " PACKAGE_BUGREPORT "\n\n";
 
 
@@ -73,6 +75,7 @@ namespace opt
 
 	static unsigned int minOverlap=30;
 	static size_t maxEdges = 512;
+	static bool useNuma = false;
 
 	//kmer frequence parameters
 	static size_t kmerLength = 31;
@@ -103,7 +106,7 @@ namespace opt
 
 static const char* shortopts = "k:t:p:o:m:i:r:T:x:c:v";
 
-enum { OPT_HELP = 1, OPT_VERSION, OPT_EXACT, OPT_MAXINDEL,OPT_MAXEDGES};
+enum { OPT_HELP = 1, OPT_VERSION, OPT_EXACT, OPT_MAXINDEL,OPT_MAXEDGES, OPT_NUMA};
 
 static const struct option longopts[] = {
 	{ "verbose",               no_argument,       NULL, 'v' },
@@ -121,6 +124,7 @@ static const struct option longopts[] = {
 	{ "credible-overlap",      required_argument, NULL, 'c' },
 	{ "insert-size",           required_argument, NULL, 'i' },
 	{ "exact",                 no_argument,       NULL, OPT_EXACT },
+	{ "numa",                  no_argument,       NULL, OPT_NUMA },
 	{ "help",                  no_argument,       NULL, OPT_HELP },
 	{ "version",               no_argument,       NULL, OPT_VERSION },
 	{ NULL, 0, NULL, 0 }
@@ -133,6 +137,8 @@ int assembleMain(int argc, char** argv)
 {
 	Timer* pTimer = new Timer("StriDe assembly");
 	parseAssembleOptions(argc, argv);
+	if(opt::useNuma)
+		NumaPolicy::enable();
 
 	std::cout << "\n#---  Parameters   ---#\n";
 	std::cout << "Kmer Size              : " << opt::kmerLength << std::endl;
@@ -151,12 +157,14 @@ int assembleMain(int argc, char** argv)
 int assemble()
 {
 	StringGraph* pGraph;
+	// The binary edges refer to the vertices by index, so the vertex names need not be indexed
+	bool integerIDs = SGUtil::hasBinaryEdges(opt::asqgFile);
 	#pragma omp parallel
 	{
 		#pragma omp single nowait
 		{
 			std::cout << "\n[ Loading string graph: " << opt::asqgFile <<  " ]\n";
-			pGraph=SGUtil::loadASQGVertex(opt::asqgFile, opt::minOverlap, true, opt::maxEdges);
+			pGraph=SGUtil::loadASQGVertex(opt::asqgFile, opt::minOverlap, true, opt::maxEdges, integerIDs);
 		}
 		#pragma omp single nowait
 		{
@@ -171,7 +179,7 @@ int assemble()
 		#pragma omp single nowait
 		{
 			std::cout << "[ Loading SAI ]\n";
-			opt::pSSA = new SampledSuffixArray(opt::prefix + SAI_EXT, SSA_FT_SAI);
+			opt::pSSA = SampledSuffixArray::load(opt::prefix + SSA_EXT, opt::prefix + SAI_EXT);
 		}
 	}
     opt::indices.pBWT = opt::pBWT;
@@ -343,11 +351,12 @@ int assemble()
     /*** 2. Collect read IDs mapped to large island/tip with size > min_size_of_islandtip ***/
 	ThreadSafeListVector tslv;
 	tslv.resize(opt::pSSA->getNumberOfReads());
-    SGIslandCollectVisitor sgicv(&tslv, opt::indices, opt::insertSize, 51, min_size_of_islandtip);
+	IslandReadIDMap islandReadIDs;
+    SGIslandCollectVisitor sgicv(&tslv, &islandReadIDs, opt::indices, opt::insertSize, 51, min_size_of_islandtip);
     pGraph->visitP(sgicv);
     
 	/*** 3. Join islands/tips with PE support using FM-index walk (depth,leaves,minoverlap)=(150, 2000, 19) ***/
-	SGJoinIslandVisitor sgjiv(100, 4000, opt::kmerLength/2+4, min_size_of_islandtip, &tslv, opt::indices, 3);
+	SGJoinIslandVisitor sgjiv(100, 4000, opt::kmerLength/2+4, min_size_of_islandtip, &tslv, &islandReadIDs, opt::indices, 3);
 	pGraph->visitProgress(sgjiv);
 	graphTrimAndSmooth (pGraph, opt::maxChimeraLength, false);
 
@@ -363,6 +372,9 @@ int assemble()
 	pGraph->writeASQG(opt::outGraphFile);
     pGraph->writeDot("StriDe-graph.dot",0);
 
+	std::cout << "\n[Stats] Visitor timing:\n";
+	pGraph->printVisitStats();
+
 	delete pGraph;
 	return 0;
 
@@ -397,6 +409,7 @@ void parseAssembleOptions(int argc, char** argv)
 		case OPT_MAXEDGES: arg >> opt::maxEdges; break;
 		case OPT_MAXINDEL: arg >> opt::maxIndelLength; break;
 		case OPT_EXACT: opt::bExact = true; break;
+		case OPT_NUMA: opt::useNuma = true; break;
 		case OPT_HELP:
 			std::cout << ASSEMBLE_USAGE_MESSAGE;
 			exit(EXIT_SUCCESS);
@@ -541,4 +554,7 @@ void outputGraphAndFasta(StringGraph* pGraph , std::string  name , int phase)
 	SGFastaVisitor fastaVisit (out+"contigs.fa");
 	pGraph->visit(fastaVisit);
 	// pGraph->writeASQG(out+"graph.asqg.gz");
+
+	// Release the vertices and edges removed in this phase
+	pGraph->compactMemory();
 }
@@ -0,0 +1,284 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// bwtbench - Compare the query speed of the FM-index backends
+// on a real .bwt file. Both backends answer the same random
+// getOcc/getFullOcc queries and backward searches of k-mers
+// sampled from the index, and the results are cross-checked.
+//
+#include <iostream>
+#include <fstream>
+#include "SGACommon.h"
+#include "Util.h"
+#include "bwtbench.h"
+#include "RLBWT.h"
+#include "RankBWT.h"
+#include "Timer.h"
+#include "BWTAlgorithms.h"
+
+//
+// Getopt
+//
+#define SUBPROGRAM "bwtbench"
+
+static const char *BWTBENCH_VERSION_MESSAGE =
+SUBPROGRAM " Version " PACKAGE_VERSION "\n"
+"\n";
+
+static const char *BWTBENCH_USAGE_MESSAGE =
+"Usage: " PACKAGE_NAME " " SUBPROGRAM " [OPTION] ... BWTFILE\n"
+"Benchmark the rlbwt and rank FM-index backends head-to-head on BWTFILE\n"
+"  -k, --kmer-length=N                  length of the k-mers used for backward searches (default: 31)\n"
+"  -n, --num-queries=N                  number of random occurrence queries (default: 1000000)\n"
+"  -s, --seed=N                         random seed (default: 1)\n"
+"  -v, --verbose                        display verbose output\n"
+"      --help                           display this help and exit\n";
+
+namespace opt
+{
+    static unsigned int verbose;
+    static std::string bwtFile;
+    static size_t kmerLength = 31;
+    static size_t numQueries = 1000000;
+    static unsigned int seed = 1;
+}
+
+static const char* shortopts = "k:n:s:v";
+
+enum { OPT_HELP = 1, OPT_VERSION };
+
+static const struct option longopts[] = {
+    { "verbose",     no_argument,       NULL, 'v' },
+    { "kmer-length", required_argument, NULL, 'k' },
+    { "num-queries", required_argument, NULL, 'n' },
+    { "seed",        required_argument, NULL, 's' },
+    { "help",        no_argument,       NULL, OPT_HELP },
+    { "version",     no_argument,       NULL, OPT_VERSION },
+    { NULL, 0, NULL, 0 }
+};
+
+// Return a random substring of length len read backwards from a random position of the bwt
+static std::string sampleSubstring(const RLBWT* pBWT, size_t len)
+{
+    size_t tries = 1000;
+    while(tries-- > 0)
+    {
+        size_t idx = ((size_t)rand() * RAND_MAX + rand()) % pBWT->getBWLen();
+        std::string out;
+        BWTInterval interval(idx, idx);
+        while(out.length() < len)
+        {
+            char b = pBWT->getChar(interval.lower);
+            if(b == '$')
+                break;
+            out.push_back(b);
+            BWTAlgorithms::updateInterval(interval, b, pBWT);
+        }
+        if(out.size() == len)
+            return reverse(out);
+    }
+    return "";
+}
+
+// The result of timing one query type on one backend
+struct BenchResult
+{
+    double seconds;
+    size_t checksum;
+};
+
+//
+template<class T>
+static BenchResult benchOcc(const T* pBWT, const std::vector<size_t>& positions, const std::string& symbols)
+{
+    Timer timer("occ", true);
+    size_t checksum = 0;
+    for(size_t i = 0; i < positions.size(); ++i)
+        checksum += pBWT->getOcc(symbols[i], positions[i]);
+    BenchResult result = { timer.getElapsedWallTime(), checksum };
+    return result;
+}
+
+//
+template<class T>
+static BenchResult benchFullOcc(const T* pBWT, const std::vector<size_t>& positions)
+{
+    Timer timer("fullocc", true);
+    size_t checksum = 0;
+    for(size_t i = 0; i < positions.size(); ++i)
+    {
+        AlphaCount64 ac = pBWT->getFullOcc(positions[i]);
+        for(size_t j = 0; j < ALPHABET_SIZE; ++j)
+            checksum += ac.getByIdx(j) * (j + 1);
+    }
+    BenchResult result = { timer.getElapsedWallTime(), checksum };
+    return result;
+}
+
+// Backward search of every k-mer, the checksum is the total number of occurrences
+template<class T>
+static BenchResult benchSearch(const T* pBWT, const StringVector& kmers)
+{
+    Timer timer("search", true);
+    size_t checksum = 0;
+    for(size_t i = 0; i < kmers.size(); ++i)
+    {
+        const std::string& w = kmers[i];
+        int j = w.size() - 1;
+        char curr = w[j];
+        int64_t lower = pBWT->getPC(curr);
+        int64_t upper = lower + pBWT->getOcc(curr, pBWT->getBWLen() - 1) - 1;
+        --j;
+        for(; j >= 0 && lower <= upper; --j)
+        {
+            curr = w[j];
+            size_t pb = pBWT->getPC(curr);
+            lower = pb + pBWT->getOcc(curr, lower - 1);
+            upper = pb + pBWT->getOcc(curr, upper) - 1;
+        }
+        if(lower <= upper)
+            checksum += upper - lower + 1;
+    }
+    BenchResult result = { timer.getElapsedWallTime(), checksum };
+    return result;
+}
+
+//
+static void printResult(const std::string& backend, const std::string& query, size_t n, const BenchResult& result)
+{
+    printf("%-8s %-10s %10zu %10.3lf %12.3lf\n", backend.c_str(), query.c_str(), n, result.seconds, n / result.seconds / 1000000);
+}
+
+//
+static void checkResults(const std::string& query, const BenchResult& a, const BenchResult& b)
+{
+    if(a.checksum != b.checksum)
+    {
+        std::cerr << SUBPROGRAM ": the backends disagree on " << query << " (" << a.checksum << " != " << b.checksum << ")\n";
+        exit(EXIT_FAILURE);
+    }
+}
+
+int bwtbenchMain(int argc, char** argv)
+{
+    parseBWTBenchOptions(argc, argv);
+    srand(opt::seed);
+
+    Timer* pLoadTimer = new Timer("Load rlbwt", true);
+    RLBWT* pBWT = new RLBWT(opt::bwtFile);
+    double rlLoadTime = pLoadTimer->getElapsedWallTime();
+    pLoadTimer->reset();
+    RankBWT* pRankBWT = new RankBWT(opt::bwtFile);
+    double rankLoadTime = pLoadTimer->getElapsedWallTime();
+    delete pLoadTimer;
+
+    if(opt::verbose > 0)
+    {
+        pBWT->printInfo();
+        pRankBWT->printInfo();
+    }
+
+    printf("Load time -- rlbwt: %.3lfs%s rank: %.3lfs%s\n", rlLoadTime, pBWT->isMapped() ? " (mapped)" : "",
+                                                           rankLoadTime, pRankBWT->isMapped() ? " (mapped)" : "");
+
+    // Generate the queries
+    size_t n = pBWT->getBWLen();
+    std::vector<size_t> positions(opt::numQueries);
+    std::string symbols(opt::numQueries, 'A');
+    for(size_t i = 0; i < opt::numQueries; ++i)
+    {
+        positions[i] = ((size_t)rand() * RAND_MAX + rand()) % n;
+        symbols[i] = RANK_ALPHABET[1 + rand() % DNA_ALPHABET_SIZE];
+    }
+
+    size_t numKmers = std::max<size_t>(opt::numQueries / opt::kmerLength, 1);
+    StringVector kmers;
+    kmers.reserve(numKmers);
+    for(size_t i = 0; i < numKmers; ++i)
+    {
+        std::string kmer = sampleSubstring(pBWT, opt::kmerLength);
+        if(!kmer.empty())
+            kmers.push_back(kmer);
+    }
+
+    printf("%-8s %-10s %10s %10s %12s\n", "backend", "query", "n", "seconds", "Mqueries/s");
+
+    BenchResult rlOcc = benchOcc(pBWT, positions, symbols);
+    BenchResult rankOcc = benchOcc(pRankBWT, positions, symbols);
+    printResult("rlbwt", "getOcc", positions.size(), rlOcc);
+    printResult("rank", "getOcc", positions.size(), rankOcc);
+    checkResults("getOcc", rlOcc, rankOcc);
+
+    BenchResult rlFullOcc = benchFullOcc(pBWT, positions);
+    BenchResult rankFullOcc = benchFullOcc(pRankBWT, positions);
+    printResult("rlbwt", "getFullOcc", positions.size(), rlFullOcc);
+    printResult("rank", "getFullOcc", positions.size(), rankFullOcc);
+    checkResults("getFullOcc", rlFullOcc, rankFullOcc);
+
+    BenchResult rlSearch = benchSearch(pBWT, kmers);
+    BenchResult rankSearch = benchSearch(pRankBWT, kmers);
+    printResult("rlbwt", "search", kmers.size(), rlSearch);
+    printResult("rank", "search", kmers.size(), rankSearch);
+    checkResults("search", rlSearch, rankSearch);
+
+    printf("Speedup of rank over rlbwt -- getOcc: %.2lfx getFullOcc: %.2lfx search: %.2lfx\n",
+           rlOcc.seconds / rankOcc.seconds, rlFullOcc.seconds / rankFullOcc.seconds, rlSearch.seconds / rankSearch.seconds);
+
+    delete pRankBWT;
+    delete pBWT;
+    return 0;
+}
+
+//
+// Handle command line arguments
+//
+void parseBWTBenchOptions(int argc, char** argv)
+{
+    optind = 1;
+    bool die = false;
+    for (char c; (c = getopt_long(argc, argv, shortopts, longopts, NULL)) != -1;)
+    {
+        std::istringstream arg(optarg != NULL ? optarg : "");
+        switch (c)
+        {
+            case '?': die = true; break;
+            case 'v': opt::verbose++; break;
+            case 'k': arg >> opt::kmerLength; break;
+            case 'n': arg >> opt::numQueries; break;
+            case 's': arg >> opt::seed; break;
+            case OPT_HELP:
+                std::cout << BWTBENCH_USAGE_MESSAGE;
+                exit(EXIT_SUCCESS);
+            case OPT_VERSION:
+                std::cout << BWTBENCH_VERSION_MESSAGE;
+                exit(EXIT_SUCCESS);
+        }
+    }
+
+    if (argc - optind < 1)
+    {
+        std::cerr << SUBPROGRAM ": missing arguments\n";
+        die = true;
+    }
+    else if (argc - optind > 1)
+    {
+        std::cerr << SUBPROGRAM ": too many arguments\n";
+        die = true;
+    }
+
+    if(opt::kmerLength == 0 || opt::numQueries == 0)
+    {
+        std::cerr << SUBPROGRAM ": the k-mer length and number of queries must be positive\n";
+        die = true;
+    }
+
+    if (die)
+    {
+        std::cout << "\n" << BWTBENCH_USAGE_MESSAGE;
+        exit(EXIT_FAILURE);
+    }
+
+    opt::bwtFile = argv[optind++];
+}
@@ -0,0 +1,16 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// bwtbench - Compare the query speed of the FM-index backends
+//
+#ifndef BWTBENCH_H
+#define BWTBENCH_H
+#include <getopt.h>
+#include "config.h"
+
+int bwtbenchMain(int argc, char** argv);
+void parseBWTBenchOptions(int argc, char** argv);
+
+#endif
@@ -0,0 +1,121 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// convert-sai - Convert suffix array index files (.sai/.rsai)
+// written in the text format by earlier versions to the binary
+// format that is memory-mapped by overlap, correct and assemble.
+// Each file is replaced by its conversion.
+//
+#include <iostream>
+#include <cstdio>
+#include "Util.h"
+#include "convert-sai.h"
+#include "LexicoIndex.h"
+#include "Timer.h"
+
+//
+// Getopt
+//
+#define SUBPROGRAM "convert-sai"
+
+static const char *CONVERTSAI_VERSION_MESSAGE =
+SUBPROGRAM " Version " PACKAGE_VERSION "\n"
+"\n";
+
+static const char *CONVERTSAI_USAGE_MESSAGE =
+"Usage: " PACKAGE_NAME " " SUBPROGRAM " [OPTION] ... SAIFILE ...\n"
+"Convert each SAIFILE (.sai or .rsai) from the text format to the binary format, in place.\n"
+"Files that are already binary are left unchanged.\n"
+"  -v, --verbose                        display verbose output\n"
+"      --help                           display this help and exit\n";
+
+namespace opt
+{
+    static unsigned int verbose;
+    static std::vector<std::string> saiFiles;
+}
+
+static const char* shortopts = "v";
+
+enum { OPT_HELP = 1, OPT_VERSION };
+
+static const struct option longopts[] = {
+    { "verbose",     no_argument,       NULL, 'v' },
+    { "help",        no_argument,       NULL, OPT_HELP },
+    { "version",     no_argument,       NULL, OPT_VERSION },
+    { NULL, 0, NULL, 0 }
+};
+
+int convertSAIMain(int argc, char** argv)
+{
+    parseConvertSAIOptions(argc, argv);
+    Timer t(SUBPROGRAM);
+
+    for(size_t i = 0; i < opt::saiFiles.size(); ++i)
+    {
+        const std::string& filename = opt::saiFiles[i];
+        if(LexicoIndex::isBinary(filename))
+        {
+            std::cout << filename << " is already binary, skipping\n";
+            continue;
+        }
+
+        // Write next to the input and rename so an interrupted conversion leaves the original
+        LexicoIndex index(filename);
+        std::string tmpFilename = filename + ".tmp";
+        {
+            LexicoIndexWriter writer(tmpFilename, index.getNumStrings());
+            for(size_t j = 0; j < index.getSize(); ++j)
+                writer.writeID(index.getID(j));
+        }
+
+        if(rename(tmpFilename.c_str(), filename.c_str()) != 0)
+        {
+            std::cerr << SUBPROGRAM ": could not replace " << filename << " with " << tmpFilename << "\n";
+            exit(EXIT_FAILURE);
+        }
+        std::cout << "Converted " << filename << " (" << index.getSize() << " reads, "
+                  << LexicoIndexWriter::getElemBytes(index.getNumStrings()) << " bytes per entry)\n";
+    }
+    return 0;
+}
+
+//
+// Handle command line arguments
+//
+void parseConvertSAIOptions(int argc, char** argv)
+{
+    optind = 1;
+    bool die = false;
+    for (char c; (c = getopt_long(argc, argv, shortopts, longopts, NULL)) != -1;)
+    {
+        switch (c)
+        {
+            case '?': die = true; break;
+            case 'v': opt::verbose++; break;
+            case OPT_HELP:
+                std::cout << CONVERTSAI_USAGE_MESSAGE;
+                exit(EXIT_SUCCESS);
+            case OPT_VERSION:
+                std::cout << CONVERTSAI_VERSION_MESSAGE;
+                exit(EXIT_SUCCESS);
+        }
+    }
+
+    if (argc - optind < 1)
+    {
+        std::cerr << SUBPROGRAM ": missing arguments\n";
+        die = true;
+    }
+
+    if (die)
+    {
+        std::cout << "\n" << CONVERTSAI_USAGE_MESSAGE;
+        exit(EXIT_FAILURE);
+    }
+
+    while(optind < argc)
+        opt::saiFiles.push_back(argv[optind++]);
+}
@@ -0,0 +1,17 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// convert-sai - Convert suffix array index files from
+// the text format to the binary format
+//
+#ifndef CONVERTSAI_H
+#define CONVERTSAI_H
+#include <getopt.h>
+#include "config.h"
+
+int convertSAIMain(int argc, char** argv);
+void parseConvertSAIOptions(int argc, char** argv);
+
+#endif
@@ -11,9 +11,11 @@
 #include <sstream>
 #include <iterator>
 #include "Util.h"
+#include "BGZFStream.h"
 #include "correct.h"
 #include "SuffixArray.h"
 #include "BWT.h"
+#include "NumaPolicy.h"
 #include "SGACommon.h"
 #include "OverlapCommon.h"
 #include "Timer.h"
@@ -50,6 +52,8 @@ static const char *CORRECT_USAGE_MESSAGE =
 "      -p, --prefix=PREFIX              use PREFIX for the names of the index files (default: prefix of the input file)\n"
 "      -o, --outfile=FILE               write the corrected reads to FILE (default: READSFILE.ec.fa)\n"
 "      -t, --threads=NUM                use NUM threads for the computation (default: 1)\n"
+"          --numa                       interleave the FM-index over the NUMA nodes and pin the worker threads to the nodes in turn\n"
+"          --gz-level=N                 compress the .gz outputs at level N, from 0 (fastest) to 9 (smallest) (default: 6)\n"
 "          --discard                    detect and discard low-quality reads\n"
 "      -d, --sample-rate=N              use occurrence array sample rate of N in the FM-index. Higher values use significantly\n"
 "                                       less memory at the cost of higher runtime. This value must be a power of 2 (default: 128)\n"
@@ -74,6 +78,10 @@ static const char *CORRECT_USAGE_MESSAGE =
 "                                       highly-repetitive reads. If the number of branches exceeds N, the search stops and the read\n"
 "                                       will not be corrected. This is not enabled by default.\n"
 "      -r, --rounds=NUM                 iteratively correct reads up to a maximum of NUM rounds (default: 1)\n"
+"          --search-budget=N            correct a read again with the retry budget when its overlap correction takes\n"
+"                                       more than N LF-mapping steps (default: 0, no budget)\n"
+"          --retry-budget=N             the search budget of the second attempt. The reads still over it are written\n"
+"                                       as corrected so far (default: 0, no budget)\n"
 
 "\nReport bugs to " PACKAGE_BUGREPORT "\n\n";
 
@@ -84,6 +92,8 @@ namespace opt
 {
     static unsigned int verbose;
     static int numThreads = 1;
+    static bool useNuma = false;
+    static int gzLevel = 6;
     static int numOverlapRounds = 1;
     static std::string prefix;
     static std::string readsFile;
@@ -99,6 +109,8 @@ namespace opt
     static int seedStride = 0;
     static int conflictCutoff = 3;
     static int branchCutoff = -1;
+    static size_t searchBudget = 0;
+    static size_t retryBudget = 0;
 
     static int kmerLength = 31;
     static int kmerThreshold = 3;
@@ -111,7 +123,7 @@ namespace opt
 
 static const char* shortopts = "p:m:d:e:t:l:s:o:r:b:a:c:k:x:i:v";
 
-enum { OPT_HELP = 1, OPT_VERSION, OPT_METRICS, OPT_DISCARD, OPT_LEARN, OPT_DIPLOID };
+enum { OPT_HELP = 1, OPT_VERSION, OPT_METRICS, OPT_DISCARD, OPT_LEARN, OPT_DIPLOID, OPT_GZLEVEL, OPT_SEARCHBUDGET, OPT_RETRYBUDGET, OPT_NUMA };
 
 static const struct option longopts[] = {
     { "verbose",       no_argument,       NULL, 'v' },
@@ -132,6 +144,10 @@ static const struct option longopts[] = {
     { "kmer-rounds",   required_argument, NULL, 'i' },
     { "learn",         no_argument,       NULL, OPT_LEARN },
     { "discard",       no_argument,       NULL, OPT_DISCARD },
+    { "gz-level",      required_argument, NULL, OPT_GZLEVEL },
+    { "search-budget", required_argument, NULL, OPT_SEARCHBUDGET },
+    { "retry-budget",  required_argument, NULL, OPT_RETRYBUDGET },
+    { "numa",          no_argument,       NULL, OPT_NUMA },
     { "help",          no_argument,       NULL, OPT_HELP },
     { "version",       no_argument,       NULL, OPT_VERSION },
     { "metrics",       required_argument, NULL, OPT_METRICS },
@@ -145,6 +161,8 @@ static const struct option longopts[] = {
 int correctMain(int argc, char** argv)
 {
     parseCorrectOptions(argc, argv);
+    if(opt::useNuma)
+        NumaPolicy::enable();
 
     std::cout << "Correcting sequencing errors for " << opt::readsFile << "\n";
 
@@ -159,7 +177,7 @@ int correctMain(int argc, char** argv)
     BWT* pRBWT = new BWT(opt::prefix + RBWT_EXT, opt::sampleRate);;
     SampledSuffixArray* pSSA = NULL;
     if(opt::algorithm == ECA_OVERLAP || opt::algorithm == ECA_HYBRID)
-        pSSA = new SampledSuffixArray(opt::prefix + SAI_EXT, SSA_FT_SAI);
+        pSSA = SampledSuffixArray::load(opt::prefix + SSA_EXT, opt::prefix + SAI_EXT);
 
     BWTIndexSet indexSet;
     indexSet.pBWT = pBWT;
@@ -188,6 +206,7 @@ int correctMain(int argc, char** argv)
     ecParams.numOverlapRounds = opt::numOverlapRounds;
     ecParams.minIdentity = 1.0f - opt::errorRate;
     ecParams.conflictCutoff = opt::conflictCutoff;
+    ecParams.searchBudget = opt::searchBudget;
 
     ecParams.numKmerRounds = opt::numKmerRounds;
     ecParams.kmerLength = opt::kmerLength;
@@ -202,34 +221,48 @@ int correctMain(int argc, char** argv)
     bool bCollectMetrics = !opt::metricsFile.empty();
     ErrorCorrectPostProcess postProcessor(pWriter, pDiscardWriter, bCollectMetrics);
 
+    // A read over the search budget is corrected again at once with the retry budget
+    typedef SequenceProcessFramework::RetryProcess<SequenceWorkItem, ErrorCorrectResult, ErrorCorrectProcess> RetryProcessor;
+    ErrorCorrectParameters retryParams = ecParams;
+    retryParams.searchBudget = opt::retryBudget;
+    Timer passTimer(PROGRAM_IDENT, true);
+
+    int numProcessors = opt::numThreads <= 1 ? 1 : opt::numThreads;
+    std::vector<ErrorCorrectProcess*> processorVector;
+    std::vector<ErrorCorrectProcess*> retryProcessorVector;
+    std::vector<RetryProcessor*> retryVector;
+    for(int i = 0; i < numProcessors; ++i)
+    {
+        processorVector.push_back(new ErrorCorrectProcess(ecParams));
+        retryProcessorVector.push_back(opt::searchBudget > 0 ? new ErrorCorrectProcess(retryParams) : NULL);
+        retryVector.push_back(new RetryProcessor(processorVector[i], retryProcessorVector[i]));
+    }
+
     if(opt::numThreads <= 1)
     {
         // Serial mode
-        ErrorCorrectProcess processor(ecParams);
         SequenceProcessFramework::processSequencesSerial<SequenceWorkItem,
                                                          ErrorCorrectResult,
-                                                         ErrorCorrectProcess,
-                                                         ErrorCorrectPostProcess>(opt::readsFile, &processor, &postProcessor);
+                                                         RetryProcessor,
+                                                         ErrorCorrectPostProcess>(opt::readsFile, retryVector.front(), &postProcessor);
     }
     else
     {
         // Parallel mode
-        std::vector<ErrorCorrectProcess*> processorVector;
-        for(int i = 0; i < opt::numThreads; ++i)
-        {
-            ErrorCorrectProcess* pProcessor = new ErrorCorrectProcess(ecParams);
-            processorVector.push_back(pProcessor);
-        }
-
         SequenceProcessFramework::processSequencesParallel<SequenceWorkItem,
                                                            ErrorCorrectResult,
-                                                           ErrorCorrectProcess,
-                                                           ErrorCorrectPostProcess>(opt::readsFile, processorVector, &postProcessor);
+                                                           RetryProcessor,
+                                                           ErrorCorrectPostProcess>(opt::readsFile, retryVector, &postProcessor);
+    }
 
-        for(int i = 0; i < opt::numThreads; ++i)
-        {
-            delete processorVector[i];
-        }
+    if(opt::searchBudget > 0)
+        SequenceProcessFramework::printRetryStats(retryVector, passTimer.getElapsedWallTime());
+
+    for(int i = 0; i < numProcessors; ++i)
+    {
+        delete retryVector[i];
+        delete retryProcessorVector[i];
+        delete processorVector[i];
     }
 
     if(bCollectMetrics)
@@ -342,6 +375,10 @@ void parseCorrectOptions(int argc, char** argv)
             case OPT_DISCARD: bDiscardReads = true; break;
             case OPT_METRICS: arg >> opt::metricsFile; break;
 			case OPT_DIPLOID: opt::diploid = true; break;
+            case OPT_GZLEVEL: arg >> opt::gzLevel; break;
+            case OPT_SEARCHBUDGET: arg >> opt::searchBudget; break;
+            case OPT_RETRYBUDGET: arg >> opt::retryBudget; break;
+            case OPT_NUMA: opt::useNuma = true; break;
             case OPT_HELP:
                 std::cout << CORRECT_USAGE_MESSAGE;
                 exit(EXIT_SUCCESS);
@@ -408,12 +445,26 @@ void parseCorrectOptions(int argc, char** argv)
         }
     }
 
+    if(opt::retryBudget != 0 && opt::retryBudget <= opt::searchBudget)
+    {
+        std::cerr << SUBPROGRAM ": invalid retry budget: " << opt::retryBudget << ", must be greater than the search budget\n";
+        die = true;
+    }
+
+    if(opt::gzLevel < 0 || opt::gzLevel > 9)
+    {
+        std::cerr << SUBPROGRAM ": invalid compression level: " << opt::gzLevel << ", must be between 0 and 9\n";
+        die = true;
+    }
+
     if (die)
     {
         std::cout << "\n" << CORRECT_USAGE_MESSAGE;
         exit(EXIT_FAILURE);
     }
 
+    BGZFStreamBuf::setDefaultLevel(opt::gzLevel);
+
     // Validate parameters
     if(opt::errorRate <= 0)
         opt::errorRate = 0.0f;
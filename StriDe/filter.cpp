@@ -14,6 +14,7 @@
 #include "filter.h"
 #include "SuffixArray.h"
 #include "BWT.h"
+#include "NumaPolicy.h"
 #include "SGACommon.h"
 #include "OverlapCommon.h"
 #include "Timer.h"
@@ -24,6 +25,7 @@
 #include "QCProcess.h"
 #include "BitVector.h"
 #include "BWTCARopebwt.h"
+#include "BWTWriterBinary.h"
 
 
 // Defines
@@ -57,6 +59,7 @@ static const char *FILTER_USAGE_MESSAGE =
 "      -p, --prefix=PREFIX              use PREFIX for the names of the index files (default: prefix of the input file)\n"
 "      -o, --outfile=FILE               write the qc-passed reads to FILE (default: READSFILE.filter.pass.fa)\n"
 "      -t, --threads=NUM                use NUM threads to compute the overlaps (default: 1)\n"
+"          --numa                       interleave the FM-index over the NUMA nodes and pin the worker threads to the nodes in turn\n"
 "      -d, --sample-rate=N              use occurrence array sample rate of N in the FM-index. Higher values use significantly\n"
 "                                       less memory at the cost of higher runtime. This value must be a power of 2 (default: 128)\n"
 "      --no-duplicate-check             turn off duplicate removal\n"
@@ -76,6 +79,7 @@ namespace opt
 {
     static unsigned int verbose;
     static int numThreads = 8;
+    static bool useNuma = false;
     static std::string prefix;
     static std::string readsFile;
     static std::string outFile;
@@ -94,7 +98,7 @@ namespace opt
 
 static const char* shortopts = "p:d:t:o:k:x:v";
 
-enum { OPT_HELP = 1, OPT_VERSION, OPT_SUBSTRING_ONLY, OPT_NO_RMDUP, OPT_NO_KMER, OPT_CHECK_HPRUNS, OPT_CHECK_COMPLEXITY };
+enum { OPT_HELP = 1, OPT_VERSION, OPT_SUBSTRING_ONLY, OPT_NO_RMDUP, OPT_NO_KMER, OPT_CHECK_HPRUNS, OPT_CHECK_COMPLEXITY, OPT_NUMA };
 
 static const struct option longopts[] = {
     { "verbose",               no_argument,       NULL, 'v' },
@@ -104,6 +108,7 @@ static const struct option longopts[] = {
     { "sample-rate",           required_argument, NULL, 'd' },
     { "kmer-size",             required_argument, NULL, 'k' },
     { "kmer-threshold",        required_argument, NULL, 'x' },
+    { "numa",                  no_argument,       NULL, OPT_NUMA },
     { "help",                  no_argument,       NULL, OPT_HELP },
     { "version",               no_argument,       NULL, OPT_VERSION },
     { "no-duplicate-check",    no_argument,       NULL, OPT_NO_RMDUP },
@@ -120,6 +125,8 @@ static const struct option longopts[] = {
 int filterMain(int argc, char** argv)
 {
     parseFilterOptions(argc, argv);
+    if(opt::useNuma)
+        NumaPolicy::enable();
     Timer* pTimer = new Timer(PROGRAM_IDENT);
 
 
@@ -193,24 +200,19 @@ int filterMain(int argc, char** argv)
 
     std::cout << "RE-building index for " << opt::outFile << " in memory using ropebwt2\n";
     std::string prefix=stripFilename(opt::outFile);
+
+    // A sampled suffix array of an earlier index of the output no longer matches it
+    remove((prefix + SSA_EXT).c_str());
         //BWT *pBWT, *pRBWT;
-		#pragma omp parallel
-		{
-			#pragma omp single nowait
-			{	
-			    std::string bwt_filename = prefix + BWT_EXT;
-				BWTCA::runRopebwt2(opt::outFile, bwt_filename, opt::numThreads, false);
-				std::cout << "\t done bwt construction, generating .sai file\n";
-				pBWT = new BWT(bwt_filename);
-			}
-			#pragma omp single nowait
-			{	
-				std::string rbwt_filename = prefix + RBWT_EXT;
-				BWTCA::runRopebwt2(opt::outFile, rbwt_filename, opt::numThreads, true);
-				std::cout << "\t done rbwt construction, generating .rsai file\n";
-				pRBWT = new BWT(rbwt_filename);
-			}
-		}
+        RLBWT* pRLBWT = NULL;
+        RLBWT* pRLRBWT = NULL;
+        BWTCA::runRopebwt2(opt::outFile, opt::numThreads, &pRLBWT, &pRLRBWT);
+        pBWT = new BWT(pRLBWT);
+        pRBWT = new BWT(pRLRBWT);
+        BWTWriterBinary(prefix + BWT_EXT).write(pBWT->getRLBWT());
+        BWTWriterBinary(prefix + RBWT_EXT).write(pRBWT->getRLBWT());
+        std::cout << "\t done bwt construction, generating .sai files\n";
+
         std::string sai_filename = prefix + SAI_EXT;
 		SampledSuffixArray ssa;
         ssa.buildLexicoIndex(pBWT, opt::numThreads);
@@ -255,6 +257,7 @@ void parseFilterOptions(int argc, char** argv)
             case OPT_SUBSTRING_ONLY: opt::substringOnly = true; break;
             case '?': die = true; break;
             case 'v': opt::verbose++; break;
+            case OPT_NUMA: opt::useNuma = true; break;
             case OPT_HELP:
                 std::cout << FILTER_USAGE_MESSAGE;
                 exit(EXIT_SUCCESS);
@@ -12,6 +12,7 @@
 #include <sstream>
 #include <iterator>
 #include "Util.h"
+#include "BGZFStream.h"
 #include "fm-merge.h"
 #include "SuffixArray.h"
 #include "BWT.h"
@@ -45,6 +46,7 @@ static const char *FMMERGE_USAGE_MESSAGE =
 "      -v, --verbose                    display verbose output\n"
 "      -p, --prefix=PREFIX              use PREFIX for the names of the index files (default: prefix of the input file)\n"
 "      -t, --threads=NUM                use NUM worker threads (default: no threading)\n"
+"          --gz-level=N                 compress the .gz outputs at level N, from 0 (fastest) to 9 (smallest) (default: 6)\n"
 "      -m, --min-overlap=LEN            minimum overlap required between two reads to merge (default: 45)\n"
 "      -o, --outfile=FILE               write the merged sequences to FILE (default: basename.merged.fa)\n"
 "\nReport bugs to " PACKAGE_BUGREPORT "\n\n";
@@ -56,6 +58,7 @@ namespace opt
 {
     static unsigned int verbose;
     static int numThreads = 1;
+    static int gzLevel = 6;
     static std::string readsFile;
     static std::string outFile;
     static std::string prefix;
@@ -64,7 +67,7 @@ namespace opt
 
 static const char* shortopts = "p:m:d:e:t:l:s:o:vix";
 
-enum { OPT_HELP = 1, OPT_VERSION };
+enum { OPT_HELP = 1, OPT_VERSION, OPT_GZLEVEL };
 
 static const struct option longopts[] = {
     { "prefix",      required_argument, NULL, 'p' },
@@ -72,6 +75,7 @@ static const struct option longopts[] = {
     { "threads",     required_argument, NULL, 't' },
     { "min-overlap", required_argument, NULL, 'm' },
     { "outfile",     required_argument, NULL, 'o' },
+    { "gz-level",    required_argument, NULL, OPT_GZLEVEL },
     { "help",        no_argument,       NULL, OPT_HELP },
     { "version",     no_argument,       NULL, OPT_VERSION },
     { NULL, 0, NULL, 0 }
@@ -172,6 +176,7 @@ void parseFMMergeOptions(int argc, char** argv)
             case 't': arg >> opt::numThreads; break;
             case '?': die = true; break;
             case 'v': opt::verbose++; break;
+            case OPT_GZLEVEL: arg >> opt::gzLevel; break;
             case OPT_HELP:
                 std::cout << FMMERGE_USAGE_MESSAGE;
                 exit(EXIT_SUCCESS);
@@ -198,12 +203,20 @@ void parseFMMergeOptions(int argc, char** argv)
         die = true;
     }
 
+    if(opt::gzLevel < 0 || opt::gzLevel > 9)
+    {
+        std::cerr << SUBPROGRAM ": invalid compression level: " << opt::gzLevel << ", must be between 0 and 9\n";
+        die = true;
+    }
+
     if (die) 
     {
         std::cout << "\n" << FMMERGE_USAGE_MESSAGE;
         exit(EXIT_FAILURE);
     }
 
+    BGZFStreamBuf::setDefaultLevel(opt::gzLevel);
+
     // Parse the input filenames
     opt::readsFile = argv[optind++];
 
@@ -61,7 +61,7 @@ int grepMain(int argc, char** argv)
 	std::string  prefix = stripFilename(opt::readsFile);
 	Timer* pLTimer = new Timer("Load Time");
 	BWT* pBWT = new BWT(prefix + BWT_EXT, BWT::DEFAULT_SAMPLE_RATE_SMALL);
-	SampledSuffixArray* pSSA = new SampledSuffixArray(prefix + SAI_EXT, SSA_FT_SAI);
+	SampledSuffixArray* pSSA = SampledSuffixArray::load(prefix + SSA_EXT, prefix + SAI_EXT);
 	ReadTable* pRT = new ReadTable(opt::readsFile);
 	delete pLTimer;
 	
@@ -18,7 +18,11 @@
 #include "BWT.h"
 #include "Timer.h"
 #include "BWTCARopebwt.h"
+#include "BWTWriterBinary.h"
 #include "SampledSuffixArray.h"
+#include "RankBWT.h"
+#include "BWTIntervalPairCache.h"
+#include "BWTDiskConstruction.h"
 
 //
 // Getopt
@@ -43,9 +47,26 @@ static const char *INDEX_USAGE_MESSAGE =
 "                                       ropebwt2 - Li's ropebwt2 algorithm, suitable for short and long reads (default)\n"
 "  -t, --threads=NUM                    use NUM threads to construct the index (default: 1)\n"
 "  -p, --prefix=PREFIX                  write index to file using PREFIX instead of prefix of READSFILE\n"
+"  -d, --disk=NUM                       use the disk-based construction for read sets larger than memory. The suffix\n"
+"                                       arrays of batches of NUM reads are built in memory and the partial indices\n"
+"                                       are merged on disk. --algorithm is ignored\n"
+"  -g, --gap-array=N                    use N bits of storage for each element of the gap array of the disk-based\n"
+"                                       construction. Acceptable values are 4,8,16 or 32 (default: 4)\n"
 "      --no-reverse                     suppress construction of the reverse BWT. Use this option when building the index\n"
 "                                       for reads that will be error corrected using the k-mer corrector, which only needs the forward index\n"
 "      --no-forward                     suppress construction of the forward BWT. Use this option when building the forward and reverse index separately\n"
+"      --mmap                           also write the FM-index in its in-memory layout (.bwt" RLBWT_INDEX_EXT ", .rbwt" RLBWT_INDEX_EXT ")\n"
+"                                       so later stages memory-map it instead of rebuilding the markers\n"
+"      --backend=STR                    occurrence backend of the FM-index used by later stages. STR can be:\n"
+"                                       rlbwt - run-length encoded, walks runs from the nearest marker (default)\n"
+"                                       rank - bit-sliced blocks answering getOcc with popcounts. Faster on\n"
+"                                       low-complexity read sets at about 4 bits per symbol. Implies --mmap\n"
+"      --interval-cache=LEN             write the intervals of all strings up to LEN bases next to each index\n"
+"                                       (.bwt" BWT_INTERVAL_CACHE_EXT ", .rbwt" BWT_INTERVAL_CACHE_EXT ") so searches skip their first LEN steps.\n"
+"                                       Each file takes 32*4^LEN bytes. 0 disables the cache (default: 10)\n"
+"      --sa-sample-rate=N               also write a sampled suffix array (.ssa) holding every N-th entry of the forward\n"
+"                                       index, so read IDs are found in about N backtracking steps instead of half a read\n"
+"                                       length. Costs 8/N bytes per base. 0 writes the .sai only (default: 0)\n"
 "\nReport bugs to " PACKAGE_BUGREPORT "\n\n";
 
 namespace opt
@@ -61,11 +82,15 @@ namespace opt
     static bool bBuildForward = true;
     static bool validate;
     static int gapArrayStorage = 4;
+    static bool bWriteMappedIndex = false;
+    static std::string backend = "rlbwt";
+    static int intervalCacheLength = 10;
+    static int saSampleRate = 0;
 }
 
 static const char* shortopts = "p:a:m:t:d:g:cv";
 
-enum { OPT_HELP = 1, OPT_VERSION, OPT_NO_REVERSE,OPT_NO_FWD };
+enum { OPT_HELP = 1, OPT_VERSION, OPT_NO_REVERSE,OPT_NO_FWD, OPT_MMAP, OPT_BACKEND, OPT_INTERVAL_CACHE, OPT_SA_SAMPLE_RATE };
 
 static const struct option longopts[] = {
     { "verbose",     no_argument,       NULL, 'v' },
@@ -77,6 +102,10 @@ static const struct option longopts[] = {
     { "algorithm",   required_argument, NULL, 'a' },
     { "no-reverse",  no_argument,       NULL, OPT_NO_REVERSE },
     { "no-forward",  no_argument,       NULL, OPT_NO_FWD },
+    { "mmap",        no_argument,       NULL, OPT_MMAP },
+    { "backend",     required_argument, NULL, OPT_BACKEND },
+    { "interval-cache", required_argument, NULL, OPT_INTERVAL_CACHE },
+    { "sa-sample-rate", required_argument, NULL, OPT_SA_SAMPLE_RATE },
     { "help",        no_argument,       NULL, OPT_HELP },
     { "version",     no_argument,       NULL, OPT_VERSION },
     { NULL, 0, NULL, 0 }
@@ -87,6 +116,23 @@ int indexMain(int argc, char** argv)
     Timer* pTimer = new Timer("Build FM index");
 
     parseIndexOptions(argc, argv);
+
+    // A mapped index left over from a previous run no longer matches the rebuilt bwt
+    if(opt::bBuildForward)
+    {
+        remove((opt::prefix + BWT_EXT + RLBWT_INDEX_EXT).c_str());
+        remove((opt::prefix + SSA_EXT).c_str());
+    }
+    if(opt::bBuildReverse)
+        remove((opt::prefix + RBWT_EXT + RLBWT_INDEX_EXT).c_str());
+
+    // The interval caches hold intervals of both indices so either rebuild invalidates them
+    if(opt::bBuildForward || opt::bBuildReverse)
+    {
+        remove((opt::prefix + BWT_EXT + BWT_INTERVAL_CACHE_EXT).c_str());
+        remove((opt::prefix + RBWT_EXT + BWT_INTERVAL_CACHE_EXT).c_str());
+    }
+
     if(!opt::bDiskAlgo)
     {
         if(opt::algorithm == "sais")
@@ -97,7 +143,10 @@ int indexMain(int argc, char** argv)
             indexInMemoryRopebwt2();
 	}
     else
-	std::cout << "Unknown BWT algorithm!\n";
+        indexOnDisk();
+
+    writeIntervalCaches();
+    std::cout << "Peak memory usage: " << getPeakRSS() / (1024 * 1024) << " MB\n";
  
 	
 	delete pTimer;
@@ -113,37 +162,21 @@ void indexInMemoryRopebwt()
     bool use_threads = opt::numThreads >= 4;
 	std::string bwt_filename = opt::prefix + BWT_EXT;
 	std::string rbwt_filename = opt::prefix + RBWT_EXT;
-	BWT *pBWT, *pRBWT;
-
-	#pragma omp parallel
-	{
-		#pragma omp single nowait
-		{
-			if(opt::bBuildForward)
-			{
-				BWTCA::runRopebwt(opt::readsFile, bwt_filename, use_threads, false);
-				std::cout << "\t done bwt construction, generating .sai file\n";
-				pBWT = new BWT(bwt_filename);
-			}
-		}
-		#pragma omp single nowait
-		{	
-			if(opt::bBuildReverse)
-			{
-				BWTCA::runRopebwt(opt::readsFile, rbwt_filename, use_threads, true);
-				std::cout << "\t done rbwt construction, generating .rsai file\n";
-				pRBWT = new BWT(rbwt_filename);
-			}
-		}
-	}
+	BWTCA::runRopebwt(opt::readsFile, opt::bBuildForward ? bwt_filename : "",
+	                  opt::bBuildReverse ? rbwt_filename : "", use_threads);
+	std::cout << "\t done bwt construction, generating .sai files\n";
+	BWT* pBWT = opt::bBuildForward ? new BWT(bwt_filename) : NULL;
+	BWT* pRBWT = opt::bBuildReverse ? new BWT(rbwt_filename) : NULL;
 	
 	//Construct forward SAI
 	if(opt::bBuildForward)
 	{
 		std::string sai_filename = opt::prefix + SAI_EXT;
 		SampledSuffixArray ssa;
-		ssa.buildLexicoIndex(pBWT, opt::numThreads);
+		ssa.buildLexicoIndex(pBWT, opt::numThreads, opt::saSampleRate);
 		ssa.writeLexicoIndex(sai_filename);
+		writeSampledSuffixArray(ssa);
+		writeMappedIndex(pBWT, bwt_filename);
 		delete pBWT;
 	}
 	
@@ -154,6 +187,7 @@ void indexInMemoryRopebwt()
 		SampledSuffixArray rssa;
 		rssa.buildLexicoIndex(pRBWT, opt::numThreads);
 		rssa.writeLexicoIndex(rsai_filename);
+		writeMappedIndex(pRBWT, rbwt_filename);
 		delete pRBWT;
 	}
 }
@@ -166,28 +200,22 @@ void indexInMemoryRopebwt2()
 
 	std::string bwt_filename = opt::prefix + BWT_EXT;
 	std::string rbwt_filename = opt::prefix + RBWT_EXT;
-	BWT* pBWT;
-	BWT* pRBWT;
-	#pragma omp parallel
+	RLBWT* pRLBWT = NULL;
+	RLBWT* pRLRBWT = NULL;
+	BWTCA::runRopebwt2(opt::readsFile, opt::numThreads, opt::bBuildForward ? &pRLBWT : NULL,
+	                   opt::bBuildReverse ? &pRLRBWT : NULL);
+	std::cout << "\t done bwt construction, generating .sai files\n";
+	BWT* pBWT = pRLBWT != NULL ? new BWT(pRLBWT) : NULL;
+	BWT* pRBWT = pRLRBWT != NULL ? new BWT(pRLRBWT) : NULL;
+
+	// The indices are in memory so the bwt files are written
+	// in the background while the SAIs are constructed from them
+	BWTFileJob job = { { pBWT, pRBWT }, { bwt_filename, rbwt_filename } };
+	pthread_t writerThread;
+	if(pthread_create(&writerThread, NULL, &writeBWTFiles, &job) != 0)
 	{
-		#pragma omp single nowait
-		{	
-			if(opt::bBuildForward)
-			{
-				BWTCA::runRopebwt2(opt::readsFile, bwt_filename, opt::numThreads, false);
-				std::cout << "\t done bwt construction, generating .sai file\n";
-				pBWT = new BWT(bwt_filename);
-			}
-		}
-		#pragma omp single nowait
-		{	
-			if(opt::bBuildReverse)
-			{
-				BWTCA::runRopebwt2(opt::readsFile, rbwt_filename, opt::numThreads, true);
-				std::cout << "\t done rbwt construction, generating .rsai file\n";
-				pRBWT = new BWT(rbwt_filename);
-			}
-		}
+		std::cerr << "Error: could not start the bwt writer thread\n";
+		exit(EXIT_FAILURE);
 	}
 
 	//Construct forward SAI
@@ -195,9 +223,9 @@ void indexInMemoryRopebwt2()
 	{	
 		std::string sai_filename = opt::prefix + SAI_EXT;
 		SampledSuffixArray ssa;
-		ssa.buildLexicoIndex(pBWT, opt::numThreads);
+		ssa.buildLexicoIndex(pBWT, opt::numThreads, opt::saSampleRate);
 		ssa.writeLexicoIndex(sai_filename);
-		delete pBWT;
+		writeSampledSuffixArray(ssa);
 	}
 
 	//Construct reverse SAI
@@ -207,10 +235,37 @@ void indexInMemoryRopebwt2()
 		SampledSuffixArray rssa;
 		rssa.buildLexicoIndex(pRBWT, opt::numThreads);
 		rssa.writeLexicoIndex(rsai_filename);
+	}
+
+	// The rank backend builds its mapped index from the bwt file
+	pthread_join(writerThread, NULL);
+	if(opt::bBuildForward)
+	{
+		writeMappedIndex(pBWT, bwt_filename);
+		delete pBWT;
+	}
+	if(opt::bBuildReverse)
+	{
+		writeMappedIndex(pRBWT, rbwt_filename);
 		delete pRBWT;
 	}
 }
 
+// Write the .bwt files of the indices of a BWTFileJob, skipping the ones that are NULL
+void* writeBWTFiles(void* pArg)
+{
+	BWTFileJob* pJob = static_cast<BWTFileJob*>(pArg);
+	for(size_t i = 0; i < 2; ++i)
+	{
+		if(pJob->pBWT[i] != NULL)
+		{
+			BWTWriterBinary writer(pJob->filename[i]);
+			writer.write(pJob->pBWT[i]->getRLBWT());
+		}
+	}
+	return NULL;
+}
+
 //
 void indexInMemorySAIS()
 {
@@ -261,6 +316,108 @@ void buildIndexForTable(std::string prefix, const ReadTable* pRT, bool isReverse
 
     delete pSA;
     pSA = NULL;
+
+    writeDerivedIndices(bwt_filename, isReverse);
+}
+
+// Build the index from batches of reads whose partial indices are merged on disk
+void indexOnDisk()
+{
+    std::cout << "Building index for " << opt::readsFile << " on disk in batches of " << opt::numReadsPerBatch << " reads\n";
+
+    BWTDiskParameters parameters;
+    parameters.inFile = opt::readsFile;
+    parameters.outPrefix = opt::prefix;
+    parameters.numReadsPerBatch = opt::numReadsPerBatch;
+    parameters.numThreads = opt::numThreads;
+    parameters.storageLevel = opt::gapArrayStorage;
+    parameters.bValidate = opt::validate;
+
+    if(opt::bBuildForward)
+    {
+        parameters.bwtExtension = BWT_EXT;
+        parameters.saiExtension = SAI_EXT;
+        parameters.doReverse = false;
+        buildBWTDisk(parameters);
+        writeDerivedIndices(opt::prefix + BWT_EXT, false);
+    }
+
+    if(opt::bBuildReverse)
+    {
+        parameters.bwtExtension = RBWT_EXT;
+        parameters.saiExtension = RSAI_EXT;
+        parameters.doReverse = true;
+        buildBWTDisk(parameters);
+        writeDerivedIndices(opt::prefix + RBWT_EXT, true);
+    }
+}
+
+// Write the mapped index and the sampled suffix array of an index written to bwt_filename
+void writeDerivedIndices(const std::string& bwt_filename, bool isReverse)
+{
+    if(opt::bWriteMappedIndex)
+    {
+        BWT* pBWT = opt::backend == "rlbwt" ? new BWT(bwt_filename) : NULL;
+        writeMappedIndex(pBWT, bwt_filename);
+        delete pBWT;
+    }
+
+    // The samples are computed from the bwt rather than the suffix array
+    // so that they are identical for every construction algorithm
+    if(!isReverse && opt::saSampleRate > 0)
+    {
+        BWT* pBWT = new BWT(bwt_filename);
+        SampledSuffixArray ssa;
+        ssa.buildLexicoIndex(pBWT, opt::numThreads, opt::saSampleRate);
+        writeSampledSuffixArray(ssa);
+        delete pBWT;
+    }
+}
+
+// Write the sampled suffix array of the forward index, if requested
+void writeSampledSuffixArray(SampledSuffixArray& ssa)
+{
+    if(opt::saSampleRate == 0)
+        return;
+
+    ssa.writeSSA(opt::prefix + SSA_EXT);
+    ssa.printInfo();
+}
+
+// Write the memory-mappable index of the selected backend next to bwtFilename.
+// pBWT is only used by the rlbwt backend
+void writeMappedIndex(const BWT* pBWT, const std::string& bwtFilename)
+{
+    if(!opt::bWriteMappedIndex)
+        return;
+
+    if(opt::backend == "rank")
+    {
+        RankBWT rankBWT(bwtFilename);
+        rankBWT.writeMappedIndex(bwtFilename + RLBWT_INDEX_EXT);
+    }
+    else
+    {
+        pBWT->writeMappedIndex(bwtFilename + RLBWT_INDEX_EXT);
+    }
+}
+
+// Write the interval cache of the forward and reverse index. The entries
+// pair the intervals of both indices so both must have been built by this run
+void writeIntervalCaches()
+{
+    if(opt::intervalCacheLength == 0 || !opt::bBuildForward || !opt::bBuildReverse)
+        return;
+
+    std::cout << "Writing the interval caches of strings up to length " << opt::intervalCacheLength << "\n";
+    std::string bwt_filename = opt::prefix + BWT_EXT;
+    std::string rbwt_filename = opt::prefix + RBWT_EXT;
+    BWT* pBWT = new BWT(bwt_filename);
+    BWT* pRBWT = new BWT(rbwt_filename);
+    BWTIntervalPairCache::write(bwt_filename + BWT_INTERVAL_CACHE_EXT, pBWT, pRBWT, opt::intervalCacheLength, opt::numThreads);
+    BWTIntervalPairCache::write(rbwt_filename + BWT_INTERVAL_CACHE_EXT, pRBWT, pBWT, opt::intervalCacheLength, opt::numThreads);
+    delete pBWT;
+    delete pRBWT;
 }
 
 //
@@ -285,6 +442,10 @@ void parseIndexOptions(int argc, char** argv)
             case 'v': opt::verbose++; break;
             case OPT_NO_REVERSE: opt::bBuildReverse = false; break;
             case OPT_NO_FWD: opt::bBuildForward = false; break;
+            case OPT_MMAP: opt::bWriteMappedIndex = true; break;
+            case OPT_BACKEND: arg >> opt::backend; break;
+            case OPT_INTERVAL_CACHE: arg >> opt::intervalCacheLength; break;
+            case OPT_SA_SAMPLE_RATE: arg >> opt::saSampleRate; break;
             case OPT_HELP:
                 std::cout << INDEX_USAGE_MESSAGE;
                 exit(EXIT_SUCCESS);
@@ -296,6 +457,11 @@ void parseIndexOptions(int argc, char** argv)
 
     // Transform algorithm parameter to lower case
     std::transform(opt::algorithm.begin(), opt::algorithm.end(), opt::algorithm.begin(), ::tolower);
+    std::transform(opt::backend.begin(), opt::backend.end(), opt::backend.begin(), ::tolower);
+
+    // The rank backend is only usable through its mapped index
+    if(opt::backend == "rank")
+        opt::bWriteMappedIndex = true;
 
     if (argc - optind < 1)
     {
@@ -315,18 +481,42 @@ void parseIndexOptions(int argc, char** argv)
         die = true;
     }
 
+    if(opt::intervalCacheLength < 0 || opt::intervalCacheLength > BWT_INTERVAL_CACHE_MAX_LENGTH)
+    {
+        std::cerr << SUBPROGRAM ": invalid argument, --interval-cache must be between 0 and " << BWT_INTERVAL_CACHE_MAX_LENGTH << " (found: " << opt::intervalCacheLength << ")\n";
+        die = true;
+    }
+
+    if(opt::saSampleRate < 0)
+    {
+        std::cerr << SUBPROGRAM ": invalid argument, --sa-sample-rate must not be negative (found: " << opt::saSampleRate << ")\n";
+        die = true;
+    }
+
     if(opt::numThreads <= 0)
     {
         std::cerr << SUBPROGRAM ": invalid number of threads: " << opt::numThreads << "\n";
         die = true;
     }
 
+    if(opt::bDiskAlgo && opt::numReadsPerBatch <= 0)
+    {
+        std::cerr << SUBPROGRAM ": invalid argument, --disk must be a positive number of reads (found: " << opt::numReadsPerBatch << ")\n";
+        die = true;
+    }
+
     if(opt::algorithm != "sais" && opt::algorithm != "bcr" && opt::algorithm != "ropebwt" && opt::algorithm != "ropebwt2")
     {
         std::cerr << SUBPROGRAM ": unrecognized algorithm string " << opt::algorithm << ". --algorithm must be sais, bcr or ropebwt\n";
         die = true;
     }
 
+    if(opt::backend != "rlbwt" && opt::backend != "rank")
+    {
+        std::cerr << SUBPROGRAM ": unrecognized backend " << opt::backend << ". --backend must be rlbwt or rank\n";
+        die = true;
+    }
+
     if (die)
     {
         std::cout << "\n" << INDEX_USAGE_MESSAGE;
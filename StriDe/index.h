@@ -11,6 +11,8 @@
 #include <getopt.h>
 #include "config.h"
 #include "SuffixArray.h"
+#include "BWT.h"
+#include "SampledSuffixArray.h"
 
 int indexMain(int argc, char** argv);
 void indexInMemorySAIS();
@@ -19,7 +21,19 @@ void indexInMemoryRopebwt();
 void indexInMemoryRopebwt2();
 
 void indexOnDisk();
+
+// The bwt files written by writeBWTFiles on a background thread
+struct BWTFileJob
+{
+    const BWT* pBWT[2];
+    std::string filename[2];
+};
+void* writeBWTFiles(void* pArg);
 void buildIndexForTable(std::string outfile, const ReadTable* pRT, bool isReverse);
+void writeDerivedIndices(const std::string& bwt_filename, bool isReverse);
+void writeMappedIndex(const BWT* pBWT, const std::string& bwtFilename);
+void writeIntervalCaches();
+void writeSampledSuffixArray(SampledSuffixArray& ssa);
 void parseIndexOptions(int argc, char** argv);
 
 #endif
@@ -11,6 +11,7 @@
 #include "Timer.h"
 #include "BWTAlgorithms.h"
 #include <iomanip>
+#include <algorithm>
 //
 // Getopt
 //
@@ -37,6 +38,9 @@ namespace opt
 
 static const char* shortopts = "k:v";
 
+// The kmers of a query counted by one thread at a time
+static const size_t KMER_CHUNK_SIZE = 1024;
+
 enum { OPT_HELP = 1, OPT_VERSION };
 
 static const struct option longopts[] = {
@@ -65,16 +69,29 @@ int kmerfreqMain(int argc, char** argv)
 		size_t seqLength = queryString.length();
 		size_t numKmer = seqLength-opt::kmerLength+1 ;
 		std::vector<std::string> kmers (numKmer);
+		std::vector<std::string> rcKmers (numKmer);
 		std::vector<size_t> kmerFreqs_same (numKmer);
 		std::vector<size_t> kmerFreqs_revc (numKmer);
 		
-		#pragma omp parallel for
 		for (size_t i = 0 ; i < numKmer  ; i++)
 		{
 			kmers[i] = queryString.substr (i,opt::kmerLength);
-			kmerFreqs_same[i] = BWTAlgorithms::countSequenceOccurrencesSingleStrand(kmers[i], pBWT) ;
-			kmerFreqs_revc[i] = BWTAlgorithms::countSequenceOccurrencesSingleStrand(reverseComplement(kmers[i]), pBWT) ;
+			rcKmers[i] = reverseComplement(kmers[i]);
 		}	
+
+		// Each thread counts a chunk of the kmers, the batched search overlaps
+		// the index lookups within the chunk
+		BWTIndexSet indices;
+		indices.pBWT = pBWT;
+		size_t numChunks = (numKmer + KMER_CHUNK_SIZE - 1) / KMER_CHUNK_SIZE;
+		#pragma omp parallel for schedule(dynamic)
+		for (size_t c = 0 ; c < numChunks ; c++)
+		{
+			size_t start = c * KMER_CHUNK_SIZE;
+			size_t n = std::min(KMER_CHUNK_SIZE, numKmer - start);
+			BWTAlgorithms::countSequenceOccurrencesSingleStrand(&kmers[start], n, indices, &kmerFreqs_same[start]);
+			BWTAlgorithms::countSequenceOccurrencesSingleStrand(&rcKmers[start], n, indices, &kmerFreqs_revc[start]);
+		}
 		
 		for (size_t i = 0 ; i < numKmer  ; i++)
 		{
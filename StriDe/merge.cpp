@@ -0,0 +1,286 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// merge - Merge the FM-indices of several read sets into
+// a single index. The index of the first read set is
+// extended with the reads of the others one set at a time,
+// so only the suffixes of the added reads are ranked
+// instead of rebuilding the index of the union.
+//
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include "SGACommon.h"
+#include "Util.h"
+#include "merge.h"
+#include "SeqReader.h"
+#include "Timer.h"
+#include "BWT.h"
+#include "BWTDiskConstruction.h"
+#include "BWTIntervalPairCache.h"
+
+//
+// Getopt
+//
+#define SUBPROGRAM "merge"
+
+static const char *MERGE_VERSION_MESSAGE =
+SUBPROGRAM " Version " PACKAGE_VERSION "\n"
+"\n";
+
+static const char *MERGE_USAGE_MESSAGE =
+"Usage: " PACKAGE_NAME " " SUBPROGRAM " [OPTION] ... READSFILE1 READSFILE2 ...\n"
+"Merge the indices of two or more read sets, built by the index command, into a single index.\n"
+"The reads of READSFILE2 onwards are ranked against the index of the reads before them, so adding\n"
+"a small read set to a large index costs about as much as indexing the small set.\n"
+"The reads are written to PREFIX with the extension of READSFILE1, in the order of the input files.\n"
+"\n"
+"  -v, --verbose                        display verbose output\n"
+"      --help                           display this help and exit\n"
+"  -t, --threads=NUM                    use NUM threads to rank the added reads (default: 1)\n"
+"  -p, --prefix=PREFIX                  write the merged index and reads using PREFIX (default: merged)\n"
+"  -g, --gap-array=N                    use N bits of storage for each element of the gap array. Acceptable values are 4,8,16\n"
+"                                       or 32. Lower values can substantially reduce the amount of memory required at the cost of\n"
+"                                       less predictable memory usage. When this value is set to 32, the memory requirement is\n"
+"                                       approximately 4 bytes per base of the index being extended (default: 4)\n"
+"  -r, --remove                         remove the input reads and index files once the merge is complete\n"
+"      --no-reverse                     only merge the forward indices (.bwt, .sai)\n"
+"      --no-forward                     only merge the reverse indices (.rbwt, .rsai)\n"
+"      --no-sequence                    do not write the merged reads file\n"
+"      --interval-cache=LEN             write the intervals of all strings up to LEN bases next to each merged index,\n"
+"                                       as the index command does. 0 disables the cache (default: 10)\n"
+"\nReport bugs to " PACKAGE_BUGREPORT "\n\n";
+
+namespace opt
+{
+    static unsigned int verbose;
+    static std::vector<std::string> readsFiles;
+    static std::string prefix = "merged";
+    static int numThreads = 1;
+    static int gapArrayStorage = 4;
+    static bool bRemove = false;
+    static bool bMergeForward = true;
+    static bool bMergeReverse = true;
+    static bool bMergeSequence = true;
+    static int intervalCacheLength = 10;
+}
+
+static const char* shortopts = "p:t:g:rv";
+
+enum { OPT_HELP = 1, OPT_VERSION, OPT_NO_REVERSE, OPT_NO_FWD, OPT_NO_SEQUENCE, OPT_INTERVAL_CACHE };
+
+static const struct option longopts[] = {
+    { "verbose",        no_argument,       NULL, 'v' },
+    { "prefix",         required_argument, NULL, 'p' },
+    { "threads",        required_argument, NULL, 't' },
+    { "gap-array",      required_argument, NULL, 'g' },
+    { "remove",         no_argument,       NULL, 'r' },
+    { "no-reverse",     no_argument,       NULL, OPT_NO_REVERSE },
+    { "no-forward",     no_argument,       NULL, OPT_NO_FWD },
+    { "no-sequence",    no_argument,       NULL, OPT_NO_SEQUENCE },
+    { "interval-cache", required_argument, NULL, OPT_INTERVAL_CACHE },
+    { "help",           no_argument,       NULL, OPT_HELP },
+    { "version",        no_argument,       NULL, OPT_VERSION },
+    { NULL, 0, NULL, 0 }
+};
+
+int mergeMain(int argc, char** argv)
+{
+    Timer* pTimer = new Timer("Merge FM indices");
+    parseMergeOptions(argc, argv);
+
+    // Side files of an earlier index with the output prefix no longer match the merged index
+    remove((opt::prefix + SSA_EXT).c_str());
+    remove((opt::prefix + BWT_EXT + RLBWT_INDEX_EXT).c_str());
+    remove((opt::prefix + RBWT_EXT + RLBWT_INDEX_EXT).c_str());
+    remove((opt::prefix + BWT_EXT + BWT_INTERVAL_CACHE_EXT).c_str());
+    remove((opt::prefix + RBWT_EXT + BWT_INTERVAL_CACHE_EXT).c_str());
+
+    if(opt::bMergeForward)
+        mergeIndexSet(BWT_EXT, SAI_EXT, false);
+    if(opt::bMergeReverse)
+        mergeIndexSet(RBWT_EXT, RSAI_EXT, true);
+    if(opt::bMergeSequence)
+        mergeReadFiles();
+
+    if(opt::intervalCacheLength > 0 && opt::bMergeForward && opt::bMergeReverse)
+    {
+        std::cout << "Writing the interval caches of strings up to length " << opt::intervalCacheLength << "\n";
+        std::string bwt_filename = opt::prefix + BWT_EXT;
+        std::string rbwt_filename = opt::prefix + RBWT_EXT;
+        BWT* pBWT = new BWT(bwt_filename);
+        BWT* pRBWT = new BWT(rbwt_filename);
+        BWTIntervalPairCache::write(bwt_filename + BWT_INTERVAL_CACHE_EXT, pBWT, pRBWT, opt::intervalCacheLength, opt::numThreads);
+        BWTIntervalPairCache::write(rbwt_filename + BWT_INTERVAL_CACHE_EXT, pRBWT, pBWT, opt::intervalCacheLength, opt::numThreads);
+        delete pBWT;
+        delete pRBWT;
+    }
+
+    if(opt::bRemove)
+        removeInputFiles();
+
+    delete pTimer;
+    return 0;
+}
+
+// Extend the index of the first read set with each of the others in turn.
+// The intermediate indices are written next to the output and removed once used
+void mergeIndexSet(const std::string& bwt_extension, const std::string& sai_extension, bool doReverse)
+{
+    std::string internalPrefix = stripFilename(opt::readsFiles[0]);
+    for(size_t i = 1; i < opt::readsFiles.size(); ++i)
+    {
+        MergeItem internalItem;
+        internalItem.bwt_filename = internalPrefix + bwt_extension;
+        internalItem.sai_filename = internalPrefix + sai_extension;
+
+        std::string externalPrefix = stripFilename(opt::readsFiles[i]);
+        MergeItem externalItem;
+        externalItem.reads_filename = opt::readsFiles[i];
+        externalItem.bwt_filename = externalPrefix + bwt_extension;
+        externalItem.sai_filename = externalPrefix + sai_extension;
+
+        std::stringstream outPrefix;
+        outPrefix << opt::prefix;
+        if(i + 1 < opt::readsFiles.size())
+            outPrefix << ".tmp" << i;
+
+        mergeIndependentIndices(internalItem, externalItem,
+                                outPrefix.str() + bwt_extension, outPrefix.str() + sai_extension,
+                                doReverse, opt::numThreads, opt::gapArrayStorage);
+
+        if(i > 1)
+        {
+            remove(internalItem.bwt_filename.c_str());
+            remove(internalItem.sai_filename.c_str());
+        }
+        internalPrefix = outPrefix.str();
+    }
+}
+
+// Concatenate the reads in the order the indices were merged, so
+// the read IDs of the merged index refer to the merged reads file
+void mergeReadFiles()
+{
+    std::string outFilename = getMergedReadsFilename();
+    std::cout << "Writing the merged reads to " << outFilename << "\n";
+    std::ostream* pWriter = createWriter(outFilename);
+    for(size_t i = 0; i < opt::readsFiles.size(); ++i)
+    {
+        SeqReader reader(opt::readsFiles[i], SRF_NO_VALIDATION);
+        SeqRecord record;
+        while(reader.get(record))
+            record.write(*pWriter);
+    }
+    delete pWriter;
+}
+
+// The merged reads are written uncompressed, in the format of the first input
+std::string getMergedReadsFilename()
+{
+    std::string filename = stripDirectories(opt::readsFiles[0]);
+    if(isGzip(filename))
+        filename = stripExtension(filename);
+    size_t suffixPos = filename.find_last_of('.');
+    return opt::prefix + (suffixPos == std::string::npos ? ".fa" : filename.substr(suffixPos));
+}
+
+//
+void removeInputFiles()
+{
+    const char* extensions[] = { BWT_EXT, RBWT_EXT, SAI_EXT, RSAI_EXT, SSA_EXT,
+                                 BWT_EXT RLBWT_INDEX_EXT, RBWT_EXT RLBWT_INDEX_EXT,
+                                 BWT_EXT BWT_INTERVAL_CACHE_EXT, RBWT_EXT BWT_INTERVAL_CACHE_EXT };
+    for(size_t i = 0; i < opt::readsFiles.size(); ++i)
+    {
+        std::string prefix = stripFilename(opt::readsFiles[i]);
+        for(size_t j = 0; j < sizeof(extensions) / sizeof(extensions[0]); ++j)
+            remove((prefix + extensions[j]).c_str());
+        remove(opt::readsFiles[i].c_str());
+    }
+}
+
+//
+// Handle command line arguments
+//
+void parseMergeOptions(int argc, char** argv)
+{
+    optind = 1;
+    bool die = false;
+    for (char c; (c = getopt_long(argc, argv, shortopts, longopts, NULL)) != -1;)
+    {
+        std::istringstream arg(optarg != NULL ? optarg : "");
+        switch (c)
+        {
+            case 'p': arg >> opt::prefix; break;
+            case 't': arg >> opt::numThreads; break;
+            case 'g': arg >> opt::gapArrayStorage; break;
+            case 'r': opt::bRemove = true; break;
+            case '?': die = true; break;
+            case 'v': opt::verbose++; break;
+            case OPT_NO_REVERSE: opt::bMergeReverse = false; break;
+            case OPT_NO_FWD: opt::bMergeForward = false; break;
+            case OPT_NO_SEQUENCE: opt::bMergeSequence = false; break;
+            case OPT_INTERVAL_CACHE: arg >> opt::intervalCacheLength; break;
+            case OPT_HELP:
+                std::cout << MERGE_USAGE_MESSAGE;
+                exit(EXIT_SUCCESS);
+            case OPT_VERSION:
+                std::cout << MERGE_VERSION_MESSAGE;
+                exit(EXIT_SUCCESS);
+        }
+    }
+
+    if (argc - optind < 2)
+    {
+        std::cerr << SUBPROGRAM ": missing arguments, at least two read files are required\n";
+        die = true;
+    }
+
+    if(opt::gapArrayStorage != 4 && opt::gapArrayStorage != 8 &&
+       opt::gapArrayStorage != 16 && opt::gapArrayStorage != 32)
+    {
+        std::cerr << SUBPROGRAM ": invalid argument, --gap-array,-g must be one of 4,8,16,32 (found: " << opt::gapArrayStorage << ")\n";
+        die = true;
+    }
+
+    if(opt::intervalCacheLength < 0 || opt::intervalCacheLength > BWT_INTERVAL_CACHE_MAX_LENGTH)
+    {
+        std::cerr << SUBPROGRAM ": invalid argument, --interval-cache must be between 0 and " << BWT_INTERVAL_CACHE_MAX_LENGTH << " (found: " << opt::intervalCacheLength << ")\n";
+        die = true;
+    }
+
+    if(opt::numThreads <= 0)
+    {
+        std::cerr << SUBPROGRAM ": invalid number of threads: " << opt::numThreads << "\n";
+        die = true;
+    }
+
+    if(!opt::bMergeForward && !opt::bMergeReverse && !opt::bMergeSequence)
+    {
+        std::cerr << SUBPROGRAM ": --no-forward, --no-reverse and --no-sequence leave nothing to merge\n";
+        die = true;
+    }
+
+    if (die)
+    {
+        std::cout << "\n" << MERGE_USAGE_MESSAGE;
+        exit(EXIT_FAILURE);
+    }
+
+    while(optind < argc)
+        opt::readsFiles.push_back(argv[optind++]);
+
+    // The inputs are read while the output is written so they must not share a prefix
+    for(size_t i = 0; i < opt::readsFiles.size(); ++i)
+    {
+        if(stripFilename(opt::readsFiles[i]) == opt::prefix ||
+           (opt::bMergeSequence && opt::readsFiles[i] == getMergedReadsFilename()))
+        {
+            std::cerr << SUBPROGRAM ": the output prefix " << opt::prefix << " is the prefix of the input " << opt::readsFiles[i] << "\n";
+            exit(EXIT_FAILURE);
+        }
+    }
+}
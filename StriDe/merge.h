@@ -0,0 +1,22 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// merge - Merge the FM-indices of several read sets
+// into a single index
+//
+#ifndef MERGE_H
+#define MERGE_H
+#include <getopt.h>
+#include <string>
+#include "config.h"
+
+int mergeMain(int argc, char** argv);
+void mergeIndexSet(const std::string& bwt_extension, const std::string& sai_extension, bool doReverse);
+void mergeReadFiles();
+std::string getMergedReadsFilename();
+void removeInputFiles();
+void parseMergeOptions(int argc, char** argv);
+
+#endif
@@ -12,9 +12,11 @@
 #include <iterator>
 #include <iomanip>
 #include "Util.h"
+#include "BGZFStream.h"
 #include "overlap.h"
 #include "SuffixArray.h"
 #include "BWT.h"
+#include "NumaPolicy.h"
 #include "SGACommon.h"
 #include "OverlapCommon.h"
 #include "Timer.h"
@@ -60,7 +62,7 @@ size_t computeHitsParallel(int numThreads, const std::string& prefix, const std:
 void convertHitsToASQG(const std::string& indexPrefix, const StringVector& hitsFilenames, std::ostream* pASQGWriter, DenseHashSet < std::string, StringHasher > *SuperRepeatVertices);
 
 void convertHitsToASQGedgeParallel(const std::string hitsFilename, std::ostream* pASQGWriter ,std::ostream* pDiscardEdgeWriter, 
-	SuffixArray* pFwdSAI ,SuffixArray* pRevSAI , ReadInfoTable* pQueryRIT , ReadInfoTable* pTargetRIT, DenseHashSet < std::string, StringHasher > *SuperRepeatVertices);
+	LexicoIndex* pFwdSAI ,LexicoIndex* pRevSAI , ReadInfoTable* pQueryRIT , ReadInfoTable* pTargetRIT, DenseHashSet < std::string, StringHasher > *SuperRepeatVertices);
 
 //
 // Getopt
@@ -79,6 +81,8 @@ static const char *OVERLAP_USAGE_MESSAGE =
 "      --help                           display this help and exit\n"
 "      -v, --verbose                    display verbose output\n"
 "      -t, --threads=NUM                use NUM worker threads to compute the overlaps (default: no threading)\n"
+"          --numa                       interleave the FM-index over the NUMA nodes and pin the worker threads to the nodes in turn\n"
+"          --gz-level=N                 compress the .gz outputs at level N, from 0 (fastest) to 9 (smallest) (default: 6)\n"
 "      -e, --error-rate                 the maximum error rate allowed to consider two sequences aligned (default: exact matches only)\n"
 "      -m, --min-overlap=LEN            minimum overlap required between two reads (default: 45)\n"
 "      -f, --target-file=FILE           perform the overlap queries against the reads in FILE\n"
@@ -86,6 +90,8 @@ static const char *OVERLAP_USAGE_MESSAGE =
 "      -x, --exhaustive                 output all overlaps, including transitive edges\n"
 "          --exact                      force the use of the exact-mode irreducible block algorithm. This is faster\n"
 "                                       but requires that no substrings are present in the input set.\n"
+"          --binary-edges               write the edges of each thread as compact binary records (.edges.bin) instead\n"
+"                                       of ASQG edge records (.edges.gz). assemble loads either. Cannot be used with -f\n"
 "      -l, --seed-length=LEN            force the seed length to be LEN. By default, the seed length in the overlap step\n"
 "                                       is calculated to guarantee all overlaps with --error-rate differences are found.\n"
 "                                       This option removes the guarantee but will be (much) faster. As SGA can tolerate some\n"
@@ -103,6 +109,8 @@ namespace opt
 {
 	static unsigned int verbose;
 	static int numThreads = 1;
+	static bool useNuma = false;
+	static int gzLevel = 6;
 	static OutputType outputType = OT_ASQG;
 	static std::string readsFile;
 	static std::string targetFile;
@@ -116,11 +124,12 @@ namespace opt
 	static bool bIrreducibleOnly = true;
 	static bool bExactIrreducible = false;
 	static bool bIsPairedOverlapOnly  = false;
+	static bool bBinaryEdges = false;
 }
 
 static const char* shortopts = "m:d:e:t:l:s:o:f:vixp";
 
-enum { OPT_HELP = 1, OPT_VERSION, OPT_EXACT };
+enum { OPT_HELP = 1, OPT_VERSION, OPT_EXACT, OPT_GZLEVEL, OPT_BINARYEDGES, OPT_NUMA };
 
 static const struct option longopts[] = {
 	{ "verbose",     no_argument,       NULL, 'v' },
@@ -136,6 +145,9 @@ static const struct option longopts[] = {
 	{ "exhaustive",  no_argument,       NULL, 'x' },
 	{ "paired-overlap",no_argument,     NULL, 'p' },
 	{ "exact",       no_argument,       NULL, OPT_EXACT },
+	{ "gz-level",    required_argument, NULL, OPT_GZLEVEL },
+	{ "binary-edges",no_argument,       NULL, OPT_BINARYEDGES },
+	{ "numa",        no_argument,       NULL, OPT_NUMA },
 	{ "help",        no_argument,       NULL, OPT_HELP },
 	{ "version",     no_argument,       NULL, OPT_VERSION },
 	{ NULL, 0, NULL, 0 }
@@ -147,6 +159,8 @@ static const struct option longopts[] = {
 int overlapMain(int argc, char** argv)
 {
 	parseOverlapOptions(argc, argv);
+	if(opt::useNuma)
+		NumaPolicy::enable();
 
 	// Prepare the output ASQG file
 	assert(opt::outputType == OT_ASQG);
@@ -177,7 +191,7 @@ int overlapMain(int argc, char** argv)
 		indexPrefix = stripFilename(opt::readsFile);
 
 	BWT *pBWT, *pRBWT;
-	SuffixArray *pFwdSAI, *pRevSAI;
+	LexicoIndex *pFwdSAI, *pRevSAI;
 	#pragma omp parallel
 	{
 		#pragma omp single nowait
@@ -190,11 +204,11 @@ int overlapMain(int argc, char** argv)
 		}
 		#pragma omp single nowait
 		{
-			pFwdSAI = new SuffixArray(indexPrefix + SAI_EXT);
+			pFwdSAI = new LexicoIndex(indexPrefix + SAI_EXT);
 		}
 		#pragma omp single nowait
 		{
-			pRevSAI = new SuffixArray(indexPrefix + RSAI_EXT);
+			pRevSAI = new LexicoIndex(indexPrefix + RSAI_EXT);
 		}
 	}
 	// Load the ReadInfoTable for the queries to look up the ID and lengths of the hits
@@ -206,6 +220,10 @@ int overlapMain(int argc, char** argv)
 	else
 		pTargetRIT = pQueryRIT;
 
+	// The self overlaps pick the side of each edge to write by the rank of the read names
+	if(pTargetRIT == pQueryRIT)
+		pQueryRIT->buildNameRanks();
+
 	OverlapAlgorithm* pOverlapper = new OverlapAlgorithm(pBWT, pRBWT, pFwdSAI, pRevSAI, pQueryRIT, pTargetRIT);
 	
 	Timer* pTimer = new Timer(PROGRAM_IDENT);
@@ -236,21 +254,48 @@ int overlapMain(int argc, char** argv)
 	delete pOverlapper;
 	delete pBWT; 
 	delete pRBWT;
+	delete pFwdSAI;
+	delete pRevSAI;
 	delete pASQGWriter;
 	delete pTimer;
 
 	return 0;
 }
 
+// The name of the edges file written by thread i
+static std::string getEdgesFilename(const std::string& prefix, size_t i, bool binary)
+{
+	std::stringstream ss;
+	ss << prefix << "-thread" << i << HITS_EXT << (binary ? BIN_EXT : GZIP_EXT);
+	return ss.str();
+}
+
+// Remove the edge files of the threads from fileIdx on, left by earlier runs,
+// otherwise subsequent assembly may load inconsistent edges files
+static void removeEdgeFiles(const std::string& prefix, size_t fileIdx, bool binary)
+{
+	std::string edgefile = getEdgesFilename(prefix, fileIdx, binary);
+	struct stat buffer;   
+	while(stat (edgefile.c_str(), &buffer) == 0)
+	{
+		remove(edgefile.c_str());
+		//search for next edge file
+		fileIdx++;
+		edgefile = getEdgesFilename(prefix, fileIdx, binary);
+	}
+}
+
 // Compute the hits for each read in the input file without threading
 // Return the number of reads processed
 size_t computeHitsSerial(const std::string& prefix, const std::string& readsFile, const OverlapAlgorithm* pOverlapper, int minOverlap, 
 						StringVector& filenameVec, std::ostream* pASQGWriter)
 {
-	std::string filename = prefix + "-thread0" +HITS_EXT + GZIP_EXT;
+	std::string filename = getEdgesFilename(prefix, 0, opt::bBinaryEdges);
 	filenameVec.push_back(filename);
+	removeEdgeFiles(prefix, 1, opt::bBinaryEdges);
+	removeEdgeFiles(prefix, 0, !opt::bBinaryEdges);
 
-	OverlapProcess processor(filename, pOverlapper, minOverlap);
+	OverlapProcess processor(filename, pOverlapper, minOverlap, opt::bBinaryEdges);
 	OverlapPostProcess postProcessor(pASQGWriter, pOverlapper);
 
 	size_t numProcessed = 
@@ -275,30 +320,15 @@ size_t computeHitsParallel(int numThreads, const std::string& prefix, const std:
 	std::vector<OverlapProcess*> processorVector;
 	for(int i = 0; i < numThreads; ++i)
 	{
-		std::stringstream ss;
-		ss << prefix << "-thread" << i << HITS_EXT << GZIP_EXT;
-		std::string outfile = ss.str();
+		std::string outfile = getEdgesFilename(prefix, i, opt::bBinaryEdges);
 		filenameVec.push_back(outfile);
-		OverlapProcess* pProcessor = new OverlapProcess(outfile, pOverlapper, minOverlap);
+		OverlapProcess* pProcessor = new OverlapProcess(outfile, pOverlapper, minOverlap, opt::bBinaryEdges);
 		processorVector.push_back(pProcessor);
 	}
 
-	//Remove previous edge files generated by larger threads, otherwise, subsequent assembly may load inconsistent edges files
-	std::stringstream ss;
-	size_t fileIdx=numThreads;
-	ss << prefix << "-thread" << fileIdx << HITS_EXT << GZIP_EXT;
-	std::string edgefile = ss.str();
-	
-	struct stat buffer;   
-	while(stat (edgefile.c_str(), &buffer) == 0)
-	{
-		remove(edgefile.c_str());
-		//search for next edge file
-		ss.str("");
-		fileIdx++;
-		ss << prefix << "-thread" << fileIdx << HITS_EXT << GZIP_EXT;
-		edgefile = ss.str();
-	}
+	//Remove previous edge files generated by larger threads, or in the other format
+	removeEdgeFiles(prefix, numThreads, opt::bBinaryEdges);
+	removeEdgeFiles(prefix, 0, !opt::bBinaryEdges);
 	/*
 	std::istream* pistream = createReader(edgefile);
 	while(pistream->peek()!=std::istream::traits_type::eof())
@@ -487,10 +517,13 @@ void parseOverlapOptions(int argc, char** argv)
 		case 'd': arg >> opt::sampleRate; break;
 		case 'f': arg >> opt::targetFile; break;
 		case OPT_EXACT: opt::bExactIrreducible = true; break;
+		case OPT_BINARYEDGES: opt::bBinaryEdges = true; break;
 		case 'x': opt::bIrreducibleOnly = false; break;
 		case 'p': opt::bIsPairedOverlapOnly = true;  opt::bIrreducibleOnly = false; break;
 		case '?': die = true; break;
 		case 'v': opt::verbose++; break;
+		case OPT_GZLEVEL: arg >> opt::gzLevel; break;
+		case OPT_NUMA: opt::useNuma = true; break;
 		case OPT_HELP:
 			std::cout << OVERLAP_USAGE_MESSAGE;
 			exit(EXIT_SUCCESS);
@@ -523,12 +556,27 @@ void parseOverlapOptions(int argc, char** argv)
 		die = true;
 	}
 
+	// The binary edges name the reads by their index in the vertex records, which only hold the query reads
+	if(opt::bBinaryEdges && !opt::targetFile.empty())
+	{
+		std::cerr << SUBPROGRAM ": --binary-edges cannot be used with --target-file\n";
+		die = true;
+	}
+
+	if(opt::gzLevel < 0 || opt::gzLevel > 9)
+	{
+		std::cerr << SUBPROGRAM ": invalid compression level: " << opt::gzLevel << ", must be between 0 and 9\n";
+		die = true;
+	}
+
 	if (die) 
 	{
 		std::cout << "\n" << OVERLAP_USAGE_MESSAGE;
 		exit(EXIT_FAILURE);
 	}
 
+	BGZFStreamBuf::setDefaultLevel(opt::gzLevel);
+
 	// Validate parameters
 	if(opt::errorRate <= 0)
 	opt::errorRate = 0.0f;
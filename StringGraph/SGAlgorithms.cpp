@@ -15,13 +15,7 @@
 // add edges to the graph for the given overlap
 Edge* SGAlgorithms::createEdgesFromOverlap(StringGraph* pGraph, const Overlap& o, bool allowContained, size_t maxEdges,GraphColor c)
 {
-    // Initialize data and perform checks
     Vertex* pVerts[2];
-    EdgeComp comp = (o.match.isRC()) ? EC_REVERSE : EC_SAME;
-
-    bool isContainment = o.match.isContainment();
-    assert(allowContained || !isContainment);
-    (void)allowContained;
     for(size_t idx = 0; idx < 2; ++idx)
     {
         pVerts[idx] = pGraph->getVertex(o.id[idx]);
@@ -33,6 +27,20 @@ Edge* SGAlgorithms::createEdgesFromOverlap(StringGraph* pGraph, const Overlap& o
             return NULL;
     }
 
+    return createEdgesFromOverlap(pGraph, pVerts[0], pVerts[1], o, allowContained, maxEdges, c);
+}
+
+//
+Edge* SGAlgorithms::createEdgesFromOverlap(StringGraph* pGraph, Vertex* pVert0, Vertex* pVert1, const Overlap& o, bool allowContained, size_t maxEdges,GraphColor c)
+{
+    // Initialize data and perform checks
+    Vertex* pVerts[2] = { pVert0, pVert1 };
+    EdgeComp comp = (o.match.isRC()) ? EC_REVERSE : EC_SAME;
+
+    bool isContainment = o.match.isContainment();
+    assert(allowContained || !isContainment);
+    (void)allowContained;
+
     // Check if this is a substring containment, if so mark the contained read
     // but do not create edges
     for(size_t idx = 0; idx < 2; ++idx)
@@ -75,8 +83,7 @@ Edge* SGAlgorithms::createEdgesFromOverlap(StringGraph* pGraph, const Overlap& o
         {
             EdgeDir dir = o.match.coord[idx].isLeftExtreme() ? ED_ANTISENSE : ED_SENSE;
             const SeqCoord& coord = o.match.coord[idx];
-            //pEdges[idx] = new(pGraph->getEdgeAllocator()) Edge(pVerts[1 - idx], dir, comp, coord,c);
-			pEdges[idx] = new Edge(pVerts[1 - idx], dir, comp, coord,c);
+            pEdges[idx] = new(pGraph->getEdgeAllocator()) Edge(pVerts[1 - idx], dir, comp, coord,c);
         }
 
         pEdges[0]->setTwin(pEdges[1]);
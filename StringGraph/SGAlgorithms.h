@@ -35,6 +35,10 @@ void remodelVertexForExcision(StringGraph* pGraph, Vertex* pVertex, Edge* pDelet
 // if the edges cannot be added
 Edge* createEdgesFromOverlap(StringGraph* pGraph, const Overlap& o, bool allowContained, size_t maxEdges = -1,GraphColor c =0);
 
+// As above, for the overlap between the vertices pVert0 and pVert1 that
+// were already looked up. The ids of o are only used for containments
+Edge* createEdgesFromOverlap(StringGraph* pGraph, Vertex* pVert0, Vertex* pVert1, const Overlap& o, bool allowContained, size_t maxEdges = -1,GraphColor c =0);
+
 // Calculate the error rate between the two vertex sequences
 double calcErrorRate(const Vertex* pX, const Vertex* pY, const Overlap& ovrXY);
 
@@ -11,6 +11,7 @@
 #include "SeqReader.h"
 #include "SGAlgorithms.h"
 #include "SGVisitors.h"
+#include "BinaryEdge.h"
 #include "../StriDe/SGACommon.h"
 
 StringGraph* SGUtil::loadASQG(const StringVector & filenameList, const unsigned int minOverlap, bool allowContainments , size_t maxEdges ,GraphColor c)
@@ -129,10 +130,11 @@ StringGraph* SGUtil::loadASQG(const StringVector & filenameList, const unsigned
 	return pGraph;
 }
 
-StringGraph* SGUtil::loadASQGVertex(const std::string& filename, const unsigned int minOverlap, bool allowContainments, size_t maxEdges)
+StringGraph* SGUtil::loadASQGVertex(const std::string& filename, const unsigned int minOverlap, bool allowContainments, size_t maxEdges, bool integerIDs)
 {
 	// Initialize graph
 	StringGraph* pGraph = new StringGraph;
+	pGraph->setIntegerIDMode(integerIDs);
 	std::istream* pReader = createReader(filename);
 	int stage = 0;
 	int line = 0;
@@ -234,12 +236,249 @@ StringGraph* SGUtil::loadASQGVertex(const std::string& filename, const unsigned
 	return pGraph;
 }
 
+// The number of records a thread takes from an edge file at a time
+static const size_t LOAD_BATCH_SIZE = 1 << 14;
+
+// Hand out the batches of records of the sources to all threads. A thread keeps
+// taking batches from one source until it is exhausted and then moves on to the
+// next, so the parsing is spread over all threads however many files there are
+// and only one batch per thread is held in memory. func is called concurrently
+template<typename Source, typename Batch, typename Func>
+static void forEachBatch(const std::vector<Source*>& sources, const Func& func)
+{
+	size_t numSources = sources.size();
+	if(numSources == 0)
+		return;
+
+	std::vector<omp_lock_t> locks(numSources);
+	std::vector<char> exhausted(numSources, 0);
+	for(size_t i = 0; i < numSources; i++)
+		omp_init_lock(&locks[i]);
+
+	#pragma omp parallel
+	{
+		Batch batch;
+		size_t sourceIdx = omp_get_thread_num() % numSources;
+		while(true)
+		{
+			bool found = false;
+			for(size_t k = 0; k < numSources && !found; k++)
+			{
+				size_t idx = (sourceIdx + k) % numSources;
+				omp_set_lock(&locks[idx]);
+				if(!exhausted[idx])
+				{
+					found = sources[idx]->read(batch);
+					exhausted[idx] = !found;
+				}
+				omp_unset_lock(&locks[idx]);
+				if(found)
+					sourceIdx = idx;
+			}
+
+			if(!found)
+				break;
+			func(sourceIdx, batch);
+		}
+	}
+
+	for(size_t i = 0; i < numSources; i++)
+		omp_destroy_lock(&locks[i]);
+}
+
+// The lines of a text edge file
+class EdgeLineSource
+{
+	public:
+		EdgeLineSource(std::istream* pReader) : m_pReader(pReader) {}
+
+		bool read(StringVector& lines)
+		{
+			lines.resize(LOAD_BATCH_SIZE);
+			size_t numLines = 0;
+			while(numLines < LOAD_BATCH_SIZE && getline(*m_pReader, lines[numLines]))
+				numLines++;
+			lines.resize(numLines);
+			return numLines > 0;
+		}
+
+	private:
+		std::istream* m_pReader;
+};
+
+// The records of a binary edge file
+class BinaryEdgeSource
+{
+	public:
+		BinaryEdgeSource(BinaryEdge::Reader* pReader) : m_pReader(pReader) {}
+
+		bool read(BinaryEdge::RecordVector& records) { return m_pReader->read(records, LOAD_BATCH_SIZE); }
+
+	private:
+		BinaryEdge::Reader* m_pReader;
+};
+
+// Add the edges of a batch of ED records to the graph
+struct AddEdgeLines
+{
+	AddEdgeLines(const StringVector& names, const unsigned int mo, bool ac, size_t me, GraphColor col, StringGraph* pG) :
+		filenames(names), minOverlap(mo), allowContainments(ac), maxEdges(me), c(col), pGraph(pG) {}
+
+	void operator()(size_t fileIdx, const StringVector& lines) const
+	{
+		for(size_t i = 0; i < lines.size(); i++)
+		{
+			ASQG::RecordType rt = ASQG::getRecordType(lines[i]);
+			if (rt != ASQG::RT_EDGE)
+			{	
+				std::cerr << "Error: Unexpected record found in edge file " << filenames[fileIdx] << "\n";
+				exit(EXIT_FAILURE);
+			}
+			ASQG::EdgeRecord edgeRecord(lines[i]);
+			const Overlap& ovr = edgeRecord.getOverlap();
+			
+			// Add the edge to the graph
+			if(ovr.match.getMinOverlapLength() >= (int)minOverlap)
+				SGAlgorithms::createEdgesFromOverlap(pGraph, ovr, allowContainments, maxEdges, c);
+		}
+	}
+
+	const StringVector& filenames;
+	const unsigned int minOverlap;
+	bool allowContainments;
+	size_t maxEdges;
+	GraphColor c;
+	StringGraph* pGraph;
+};
+
+// Add the edges of a batch of binary records to the graph. The records name
+// the reads by their index, which is the index of their vertex in the graph
+struct AddBinaryEdges
+{
+	AddBinaryEdges(const StringVector& names, const unsigned int mo, bool ac, size_t me, StringGraph* pG) :
+		filenames(names), minOverlap(mo), allowContainments(ac), maxEdges(me), pGraph(pG) {}
+
+	void operator()(size_t fileIdx, const BinaryEdge::RecordVector& records) const
+	{
+		for(size_t j = 0; j < records.size(); j++)
+		{
+			const BinaryEdge::Record& record = records[j];
+			if(record.idx[0] >= pGraph->getNumVertexIndices() || record.idx[1] >= pGraph->getNumVertexIndices())
+			{
+				std::cerr << "Error: the edges " << filenames[fileIdx] << " refer to a read that is not in the graph\n";
+				exit(EXIT_FAILURE);
+			}
+
+			Vertex* pVert0 = pGraph->getVertexByIndex(record.idx[0]);
+			Vertex* pVert1 = pGraph->getVertexByIndex(record.idx[1]);
+
+			Overlap ovr;
+			ovr.match = record.toMatch(pVert0->getSeqLen(), pVert1->getSeqLen());
+			if(ovr.match.getMinOverlapLength() < (int)minOverlap)
+				continue;
+
+			// The ids decide which of two identical reads is contained
+			if(record.flags & BinaryEdge::BEF_CONTAINMENT)
+			{
+				ovr.id[0] = pVert0->getID();
+				ovr.id[1] = pVert1->getID();
+			}
+			SGAlgorithms::createEdgesFromOverlap(pGraph, pVert0, pVert1, ovr, allowContainments, maxEdges);
+		}
+	}
+
+	const StringVector& filenames;
+	const unsigned int minOverlap;
+	bool allowContainments;
+	size_t maxEdges;
+	StringGraph* pGraph;
+};
+
+// Load the edges of the binary edge files
+static void loadBinaryEdges(const StringVector& filenames, const unsigned int minOverlap,
+                            bool allowContainments, size_t maxEdges, StringGraph* pGraph)
+{
+	std::vector<BinaryEdge::Reader*> readers;
+	std::vector<BinaryEdgeSource*> sources;
+	for(size_t i = 0; i < filenames.size(); i++)
+	{
+		BinaryEdge::Reader* pReader = new BinaryEdge::Reader(filenames[i]);
+		if(pReader->getNumVertices() != pGraph->getNumVertexIndices())
+		{
+			std::cerr << "Error: the edges " << filenames[i] << " are for " << pReader->getNumVertices()
+			          << " reads but the graph has " << pGraph->getNumVertexIndices() << " vertices\n";
+			exit(EXIT_FAILURE);
+		}
+		readers.push_back(pReader);
+		sources.push_back(new BinaryEdgeSource(pReader));
+	}
+
+	AddBinaryEdges addEdges(filenames, minOverlap, allowContainments, maxEdges, pGraph);
+	forEachBatch<BinaryEdgeSource, BinaryEdge::RecordVector>(sources, addEdges);
+
+	for(size_t i = 0; i < readers.size(); i++)
+	{
+		delete sources[i];
+		delete readers[i];
+	}
+}
+
+// Load the ED records of the text edge files
+static void loadEdgeLines(const std::vector<std::istream*>& readers, const StringVector& filenames, const unsigned int minOverlap,
+                          bool allowContainments, size_t maxEdges, GraphColor c, StringGraph* pGraph)
+{
+	std::vector<EdgeLineSource*> sources;
+	for(size_t i = 0; i < readers.size(); i++)
+		sources.push_back(new EdgeLineSource(readers[i]));
+
+	AddEdgeLines addEdges(filenames, minOverlap, allowContainments, maxEdges, c, pGraph);
+	forEachBatch<EdgeLineSource, StringVector>(sources, addEdges);
+
+	for(size_t i = 0; i < sources.size(); i++)
+		delete sources[i];
+}
+
+//search for the binary edges files named with xxxx-thread??.edges.bin, written by overlap --binary-edges
+static StringVector findBinaryEdgeFiles(const std::string& ASQGFileName)
+{
+	std::string edgeFilePrefix = stripFilename(ASQGFileName);
+	StringVector binaryEdgeFiles;
+	for(size_t fileIdx = 0; ; fileIdx++)
+	{
+		std::stringstream binaryName;
+		binaryName << edgeFilePrefix << "-thread" << fileIdx << HITS_EXT << BIN_EXT;
+		if(!BinaryEdge::Reader::isBinary(binaryName.str()))
+			break;
+		binaryEdgeFiles.push_back(binaryName.str());
+	}
+	return binaryEdgeFiles;
+}
+
+bool SGUtil::hasBinaryEdges(const std::string& ASQGFileName)
+{
+	return !findBinaryEdgeFiles(ASQGFileName).empty();
+}
+
 StringGraph* SGUtil::loadASQGEdge(std::string ASQGFileName, const unsigned int minOverlap, bool allowContainments, size_t maxEdges, StringGraph* pGraph)
 {
 	std::string edgeFilePrefix = stripFilename(ASQGFileName);
 	std::vector<std::istream*> EdgeFileVec;
 
+	StringVector binaryEdgeFiles = findBinaryEdgeFiles(ASQGFileName);
+	if(!binaryEdgeFiles.empty())
+	{
+		for(size_t i = 0; i < binaryEdgeFiles.size(); i++)
+			std::cout << binaryEdgeFiles[i] << std::endl;
+		loadBinaryEdges(binaryEdgeFiles, minOverlap, allowContainments, maxEdges, pGraph);
+
+		// Remove any duplicate edges
+		SGDuplicateVisitor dupVisit;
+		pGraph->visit(dupVisit);
+		return pGraph;
+	}
+
 	//search for the edges files named with xxxx-thread??.edges.gz, if existed
+	StringVector edgeFiles;
 	std::stringstream ss;
 	size_t fileIdx=0;
 	ss << edgeFilePrefix << "-thread" << fileIdx << HITS_EXT << GZIP_EXT;
@@ -249,6 +488,7 @@ StringGraph* SGUtil::loadASQGEdge(std::string ASQGFileName, const unsigned int m
 	{
 		std::cout << edgefile << std::endl;
 		EdgeFileVec.push_back(pistream);
+		edgeFiles.push_back(edgefile);
 		//search for next edge file
 		ss.str("");
 		fileIdx++;
@@ -256,32 +496,11 @@ StringGraph* SGUtil::loadASQGEdge(std::string ASQGFileName, const unsigned int m
 		edgefile = ss.str();
 		pistream = createReader(edgefile);		
 	}
+	delete pistream;
 
-	int line = 0;
-
-	#pragma omp parallel for
+	loadEdgeLines(EdgeFileVec, edgeFiles, minOverlap, allowContainments, maxEdges, GC_WHITE, pGraph);
 	for(size_t i=0 ; i< EdgeFileVec.size() ;i++)
-	{
-		std::string recordLine;
-		while(getline(*EdgeFileVec[i],recordLine))
-		{
-			ASQG::RecordType rt = ASQG::getRecordType(recordLine);
-			if (rt != ASQG::RT_EDGE)
-			{	
-				std::cerr << "Error: Unexpected edge record found at line " << line << "\n";
-				exit(EXIT_FAILURE);
-			}
-			ASQG::EdgeRecord edgeRecord(recordLine);
-			const Overlap& ovr = edgeRecord.getOverlap();
-			
-			// Add the edge to the graph
-			if(ovr.match.getMinOverlapLength() >= (int)minOverlap)
-				SGAlgorithms::createEdgesFromOverlap(pGraph, ovr, allowContainments, maxEdges);
-			
-			++line;
-		}
 		delete EdgeFileVec[i];
-	}
 
 	// Completely delete the edges for all nodes that were marked as super-repetitive in the graph
 	//SGSuperRepeatVisitor superRepeatVisitor;
@@ -294,6 +513,55 @@ StringGraph* SGUtil::loadASQGEdge(std::string ASQGFileName, const unsigned int m
 	return pGraph;
 }
 
+// Set the parameters of the graph from an HT record
+static void loadHeaderRecord(StringGraph* pGraph, const std::string& recordLine)
+{
+	ASQG::HeaderRecord headerRecord(recordLine);
+	const SQG::IntTag& overlapTag = headerRecord.getOverlapTag();
+	if(overlapTag.isInitialized())
+		pGraph->setMinOverlap(overlapTag.get());
+	else
+		pGraph->setMinOverlap(0);
+
+	const SQG::FloatTag& errorRateTag = headerRecord.getErrorRateTag();
+	if(errorRateTag.isInitialized())
+	pGraph->setErrorRate(errorRateTag.get());
+	
+	const SQG::IntTag& containmentTag = headerRecord.getContainmentTag();
+	if(containmentTag.isInitialized())
+	pGraph->setContainmentFlag(containmentTag.get());
+	else
+	pGraph->setContainmentFlag(true); // conservatively assume containments are present
+
+	const SQG::IntTag& transitiveTag = headerRecord.getTransitiveTag();
+	if(!transitiveTag.isInitialized())
+	{
+		std::cerr << "Warning: ASQG does not have transitive tag\n";
+		pGraph->setTransitiveFlag(true);
+	}
+	else
+	{
+		pGraph->setTransitiveFlag(transitiveTag.get());
+	}
+}
+
+// Add the vertex of a VT record to the graph. Safe to call from several threads
+static void loadVertexRecord(StringGraph* pGraph, const std::string& recordLine)
+{
+	ASQG::VertexRecord vertexRecord(recordLine);
+	const SQG::IntTag& ssTag = vertexRecord.getSubstringTag();
+
+	Vertex* pVertex = new(pGraph->getVertexAllocator()) Vertex(vertexRecord.getID(), vertexRecord.getSeq());
+
+	if(ssTag.isInitialized() && ssTag.get() == 1)
+	{
+		// Vertex is a substring of some other vertex, mark it as contained
+		pVertex->setContained(true);
+		pGraph->setContainmentFlag(true);
+	}
+	pGraph->addVertex(pVertex);
+}
+
 StringGraph*  SGUtil::loadASQG_Parallel(const StringVector & filenameList, const unsigned int minOverlap, 
 bool allowContainments , size_t maxEdges ,GraphColor c)
 {
@@ -302,95 +570,50 @@ bool allowContainments , size_t maxEdges ,GraphColor c)
 	
 	StringGraph* pGraph = new StringGraph;
 	size_t fileNumber = filenameList.size();
-	std::vector<StringVector> decodeFiles(fileNumber);
+	std::vector<std::istream*> readers(fileNumber);
 
-	std::cout << "#Parallel decoding" << std::endl;
-	#pragma omp parallel for num_threads(fileNumber)
+	// The vertices of all files are added before any edge, which may join vertices of different files.
+	// The first ED record of each file ends its vertices and is kept for the edge loading
+	StringVector firstEdgeLines(fileNumber);
+
+	std::cout << "#Parallel loading of the vertices" << std::endl;
+	#pragma omp parallel for schedule(dynamic)
 	for ( size_t i = 0; i < fileNumber ;i ++)
 	{
-		std::istream* pReader = createReader(filenameList[i]);
+		readers[i] = createReader(filenameList[i]);
 		std::string recordLine;
-		while(getline(*pReader, recordLine)) 
-			decodeFiles[i].push_back(recordLine);
-		std::cout << filenameList[i] << " is decoded." << std::endl;
-		delete pReader;
-		
-	}
-
-	std::cout << "#Serial loading." << std::endl;
-	for (size_t i=0;i<fileNumber;i++)
-	{
-		for (size_t j=0;j<decodeFiles[i].size();j++)
+		while(getline(*readers[i], recordLine))
 		{
-			ASQG::RecordType rt = ASQG::getRecordType(decodeFiles[i][j]);
-			switch(rt)
+			ASQG::RecordType rt = ASQG::getRecordType(recordLine);
+			if(rt == ASQG::RT_EDGE)
 			{
-			case ASQG::RT_HEADER:
-				{
-					ASQG::HeaderRecord headerRecord(decodeFiles[i][j]);
-					const SQG::IntTag& overlapTag = headerRecord.getOverlapTag();
-					if(overlapTag.isInitialized())
-						pGraph->setMinOverlap(overlapTag.get());
-					else
-						pGraph->setMinOverlap(0);
-
-					const SQG::FloatTag& errorRateTag = headerRecord.getErrorRateTag();
-					if(errorRateTag.isInitialized())
-					pGraph->setErrorRate(errorRateTag.get());
-					
-					const SQG::IntTag& containmentTag = headerRecord.getContainmentTag();
-					if(containmentTag.isInitialized())
-					pGraph->setContainmentFlag(containmentTag.get());
-					else
-					pGraph->setContainmentFlag(true); // conservatively assume containments are present
-
-					const SQG::IntTag& transitiveTag = headerRecord.getTransitiveTag();
-					if(!transitiveTag.isInitialized())
-					{
-						std::cerr << "Warning: ASQG does not have transitive tag\n";
-						pGraph->setTransitiveFlag(true);
-					}
-					else
-					{
-						pGraph->setTransitiveFlag(transitiveTag.get());
-					}
-					break;
-				}
-			case ASQG::RT_VERTEX:
-				{
-					// progress the stage if we are done the header
-					ASQG::VertexRecord vertexRecord(decodeFiles[i][j]);
-					const SQG::IntTag& ssTag = vertexRecord.getSubstringTag();
-
-					Vertex* pVertex = new(pGraph->getVertexAllocator()) Vertex(vertexRecord.getID(), vertexRecord.getSeq());
-					if(ssTag.isInitialized() && ssTag.get() == 1)
-					{
-						// Vertex is a substring of some other vertex, mark it as contained
-						pVertex->setContained(true);
-						pGraph->setContainmentFlag(true);
-					}
-					pGraph->addVertex(pVertex);
-					break;
-				}
-			case ASQG::RT_EDGE:
-				{
-					ASQG::EdgeRecord edgeRecord(decodeFiles[i][j]);
-					const Overlap& ovr = edgeRecord.getOverlap();
+				firstEdgeLines[i].swap(recordLine);
+				break;
+			}
 
-						// Add the edge to the graph
-					if(ovr.match.getMinOverlapLength() >= (int)minOverlap)
-							SGAlgorithms::createEdgesFromOverlap(pGraph, ovr, allowContainments, maxEdges,c);
-					break;
-				}
-			
+			if(rt == ASQG::RT_HEADER)
+			{
+				#pragma omp critical(SGUtilHeader)
+				loadHeaderRecord(pGraph, recordLine);
+			}
+			else
+			{
+				loadVertexRecord(pGraph, recordLine);
 			}
-		
 		}
-		std::cout << filenameList[i] << " is finish." << std::endl;
 	}
-	
-	
 
+	std::cout << "#Parallel loading of the edges" << std::endl;
+	AddEdgeLines addFirstEdges(filenameList, minOverlap, allowContainments, maxEdges, c, pGraph);
+	for (size_t i = 0; i < fileNumber; i++)
+	{
+		if(!firstEdgeLines[i].empty())
+			addFirstEdges(i, StringVector(1, firstEdgeLines[i]));
+	}
+
+	loadEdgeLines(readers, filenameList, minOverlap, allowContainments, maxEdges, c, pGraph);
+	for (size_t i = 0; i < fileNumber; i++)
+		delete readers[i];
 		
 	// Completely delete the edges for all nodes that were marked as super-repetitive in the graph
 	//SGSuperRepeatVisitor superRepeatVisitor;
@@ -418,42 +641,14 @@ StringGraph* SGUtil::loadASQG_EDGE_Parallel(const StringVector & filenameList, c
 	assert (c != GC_RED);
 	
 	size_t fileNumber = filenameList.size();
-	std::vector<StringVector> decodeFiles(fileNumber);
-	
-	std::cout << "#Parallel decoding" << std::endl;
-	#pragma omp parallel for num_threads(fileNumber)
+	std::vector<std::istream*> readers(fileNumber);
 	for ( size_t i = 0; i < fileNumber ;i ++)
-	{
-		std::istream* pReader = createReader(filenameList[i]);
-		std::string recordLine;
-		while(getline(*pReader, recordLine)) 
-			decodeFiles[i].push_back(recordLine);
-		std::cout << filenameList[i] << " is decoded." << std::endl;
-		delete pReader;
-		
-	}
+		readers[i] = createReader(filenameList[i]);
 	
-	std::cout << "#Serial loading." << std::endl;
-	for (size_t i=0;i<fileNumber;i++)
-	{
-		for (size_t j=0;j<decodeFiles[i].size();j++)
-		{
-			ASQG::RecordType rt = ASQG::getRecordType(decodeFiles[i][j]);
-			if (rt != ASQG::RT_EDGE)
-			{	
-				std::cerr << "Error: Unexpected edge record found at " << filenameList[i] << "\n";
-				exit(EXIT_FAILURE);
-			}
-			ASQG::EdgeRecord edgeRecord(decodeFiles[i][j]);
-			const Overlap& ovr = edgeRecord.getOverlap();
-			
-			// Add the edge to the graph
-			if(ovr.match.getMinOverlapLength() >= (int)minOverlap)
-				SGAlgorithms::createEdgesFromOverlap(pGraph, ovr, allowContainments, maxEdges,c);
-				
-		}
-		std::cout << filenameList[i] << " is finish." << std::endl;
-	}
+	std::cout << "#Parallel loading of the edges" << std::endl;
+	loadEdgeLines(readers, filenameList, minOverlap, allowContainments, maxEdges, c, pGraph);
+	for ( size_t i = 0; i < fileNumber ;i ++)
+		delete readers[i];
 	
 	
 	// Completely delete the edges for all nodes that were marked as super-repetitive in the graph
@@ -25,9 +25,14 @@ namespace SGUtil
 	StringGraph* loadASQG(const StringVector & filenameList, const unsigned int minOverlap, bool allowContainments = false, size_t maxEdges = -1,GraphColor c =GC_WHITE);
 
 	//Parallel loading asqg by YTH
-	StringGraph* loadASQGVertex(const std::string& filename, const unsigned int minOverlap, bool allowContainments = false, size_t maxEdges=-1);
+	// The vertices are indexed in the order of the ASQG file, which is the order the binary
+	// edge files refer to. With integerIDs the graph does not index the names of the vertices
+	StringGraph* loadASQGVertex(const std::string& filename, const unsigned int minOverlap, bool allowContainments = false, size_t maxEdges=-1, bool integerIDs = false);
 	StringGraph* loadASQGEdge(std::string ASQGFileName, const unsigned int minOverlap, bool allowContainments, size_t maxEdges, StringGraph* pGraph);
 
+	// Returns true if the edges of the ASQG file were written as binary edge files
+	bool hasBinaryEdges(const std::string& ASQGFileName);
+
 	StringGraph* loadASQG_Parallel(const StringVector & filenameList, const unsigned int minOverlap, bool allowContainments = false, size_t maxEdges = -1,GraphColor c =GC_WHITE);
 	StringGraph* loadASQG_EDGE_Parallel(const StringVector & filenameList, const unsigned int minOverlap, bool allowContainments = false, size_t maxEdges = -1,GraphColor c =GC_WHITE , StringGraph* pGraph=NULL);
 
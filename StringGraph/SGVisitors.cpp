@@ -1423,10 +1423,14 @@ bool SGIslandCollectVisitor::visit(StringGraph* /*pGraph*/, Vertex* pVertex)
             }
         }
 
-		(pVertex->pVReadIDs).push_back(pVPrefixFwdID.getReadIDs());
-		(pVertex->pVReadIDs).push_back(pVPrefixRvcID.getReadIDs());
-		(pVertex->pVReadIDs).push_back(pVSuffixFwdID.getReadIDs());
-		(pVertex->pVReadIDs).push_back(pVSuffixRvcID.getReadIDs());
+		IslandReadIDs readIDs;
+		readIDs.push_back(pVPrefixFwdID.getReadIDs());
+		readIDs.push_back(pVPrefixRvcID.getReadIDs());
+		readIDs.push_back(pVSuffixFwdID.getReadIDs());
+		readIDs.push_back(pVSuffixRvcID.getReadIDs());
+
+		#pragma omp critical(IslandReadIDs)
+		m_pIslandReadIDs->insert(std::make_pair(pVertex->getIndex(), readIDs));
         changed=true;
     }
 
@@ -1458,14 +1462,20 @@ int64_t SGJoinIslandVisitor::getAnotherID(int64_t idx)
 }
 
 // Search for neighbor vertex pW having PE support wrt pV at islandDir
-// iterate through each read ID stored in pVReadIDs[islandDir]
+// iterate through each read ID collected for pV at islandDir
 // return a hashmap pWIDs storing pWs with PE support
-void SGJoinIslandVisitor::findNeighborWithPESupport(Vertex* pV, size_t islandDir, SparseHashMap<VertexID, size_t*, StringHasher>& pWIDs)
+void SGJoinIslandVisitor::findNeighborWithPESupport(Vertex* pV, size_t islandDir, SparseHashMap<size_t, size_t*>& pWIDs)
 {
-	for(size_t i=0; i<pV->pVReadIDs[islandDir].size(); i++)
+	//islands/tips formed after the collection have no read IDs
+	IslandReadIDMap::const_iterator readIDIter = m_pIslandReadIDs->find(pV->getIndex());
+	if(readIDIter == m_pIslandReadIDs->end())
+		return;
+
+	const std::vector<int64_t>& readIDs = readIDIter->second[islandDir];
+	for(size_t i=0; i<readIDs.size(); i++)
 	{
 		//convert the read ID mapped on pV into PEID of the other end
-		int64_t PEID=getAnotherID(pV->pVReadIDs[islandDir][i]);
+		int64_t PEID=getAnotherID(readIDs[i]);
 		//retrieve the vertices pWs containing PEID into currentList 
 		ThreadSafeList<std::pair<Vertex*, ReadOnContig> >  currentList= m_tslv->at(PEID);
 		// std::cout << currentList.size() << "\n";
@@ -1476,8 +1486,8 @@ void SGJoinIslandVisitor::findNeighborWithPESupport(Vertex* pV, size_t islandDir
 			Vertex* pW=slit->first;
 			ReadOnContig roc=slit->second;
 
-			SparseHashMap<VertexID, size_t*, StringHasher>::iterator islandIter;
-			islandIter=pWIDs.find(pW->getID());
+			SparseHashMap<size_t, size_t*>::iterator islandIter;
+			islandIter=pWIDs.find(pW->getIndex());
 			if(islandIter!=pWIDs.end())	//pWID already has this vertex mapped, increment the mapping frequency
 			{
 				islandIter->second[roc]++;
@@ -1487,7 +1497,7 @@ void SGJoinIslandVisitor::findNeighborWithPESupport(Vertex* pV, size_t islandDir
 				size_t* readcount = new size_t[4];	//memory leak
 				readcount[0]=readcount[1]=readcount[2]=readcount[3]=0;
 				readcount[roc]++;
-				pWIDs.insert(std::make_pair(pW->getID(), readcount));
+				pWIDs.insert(std::make_pair(pW->getIndex(), readcount));
 			}
 		}
 	}
@@ -1524,16 +1534,16 @@ bool SGJoinIslandVisitor::visit(StringGraph* pGraph, Vertex* pVertex)
 			if( pV->countEdges(ED_ANTISENSE)>0 && (islandDir==AntisenseFwd || islandDir==AntisenseRvc)) continue;
 			if( pV->countEdges(ED_SENSE)>0 && (islandDir==SenseFwd || islandDir==SenseRvc)) continue;
 
-			//pWIDs stores IDs of all islands/tips having PE mapped onto pV
-			SparseHashMap<VertexID, size_t*, StringHasher> pWIDs;
+			//pWIDs stores the indices of all islands/tips having PE mapped onto pV
+			SparseHashMap<size_t, size_t*> pWIDs;
 			//Search for vertex pW having PE support wrt pV at islandDir
 			findNeighborWithPESupport(pV, islandDir, pWIDs);
 			
 			//for each pW, perform FM-index walk between pW and pV
-			SparseHashMap<VertexID, size_t*, StringHasher>::iterator islandIter;
+			SparseHashMap<size_t, size_t*>::iterator islandIter;
             for(islandIter=pWIDs.begin(); islandIter!=pWIDs.end() ; islandIter++)
             {
-                Vertex *pW=pGraph->getVertex(islandIter->first);
+                Vertex *pW=pGraph->getVertexByIndex(islandIter->first);
 				if(pV==pW) continue;
 				
 				//retrieve the PE mapping frequency of pW
@@ -1547,8 +1557,13 @@ bool SGJoinIslandVisitor::visit(StringGraph* pGraph, Vertex* pVertex)
 
 				// std::cout << pV->getID() << "<->" << pW->getID() <<"\t"<< PreFwdCount <<":"<< PreRvcCount <<":"<< SufFwdCount <<":"<< SufRvcCount <<"\t"<< islandDir <<"\n";
 					
-               	//Deadlock prevention: the vertex with smaller memory address is always locked first, which prevent mutual locking pV<->pW at two threads
-				pGraph->lockTwoVertices(pV,pW);
+				//Take both locks without waiting. If another thread holds one, pV is visited again after the
+				//parallel pass, where the directions joined meanwhile are skipped by the edge checks above
+				if(!pGraph->tryLockTwoVertices(pV,pW))
+				{
+					pGraph->deferVisit(pV);
+					return true;
+				}
 				
 				std::string pVstr=pV->getStr();
 				std::string pWstr=pW->getStr();
@@ -1588,8 +1603,8 @@ bool SGJoinIslandVisitor::visit(StringGraph* pGraph, Vertex* pVertex)
 							//Step 3: Create new edges between pV and pW
 							SeqCoord coordV(0,m_kmer-1,pVstr.length());
 							SeqCoord coordW(0,m_kmer-1,pWStrNew.length());
-							Edge* edgeVW=new Edge(pW,ED_ANTISENSE,EC_REVERSE,coordV);
-							Edge* edgeWV=new Edge(pV,ED_ANTISENSE,EC_REVERSE,coordW);
+							Edge* edgeVW=new(pGraph->getEdgeAllocator()) Edge(pW,ED_ANTISENSE,EC_REVERSE,coordV);
+							Edge* edgeWV=new(pGraph->getEdgeAllocator()) Edge(pV,ED_ANTISENSE,EC_REVERSE,coordW);
 							edgeVW->setTwin(edgeWV);
 							edgeWV->setTwin(edgeVW);
 							pGraph->addEdge(pV,edgeVW);
@@ -1622,8 +1637,8 @@ bool SGJoinIslandVisitor::visit(StringGraph* pGraph, Vertex* pVertex)
 							//Step 3: Create new edges between pV and pW
 							SeqCoord coordV(0,m_kmer-1,pVstr.length());
 							SeqCoord coordW(pWStrNew.length()-m_kmer,pWStrNew.length()-1,pWStrNew.length());
-							Edge* edgeVW=new Edge(pW,ED_ANTISENSE,EC_SAME,coordV);
-							Edge* edgeWV=new Edge(pV,ED_SENSE,EC_SAME,coordW);
+							Edge* edgeVW=new(pGraph->getEdgeAllocator()) Edge(pW,ED_ANTISENSE,EC_SAME,coordV);
+							Edge* edgeWV=new(pGraph->getEdgeAllocator()) Edge(pV,ED_SENSE,EC_SAME,coordW);
 							edgeVW->setTwin(edgeWV);
 							edgeWV->setTwin(edgeVW);
 							pGraph->addEdge(pV,edgeVW);
@@ -1659,8 +1674,8 @@ bool SGJoinIslandVisitor::visit(StringGraph* pGraph, Vertex* pVertex)
 							//Step 3: create new edges for these two vertices
 							SeqCoord coordV(pVStrNew.length()-m_kmer,pVStrNew.length()-1,pVStrNew.length());
 							SeqCoord coordW(pWstr.length()-m_kmer,pWstr.length()-1,pWstr.length());
-							Edge* edgeVW=new Edge(pW,ED_SENSE,EC_REVERSE,coordV);
-							Edge* edgeWV=new Edge(pV,ED_SENSE,EC_REVERSE,coordW);
+							Edge* edgeVW=new(pGraph->getEdgeAllocator()) Edge(pW,ED_SENSE,EC_REVERSE,coordV);
+							Edge* edgeWV=new(pGraph->getEdgeAllocator()) Edge(pV,ED_SENSE,EC_REVERSE,coordW);
 							edgeVW->setTwin(edgeWV);
 							edgeWV->setTwin(edgeVW);
 							pGraph->addEdge(pV,edgeVW);
@@ -1693,8 +1708,8 @@ bool SGJoinIslandVisitor::visit(StringGraph* pGraph, Vertex* pVertex)
 							//Step 3: create new edges for these two vertices
 							SeqCoord coordV(pVStrNew.length()-m_kmer,pVStrNew.length()-1,pVStrNew.length()); //dummy coord
 							SeqCoord coordW(0,m_kmer-1,pWstr.length());
-							Edge* edgeVW=new Edge(pW,ED_SENSE,EC_SAME,coordV);
-							Edge* edgeWV=new Edge(pV,ED_ANTISENSE,EC_SAME,coordW);
+							Edge* edgeVW=new(pGraph->getEdgeAllocator()) Edge(pW,ED_SENSE,EC_SAME,coordV);
+							Edge* edgeWV=new(pGraph->getEdgeAllocator()) Edge(pV,ED_ANTISENSE,EC_SAME,coordW);
 							edgeVW->setTwin(edgeWV);
 							edgeWV->setTwin(edgeVW);
 							pGraph->addEdge(pV,edgeVW);
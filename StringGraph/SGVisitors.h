@@ -22,6 +22,11 @@
 //linked lists of contig IDs mapped by this read
 typedef std::vector<ThreadSafeList<std::pair<Vertex*, ReadOnContig> > > ThreadSafeListVector;
 
+//Read IDs in SA index mapped to the ends of each island/tip, keyed by the vertex index
+//[0,1,2,3]=AntisenseFwd, AntisenseRvc, SenseFwd, SenseRvc of the vertex
+typedef std::vector<std::vector<int64_t> > IslandReadIDs;
+typedef SparseHashMap<size_t, IslandReadIDs> IslandReadIDMap;
+
 class NameSet
 {
 public:
@@ -411,14 +416,15 @@ struct SGRemoveEdgeByPEVisitor
 //Store PE read IDs into NameSet hashtable
 struct SGIslandCollectVisitor
 {
-    SGIslandCollectVisitor(ThreadSafeListVector* tslv, BWTIndexSet indices, size_t insertSize, size_t kmerSize, size_t islandSize)
-	:m_tslv(tslv), m_indices(indices),m_insertSize(insertSize),m_kmerSize(kmerSize),m_minIslandSize(islandSize){}
+    SGIslandCollectVisitor(ThreadSafeListVector* tslv, IslandReadIDMap* pIslandReadIDs, BWTIndexSet indices, size_t insertSize, size_t kmerSize, size_t islandSize)
+	:m_tslv(tslv), m_pIslandReadIDs(pIslandReadIDs), m_indices(indices),m_insertSize(insertSize),m_kmerSize(kmerSize),m_minIslandSize(islandSize){}
 
 	void previsit(StringGraph* pGraph);
     bool visit(StringGraph* pGraph, Vertex* pVertex);
     void postvisit(StringGraph* pGraph);
 
 	ThreadSafeListVector* m_tslv;
+	IslandReadIDMap* m_pIslandReadIDs;
 	BWTIndexSet m_indices;
 
     size_t m_insertSize;
@@ -434,11 +440,11 @@ struct SGIslandCollectVisitor
 //SAI walk is revised to walk through high-error gaps
 struct SGJoinIslandVisitor
 {
-    SGJoinIslandVisitor(size_t SAISearchDepth, size_t SAISearchLeaves, size_t kmer, size_t islandSize, ThreadSafeListVector* tslv, BWTIndexSet indices,
-            size_t minPEcount=5)
+    SGJoinIslandVisitor(size_t SAISearchDepth, size_t SAISearchLeaves, size_t kmer, size_t islandSize, ThreadSafeListVector* tslv,
+            const IslandReadIDMap* pIslandReadIDs, BWTIndexSet indices, size_t minPEcount=5)
 	:m_SAISearchDepth(SAISearchDepth),m_SAISearchLeaves(SAISearchLeaves),
 	m_kmer(kmer),m_minIslandSize(islandSize), 
-	m_tslv(tslv), m_indices(indices),
+	m_tslv(tslv), m_pIslandReadIDs(pIslandReadIDs), m_indices(indices),
 	m_minPEcount(minPEcount)
 	{
 		m_numOfIterations=2;
@@ -448,7 +454,7 @@ struct SGJoinIslandVisitor
     bool visit(StringGraph* pGraph, Vertex* pVertex);
     void postvisit(StringGraph* pGraph);
 	
-	void findNeighborWithPESupport(Vertex* pVertex, size_t islandDir, SparseHashMap<VertexID, size_t*, StringHasher>& pWIDs);
+	void findNeighborWithPESupport(Vertex* pVertex, size_t islandDir, SparseHashMap<size_t, size_t*>& pWIDs);
 	void updateExtendedVertex(Vertex* pVertex,  std::string& newStr, EdgeDir dir);
 	int64_t getAnotherID(int64_t idx);
 		
@@ -458,6 +464,7 @@ struct SGJoinIslandVisitor
 	size_t m_minIslandSize;
 
 	ThreadSafeListVector* m_tslv;
+	const IslandReadIDMap* m_pIslandReadIDs;
 	BWTIndexSet m_indices;
 
 	size_t m_islandcount;
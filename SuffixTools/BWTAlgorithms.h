@@ -12,6 +12,7 @@
 #include "STCommon.h"
 #include "BWTIndexSet.h"
 #include "BWTInterval.h"
+#include "BWTIntervalPairCache.h"
 #include "GraphCommon.h"
 #include "KmerDistribution.h"
 
@@ -21,6 +22,9 @@
 #define LEFT_INT_IDX 0
 #define RIGHT_INT_IDX 1
 
+// The number of searches the batched backward search advances in lockstep
+#define BWT_SEARCH_BATCH_SIZE 16
+
 // structures
 
 // A (partial) prefix of a string contained in the BWT
@@ -41,6 +45,14 @@ BWTInterval findInterval(const BWT* pBWT, const std::string& w);
 BWTInterval findIntervalWithCache(const BWT* pBWT, const BWTIntervalCache* pIntervalCache, const std::string& w);
 BWTInterval findInterval(const BWTIndexSet& indices, const std::string& w);
 
+// Batched backward search. Find the intervals of the n strings in words, using pIntervalCache
+// if it is not NULL. The independent searches are interleaved and their index accesses are
+// prefetched together, which is much faster than n calls to findInterval when the index
+// does not fit in cache. The single string functions above are wrappers around this.
+void findIntervals(const BWT* pBWT, const BWTIntervalCache* pIntervalCache,
+                   const std::string* words, size_t n, BWTInterval* out);
+void findIntervals(const BWTIndexSet& indices, const StringVector& words, std::vector<BWTInterval>& out);
+
 BWTIntervalPair findIntervalPair(const BWT* pBWT, const BWT* pRevBWT, const std::string& w);
 BWTIntervalPair findIntervalPairWithCache(const BWT* pBWT, 
                                           const BWT* pRevBWT, 
@@ -57,20 +69,36 @@ size_t countSequenceOccurrences(const std::string& w, const BWTIndexSet& indices
 // Count the occurrences of w, not including the reverse complement
 size_t countSequenceOccurrencesSingleStrand(const std::string& w, const BWTIndexSet& indices);
 size_t countSequenceOccurrencesSingleStrand(const std::string& w, const BWT* pBWT);
+
+// Batched versions of the above, counts[i] is the count for words[i]
+void countSequenceOccurrences(const StringVector& words, const BWTIndexSet& indices, std::vector<size_t>& counts);
+void countSequenceOccurrences(const StringVector& words, const BWT* pBWT, std::vector<size_t>& counts);
+void countSequenceOccurrencesSingleStrand(const StringVector& words, const BWTIndexSet& indices, std::vector<size_t>& counts);
+void countSequenceOccurrencesSingleStrand(const StringVector& words, const BWT* pBWT, std::vector<size_t>& counts);
+void countSequenceOccurrencesSingleStrand(const std::string* words, size_t n, const BWTIndexSet& indices, size_t* counts);
+
+// The primitives below are templated on the index type. They can be called
+// with the BWT handle, or with the concrete RLBWT/RankBWT for tight loops
+// where the per-query dispatch of the handle is unwanted.
+
 // Update the given interval using backwards search
 // If the interval corrsponds to string S, it will be updated 
 // for string bS
-inline void updateInterval(BWTInterval& interval, char b, const BWT* pBWT)
+template<class BWTType>
+inline void updateInterval(BWTInterval& interval, char b, const BWTType* pBWT)
 {
     size_t pb = pBWT->getPC(b);
-    interval.lower = pb + pBWT->getOcc(b, interval.lower - 1);
-    interval.upper = pb + pBWT->getOcc(b, interval.upper) - 1;
+    BaseCount lower_occ, upper_occ;
+    pBWT->getOccPair(b, interval.lower - 1, interval.upper, lower_occ, upper_occ);
+    interval.lower = pb + lower_occ;
+    interval.upper = pb + upper_occ - 1;
 }
 
 // Update the interval pair for the right extension to symbol b.
 // In this version the AlphaCounts for the upper and lower intervals
 // have been calculated
-inline void updateBothR(BWTIntervalPair& pair, char b, const BWT* pRevBWT,
+template<class BWTType>
+inline void updateBothR(BWTIntervalPair& pair, char b, const BWTType* pRevBWT,
                         AlphaCount64& l, AlphaCount64& u)
 {
     AlphaCount64 diff = u - l;
@@ -87,18 +115,20 @@ inline void updateBothR(BWTIntervalPair& pair, char b, const BWT* pRevBWT,
 //
 // Update the interval pair for the right extension to symbol b.
 // 
-inline void updateBothR(BWTIntervalPair& pair, char b, const BWT* pRevBWT)
+template<class BWTType>
+inline void updateBothR(BWTIntervalPair& pair, char b, const BWTType* pRevBWT)
 {
     // Update the left index using the difference between the AlphaCounts in the reverse table
-    AlphaCount64 l = pRevBWT->getFullOcc(pair.interval[1].lower - 1);
-    AlphaCount64 u = pRevBWT->getFullOcc(pair.interval[1].upper);
+    AlphaCount64 l, u;
+    pRevBWT->getFullOccPair(pair.interval[1].lower - 1, pair.interval[1].upper, l, u);
     updateBothR(pair, b, pRevBWT, l, u);
 }
 
 // Update the interval pair for the left extension to symbol b.
 // In this version the AlphaCounts for the upper and lower intervals
 // have been calculated.
-inline void updateBothL(BWTIntervalPair& pair, char b, const BWT* pBWT, 
+template<class BWTType>
+inline void updateBothL(BWTIntervalPair& pair, char b, const BWTType* pBWT, 
                         AlphaCount64& l, AlphaCount64& u)
 {
     AlphaCount64 diff = u - l;
@@ -115,33 +145,39 @@ inline void updateBothL(BWTIntervalPair& pair, char b, const BWT* pBWT,
 //
 // Update the interval pair for the left extension to symbol b.
 //
-inline void updateBothL(BWTIntervalPair& pair, char b, const BWT* pBWT)
+template<class BWTType>
+inline void updateBothL(BWTIntervalPair& pair, char b, const BWTType* pBWT)
 {
     // Update the left index using the difference between the AlphaCounts in the reverse table
-    AlphaCount64 l = pBWT->getFullOcc(pair.interval[0].lower - 1);
-    AlphaCount64 u = pBWT->getFullOcc(pair.interval[0].upper);
+    AlphaCount64 l, u;
+    pBWT->getFullOccPair(pair.interval[0].lower - 1, pair.interval[0].upper, l, u);
     updateBothL(pair, b, pBWT, l, u);
 }
 
 
 // Initialize the interval of index idx to be the range containining all the b suffixes
-inline void initInterval(BWTInterval& interval, char b, const BWT* pB)
+template<class BWTType>
+inline void initInterval(BWTInterval& interval, char b, const BWTType* pB)
 {
     interval.lower = pB->getPC(b);
     interval.upper = interval.lower + pB->getOcc(b, pB->getBWLen() - 1) - 1;
 }
 
 // Initialize the interval of index idx to be the range containining all the b suffixes
-inline void initIntervalPair(BWTIntervalPair& pair, char b, const BWT* pBWT, const BWT* pRevBWT)
+template<class BWTType>
+inline void initIntervalPair(BWTIntervalPair& pair, char b, const BWTType* pBWT, const BWTType* pRevBWT)
 {
     initInterval(pair.interval[LEFT_INT_IDX], b, pBWT);
     initInterval(pair.interval[RIGHT_INT_IDX], b, pRevBWT);
 }
 
 // Return the counts of the bases between the lower and upper interval in pBWT
-inline AlphaCount64 getExtCount(const BWTInterval& interval, const BWT* pBWT)
+template<class BWTType>
+inline AlphaCount64 getExtCount(const BWTInterval& interval, const BWTType* pBWT)
 {
-    return pBWT->getOccDiff(interval.lower - 1, interval.upper);
+    AlphaCount64 l, u;
+    pBWT->getFullOccPair(interval.lower - 1, interval.upper, l, u);
+    return u - l;
 }
 
 // Return the count of all the possible one base extensions of the string w.
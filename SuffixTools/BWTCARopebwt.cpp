@@ -14,6 +14,8 @@
 #include "BWTWriterBinary.h"
 #include "BWTWriterAscii.h"
 #include "SAWriter.h"
+#include <algorithm>
+#include <pthread.h>
 
 /*** ropebwt2 headers ROPEBWT2_VERSION r187 ***/
 #include <zlib.h>
@@ -93,39 +95,9 @@ static unsigned char seq_nt6_table[128] = {
     5, 5, 5, 5, 4, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5
 };
 
-void BWTCA::runRopebwt(const std::string& input_filename, const std::string& bwt_out_name,
-                       bool use_threads, bool do_reverse)
+// Write the BWT built by a bcr object
+static void writeBCR(bcr_t* bcr, const std::string& bwt_out_name, size_t num_sequences, size_t num_bases)
 {
-    // Initialize ropebwt
-    std::string tmp_name = bwt_out_name + ".tmp";
-    bcr_t* bcr = bcr_init(use_threads, tmp_name.c_str());
-
-    size_t num_sequences = 0;
-    size_t num_bases = 0;
-    SeqReader reader(input_filename);
-    SeqRecord record;
-    while(reader.get(record))
-    {
-        if(do_reverse)
-            record.seq.reverse();
-
-        size_t l = record.seq.length();
-
-        // Convert the string into the alphabet encoding expected by ropebwt
-        uint8_t* s = new uint8_t[l];
-        for(size_t i = 0; i < l; ++i) {
-            char c = record.seq.get(i);
-            s[i] = seq_nt6_table[(int)c];
-        }
-
-        // Send the sequence to ropebwt
-        bcr_append(bcr, l, s);
-
-        num_sequences += 1;
-        num_bases += l;
-        delete [] s;
-    }
-
     // Build the BWT
     bcr_build(bcr);
 
@@ -151,98 +123,223 @@ void BWTCA::runRopebwt(const std::string& input_filename, const std::string& bwt
     free(itr);
     out_bwt->finalize();
     delete out_bwt;
+}
 
-    // Cleanup
-    bcr_destroy(bcr);
+void BWTCA::runRopebwt(const std::string& input_filename, const std::string& bwt_out_name,
+                       bool use_threads, bool do_reverse)
+{
+    if(do_reverse)
+        runRopebwt(input_filename, "", bwt_out_name, use_threads);
+    else
+        runRopebwt(input_filename, bwt_out_name, "", use_threads);
 }
 
+// The reads are parsed once and appended to both bcr objects
+void BWTCA::runRopebwt(const std::string& input_filename, const std::string& bwt_out_name,
+                       const std::string& rbwt_out_name, bool use_threads)
+{
+    // Initialize ropebwt
+    bcr_t* bcr[2] = { NULL, NULL };
+    std::string out_names[2] = { bwt_out_name, rbwt_out_name };
+    for(size_t k = 0; k < 2; ++k)
+    {
+        if(!out_names[k].empty())
+            bcr[k] = bcr_init(use_threads, (out_names[k] + ".tmp").c_str());
+    }
+
+    size_t num_sequences = 0;
+    size_t num_bases = 0;
+    std::vector<uint8_t> s;
+    SeqReader reader(input_filename);
+    SeqRecord record;
+    while(reader.get(record))
+    {
+        size_t l = record.seq.length();
+
+        // Convert the string into the alphabet encoding expected by ropebwt
+        s.resize(l + 1);
+        for(size_t i = 0; i < l; ++i) {
+            char c = record.seq.get(i);
+            s[i] = seq_nt6_table[(int)c];
+        }
+
+        // Send the sequence to ropebwt, reversed for the reverse index
+        if(bcr[0] != NULL)
+            bcr_append(bcr[0], l, &s[0]);
+        if(bcr[1] != NULL)
+        {
+            std::reverse(s.begin(), s.begin() + l);
+            bcr_append(bcr[1], l, &s[0]);
+        }
+
+        num_sequences += 1;
+        num_bases += l;
+    }
+
+    #pragma omp parallel for schedule(static, 1) num_threads(2)
+    for(int k = 0; k < 2; ++k)
+    {
+        if(bcr[k] != NULL)
+        {
+            writeBCR(bcr[k], out_names[k], num_sequences, num_bases);
+            bcr_destroy(bcr[k]);
+        }
+    }
+}
 
 void BWTCA::runRopebwt2(const std::string& input_filename, const std::string& bwt_out_name,
                        int thr_min, bool do_reverse)
 {
-	mrope_t *mr = 0;
+    RLBWT* pRLBWT = runRopebwt2(input_filename, thr_min, do_reverse);
+    BWTWriterBinary writer(bwt_out_name);
+    writer.write(pRLBWT);
+    delete pRLBWT;
+}
+
+//
+RLBWT* BWTCA::runRopebwt2(const std::string& input_filename, int thr_min, bool do_reverse)
+{
+    RLBWT* pRLBWT = NULL;
+    if(do_reverse)
+        runRopebwt2(input_filename, thr_min, NULL, &pRLBWT);
+    else
+        runRopebwt2(input_filename, thr_min, &pRLBWT, NULL);
+    return pRLBWT;
+}
+
+// One batch of reads inserted into a rope. The batch starts with a
+// sentinel and holds the reads as they are, the forward index walks each
+// read backwards while the reverse index walks it forwards
+struct RopeInsertJob
+{
+	mrope_t *mr;
+	kstring_t *buf;
+	int is_rev;
+};
+
+static void* insertRopeBatch(void* arg)
+{
+	RopeInsertJob* job = (RopeInsertJob*)arg;
+	if (job->is_rev)
+		mr_insert_multi_rev(job->mr, job->buf->l, (uint8_t*)job->buf->s, 1);
+	else
+		mr_insert_multi(job->mr, job->buf->l - 1, (uint8_t*)job->buf->s + 1, 1);
+	return 0;
+}
+
+// Move the runs of the rope into an RLBWT as they are decoded
+static RLBWT* convertRope(mrope_t *mr)
+{
+	int64_t c[6];
+	mr_get_c(mr, c);
+	fprintf(stderr, "[%s] symbol counts: ($, A, C, G, T, N) = (%ld, %ld, %ld, %ld, %ld, %ld)\n", __func__,
+			(long)c[0], (long)c[1], (long)c[2], (long)c[3], (long)c[4], (long)c[5]);
+
+	int64_t num_sequences = (long)c[0];
+	RLBWT* pRLBWT = new RLBWT(num_sequences);
+
+	mritr_t itr;
+	const uint8_t *block;
+
+	mr_itr_first(mr, &itr, 1);
+	while ((block = mr_itr_next_block(&itr)) != 0) {
+		const uint8_t *q = block + 2, *end = block + 2 + *rle_nptr(block);
+		while (q < end) {
+			int c = 0;
+			int64_t l;
+			rle_dec1(q, c, l);
+			pRLBWT->appendRun("$ACGTN"[c], l);
+		}		
+	}
+	mr_destroy(mr);
+
+	pRLBWT->initializeFMIndex();
+	return pRLBWT;
+}
+
+// The reads are parsed once. Each batch is encoded into one buffer that
+// the two ropes insert on their own threads, while the next batch is
+// parsed into the other buffer
+void BWTCA::runRopebwt2(const std::string& input_filename, int thr_min, RLBWT** ppBWT, RLBWT** ppRBWT)
+{
+	mrope_t *mr[2] = { 0, 0 };
 	gzFile fp;
 	kseq_t *ks;
 	int64_t m = (int64_t)(.97 * 10 * 1024 * 1024 * 1024) + 1;;
-	int i, block_len = ROPE_DEF_BLOCK_LEN, max_nodes = ROPE_DEF_MAX_NODES, so = MR_SO_IO;
-	int flag = FLAG_FOR | FLAG_REV | FLAG_THR;
-	kstring_t buf = { 0, 0, 0 };
+	int i, k, block_len = ROPE_DEF_BLOCK_LEN, max_nodes = ROPE_DEF_MAX_NODES, so = MR_SO_IO;
+	kstring_t buf[2] = { { 0, 0, 0 }, { 0, 0, 0 } };
+	RopeInsertJob jobs[2];
+	pthread_t tid[2];
+	int cur = 0, n_running = 0;
 	double ct, rt;
 
 	liftrlimit();
-	if (mr == 0) mr = mr_init(max_nodes, block_len, so);
-	if (thr_min > 0) mr_thr_min(mr, thr_min);
+	for (k = 0; k < 2; ++k) {
+		if ((k == 0? ppBWT : ppRBWT) == 0) continue;
+		mr[k] = mr_init(max_nodes, block_len, so);
+		if (thr_min > 0) mr_thr_min(mr[k], thr_min);
+	}
 	fp = gzopen( input_filename.c_str(), "rb");
+	if (fp == 0) {
+		std::cerr << "Error: could not open " << input_filename << " for reading\n";
+		exit(EXIT_FAILURE);
+	}
 	ks = kseq_init(fp);
 	ct = cputime(); rt = realtime();
+	kputsn("", 1, &buf[cur]); // the leading sentinel
 
 	for (;;) {
-		int l;
+		int l, more = kseq_read(ks) >= 0; // read fasta/fastq
 		uint8_t *s;
-		if (kseq_read(ks) < 0) break; // read fasta/fastq
-		
-		l = ks->seq.l;
-		s = (uint8_t*)ks->seq.s;
-
-		// change encoding according to seq_nt6_table
-		for (i = 0; i < l; ++i) 
-			s[i] = s[i] < 128? seq_nt6_table[s[i]] : 5;
-				
-		if(!do_reverse)
-			for (i = 0; i < l>>1; ++i) { // reverse
-				int tmp = s[l-1-i];
-				s[l-1-i] = s[i]; s[i] = tmp;
+
+		if (more) {
+			l = ks->seq.l;
+			s = (uint8_t*)ks->seq.s;
+
+			// change encoding according to seq_nt6_table
+			for (i = 0; i < l; ++i)
+				s[i] = s[i] < 128? seq_nt6_table[s[i]] : 5;
+
+			kputsn((char*)s, l + 1, &buf[cur]);
+		}
+
+		// hand the batch to the ropes once it is full or the input is exhausted
+		int64_t batch_len = buf[cur].l - 1;
+		if (batch_len >= m || (!more && batch_len > 0)) {
+			for (k = 0; k < n_running; ++k) pthread_join(tid[k], 0);
+			n_running = 0;
+			for (k = 0; k < 2; ++k) {
+				if (mr[k] == 0) continue;
+				jobs[n_running].mr = mr[k];
+				jobs[n_running].buf = &buf[cur];
+				jobs[n_running].is_rev = k == 0;
+				if (pthread_create(&tid[n_running], 0, insertRopeBatch, &jobs[n_running]) != 0) {
+					std::cerr << "Error: could not start the rope insertion thread\n";
+					exit(EXIT_FAILURE);
+				}
+				++n_running;
 			}
-		
-		//push into buffer, always process the forward strand
-		if (m) kputsn((char*)ks->seq.s, ks->seq.l + 1, &buf);
-		else mr_insert1(mr, s);
-
-		//sort if buffer is full
-		if (m && (int64_t) buf.l >= m) {
-			mr_insert_multi(mr, buf.l, (uint8_t*)buf.s, flag&FLAG_THR);
-			buf.l = 0;
-		}		
+			cur ^= 1;
+			buf[cur].l = 0;
+			kputsn("", 1, &buf[cur]);
+		}
+		if (!more) break;
 	}
+	for (k = 0; k < n_running; ++k) pthread_join(tid[k], 0);
 
-	if (m && buf.l) 
-		mr_insert_multi(mr, buf.l, (uint8_t*)buf.s, flag&FLAG_THR);
-	
 	//Done BWT construction
-	int64_t c[6];
 	fprintf(stderr, "[%s] constructed FM-index in %.3f sec, %.3f CPU sec\n", __func__, realtime() - rt, cputime() - ct);
-	mr_get_c(mr, c);
-	fprintf(stderr, "[%s] symbol counts: ($, A, C, G, T, N) = (%ld, %ld, %ld, %ld, %ld, %ld)\n", __func__,
-			(long)c[0], (long)c[1], (long)c[2], (long)c[3], (long)c[4], (long)c[5]);
-			
-	int64_t num_sequences = (long)c[0];
-    int64_t num_symbols = (long)c[0]+(long)c[1]+(long)c[2]+(long)c[3]+(long)c[4]+(long)c[5];
 
-	free(buf.s);
+	free(buf[0].s);
+	free(buf[1].s);
 	kseq_destroy(ks);
 	gzclose(fp);
-	
-	/*** output BWT char to BWTWriter ***/
-    BWTWriterBinary* out_bwt = new BWTWriterBinary(bwt_out_name);
-    out_bwt->writeHeader(num_sequences, num_symbols, BWF_NOFMI);
-
-	mritr_t itr;
-	const uint8_t *block;
 
-	mr_itr_first(mr, &itr, 1);
-	while ((block = mr_itr_next_block(&itr)) != 0) {
-		const uint8_t *q = block + 2, *end = block + 2 + *rle_nptr(block);
-		while (q < end) {
-			int c = 0;
-			int64_t j, l;
-			rle_dec1(q, c, l);
-			for (j = 0; j < l; ++j) 
-				//putchar("$ACGTN"[c]);
-				out_bwt->writeBWChar("$ACGTN"[c]);
-		}		
+	/*** convert the ropes to the run-length encoded BWTs ***/
+	#pragma omp parallel for schedule(static, 1) num_threads(2)
+	for (k = 0; k < 2; ++k) {
+		if (mr[k] == 0) continue;
+		RLBWT* pRLBWT = convertRope(mr[k]);
+		*(k == 0? ppBWT : ppRBWT) = pRLBWT;
 	}
-	
-    out_bwt->finalize();
-    delete out_bwt;
 }
-
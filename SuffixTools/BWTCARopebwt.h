@@ -12,13 +12,27 @@
 
 #include <string>
 
+class RLBWT;
+
 namespace BWTCA
 {
     void runRopebwt(const std::string& input_filename, const std::string& bwt_out_name,
                     bool use_threads, bool do_reverse);
 
+    // Construct the forward and reverse BWTs from a single pass over the reads.
+    // An index with an empty output name is not built
+    void runRopebwt(const std::string& input_filename, const std::string& bwt_out_name,
+                    const std::string& rbwt_out_name, bool use_threads);
+
 	void runRopebwt2(const std::string& input_filename, const std::string& bwt_out_name,
                     int thr_min, bool do_reverse);
+
+    // Construct the BWT with ropebwt2 and return it in memory, without writing it to disk
+    RLBWT* runRopebwt2(const std::string& input_filename, int thr_min, bool do_reverse);
+
+    // Construct the forward and reverse BWTs from a single pass over the reads.
+    // The index of a NULL output pointer is not built
+    void runRopebwt2(const std::string& input_filename, int thr_min, RLBWT** ppBWT, RLBWT** ppRBWT);
 
 };
 
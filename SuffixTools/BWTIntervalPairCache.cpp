@@ -0,0 +1,158 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// BWTIntervalPairCache - Persistent table of the interval
+// pairs of every DNA string up to a maximum length
+//
+#include "BWTIntervalPairCache.h"
+#include "BWTAlgorithms.h"
+#include <omp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// The header of the cache file. The entries follow it
+struct BWTIntervalPairCacheHeader
+{
+    uint16_t magic;
+    uint16_t version;
+    uint16_t entrySize;
+    uint16_t maxLength;
+    uint64_t numSymbols;
+    uint64_t numStrings;
+    uint64_t partnerSymbols;
+    uint64_t partnerStrings;
+    uint64_t numEntries;
+};
+
+//
+static inline void setEntry(CachedIntervalPair& entry, const BWTIntervalPair& ip)
+{
+    entry.lower[0] = ip.interval[0].lower;
+    entry.lower[1] = ip.interval[1].lower;
+    entry.size = ip.interval[0].isValid() ? ip.interval[0].size() : 0;
+}
+
+// Each level is computed from the one below it by extending every
+// string one symbol to the left, which is a single LF step per entry
+void BWTIntervalPairCache::write(const std::string& filename, const BWT* pBWT, const BWT* pRevBWT,
+                                 size_t maxLength, int numThreads)
+{
+    assert(maxLength > 0 && maxLength <= BWT_INTERVAL_CACHE_MAX_LENGTH);
+
+    size_t numEntries = getLevelOffset(maxLength + 1);
+    std::vector<CachedIntervalPair> entries(numEntries);
+
+    for(size_t i = 0; i < DNA_ALPHABET::size; ++i)
+    {
+        BWTIntervalPair ip;
+        BWTAlgorithms::initIntervalPair(ip, ALPHABET[i], pBWT, pRevBWT);
+        setEntry(entries[getLevelOffset(1) + i], ip);
+    }
+
+    omp_set_num_threads(numThreads);
+    for(size_t len = 1; len < maxLength; ++len)
+    {
+        size_t levelSize = (size_t)1 << 2*len;
+        const CachedIntervalPair* pLevel = &entries[getLevelOffset(len)];
+        CachedIntervalPair* pNextLevel = &entries[getLevelOffset(len + 1)];
+
+        #pragma omp parallel for schedule(static)
+        for(int64_t code = 0; code < (int64_t)levelSize; ++code)
+        {
+            const CachedIntervalPair& entry = pLevel[code];
+            for(size_t i = 0; i < DNA_ALPHABET::size; ++i)
+            {
+                CachedIntervalPair& next = pNextLevel[(i << 2*len) | code];
+                if(entry.size == 0)
+                {
+                    next.lower[0] = next.lower[1] = 0;
+                    next.size = 0;
+                    continue;
+                }
+
+                BWTIntervalPair ip;
+                ip.interval[0] = BWTInterval(entry.lower[0], entry.lower[0] + entry.size - 1);
+                ip.interval[1] = BWTInterval(entry.lower[1], entry.lower[1] + entry.size - 1);
+                BWTAlgorithms::updateBothL(ip, ALPHABET[i], pBWT);
+                setEntry(next, ip);
+            }
+        }
+    }
+
+    BWTIntervalPairCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = BWT_INTERVAL_CACHE_FILE_MAGIC;
+    header.version = BWT_INTERVAL_CACHE_FILE_VERSION;
+    header.entrySize = sizeof(CachedIntervalPair);
+    header.maxLength = maxLength;
+    header.numSymbols = pBWT->getBWLen();
+    header.numStrings = pBWT->getNumStrings();
+    header.partnerSymbols = pRevBWT->getBWLen();
+    header.partnerStrings = pRevBWT->getNumStrings();
+    header.numEntries = numEntries;
+
+    std::ostream* pWriter = createWriter(filename, std::ios::out | std::ios::binary);
+    pWriter->write(reinterpret_cast<const char*>(&header), sizeof(header));
+    pWriter->write(reinterpret_cast<const char*>(&entries[0]), numEntries * sizeof(CachedIntervalPair));
+    if(!pWriter->good())
+    {
+        std::cerr << "Error: could not write the interval cache to " << filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+    delete pWriter;
+}
+
+//
+BWTIntervalPairCache* BWTIntervalPairCache::load(const std::string& filename, const BWT* pBWT)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        return NULL;
+
+    BWTIntervalPairCacheHeader header;
+    struct stat st;
+    bool valid = fstat(fd, &st) == 0 &&
+                 pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+                 header.magic == BWT_INTERVAL_CACHE_FILE_MAGIC &&
+                 header.version == BWT_INTERVAL_CACHE_FILE_VERSION &&
+                 header.entrySize == sizeof(CachedIntervalPair) &&
+                 header.maxLength > 0 && header.maxLength <= BWT_INTERVAL_CACHE_MAX_LENGTH &&
+                 header.numEntries == getLevelOffset(header.maxLength + 1) &&
+                 sizeof(header) + header.numEntries * sizeof(CachedIntervalPair) == (uint64_t)st.st_size &&
+                 header.numSymbols == pBWT->getBWLen() &&
+                 header.numStrings == pBWT->getNumStrings();
+
+    void* pData = MAP_FAILED;
+    if(valid)
+        pData = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(pData == MAP_FAILED)
+        return NULL;
+
+    BWTIntervalPairCache* pCache = new BWTIntervalPairCache;
+    pCache->m_pMappedData = pData;
+    pCache->m_mappedSize = st.st_size;
+    pCache->m_pEntries = reinterpret_cast<const CachedIntervalPair*>(static_cast<const char*>(pData) + sizeof(header));
+    pCache->m_maxLength = header.maxLength;
+    pCache->m_partnerSymbols = header.partnerSymbols;
+    pCache->m_partnerStrings = header.partnerStrings;
+    return pCache;
+}
+
+//
+BWTIntervalPairCache::~BWTIntervalPairCache()
+{
+    if(m_pMappedData != NULL)
+        munmap(m_pMappedData, m_mappedSize);
+}
+
+//
+bool BWTIntervalPairCache::isPairedWith(const BWT* pRevBWT) const
+{
+    return pRevBWT->getBWLen() == m_partnerSymbols && pRevBWT->getNumStrings() == m_partnerStrings;
+}
@@ -0,0 +1,134 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// BWTIntervalPairCache - Persistent table of the interval
+// pairs of every DNA string up to a maximum length. Unlike
+// BWTIntervalCache, which holds a single k in memory, every
+// length from 1 to the maximum is stored so a search can start
+// from the longest cached suffix of any string. The table is
+// written next to the .bwt by the index command and memory-mapped
+// by the BWT that it belongs to, so all processes share one copy.
+//
+// The entry for w holds the interval of w in the index the
+// cache belongs to and the interval of reverse(w) in its
+// partner, the reverse index of the same reads.
+//
+#ifndef BWTINTERVALPAIRCACHE_H
+#define BWTINTERVALPAIRCACHE_H
+
+#include "BWTInterval.h"
+#include "Alphabet.h"
+
+class BWT;
+
+// The cache is stored next to the .bwt file with this suffix appended
+#define BWT_INTERVAL_CACHE_EXT ".ic"
+
+const uint16_t BWT_INTERVAL_CACHE_FILE_MAGIC = 0xCACE;
+const uint16_t BWT_INTERVAL_CACHE_FILE_VERSION = 1;
+
+// The longest strings that can be cached. Each length multiplies the size by 4
+#define BWT_INTERVAL_CACHE_MAX_LENGTH 14
+
+// An interval pair. Both intervals of a pair have the same size so it is stored once.
+// Empty intervals are stored with a size of 0
+struct CachedIntervalPair
+{
+    int64_t lower[2];
+    int64_t size;
+};
+
+class BWTIntervalPairCache
+{
+    public:
+
+        // Build the cache of all strings up to maxLength for pBWT, with the reverse
+        // intervals from pRevBWT, and write it to filename using numThreads threads
+        static void write(const std::string& filename, const BWT* pBWT, const BWT* pRevBWT,
+                          size_t maxLength, int numThreads);
+
+        // Map the cache for pBWT from filename. Returns NULL if there is no
+        // cache or it was not built from pBWT
+        static BWTIntervalPairCache* load(const std::string& filename, const BWT* pBWT);
+
+        ~BWTIntervalPairCache();
+
+        // The longest cached length
+        inline size_t getMaxLength() const { return m_maxLength; }
+
+        // Returns true if the reverse intervals can be used with pRevBWT
+        bool isPairedWith(const BWT* pRevBWT) const;
+
+        // Return the length of the longest suffix of w[0, len) that is cached,
+        // that is, at most getMaxLength() symbols that are all one of ACGT
+        inline size_t getCachedSuffixLength(const char* w, size_t len) const
+        {
+            size_t l = 0;
+            while(l < len && l < m_maxLength && isCachedBase(w[len - l - 1]))
+                ++l;
+            return l;
+        }
+
+        // Look up the interval pair for the string w[0, len)
+        // Precondition: 0 < len <= getMaxLength() and w only has ACGT
+        inline BWTIntervalPair lookup(const char* w, size_t len) const
+        {
+            const CachedIntervalPair& entry = m_pEntries[getLevelOffset(len) + str2int(w, len)];
+            BWTIntervalPair out;
+            out.interval[0].lower = entry.lower[0];
+            out.interval[0].upper = entry.lower[0] + entry.size - 1;
+            out.interval[1].lower = entry.lower[1];
+            out.interval[1].upper = entry.lower[1] + entry.size - 1;
+            return out;
+        }
+
+        // Look up the interval of w[0, len) in the index the cache belongs to
+        inline BWTInterval lookupInterval(const char* w, size_t len) const
+        {
+            const CachedIntervalPair& entry = m_pEntries[getLevelOffset(len) + str2int(w, len)];
+            return BWTInterval(entry.lower[0], entry.lower[0] + entry.size - 1);
+        }
+
+    private:
+
+        BWTIntervalPairCache() : m_pEntries(NULL), m_maxLength(0), m_partnerSymbols(0),
+                                 m_partnerStrings(0), m_pMappedData(NULL), m_mappedSize(0) {}
+        BWTIntervalPairCache(const BWTIntervalPairCache&);
+        BWTIntervalPairCache& operator=(const BWTIntervalPairCache&);
+
+        // The index of the first entry of the strings of length len.
+        // The levels 1, 2, ... are stored one after the other
+        static inline size_t getLevelOffset(size_t len)
+        {
+            return (((size_t)1 << 2*len) - 4) / 3;
+        }
+
+        static inline bool isCachedBase(char b)
+        {
+            return b == 'A' || b == 'C' || b == 'G' || b == 'T';
+        }
+
+        // Map a string to its index within its level
+        static inline size_t str2int(const char* w, size_t len)
+        {
+            size_t out = 0;
+            for(size_t k = 0; k < len; ++k)
+                out = (out << 2) | DNA_ALPHABET::getBaseRank(w[k]);
+            return out;
+        }
+
+        const CachedIntervalPair* m_pEntries;
+        size_t m_maxLength;
+
+        // The size of the reverse index the cache was built with
+        size_t m_partnerSymbols;
+        size_t m_partnerStrings;
+
+        // The memory-mapped file
+        void* m_pMappedData;
+        size_t m_mappedSize;
+};
+
+#endif
@@ -15,3 +15,15 @@ IBWTReader* BWTReader::createReader(const std::string& filename)
 {
     return new BWTReaderBinary(filename);
 }
+
+//
+bool BWTReader::readBinaryHeader(const std::string& filename, size_t& num_strings, size_t& num_symbols, size_t& num_runs)
+{
+    std::ifstream reader(filename.c_str(), std::ios::binary);
+    uint16_t magic_number = 0;
+    reader.read(reinterpret_cast<char*>(&magic_number), sizeof(magic_number));
+    reader.read(reinterpret_cast<char*>(&num_strings), sizeof(num_strings));
+    reader.read(reinterpret_cast<char*>(&num_symbols), sizeof(num_symbols));
+    reader.read(reinterpret_cast<char*>(&num_runs), sizeof(num_runs));
+    return reader.good() && magic_number == RLBWT_FILE_MAGIC;
+}
@@ -51,6 +51,10 @@ class IBWTReader
 namespace BWTReader
 {
     IBWTReader* createReader(const std::string& filename);
+
+    // Read the header of a binary (run-length encoded) bwt file without loading it.
+    // Returns false if the file cannot be read or is not a binary bwt
+    bool readBinaryHeader(const std::string& filename, size_t& num_strings, size_t& num_symbols, size_t& num_runs);
 };
 
 #endif
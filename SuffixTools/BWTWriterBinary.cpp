@@ -78,6 +78,16 @@ void BWTWriterBinary::writeRun(RLUnit& unit)
     ++m_numRuns;
 }
 
+//
+void BWTWriterBinary::write(const RLBWT* pRLBWT)
+{
+    writeHeader(pRLBWT->m_numStrings, pRLBWT->m_numSymbols, BWF_NOFMI);
+    assert(!m_currRun.isInitialized());
+    m_numRuns = pRLBWT->getNumRuns();
+    m_pWriter->write(reinterpret_cast<const char*>(pRLBWT->m_pRLString), m_numRuns * sizeof(RLUnit));
+    finalize();
+}
+
 // write the final run to the stream and fill in the number of runs
 void BWTWriterBinary::finalize()
 {
@@ -31,6 +31,10 @@ class BWTWriterBinary : public IBWTWriter
         virtual void writeBWChar(char b);
         virtual void finalize(); // this method must be called after writing the BW string
 
+        // Write the complete BWT file for an RLBWT. The runs are copied as they are
+        using IBWTWriter::write;
+        void write(const RLBWT* pRLBWT);
+
     private:
 
         void writeRun(RLUnit& unit);
@@ -0,0 +1,172 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// LexicoIndex - The lexicographic index of a set of reads
+//
+#include "LexicoIndex.h"
+#include "SAReader.h"
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// The header of the binary index file. The IDs follow it
+struct LexicoIndexHeader
+{
+    uint16_t magic;
+    uint16_t version;
+    uint16_t elemBytes;
+    uint16_t reserved;
+    uint64_t numStrings;
+    uint64_t numElems;
+};
+
+//
+LexicoIndex::LexicoIndex(const std::string& filename) : m_pElems(NULL),
+                                                        m_elemBytes(0),
+                                                        m_numStrings(0),
+                                                        m_numElems(0),
+                                                        m_pMappedData(NULL),
+                                                        m_mappedSize(0)
+{
+    if(!loadMapped(filename))
+        loadText(filename);
+}
+
+//
+LexicoIndex::~LexicoIndex()
+{
+    if(m_pMappedData != NULL)
+        munmap(m_pMappedData, m_mappedSize);
+}
+
+//
+bool LexicoIndex::isBinary(const std::string& filename)
+{
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    uint16_t magic = 0;
+    return in.read(reinterpret_cast<char*>(&magic), sizeof(magic)) && magic == LEXICO_INDEX_FILE_MAGIC;
+}
+
+//
+bool LexicoIndex::readHeader(const std::string& filename, size_t& num_strings)
+{
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    if(!in)
+        return false;
+
+    LexicoIndexHeader header;
+    if(in.read(reinterpret_cast<char*>(&header), sizeof(header)) && header.magic == LEXICO_INDEX_FILE_MAGIC)
+    {
+        num_strings = header.numStrings;
+        return true;
+    }
+
+    // The text format starts with the magic number in decimal
+    in.clear();
+    in.seekg(0);
+    uint16_t magic = 0;
+    in >> magic >> num_strings;
+    return in && magic == SA_FILE_MAGIC;
+}
+
+//
+bool LexicoIndex::loadMapped(const std::string& filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    LexicoIndexHeader header;
+    struct stat st;
+    bool binary = fstat(fd, &st) == 0 &&
+                  pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+                  header.magic == LEXICO_INDEX_FILE_MAGIC;
+
+    if(binary && (header.version != LEXICO_INDEX_FILE_VERSION ||
+                  (header.elemBytes != 4 && header.elemBytes != 5) ||
+                  sizeof(header) + header.numElems * header.elemBytes != (uint64_t)st.st_size))
+    {
+        std::cerr << "Error: the suffix array index " << filename << " is corrupt or from an unsupported version\n";
+        exit(EXIT_FAILURE);
+    }
+
+    void* pData = MAP_FAILED;
+    if(binary)
+        pData = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(!binary)
+        return false;
+
+    if(pData == MAP_FAILED)
+    {
+        std::cerr << "Error: could not map the suffix array index " << filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+
+    m_pMappedData = pData;
+    m_mappedSize = st.st_size;
+    m_pElems = static_cast<const uint8_t*>(pData) + sizeof(header);
+    m_elemBytes = header.elemBytes;
+    m_numStrings = header.numStrings;
+    m_numElems = header.numElems;
+    return true;
+}
+
+// Parse an index in the text format written by SAWriter into the binary layout
+void LexicoIndex::loadText(const std::string& filename)
+{
+    SAReader reader(filename);
+    reader.readHeader(m_numStrings, m_numElems);
+    m_elemBytes = LexicoIndexWriter::getElemBytes(m_numStrings);
+    m_buffer.resize(m_numElems * m_elemBytes);
+
+    for(size_t i = 0; i < m_numElems; ++i)
+    {
+        uint64_t id = reader.readElem().getID();
+        memcpy(&m_buffer[i * m_elemBytes], &id, m_elemBytes);
+    }
+    m_pElems = m_buffer.empty() ? NULL : &m_buffer[0];
+}
+
+//
+LexicoIndexWriter::LexicoIndexWriter(const std::string& filename, size_t num_strings) : m_filename(filename),
+                                                                                         m_numStrings(num_strings),
+                                                                                         m_numWritten(0)
+{
+    m_pWriter = createWriter(filename, std::ios::out | std::ios::binary);
+    m_elemBytes = getElemBytes(num_strings);
+
+    LexicoIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = LEXICO_INDEX_FILE_MAGIC;
+    header.version = LEXICO_INDEX_FILE_VERSION;
+    header.elemBytes = m_elemBytes;
+    header.numStrings = num_strings;
+    header.numElems = num_strings;
+    m_pWriter->write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+//
+LexicoIndexWriter::~LexicoIndexWriter()
+{
+    if(m_numWritten != m_numStrings || !m_pWriter->good())
+    {
+        std::cerr << "Error: could not write the suffix array index " << m_filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+    delete m_pWriter;
+}
+
+// The IDs are stored little-endian in the low m_elemBytes bytes
+void LexicoIndexWriter::writeID(size_t id)
+{
+    assert(id < m_numStrings);
+    uint64_t v = id;
+    m_pWriter->write(reinterpret_cast<const char*>(&v), m_elemBytes);
+    ++m_numWritten;
+}
@@ -0,0 +1,97 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// LexicoIndex - The lexicographic index of a set of reads
+// (.sai/.rsai), the IDs of the reads sorted by their full-length
+// suffix. The index is written as a binary file of fixed-width
+// IDs, 32 bits wide if the number of reads allows it and 40 bits
+// otherwise, behind a short header. A binary index is used
+// directly from a memory-mapping of the file. Index files in the
+// older plain text format are still read, by parsing them.
+//
+#ifndef LEXICOINDEX_H
+#define LEXICOINDEX_H
+
+#include "STCommon.h"
+
+const uint16_t LEXICO_INDEX_FILE_MAGIC = 0xCACB;
+const uint16_t LEXICO_INDEX_FILE_VERSION = 1;
+
+class LexicoIndex
+{
+    public:
+        LexicoIndex(const std::string& filename);
+        ~LexicoIndex();
+
+        // Read the number of strings from the header of a binary or text index.
+        // Returns false if filename is not an index file
+        static bool readHeader(const std::string& filename, size_t& num_strings);
+
+        // Returns true if filename is an index in the binary format
+        static bool isBinary(const std::string& filename);
+
+        // Return the ID of the read with lexicographic rank idx
+        inline size_t getID(size_t idx) const
+        {
+            assert(idx < m_numElems);
+            const uint8_t* p = m_pElems + idx * m_elemBytes;
+            uint32_t low;
+            memcpy(&low, p, sizeof(low));
+            return m_elemBytes == 4 ? low : low | ((size_t)p[4] << 32);
+        }
+
+        // Return the full-length suffix of the read with lexicographic rank idx
+        inline SAElem get(size_t idx) const { return SAElem(getID(idx), 0); }
+
+        inline size_t getSize() const { return m_numElems; }
+        inline size_t getNumStrings() const { return m_numStrings; }
+        inline bool isMapped() const { return m_pMappedData != NULL; }
+
+    private:
+
+        LexicoIndex(const LexicoIndex&);
+        LexicoIndex& operator=(const LexicoIndex&);
+
+        bool loadMapped(const std::string& filename);
+        void loadText(const std::string& filename);
+
+        // The IDs, m_elemBytes bytes each
+        const uint8_t* m_pElems;
+        size_t m_elemBytes;
+        size_t m_numStrings;
+        size_t m_numElems;
+
+        // The IDs parsed from a text index
+        std::vector<uint8_t> m_buffer;
+
+        // The memory-mapped binary index
+        void* m_pMappedData;
+        size_t m_mappedSize;
+};
+
+// Write a binary index. The IDs are written in lexicographic order
+class LexicoIndexWriter
+{
+    public:
+        LexicoIndexWriter(const std::string& filename, size_t num_strings);
+        ~LexicoIndexWriter();
+
+        void writeID(size_t id);
+
+        // The width of the IDs of an index of num_strings reads
+        static size_t getElemBytes(size_t num_strings)
+        {
+            return num_strings <= ((size_t)1 << 32) ? 4 : 5;
+        }
+
+    private:
+        std::string m_filename;
+        std::ostream* m_pWriter;
+        size_t m_elemBytes;
+        size_t m_numStrings;
+        size_t m_numWritten;
+};
+
+#endif
@@ -8,23 +8,68 @@
 //
 #include "RLBWT.h"
 #include "Timer.h"
+#include "NumaPolicy.h"
 #include "BWTReader.h"
 #include "BWTWriter.h"
 #include "BWTReader.h"
 #include <istream>
 #include <queue>
 #include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // macros
 #define OCC(c,i) m_occurrence.get(m_bwStr, (c), (i))
 #define PRED(c) m_predCount.get((c))
 
+// Page size used to align the sections of the mapped index
+#define RLBWT_INDEX_ALIGNMENT 4096
+
+// The header of the memory-mapped index file. The sizes of the
+// in-memory structures are recorded so that an index written by 
+// an incompatible build is rejected rather than misinterpreted
+struct RLBWTIndexHeader
+{
+    uint16_t magic;
+    uint16_t version;
+    uint16_t unitSize;
+    uint16_t largeMarkerSize;
+    uint16_t smallMarkerSize;
+    uint16_t alphabetSize;
+    uint32_t padding;
+    uint64_t numStrings;
+    uint64_t numSymbols;
+    uint64_t numRuns;
+    uint64_t largeSampleRate;
+    uint64_t smallSampleRate;
+    uint64_t numLargeMarkers;
+    uint64_t numSmallMarkers;
+    uint64_t predCount[ALPHABET_SIZE];
+    uint64_t largeMarkerOffset;
+    uint64_t smallMarkerOffset;
+    uint64_t runOffset;
+    uint64_t fileSize;
+};
+
+static inline uint64_t alignIndexOffset(uint64_t offset)
+{
+    return (offset + RLBWT_INDEX_ALIGNMENT - 1) & ~(uint64_t)(RLBWT_INDEX_ALIGNMENT - 1);
+}
+
 // Parse a BWT from a file
 RLBWT::RLBWT(const std::string& filename, int sampleRate) : m_numStrings(0), 
                                                             m_numSymbols(0), 
                                                             m_largeSampleRate(DEFAULT_SAMPLE_RATE_LARGE),
-                                                            m_smallSampleRate(sampleRate)
+                                                            m_smallSampleRate(sampleRate),
+                                                            m_pMappedData(NULL),
+                                                            m_mappedSize(0)
 {
+    // Use the memory-mapped index if one was written for this bwt
+    if(loadMappedIndex(filename + RLBWT_INDEX_EXT, filename))
+        return;
+
     IBWTReader* pReader = BWTReader::createReader(filename);
     pReader->read(this);
     initializeFMIndex();
@@ -32,7 +77,7 @@ RLBWT::RLBWT(const std::string& filename, int sampleRate) : m_numStrings(0),
 }
 
 // Construct the BWT from a suffix array
-RLBWT::RLBWT(const SuffixArray* pSA, const ReadTable* pRT)
+RLBWT::RLBWT(const SuffixArray* pSA, const ReadTable* pRT) : m_pMappedData(NULL), m_mappedSize(0)
 {
     // Set up BWT state
     size_t n = pSA->getSize();
@@ -82,6 +127,24 @@ RLBWT::RLBWT(const SuffixArray* pSA, const ReadTable* pRT)
     initializeFMIndex();
 }
 
+// Construct an empty BWT to be filled in by a construction algorithm
+RLBWT::RLBWT(size_t numStrings, int sampleRate) : m_numStrings(numStrings),
+                                                  m_numSymbols(0),
+                                                  m_largeSampleRate(DEFAULT_SAMPLE_RATE_LARGE),
+                                                  m_smallSampleRate(sampleRate),
+                                                  m_pMappedData(NULL),
+                                                  m_mappedSize(0)
+{
+
+}
+
+//
+RLBWT::~RLBWT()
+{
+    if(m_pMappedData != NULL)
+        munmap(m_pMappedData, m_mappedSize);
+}
+
 //
 void RLBWT::append(char b)
 {
@@ -105,6 +168,34 @@ void RLBWT::append(char b)
     ++m_numSymbols;
 }
 
+// The runs are filled greedily, as in append, so the
+// units are the same as when the symbols are appended one by one
+void RLBWT::appendRun(char b, size_t length)
+{
+    m_numSymbols += length;
+    if(!m_rlString.empty())
+    {
+        RLUnit& lastUnit = m_rlString.back();
+        while(length > 0 && lastUnit.getChar() == b && !lastUnit.isFull())
+        {
+            lastUnit.incrementCount();
+            --length;
+        }
+    }
+
+    while(length > 0)
+    {
+        RLUnit unit(b);
+        --length;
+        while(length > 0 && !unit.isFull())
+        {
+            unit.incrementCount();
+            --length;
+        }
+        m_rlString.push_back(unit);
+    }
+}
+
 // Fill in the FM-index data structures
 void RLBWT::initializeFMIndex()
 {
@@ -245,6 +336,133 @@ void RLBWT::initializeFMIndex()
     m_predCount.set('C', m_predCount.get('A') + running_ac.get('A'));
     m_predCount.set('G', m_predCount.get('C') + running_ac.get('C'));
     m_predCount.set('T', m_predCount.get('G') + running_ac.get('G'));
+
+    bindStorage();
+}
+
+//
+void RLBWT::bindStorage()
+{
+    m_pRLString = m_rlString.empty() ? NULL : &m_rlString[0];
+    m_pLargeMarkers = m_largeMarkers.empty() ? NULL : &m_largeMarkers[0];
+    m_pSmallMarkers = m_smallMarkers.empty() ? NULL : &m_smallMarkers[0];
+    m_numRuns = m_rlString.size();
+}
+
+// Write the index in the layout expected by loadMappedIndex. Each section
+// starts on a page boundary so it can be used in place once mapped.
+void RLBWT::writeMappedIndex(const std::string& filename) const
+{
+    size_t numLargeMarkers = getNumRequiredMarkers(m_numSymbols, m_largeSampleRate);
+    size_t numSmallMarkers = getNumRequiredMarkers(m_numSymbols, m_smallSampleRate);
+
+    RLBWTIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = RLBWT_INDEX_FILE_MAGIC;
+    header.version = RLBWT_INDEX_FILE_VERSION;
+    header.unitSize = sizeof(RLUnit);
+    header.largeMarkerSize = sizeof(LargeMarker);
+    header.smallMarkerSize = sizeof(SmallMarker);
+    header.alphabetSize = ALPHABET_SIZE;
+    header.numStrings = m_numStrings;
+    header.numSymbols = m_numSymbols;
+    header.numRuns = m_numRuns;
+    header.largeSampleRate = m_largeSampleRate;
+    header.smallSampleRate = m_smallSampleRate;
+    header.numLargeMarkers = numLargeMarkers;
+    header.numSmallMarkers = numSmallMarkers;
+    for(size_t i = 0; i < ALPHABET_SIZE; ++i)
+        header.predCount[i] = m_predCount.getByIdx(i);
+
+    header.largeMarkerOffset = alignIndexOffset(sizeof(header));
+    header.smallMarkerOffset = alignIndexOffset(header.largeMarkerOffset + numLargeMarkers * sizeof(LargeMarker));
+    header.runOffset = alignIndexOffset(header.smallMarkerOffset + numSmallMarkers * sizeof(SmallMarker));
+    header.fileSize = header.runOffset + m_numRuns * sizeof(RLUnit);
+
+    std::ostream* pWriter = createWriter(filename, std::ios::out | std::ios::binary);
+    std::vector<char> padding(RLBWT_INDEX_ALIGNMENT, 0);
+
+    pWriter->write(reinterpret_cast<const char*>(&header), sizeof(header));
+    pWriter->write(&padding[0], header.largeMarkerOffset - sizeof(header));
+
+    size_t end = header.largeMarkerOffset + numLargeMarkers * sizeof(LargeMarker);
+    pWriter->write(reinterpret_cast<const char*>(m_pLargeMarkers), numLargeMarkers * sizeof(LargeMarker));
+    pWriter->write(&padding[0], header.smallMarkerOffset - end);
+
+    end = header.smallMarkerOffset + numSmallMarkers * sizeof(SmallMarker);
+    pWriter->write(reinterpret_cast<const char*>(m_pSmallMarkers), numSmallMarkers * sizeof(SmallMarker));
+    pWriter->write(&padding[0], header.runOffset - end);
+
+    pWriter->write(reinterpret_cast<const char*>(m_pRLString), m_numRuns * sizeof(RLUnit));
+
+    if(!pWriter->good())
+    {
+        std::cerr << "Error: could not write the FM-index to " << filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+    delete pWriter;
+}
+
+//
+bool RLBWT::loadMappedIndex(const std::string& filename, const std::string& bwtFilename)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    RLBWTIndexHeader header;
+    struct stat st;
+    bool valid = fstat(fd, &st) == 0 &&
+                 pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+                 header.magic == RLBWT_INDEX_FILE_MAGIC &&
+                 header.version == RLBWT_INDEX_FILE_VERSION &&
+                 header.unitSize == sizeof(RLUnit) &&
+                 header.largeMarkerSize == sizeof(LargeMarker) &&
+                 header.smallMarkerSize == sizeof(SmallMarker) &&
+                 header.alphabetSize == ALPHABET_SIZE &&
+                 header.largeSampleRate == m_largeSampleRate &&
+                 header.smallSampleRate == m_smallSampleRate &&
+                 header.fileSize == (uint64_t)st.st_size;
+
+    // Reject an index that was not built from the current bwt file
+    size_t numStrings, numSymbols, numRuns;
+    if(valid && BWTReader::readBinaryHeader(bwtFilename, numStrings, numSymbols, numRuns))
+    {
+        valid = numStrings == header.numStrings && numSymbols == header.numSymbols &&
+                numRuns == header.numRuns;
+    }
+
+    void* pData = MAP_FAILED;
+    if(valid)
+        pData = mmap(NULL, header.fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(pData == MAP_FAILED)
+    {
+        if(valid)
+            std::cerr << "Warning: could not map " << filename << ", reading " << bwtFilename << " instead\n";
+        return false;
+    }
+
+    m_pMappedData = pData;
+    m_mappedSize = header.fileSize;
+
+    // In the NUMA mode the pages are faulted in now, under the interleave policy of the loading thread
+    if(NumaPolicy::isEnabled())
+        NumaPolicy::touchPages(pData, header.fileSize);
+
+    const char* pBase = static_cast<const char*>(pData);
+    m_pLargeMarkers = reinterpret_cast<const LargeMarker*>(pBase + header.largeMarkerOffset);
+    m_pSmallMarkers = reinterpret_cast<const SmallMarker*>(pBase + header.smallMarkerOffset);
+    m_pRLString = reinterpret_cast<const RLUnit*>(pBase + header.runOffset);
+    m_numRuns = header.numRuns;
+    m_numStrings = header.numStrings;
+    m_numSymbols = header.numSymbols;
+    m_smallShiftValue = Occurrence::calculateShiftValue(m_smallSampleRate);
+    m_largeShiftValue = Occurrence::calculateShiftValue(m_largeSampleRate);
+    for(size_t i = 0; i < ALPHABET_SIZE; ++i)
+        m_predCount.setByIdx(i, header.predCount[i]);
+    return true;
 }
 
 // get the number of markers required to cover the n symbols at sample rate of d
@@ -263,7 +481,7 @@ void RLBWT::print() const
     std::string bwt;
     for(size_t i = 0; i < numRuns; ++i)
     {
-        const RLUnit& unit = m_rlString[i];
+        const RLUnit& unit = m_pRLString[i];
         char symbol = unit.getChar();
         size_t length = unit.getCount();
         for(size_t j = 0; j < length; ++j)
@@ -277,11 +495,11 @@ void RLBWT::print() const
 // Print information about the BWT
 void RLBWT::printInfo() const
 {
-    size_t small_m_size = m_smallMarkers.capacity() * sizeof(SmallMarker);
-    size_t large_m_size = m_largeMarkers.capacity() * sizeof(LargeMarker);
+    size_t small_m_size = getNumRequiredMarkers(m_numSymbols, m_smallSampleRate) * sizeof(SmallMarker);
+    size_t large_m_size = getNumRequiredMarkers(m_numSymbols, m_largeSampleRate) * sizeof(LargeMarker);
     size_t total_marker_size = small_m_size + large_m_size;
 
-    size_t bwStr_size = m_rlString.capacity() * sizeof(RLUnit);
+    size_t bwStr_size = m_numRuns * sizeof(RLUnit);
     size_t other_size = sizeof(*this);
     size_t total_size = total_marker_size + bwStr_size + other_size;
 
@@ -291,7 +509,8 @@ void RLBWT::printInfo() const
     printf("\nRLBWT info:\n");
     printf("Large Sample rate: %zu\n", m_largeSampleRate);
     printf("Small Sample rate: %zu\n", m_smallSampleRate);
-    printf("Contains %zu symbols in %zu runs (%1.4lf symbols per run)\n", m_numSymbols, m_rlString.size(), (double)m_numSymbols / m_rlString.size());
+    printf("Memory-mapped: %s\n", isMapped() ? "yes" : "no");
+    printf("Contains %zu symbols in %zu runs (%1.4lf symbols per run)\n", m_numSymbols, m_numRuns, (double)m_numSymbols / m_numRuns);
     printf("Marker Memory -- Small Markers: %zu (%.1lf MB) Large Markers: %zu (%.1lf MB)\n", small_m_size, small_m_size / mb, large_m_size, large_m_size / mb);
     printf("Total Memory -- Markers: %zu (%.1lf MB) Str: %zu (%.1lf MB) Misc: %zu Total: %zu (%lf MB)\n", total_marker_size, total_marker_size / mb, bwStr_size, bwStr_size / mb, other_size, total_size, total_mb);
     printf("N: %zu Bytes per symbol: %lf\n\n", m_numSymbols, (double)total_size / m_numSymbols);
@@ -311,7 +530,7 @@ void RLBWT::printRunLengths() const
     size_t totalRuns = 0;
     for(size_t i = 0; i < numRuns; ++i)
     {
-        const RLUnit& unit = m_rlString[i];
+        const RLUnit& unit = m_pRLString[i];
         size_t length = unit.getCount();
         if(unit.getChar() == prevSym)
         {
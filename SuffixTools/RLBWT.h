@@ -22,6 +22,12 @@
 // Defines
 //#define RLBWT_VALIDATE 1
 
+// The memory-mapped index is stored next to the .bwt file with this suffix appended
+#define RLBWT_INDEX_EXT ".fmi"
+
+const uint16_t RLBWT_INDEX_FILE_MAGIC = 0xCAFE;
+const uint16_t RLBWT_INDEX_FILE_VERSION = 1;
+
 //
 // RLBWT
 //
@@ -33,12 +39,27 @@ class RLBWT
         RLBWT(const std::string& filename, int sampleRate = DEFAULT_SAMPLE_RATE_SMALL);
         RLBWT(const SuffixArray* pSA, const ReadTable* pRT);
 
+        // Construct an empty BWT of numStrings strings. The symbols are added
+        // with append or appendRun and the index is finished by initializeFMIndex
+        RLBWT(size_t numStrings, int sampleRate = DEFAULT_SAMPLE_RATE_SMALL);
+        ~RLBWT();
+
         //    
         void initializeFMIndex();
 
+        // Write the run string, markers and C(a) array in their in-memory layout
+        // so the index can later be memory-mapped instead of rebuilt
+        void writeMappedIndex(const std::string& filename) const;
+
+        // Returns true if the index is backed by a memory-mapped file
+        inline bool isMapped() const { return m_pMappedData != NULL; }
+
         // Append a symbol to the bw string
         void append(char b);
 
+        // Append length copies of b to the bw string
+        void appendRun(char b, size_t length);
+
         inline char getChar(size_t idx) const
         {
             // Calculate the Marker who's position is not less than idx
@@ -53,11 +74,11 @@ class RLBWT
             {
                 assert(symbol_index != 0);
                 symbol_index -= 1;
-                current_position -= m_rlString[symbol_index].getCount();
+                current_position -= m_pRLString[symbol_index].getCount();
             }
 
             // symbol_index is now the index of the run containing the idx symbol
-            const RLUnit& unit = m_rlString[symbol_index];
+            const RLUnit& unit = m_pRLString[symbol_index];
             assert(current_position <= idx && current_position + unit.getCount() >= idx);
             return unit.getChar();
         }
@@ -108,8 +129,8 @@ class RLBWT
             size_t target_position = target_small_idx << m_smallShiftValue;
             size_t curr_large_idx = target_position >> m_largeShiftValue;
 
-            LargeMarker absoluteMarker = m_largeMarkers[curr_large_idx];
-            const SmallMarker& relative = m_smallMarkers[target_small_idx];
+            LargeMarker absoluteMarker = m_pLargeMarkers[curr_large_idx];
+            const SmallMarker& relative = m_pSmallMarkers[target_small_idx];
             alphacount_add16(absoluteMarker.counts, relative.counts);
             absoluteMarker.unitIndex += relative.unitCount;
             return absoluteMarker;
@@ -173,7 +194,7 @@ class RLBWT
 #endif
                 --currentUnitIndex;
 
-                const RLUnit& curr_unit = m_rlString[currentUnitIndex];
+                const RLUnit& curr_unit = m_pRLString[currentUnitIndex];
                 currentPosition -= curr_unit.subtractAlphaCount(running_count, diff);
             }
         }
@@ -187,9 +208,9 @@ class RLBWT
             {
                 size_t diff = targetPosition - currentPosition;
 #ifdef RLBWT_VALIDATE
-                assert(currentUnitIndex != m_rlString.size());
+                assert(currentUnitIndex != m_numRuns);
 #endif
-                const RLUnit& curr_unit = m_rlString[currentUnitIndex];
+                const RLUnit& curr_unit = m_pRLString[currentUnitIndex];
                 currentPosition += curr_unit.addAlphaCount(running_count, diff);
                 ++currentUnitIndex;
             }
@@ -207,7 +228,7 @@ class RLBWT
                 assert(currentUnitIndex != 0);
 #endif
                 --currentUnitIndex;
-                const RLUnit& curr_unit = m_rlString[currentUnitIndex];
+                const RLUnit& curr_unit = m_pRLString[currentUnitIndex];
                 currentPosition -= curr_unit.subtractCount(b, running_count, diff);
             }
         }
@@ -221,23 +242,200 @@ class RLBWT
             {
                 size_t diff = targetPosition - currentPosition;
 #ifdef RLBWT_VALIDATE
-                assert(currentUnitIndex != m_rlString.size());
+                assert(currentUnitIndex != m_numRuns);
 #endif
-                const RLUnit& curr_unit = m_rlString[currentUnitIndex];
+                const RLUnit& curr_unit = m_pRLString[currentUnitIndex];
                 currentPosition += curr_unit.addCount(b, running_count, diff);
                 ++currentUnitIndex;
             }
         }
 
+        // Return the number of times char b appears in bwt[0, idx0] and bwt[0, idx1].
+        // This is used for the two ends of an interval. When both positions are
+        // nearest to the same marker, which is the common case for the narrow
+        // intervals of a backward search, the runs are only walked once: to the
+        // position closest to the marker and then on to the other one.
+        inline void getOccPair(char b, size_t idx0, size_t idx1, BaseCount& occ0, BaseCount& occ1) const
+        {
+            // The counts in the marker are not inclusive so we increment the indices by 1
+            size_t p0 = idx0 + 1;
+            size_t p1 = idx1 + 1;
+            size_t marker_idx = getNearestMarkerIdx(p0, m_smallSampleRate, m_smallShiftValue);
+            if(p1 < p0 || getNearestMarkerIdx(p1, m_smallSampleRate, m_smallShiftValue) != marker_idx)
+            {
+                occ0 = getOcc(b, idx0);
+                occ1 = getOcc(b, idx1);
+                return;
+            }
+
+            const LargeMarker& marker = getInterpolatedMarker(marker_idx);
+            size_t current_position = marker.getActualPosition();
+            size_t running_count = marker.counts.get(b);
+            size_t symbol_index = marker.unitIndex;
+
+            if(current_position <= p0)
+            {
+                occ0 = scanForwards(b, running_count, symbol_index, current_position, p0);
+                occ1 = scanForwards(b, running_count, symbol_index, current_position, p1);
+            }
+            else if(current_position >= p1)
+            {
+                occ1 = scanBackwards(b, running_count, symbol_index, current_position, p1);
+                occ0 = scanBackwards(b, running_count, symbol_index, current_position, p0);
+            }
+            else
+            {
+                // The marker lies between the positions, walk out from it in both directions
+                size_t lower_count = running_count;
+                accumulateBackwards(b, lower_count, symbol_index, current_position, p0);
+                accumulateForwards(b, running_count, symbol_index, current_position, p1);
+                occ0 = lower_count;
+                occ1 = running_count;
+            }
+        }
+
+        // Return the number of times each symbol appears in bwt[0, idx0] and bwt[0, idx1],
+        // walking the runs once if possible. See getOccPair
+        inline void getFullOccPair(size_t idx0, size_t idx1, AlphaCount64& occ0, AlphaCount64& occ1) const
+        {
+            size_t p0 = idx0 + 1;
+            size_t p1 = idx1 + 1;
+            size_t marker_idx = getNearestMarkerIdx(p0, m_smallSampleRate, m_smallShiftValue);
+            if(p1 < p0 || getNearestMarkerIdx(p1, m_smallSampleRate, m_smallShiftValue) != marker_idx)
+            {
+                occ0 = getFullOcc(idx0);
+                occ1 = getFullOcc(idx1);
+                return;
+            }
+
+            const LargeMarker& marker = getInterpolatedMarker(marker_idx);
+            size_t current_position = marker.getActualPosition();
+            AlphaCount64 running_count = marker.counts;
+            size_t symbol_index = marker.unitIndex;
+
+            if(current_position <= p0)
+            {
+                occ0 = scanForwards(running_count, symbol_index, current_position, p0);
+                occ1 = scanForwards(running_count, symbol_index, current_position, p1);
+            }
+            else if(current_position >= p1)
+            {
+                occ1 = scanBackwards(running_count, symbol_index, current_position, p1);
+                occ0 = scanBackwards(running_count, symbol_index, current_position, p0);
+            }
+            else
+            {
+                occ0 = running_count;
+                accumulateBackwards(occ0, symbol_index, current_position, p0);
+                accumulateForwards(running_count, symbol_index, current_position, p1);
+                occ1 = running_count;
+            }
+        }
+
+        // Move forwards over the runs that end at or before targetPosition and return the
+        // count of b in bwt[0, targetPosition). The running count, unit index and position are
+        // left at the start of the run containing targetPosition so the walk can be resumed.
+        // Precondition: currentPosition <= targetPosition
+        inline size_t scanForwards(char b, size_t& running_count, size_t& currentUnitIndex, size_t& currentPosition, const size_t targetPosition) const
+        {
+            while(currentPosition < targetPosition)
+            {
+                const RLUnit& curr_unit = m_pRLString[currentUnitIndex];
+                size_t run_len = curr_unit.getCount();
+                if(currentPosition + run_len > targetPosition)
+                    return running_count + (curr_unit.getChar() == b ? targetPosition - currentPosition : 0);
+                if(curr_unit.getChar() == b)
+                    running_count += run_len;
+                currentPosition += run_len;
+                ++currentUnitIndex;
+            }
+            return running_count;
+        }
+
+        // Move backwards to the start of the run containing targetPosition and return the
+        // count of b in bwt[0, targetPosition). The state is left at the start of that run.
+        // Precondition: currentPosition is the start of the run at currentUnitIndex
+        inline size_t scanBackwards(char b, size_t& running_count, size_t& currentUnitIndex, size_t& currentPosition, const size_t targetPosition) const
+        {
+            while(currentPosition > targetPosition)
+            {
+                --currentUnitIndex;
+                const RLUnit& curr_unit = m_pRLString[currentUnitIndex];
+                currentPosition -= curr_unit.getCount();
+                if(curr_unit.getChar() == b)
+                    running_count -= curr_unit.getCount();
+            }
+
+            if(currentPosition < targetPosition && m_pRLString[currentUnitIndex].getChar() == b)
+                return running_count + (targetPosition - currentPosition);
+            return running_count;
+        }
+
+        // As above for all symbols
+        inline AlphaCount64 scanForwards(AlphaCount64& running_count, size_t& currentUnitIndex, size_t& currentPosition, const size_t targetPosition) const
+        {
+            while(currentPosition < targetPosition)
+            {
+                const RLUnit& curr_unit = m_pRLString[currentUnitIndex];
+                size_t run_len = curr_unit.getCount();
+                if(currentPosition + run_len > targetPosition)
+                {
+                    AlphaCount64 out = running_count;
+                    out.add(curr_unit.getChar(), targetPosition - currentPosition);
+                    return out;
+                }
+                running_count.add(curr_unit.getChar(), run_len);
+                currentPosition += run_len;
+                ++currentUnitIndex;
+            }
+            return running_count;
+        }
+
+        //
+        inline AlphaCount64 scanBackwards(AlphaCount64& running_count, size_t& currentUnitIndex, size_t& currentPosition, const size_t targetPosition) const
+        {
+            while(currentPosition > targetPosition)
+            {
+                --currentUnitIndex;
+                const RLUnit& curr_unit = m_pRLString[currentUnitIndex];
+                currentPosition -= curr_unit.getCount();
+                running_count.subtract(curr_unit.getChar(), curr_unit.getCount());
+            }
+
+            AlphaCount64 out = running_count;
+            if(currentPosition < targetPosition)
+                out.add(m_pRLString[currentUnitIndex].getChar(), targetPosition - currentPosition);
+            return out;
+        }
+
         // Return the number of times each symbol in the alphabet appears ins bwt[idx0, idx1]
         inline AlphaCount64 getOccDiff(size_t idx0, size_t idx1) const 
         { 
-            return getFullOcc(idx1) - getFullOcc(idx0); 
+            AlphaCount64 occ0;
+            AlphaCount64 occ1;
+            getFullOccPair(idx0, idx1, occ0, occ1);
+            return occ1 - occ0;
+        }
+
+        // Prefetch the markers read by getOcc(b, idx). The runs can only be
+        // prefetched once the markers are in cache, see prefetchRun
+        inline void prefetchMarker(size_t idx) const
+        {
+            size_t small_idx = getNearestMarkerIdx(idx + 1, m_smallSampleRate, m_smallShiftValue);
+            __builtin_prefetch(&m_pSmallMarkers[small_idx]);
+            __builtin_prefetch(&m_pLargeMarkers[(small_idx << m_smallShiftValue) >> m_largeShiftValue]);
+        }
+
+        // Prefetch the run string where getOcc(b, idx) starts counting
+        inline void prefetchRun(size_t idx) const
+        {
+            const LargeMarker& marker = getNearestMarker(idx + 1);
+            __builtin_prefetch(&m_pRLString[marker.unitIndex]);
         }
 
         inline size_t getNumStrings() const { return m_numStrings; } 
         inline size_t getBWLen() const { return m_numSymbols; }
-        inline size_t getNumRuns() const { return m_rlString.size(); }
+        inline size_t getNumRuns() const { return m_numRuns; }
 
         // Return the first letter of the suffix starting at idx
         inline char getF(size_t idx) const
@@ -267,12 +465,21 @@ class RLBWT
     private:
 
 
-        // Default constructor is not allowed
+        // Default constructor and copying are not allowed
         RLBWT() {}
+        RLBWT(const RLBWT&);
+        RLBWT& operator=(const RLBWT&);
         
         // Calculate the number of markers to place
         size_t getNumRequiredMarkers(size_t n, size_t d) const;
 
+        // Point the run string and marker views at the owned vectors
+        void bindStorage();
+
+        // Map the index written by writeMappedIndex. Returns false, leaving
+        // the object untouched, if the file is missing, stale or incompatible
+        bool loadMappedIndex(const std::string& filename, const std::string& bwtFilename);
+
         // The C(a) array
         AlphaCount64 m_predCount;
         
@@ -297,5 +504,16 @@ class RLBWT
         int m_smallShiftValue;
         int m_largeShiftValue;
 
+        // The run string and markers used by the queries. These point either
+        // into the vectors or into the memory-mapped index file
+        const RLUnit* m_pRLString;
+        const LargeMarker* m_pLargeMarkers;
+        const SmallMarker* m_pSmallMarkers;
+        size_t m_numRuns;
+
+        // The memory-mapped index, if any
+        void* m_pMappedData;
+        size_t m_mappedSize;
+
 };
 #endif
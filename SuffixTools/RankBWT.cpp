@@ -0,0 +1,275 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// RankBWT - Burrows Wheeler transform stored as bit-sliced
+// blocks with embedded counts
+//
+#include "RankBWT.h"
+#include "RLBWT.h"
+#include "BWTReaderBinary.h"
+#include "NumaPolicy.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Page size used to align the sections of the mapped index
+#define RANKBWT_INDEX_ALIGNMENT 4096
+
+// Alignment of the block array so that a block never straddles two cache lines
+#define RANKBWT_BLOCK_ALIGNMENT 64
+
+// The header of the memory-mapped index file
+struct RankBWTIndexHeader
+{
+    uint16_t magic;
+    uint16_t version;
+    uint16_t blockSize;
+    uint16_t alphabetSize;
+    uint32_t blockShift;
+    uint32_t superblockShift;
+    uint64_t numStrings;
+    uint64_t numSymbols;
+    uint64_t numRuns;
+    uint64_t numBlocks;
+    uint64_t numSuperblocks;
+    uint64_t predCount[ALPHABET_SIZE];
+    uint64_t superOffset;
+    uint64_t blockOffset;
+    uint64_t fileSize;
+};
+
+static inline uint64_t alignIndexOffset(uint64_t offset)
+{
+    return (offset + RANKBWT_INDEX_ALIGNMENT - 1) & ~(uint64_t)(RANKBWT_INDEX_ALIGNMENT - 1);
+}
+
+// Load the BWT from the memory-mapped index next to filename if one exists,
+// otherwise build the blocks from the .bwt file
+RankBWT::RankBWT(const std::string& filename, int /*sampleRate*/) : m_pBlocks(NULL),
+                                                                  m_numBlocks(0),
+                                                                  m_numStrings(0),
+                                                                  m_numSymbols(0),
+                                                                  m_numRuns(0),
+                                                                  m_pMappedData(NULL),
+                                                                  m_mappedSize(0)
+{
+    if(!loadMappedIndex(filename + RLBWT_INDEX_EXT, filename))
+        buildFromFile(filename);
+}
+
+//
+RankBWT::~RankBWT()
+{
+    if(m_pMappedData != NULL)
+        munmap(m_pMappedData, m_mappedSize);
+    else
+        free(const_cast<RankBlock*>(m_pBlocks));
+}
+
+// Stream the symbols of the run-length encoded bwt into the blocks
+void RankBWT::buildFromFile(const std::string& filename)
+{
+    BWTReaderBinary reader(filename);
+    BWFlag flag;
+    reader.readHeader(m_numStrings, m_numSymbols, flag);
+
+    // The run count is kept to validate a mapped index written from this bwt
+    size_t numStrings, numSymbols;
+    BWTReader::readBinaryHeader(filename, numStrings, numSymbols, m_numRuns);
+
+    // One block more than strictly needed so that the block for position n always exists
+    m_numBlocks = (m_numSymbols >> RANK_BLOCK_SHIFT) + 1;
+    size_t numSuperblocks = (m_numSymbols >> RANK_SUPERBLOCK_SHIFT) + 1;
+
+    void* pMemory = NULL;
+    if(posix_memalign(&pMemory, RANKBWT_BLOCK_ALIGNMENT, m_numBlocks * sizeof(RankBlock)) != 0)
+    {
+        std::cerr << "Error: could not allocate " << m_numBlocks * sizeof(RankBlock) << " bytes for the RankBWT\n";
+        exit(EXIT_FAILURE);
+    }
+    memset(pMemory, 0, m_numBlocks * sizeof(RankBlock));
+    RankBlock* pBlocks = static_cast<RankBlock*>(pMemory);
+    m_superCounts.resize(numSuperblocks);
+
+    AlphaCount64 running_ac;
+    size_t position = 0;
+    for(size_t i = 0; i < m_numBlocks; ++i)
+    {
+        RankBlock& block = pBlocks[i];
+
+        // Place the superblock counts at the superblock boundary
+        if((position & (((size_t)1 << RANK_SUPERBLOCK_SHIFT) - 1)) == 0)
+            m_superCounts[position >> RANK_SUPERBLOCK_SHIFT] = running_ac;
+
+        const AlphaCount64& super = m_superCounts[position >> RANK_SUPERBLOCK_SHIFT];
+        for(size_t j = 0; j < DNA_ALPHABET_SIZE; ++j)
+            block.counts[j] = running_ac.getByIdx(j + 1) - super.getByIdx(j + 1);
+
+        for(size_t j = 0; j < RANK_BLOCK_SIZE && position < m_numSymbols; ++j, ++position)
+        {
+            char b = reader.readBWChar();
+            assert(b != '\n');
+            running_ac.increment(b);
+
+            uint64_t code = BWT_ALPHABET::getRank(b);
+            size_t word = j >> 6;
+            uint64_t bit = (uint64_t)1 << (j & 63);
+            for(size_t k = 0; k < 3; ++k)
+            {
+                if((code >> k) & 1)
+                    block.planes[k][word] |= bit;
+            }
+        }
+    }
+    assert(running_ac.getSum() == m_numSymbols);
+    m_pBlocks = pBlocks;
+
+    // Initialize C(a)
+    m_predCount.set('$', 0);
+    m_predCount.set('A', running_ac.get('$'));
+    m_predCount.set('C', m_predCount.get('A') + running_ac.get('A'));
+    m_predCount.set('G', m_predCount.get('C') + running_ac.get('C'));
+    m_predCount.set('T', m_predCount.get('G') + running_ac.get('G'));
+}
+
+// Write the index in the layout expected by loadMappedIndex
+void RankBWT::writeMappedIndex(const std::string& filename) const
+{
+    RankBWTIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = RANKBWT_INDEX_FILE_MAGIC;
+    header.version = RANKBWT_INDEX_FILE_VERSION;
+    header.blockSize = sizeof(RankBlock);
+    header.alphabetSize = ALPHABET_SIZE;
+    header.blockShift = RANK_BLOCK_SHIFT;
+    header.superblockShift = RANK_SUPERBLOCK_SHIFT;
+    header.numStrings = m_numStrings;
+    header.numSymbols = m_numSymbols;
+    header.numRuns = m_numRuns;
+    header.numBlocks = m_numBlocks;
+    header.numSuperblocks = m_superCounts.size();
+    for(size_t i = 0; i < ALPHABET_SIZE; ++i)
+        header.predCount[i] = m_predCount.getByIdx(i);
+
+    header.superOffset = sizeof(header);
+    header.blockOffset = alignIndexOffset(header.superOffset + header.numSuperblocks * ALPHABET_SIZE * sizeof(uint64_t));
+    header.fileSize = header.blockOffset + m_numBlocks * sizeof(RankBlock);
+
+    std::ostream* pWriter = createWriter(filename, std::ios::out | std::ios::binary);
+    pWriter->write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for(size_t i = 0; i < m_superCounts.size(); ++i)
+    {
+        for(size_t j = 0; j < ALPHABET_SIZE; ++j)
+        {
+            uint64_t v = m_superCounts[i].getByIdx(j);
+            pWriter->write(reinterpret_cast<const char*>(&v), sizeof(v));
+        }
+    }
+
+    size_t end = header.superOffset + header.numSuperblocks * ALPHABET_SIZE * sizeof(uint64_t);
+    std::vector<char> padding(header.blockOffset - end, 0);
+    if(!padding.empty())
+        pWriter->write(&padding[0], padding.size());
+    pWriter->write(reinterpret_cast<const char*>(m_pBlocks), m_numBlocks * sizeof(RankBlock));
+
+    if(!pWriter->good())
+    {
+        std::cerr << "Error: could not write the FM-index to " << filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+    delete pWriter;
+}
+
+//
+bool RankBWT::loadMappedIndex(const std::string& filename, const std::string& bwtFilename)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    RankBWTIndexHeader header;
+    struct stat st;
+    bool valid = fstat(fd, &st) == 0 &&
+                 pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+                 header.magic == RANKBWT_INDEX_FILE_MAGIC &&
+                 header.version == RANKBWT_INDEX_FILE_VERSION &&
+                 header.blockSize == sizeof(RankBlock) &&
+                 header.alphabetSize == ALPHABET_SIZE &&
+                 header.blockShift == RANK_BLOCK_SHIFT &&
+                 header.superblockShift == RANK_SUPERBLOCK_SHIFT &&
+                 header.fileSize == (uint64_t)st.st_size;
+
+    // Reject an index that was not built from the current bwt file
+    size_t numStrings, numSymbols, numRuns;
+    if(valid && BWTReader::readBinaryHeader(bwtFilename, numStrings, numSymbols, numRuns))
+    {
+        valid = numStrings == header.numStrings && numSymbols == header.numSymbols &&
+                numRuns == header.numRuns;
+    }
+
+    void* pData = MAP_FAILED;
+    if(valid)
+        pData = mmap(NULL, header.fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(pData == MAP_FAILED)
+    {
+        if(valid)
+            std::cerr << "Warning: could not map " << filename << ", reading " << bwtFilename << " instead\n";
+        return false;
+    }
+
+    m_pMappedData = pData;
+    m_mappedSize = header.fileSize;
+
+    // In the NUMA mode the pages are faulted in now, under the interleave policy of the loading thread
+    if(NumaPolicy::isEnabled())
+        NumaPolicy::touchPages(pData, header.fileSize);
+
+    const char* pBase = static_cast<const char*>(pData);
+    const uint64_t* pSuper = reinterpret_cast<const uint64_t*>(pBase + header.superOffset);
+    m_superCounts.resize(header.numSuperblocks);
+    for(size_t i = 0; i < header.numSuperblocks; ++i)
+    {
+        for(size_t j = 0; j < ALPHABET_SIZE; ++j)
+            m_superCounts[i].setByIdx(j, pSuper[i * ALPHABET_SIZE + j]);
+    }
+
+    m_pBlocks = reinterpret_cast<const RankBlock*>(pBase + header.blockOffset);
+    m_numBlocks = header.numBlocks;
+    m_numStrings = header.numStrings;
+    m_numSymbols = header.numSymbols;
+    m_numRuns = header.numRuns;
+    for(size_t i = 0; i < ALPHABET_SIZE; ++i)
+        m_predCount.setByIdx(i, header.predCount[i]);
+    return true;
+}
+
+// Print the BWT
+void RankBWT::print() const
+{
+    std::string bwt;
+    for(size_t i = 0; i < m_numSymbols; ++i)
+        bwt.append(1, getChar(i));
+    std::cout << "B: " << bwt << "\n";
+}
+
+// Print information about the BWT
+void RankBWT::printInfo() const
+{
+    size_t block_size = m_numBlocks * sizeof(RankBlock);
+    size_t super_size = m_superCounts.size() * sizeof(AlphaCount64);
+    size_t other_size = sizeof(*this);
+    size_t total_size = block_size + super_size + other_size;
+    double mb = (double)(1024 * 1024);
+
+    printf("\nRankBWT info:\n");
+    printf("Block size: %d symbols (%zu bytes)\n", RANK_BLOCK_SIZE, sizeof(RankBlock));
+    printf("Memory-mapped: %s\n", isMapped() ? "yes" : "no");
+    printf("Contains %zu symbols in %zu blocks\n", m_numSymbols, m_numBlocks);
+    printf("Total Memory -- Blocks: %zu (%.1lf MB) Superblocks: %zu Misc: %zu Total: %zu (%lf MB)\n", block_size, block_size / mb, super_size, other_size, total_size, total_size / mb);
+    printf("N: %zu Bytes per symbol: %lf\n\n", m_numSymbols, (double)total_size / m_numSymbols);
+}
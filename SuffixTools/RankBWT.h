@@ -0,0 +1,223 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// RankBWT - Burrows Wheeler transform stored as bit-sliced
+// blocks with embedded counts. Each 64-byte block holds 128
+// symbols as three bit-planes together with the symbol counts
+// preceding the block, so getOcc is answered from a single
+// cache line with a few popcounts instead of walking runs.
+// This uses more memory than the RLBWT (4 bits per symbol)
+// but the rank is constant-time and branch-free, which pays
+// off for low-complexity read sets with short runs.
+//
+#ifndef RANKBWT_H
+#define RANKBWT_H
+
+#include "STCommon.h"
+#include "Occurrence.h"
+#include "BWTReader.h"
+
+const uint16_t RANKBWT_INDEX_FILE_MAGIC = 0xCAFD;
+const uint16_t RANKBWT_INDEX_FILE_VERSION = 1;
+
+// Number of symbols per block and per superblock (as a shift)
+#define RANK_BLOCK_SHIFT 7
+#define RANK_BLOCK_SIZE (1 << RANK_BLOCK_SHIFT)
+#define RANK_BLOCK_MASK (RANK_BLOCK_SIZE - 1)
+#define RANK_SUPERBLOCK_SHIFT 31
+
+// Count the set bits of a 64-bit word. The popcnt instruction
+// is only used when the compiler targets it (--enable-popcnt)
+inline size_t popcount64(uint64_t x)
+{
+#if defined(__POPCNT__)
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (x * 0x0101010101010101ULL) >> 56;
+#endif
+}
+
+// A block of 128 symbols. Bit i of plane k (split over two words) is bit k
+// of the rank code of the i-th symbol of the block. The counts are the number
+// of A,C,G,T seen before the block, relative to the start of its superblock.
+// The count of $ is implied by the position.
+struct RankBlock
+{
+    uint32_t counts[DNA_ALPHABET_SIZE];
+    uint64_t planes[3][2];
+};
+
+//
+// RankBWT
+//
+class RankBWT
+{
+    public:
+
+        // Constructors
+        RankBWT(const std::string& filename, int sampleRate = DEFAULT_SAMPLE_RATE_SMALL);
+        ~RankBWT();
+
+        // Write the blocks in their in-memory layout so the index can be memory-mapped
+        void writeMappedIndex(const std::string& filename) const;
+
+        // Returns true if the index is backed by a memory-mapped file
+        inline bool isMapped() const { return m_pMappedData != NULL; }
+
+        inline char getChar(size_t idx) const
+        {
+            const RankBlock& block = m_pBlocks[idx >> RANK_BLOCK_SHIFT];
+            size_t offset = idx & RANK_BLOCK_MASK;
+            size_t word = offset >> 6;
+            size_t bit = offset & 63;
+            uint8_t code = ((block.planes[0][word] >> bit) & 1) |
+                           (((block.planes[1][word] >> bit) & 1) << 1) |
+                           (((block.planes[2][word] >> bit) & 1) << 2);
+            return BWT_ALPHABET::getChar(code);
+        }
+
+        inline BaseCount getPC(char b) const { return m_predCount.get(b); }
+
+        // Return the number of times char b appears in bwt[0, idx]
+        inline BaseCount getOcc(char b, size_t idx) const
+        {
+            // The counts in the blocks are not inclusive so we increment the index by 1
+            ++idx;
+            uint8_t code = BWT_ALPHABET::getRank(b);
+            if(code == 0)
+            {
+                // The number of $ is whatever is left over from the other symbols
+                return idx - getOcc('A', idx - 1) - getOcc('C', idx - 1) - getOcc('G', idx - 1) - getOcc('T', idx - 1);
+            }
+
+            const RankBlock& block = m_pBlocks[idx >> RANK_BLOCK_SHIFT];
+            return m_superCounts[idx >> RANK_SUPERBLOCK_SHIFT].getByIdx(code) +
+                   block.counts[code - 1] +
+                   countInBlock(block, code, idx & RANK_BLOCK_MASK);
+        }
+
+        // Return the number of times each symbol in the alphabet appears in bwt[0, idx]
+        inline AlphaCount64 getFullOcc(size_t idx) const
+        {
+            ++idx;
+            const RankBlock& block = m_pBlocks[idx >> RANK_BLOCK_SHIFT];
+            const AlphaCount64& super = m_superCounts[idx >> RANK_SUPERBLOCK_SHIFT];
+            size_t offset = idx & RANK_BLOCK_MASK;
+
+            AlphaCount64 out;
+            size_t sum = 0;
+            for(uint8_t code = 1; code < ALPHABET_SIZE; ++code)
+            {
+                size_t count = super.getByIdx(code) + block.counts[code - 1] + countInBlock(block, code, offset);
+                out.setByIdx(code, count);
+                sum += count;
+            }
+            out.setByIdx(0, idx - sum);
+            return out;
+        }
+
+        // Return the number of times char b appears in bwt[0, idx0] and bwt[0, idx1].
+        // Each count is a single block lookup so there is no walk to share
+        inline void getOccPair(char b, size_t idx0, size_t idx1, BaseCount& occ0, BaseCount& occ1) const
+        {
+            occ0 = getOcc(b, idx0);
+            occ1 = getOcc(b, idx1);
+        }
+
+        inline void getFullOccPair(size_t idx0, size_t idx1, AlphaCount64& occ0, AlphaCount64& occ1) const
+        {
+            occ0 = getFullOcc(idx0);
+            occ1 = getFullOcc(idx1);
+        }
+
+        // Return the number of times each symbol in the alphabet appears ins bwt[idx0, idx1]
+        inline AlphaCount64 getOccDiff(size_t idx0, size_t idx1) const
+        {
+            return getFullOcc(idx1) - getFullOcc(idx0);
+        }
+
+        // Prefetch the block read by getOcc(b, idx). The counts are stored
+        // in the block so there is nothing else to fetch in prefetchRun
+        inline void prefetchMarker(size_t idx) const { __builtin_prefetch(&m_pBlocks[(idx + 1) >> RANK_BLOCK_SHIFT]); }
+        inline void prefetchRun(size_t /*idx*/) const {}
+
+        inline size_t getNumStrings() const { return m_numStrings; }
+        inline size_t getBWLen() const { return m_numSymbols; }
+
+        // Return the first letter of the suffix starting at idx
+        inline char getF(size_t idx) const
+        {
+            size_t ci = 0;
+            while(ci < ALPHABET_SIZE && m_predCount.getByIdx(ci) <= idx)
+                ci++;
+            assert(ci != 0);
+            return RANK_ALPHABET[ci - 1];
+        }
+
+        // Print the size of the BWT
+        void printInfo() const;
+        void print() const;
+        void printRunLengths() const { std::cout << "Using RankBWT - No run lengths\n"; }
+
+        // The block size is fixed, the sample rate is accepted for interface
+        // compatibility with the other BWT implementations
+        static const int DEFAULT_SAMPLE_RATE_SMALL = RANK_BLOCK_SIZE;
+
+    private:
+
+        // Default constructor and copying are not allowed
+        RankBWT() {}
+        RankBWT(const RankBWT&);
+        RankBWT& operator=(const RankBWT&);
+
+        // Count the occurrences of the symbol with rank code in the first offset symbols of block
+        inline size_t countInBlock(const RankBlock& block, uint8_t code, size_t offset) const
+        {
+            // Select the plane or its complement depending on the bits of the code
+            uint64_t s0 = -(uint64_t)(code & 1);
+            uint64_t s1 = -(uint64_t)((code >> 1) & 1);
+            uint64_t s2 = -(uint64_t)((code >> 2) & 1);
+            uint64_t lo = ~(block.planes[0][0] ^ s0) & ~(block.planes[1][0] ^ s1) & ~(block.planes[2][0] ^ s2);
+            uint64_t hi = ~(block.planes[0][1] ^ s0) & ~(block.planes[1][1] ^ s1) & ~(block.planes[2][1] ^ s2);
+
+            uint64_t lo_mask = offset >= 64 ? ~0ULL : (1ULL << (offset & 63)) - 1;
+            uint64_t hi_mask = offset > 64 ? (1ULL << ((offset - 64) & 63)) - 1 : 0;
+            return popcount64(lo & lo_mask) + popcount64(hi & hi_mask);
+        }
+
+        // Build the blocks from the run-length encoded bwt file
+        void buildFromFile(const std::string& filename);
+
+        // Map the index written by writeMappedIndex. Returns false if the file
+        // is missing, stale or incompatible
+        bool loadMappedIndex(const std::string& filename, const std::string& bwtFilename);
+
+        // The C(a) array
+        AlphaCount64 m_predCount;
+
+        // The absolute counts at the start of each superblock
+        std::vector<AlphaCount64> m_superCounts;
+
+        // The blocks, either owned or pointing into the memory-mapped file
+        const RankBlock* m_pBlocks;
+        size_t m_numBlocks;
+
+        // The number of strings in the collection
+        size_t m_numStrings;
+
+        // The total length of the bw string
+        size_t m_numSymbols;
+
+        // The number of runs in the source .bwt, used to detect stale index files
+        size_t m_numRuns;
+
+        // The memory-mapped index, if any
+        void* m_pMappedData;
+        size_t m_mappedSize;
+};
+#endif
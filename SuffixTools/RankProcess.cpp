@@ -45,12 +45,12 @@ RankResult RankProcess::process(const SequenceWorkItem& workItem)
     size_t l = w.length();
     int i = l - 1;
 
-    // In add mode, the initial rank is zero and we calculate the rank
-    // for the last base of the sequence using just C(a). In remove
+    // In add mode, the read is appended after the reads of the index so
+    // its sentinel ranks after all the sentinels of the index. In remove
     // mode we use the index of the read (in the original read table) as
     // the rank so that ranks calculate correspond to the correct
     // entries in the BWT for the read to remove.
-    int64_t rank = 0; // add mode
+    int64_t rank = m_pBWT->getNumStrings(); // add mode
     if(m_removeMode)
     {
         // Parse the read index from the read id
@@ -64,8 +64,8 @@ RankResult RankProcess::process(const SequenceWorkItem& workItem)
     // Compute the starting rank for the last symbol of w
     char c = w.get(i);
 
-    // In the case that the starting rank is zero (default
-    // in add mode, or if we are removing the first read)
+    // In the case that the starting rank is zero (adding to an
+    // empty index, or if we are removing the first read)
     // there can no occurrence of any characters before this
     // suffix so we just calculate the rank from C(a)
     if(rank == 0)
@@ -10,8 +10,7 @@
 // suffix array can be calculated.
 //
 #include "SampledSuffixArray.h"
-#include "SAReader.h"
-#include "SAWriter.h"
+#include "LexicoIndex.h"
 #include "config.h"
 
 #if HAVE_OPENMP
@@ -26,12 +25,16 @@ static const uint32_t SSA_MAGIC_NUMBER = 12412;
 #define SSA_WRITE_N(x,n) pWriter->write(reinterpret_cast<const char*>(&(x)), (n));
 
 //
-SampledSuffixArray::SampledSuffixArray()
+SampledSuffixArray::SampledSuffixArray() : m_pLexoIndex(NULL), m_sampleRate(0), m_num_strings(0), m_meanSampledSteps(0), m_meanLexoSteps(0)
 {
 
 }
 
-SampledSuffixArray::SampledSuffixArray(const std::string& filename, SSAFileType filetype)
+SampledSuffixArray::SampledSuffixArray(const std::string& filename, SSAFileType filetype) : m_pLexoIndex(NULL),
+                                                                                            m_sampleRate(0),
+                                                                                            m_num_strings(0),
+                                                                                            m_meanSampledSteps(0),
+                                                                                            m_meanLexoSteps(0)
 {
     // Read the sampled suffix array from a file - either from a .ssa or .sai file
     if(filetype == SSA_FT_SSA)
@@ -40,6 +43,33 @@ SampledSuffixArray::SampledSuffixArray(const std::string& filename, SSAFileType
         readSAI(filename);
 }
 
+//
+SampledSuffixArray::~SampledSuffixArray()
+{
+    delete m_pLexoIndex;
+}
+
+//
+SampledSuffixArray* SampledSuffixArray::load(const std::string& ssaFilename, const std::string& saiFilename)
+{
+    // The .ssa file starts with the magic number, the sample rate and the number of reads
+    std::ifstream in(ssaFilename.c_str(), std::ios::in | std::ios::binary);
+    uint32_t magic = 0;
+    int sampleRate = 0;
+    size_t numStrings = 0;
+    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    in.read(reinterpret_cast<char*>(&sampleRate), sizeof(sampleRate));
+    in.read(reinterpret_cast<char*>(&numStrings), sizeof(numStrings));
+
+    if(in && magic == SSA_MAGIC_NUMBER && sampleRate > 0)
+    {
+        size_t saiStrings = 0;
+        if(LexicoIndex::readHeader(saiFilename, saiStrings) && saiStrings == numStrings)
+            return new SampledSuffixArray(ssaFilename, SSA_FT_SSA);
+    }
+    return new SampledSuffixArray(saiFilename, SSA_FT_SAI);
+}
+
 // 
 SAElem SampledSuffixArray::calcSA(int64_t idx, const BWT* pBWT) const
 {
@@ -64,8 +94,8 @@ SAElem SampledSuffixArray::calcSA(int64_t idx, const BWT* pBWT) const
         {
             // idx (before the update) corresponds to the start of a read.
             // We can directly look up the saElem for idx from the lexicographic index
-            assert(idx < (int64_t)m_saLexoIndex.size());
-            elem.setID(m_saLexoIndex[idx]);
+            assert(idx < (int64_t)m_num_strings);
+            elem.setID(lookupLexoRank(idx));
             elem.setPos(0);
             break;
         }
@@ -80,12 +110,6 @@ SAElem SampledSuffixArray::calcSA(int64_t idx, const BWT* pBWT) const
     return elem;
 }
 
-// Returns the ID of the read with lexicographic rank r
-size_t SampledSuffixArray::lookupLexoRank(size_t r) const
-{
-    return m_saLexoIndex[r];
-}
-
 // 
 void SampledSuffixArray::build(const BWT* pBWT, const ReadInfoTable* pRIT, int sampleRate)
 {
@@ -154,27 +178,47 @@ void SampledSuffixArray::build(const BWT* pBWT, const ReadInfoTable* pRIT, int s
     }
 }
 
-// A streamlined version of the above function
-void SampledSuffixArray::buildLexicoIndex(const BWT* pBWT, int num_threads)
+// A streamlined version of the above function that only needs the BWT.
+// As the length of a read is not known until its start is reached, the
+// sampled indices of a read are kept with their distance from the end of
+// the read and are stored once the walk is finished.
+void SampledSuffixArray::buildLexicoIndex(const BWT* pBWT, int num_threads, int sampleRate)
 {
     int64_t numStrings = pBWT->getNumStrings();
     m_saLexoIndex.resize(numStrings);
+    m_num_strings = numStrings;
     int64_t MAX_ELEMS = std::numeric_limits<SSA_INT_TYPE>::max();
     assert(numStrings < MAX_ELEMS);
 
+    m_sampleRate = sampleRate;
+    m_saSamples.clear();
+    if(m_sampleRate > 0)
+        m_saSamples.resize((pBWT->getBWLen() / m_sampleRate) + 1);
+
+    // The total number of calcSA steps over all suffixes, with and without samples
+    double sampledSteps = 0;
+    double lexoSteps = 0;
+
     (void)num_threads;
     // Parallelize this computaiton using openmp, if the compiler supports it
 #if HAVE_OPENMP
     omp_set_num_threads(num_threads);
-    #pragma omp parallel for schedule(guided)
+    #pragma omp parallel for schedule(guided) reduction(+:sampledSteps,lexoSteps)
 #endif
     for(int64_t read_idx = 0; read_idx < numStrings; ++read_idx)
     {
+        // The sampled indices of this read and the number of steps from the end of the read
+        std::vector<std::pair<size_t, size_t> > samples;
+
         // For each read, start from the end of the read and backtrack through the suffix array/BWT
         // to calculate its lexicographic rank in the collection
         size_t idx = read_idx;
+        size_t steps = 0;
         while(1)
         {
+            if(m_sampleRate > 0 && idx % m_sampleRate == 0)
+                samples.push_back(std::make_pair(idx, steps));
+
             char b = pBWT->getChar(idx);
             idx = pBWT->getPC(b) + pBWT->getOcc(b, idx - 1);
             if(b == '$')
@@ -185,7 +229,32 @@ void SampledSuffixArray::buildLexicoIndex(const BWT* pBWT, int num_threads)
                 m_saLexoIndex[idx] = read_idx;
                 break; // done;
             }
+            steps += 1;
+        }
+
+        if(m_sampleRate == 0)
+            continue;
+
+        // steps is now the read length. Each suffix array index is visited by
+        // exactly one read so the samples can also be set without a lock.
+        // calcSA from the suffix at distance k from the end stops at the next
+        // sample, or after reading the '$' at distance steps + 1.
+        size_t next = steps + 1;
+        for(size_t i = samples.size(); i > 0; --i)
+        {
+            size_t k = samples[i - 1].second;
+            m_saSamples[samples[i - 1].first / m_sampleRate] = SAElem(read_idx, steps - k);
+            sampledSteps += (double)(next - k) * (next - k - 1) / 2;
+            next = k;
         }
+        sampledSteps += (double)next * (next + 1) / 2;
+        lexoSteps += (double)(steps + 1) * (steps + 2) / 2;
+    }
+
+    if(m_sampleRate > 0)
+    {
+        m_meanSampledSteps = sampledSteps / pBWT->getBWLen();
+        m_meanLexoSteps = lexoSteps / pBWT->getBWLen();
     }
 }
 
@@ -244,17 +313,12 @@ void SampledSuffixArray::writeSSA(std::string filename)
     delete pWriter;
 }
 
-// Save just the lexicographic index portion of the SSA to disk as plaintext
+// Save just the lexicographic index portion of the SSA to disk
 void SampledSuffixArray::writeLexicoIndex(const std::string& filename)
 {
-    SAWriter writer(filename);
-    size_t num_strings = m_saLexoIndex.size();
-    writer.writeHeader(num_strings, num_strings);
+    LexicoIndexWriter writer(filename, m_saLexoIndex.size());
     for(size_t i = 0; i < m_saLexoIndex.size(); ++i) 
-    {
-        SAElem elem(m_saLexoIndex[i], 0);
-        writer.writeElem(elem);
-    }
+        writer.writeID(m_saLexoIndex[i]);
 }
 
 
@@ -287,20 +351,19 @@ void SampledSuffixArray::readSSA(std::string filename)
     SSA_READ_N(m_saSamples.front(), sizeof(SAElem) * n)
 
     delete pReader;
+    m_num_strings = m_saLexoIndex.size();
 }
 
 void SampledSuffixArray::readSAI(std::string filename)
 {
-    SAReader reader(filename);
-    size_t num_strings, num_elems;
-    reader.readHeader(num_strings, num_elems);
-    assert(num_strings == num_elems);
-    m_saLexoIndex.reserve(num_strings);
-    reader.readElems(m_saLexoIndex);
+    delete m_pLexoIndex;
+    m_pLexoIndex = new LexicoIndex(filename);
+    assert(m_pLexoIndex->getNumStrings() == m_pLexoIndex->getSize());
+    m_saLexoIndex.clear();
 
     // Set the sample rate to zero to signify there are no samples
     m_sampleRate = 0;
-	m_num_strings = num_strings;
+	m_num_strings = m_pLexoIndex->getNumStrings();
 }
 
 // Print memory usage information
@@ -308,11 +371,19 @@ void SampledSuffixArray::printInfo() const
 {
     double mb = (double)(1024*1024);
     double lexoSize = (double)(sizeof(SSA_INT_TYPE) * m_saLexoIndex.capacity()) / mb;
+    size_t lexoEntries = m_saLexoIndex.size();
+    if(m_pLexoIndex != NULL)
+    {
+        lexoSize = (double)(LexicoIndexWriter::getElemBytes(m_num_strings) * m_num_strings) / mb;
+        lexoEntries = m_num_strings;
+    }
     double sampleSize = (double)(sizeof(SAElem) * m_saSamples.capacity()) / mb;
     
     printf("SampledSuffixArray info:\n");
     printf("Sample rate: %d\n", m_sampleRate);
-    printf("Contains %zu entries in lexicographic array (%.1lf MB)\n", m_saLexoIndex.size(), lexoSize);
+    printf("Contains %zu entries in lexicographic array (%.1lf MB)\n", lexoEntries, lexoSize);
     printf("Contains %zu entries in sample array (%.1lf MB)\n", m_saSamples.size(), sampleSize);
     printf("Total size: %.1lf\n", lexoSize + sampleSize);
+    if(m_meanLexoSteps > 0)
+        printf("Mean backtracking steps per lookup: %.1lf (%.1lf without samples)\n", m_meanSampledSteps, m_meanLexoSteps);
 }
@@ -15,6 +15,7 @@
 #include "SuffixArray.h"
 #include "BWT.h"
 #include "ReadInfoTable.h"
+#include "LexicoIndex.h"
 
 typedef uint32_t SSA_INT_TYPE;
 
@@ -30,18 +31,39 @@ class SampledSuffixArray
 
         SampledSuffixArray();
         SampledSuffixArray(const std::string& filename, SSAFileType filetype = SSA_FT_SSA);
+        ~SampledSuffixArray();
+
+        // Load the sampled suffix array from ssaFilename if it was written for the
+        // same reads as the lexicographic index in saiFilename, otherwise load
+        // only the lexicographic index
+        static SampledSuffixArray* load(const std::string& ssaFilename, const std::string& saiFilename);
         
         // Calculate the suffix array element for the given index
         SAElem calcSA(int64_t idx, const BWT* pBWT) const;
 
+        // If the suffix array element for idx is sampled, copy it into elem and return true
+        inline bool getSample(int64_t idx, SAElem& elem) const
+        {
+            if(m_sampleRate > 0 && idx % m_sampleRate == 0 && !m_saSamples[idx / m_sampleRate].isEmpty())
+            {
+                elem = m_saSamples[idx / m_sampleRate];
+                return true;
+            }
+            return false;
+        }
+
         // Returns the ID of the read with lexicographic rank r
-        size_t lookupLexoRank(size_t r) const;
+        inline size_t lookupLexoRank(size_t r) const
+        {
+            return m_pLexoIndex != NULL ? m_pLexoIndex->getID(r) : m_saLexoIndex[r];
+        }
 
         // Construct the sampled SA using the bwt of a set of reads and their lengths
         void build(const BWT* pBWT, const ReadInfoTable* pRIT, int sampleRate = DEFAULT_SA_SAMPLE_RATE);
 
-        // Construct the lexicographic index (.sai) from the BWT
-        void buildLexicoIndex(const BWT* pBWT, int num_threads);
+        // Construct the lexicographic index (.sai) from the BWT. If sampleRate is
+        // positive, every sampleRate-th suffix array element is sampled in the same pass
+        void buildLexicoIndex(const BWT* pBWT, int num_threads, int sampleRate = 0);
 
         // Validate using the full suffix array for the given set of reads. Very slow.
         void validate(std::string readsFile, const BWT* pBWT);
@@ -57,6 +79,9 @@ class SampledSuffixArray
 
     private:
 
+        SampledSuffixArray(const SampledSuffixArray&);
+        SampledSuffixArray& operator=(const SampledSuffixArray&);
+
         // Unsigned integers indicating the start of every read in the
         // sequence collection. These elements are in lexicographic order
         // based on the whole read sequence. Tracing a read backwards through
@@ -68,10 +93,18 @@ class SampledSuffixArray
         // size.
         std::vector<SSA_INT_TYPE> m_saLexoIndex;
 
+        // The lexicographic index mapped from a .sai file, used instead of m_saLexoIndex when set
+        LexicoIndex* m_pLexoIndex;
+
         static const int DEFAULT_SA_SAMPLE_RATE = 64;
         int m_sampleRate;
         SAElemVector m_saSamples;
 		size_t m_num_strings;
+
+        // The mean number of backtracking steps calcSA takes with the
+        // samples and with the lexicographic index only, set by buildLexicoIndex
+        double m_meanSampledSteps;
+        double m_meanLexoSteps;
 };
 
 #endif
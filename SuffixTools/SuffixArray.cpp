@@ -15,6 +15,7 @@
 #include "Timer.h"
 #include "SAReader.h"
 #include "SAWriter.h"
+#include "LexicoIndex.h"
 #include "BWTWriter.h"
 
 // Read a suffix array from a file
@@ -193,12 +194,11 @@ void SuffixArray::writeBWT(const std::string& filename, const ReadTable* pRT)
 // write the index of the suffix array to a file
 void SuffixArray::writeIndex(std::string& filename)
 {
-    SAWriter writer(filename);
-    writer.writeHeader(m_numStrings, m_numStrings);
+    LexicoIndexWriter writer(filename, m_numStrings);
     for(size_t i = 0; i < m_data.size(); ++i)
     {
         if(m_data[i].isFull())
-            writer.writeElem(m_data[i]);
+            writer.writeID(m_data[i].getID());
     }
 }
 
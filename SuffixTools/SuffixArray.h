@@ -54,7 +54,7 @@ class SuffixArray
         // Output the suffix array index
         // The suffix array index are the full-length suffixes (the entire string)
         // of the suffix array, sorted into lexographical order
-        // The file format is the same as the suffix array
+        // The file is written in the binary format of LexicoIndex
         // This is used during the BWT indexing and is the only part of the
         // suffix array that we need
         void writeIndex(std::string& filename);
@@ -181,13 +181,13 @@ typedef const uint8_t *cstr_t;
 
 #define rope_comp6(c) ((c) >= 1 && (c) <= 4? 5 - (c) : (c))
 
-static void mr_insert_multi_aux(rope_t *rope, int64_t m, triple64_t *a, int is_comp)
+static void mr_insert_multi_aux(rope_t *rope, int64_t m, triple64_t *a, int is_comp, int step)
 {
 	int64_t k, beg;
 	rpcache_t cache;
 	memset(&cache, 0, sizeof(rpcache_t));
 	for (k = 0; k != m; ++k) // set the base to insert
-		a[k].c = *a[k].p++;
+		a[k].c = *a[k].p, a[k].p += step;
 	for (k = 1, beg = 0; k <= m; ++k) {
 		if (k == m || a[k].u != a[k-1].u) {
 			int64_t x, i, l = a[beg].l, u = a[beg].u, tl[6], tu[6], c[6];
@@ -237,7 +237,7 @@ typedef struct {
 	volatile int to_run;
 	int to_exit;
 	mrope_t *mr;
-	int b, is_comp;
+	int b, is_comp, step;
 	int64_t m;
 	triple64_t *a;
 } worker_t;
@@ -249,16 +249,16 @@ static void *worker(void *data)
 	req.tv_sec = 0; req.tv_nsec = 1000000;
 	do {
 		while (!__sync_bool_compare_and_swap(&w->to_run, 1, 0)) nanosleep(&req, &rem); // wait for the signal from the master thread
-		if (w->m) mr_insert_multi_aux(w->mr->r[w->b], w->m, w->a, w->is_comp);
+		if (w->m) mr_insert_multi_aux(w->mr->r[w->b], w->m, w->a, w->is_comp, w->step);
 		__sync_add_and_fetch(w->n_fin_workers, 1);
 	} while (!w->to_exit);
 	return 0;
 }
 
-void mr_insert_multi(mrope_t *mr, int64_t len, const uint8_t *s, int is_thr)
+static void mr_insert_multi_core(mrope_t *mr, int64_t len, const uint8_t *s, int is_thr, int is_rev)
 {
 	int64_t k, m, n0;
-	int b, is_srt = (mr->so != MR_SO_IO), is_comp = (mr->so == MR_SO_RCLO), stop_thr = 0;
+	int b, is_srt = (mr->so != MR_SO_IO), is_comp = (mr->so == MR_SO_RCLO), stop_thr = 0, step = is_rev? -1 : 1;
 	volatile int n_fin_workers = 0;
 	triple64_t *a[2], *curr, *prev, *swap;
 	pthread_t *tid = 0;
@@ -266,14 +266,18 @@ void mr_insert_multi(mrope_t *mr, int64_t len, const uint8_t *s, int is_thr)
 
 	if (mr->thr_min < 0) mr->thr_min = 0;
 	assert(len > 0 && s[len-1] == 0);
+	if (is_rev) { // the strings are read backwards from their sentinel to the preceding one
+		assert(s[0] == 0);
+		++s, --len;
+	}
 	{ // split into short strings
 		cstr_t p, q, end = s + len;
 		for (p = s, m = 0; p != end; ++p) // count #sentinels
 			if (*p == 0) ++m;
 		curr = a[0] = malloc(m * sizeof(triple64_t));
 		prev = a[1] = malloc(m * sizeof(triple64_t));
-		for (p = q = s, k = 0; p != end; ++p) // find the start of each string
-			if (*p == 0) prev[k++].p = q, q = p + 1;
+		for (p = q = s, k = 0; p != end; ++p) // find the start (or the end) of each string
+			if (*p == 0) prev[k++].p = is_rev? p - 1 : q, q = p + 1;
 	}
 
 	for (k = n0 = 0; k < 6; ++k) n0 += mr->r[k]->c[0];
@@ -282,14 +286,14 @@ void mr_insert_multi(mrope_t *mr, int64_t len, const uint8_t *s, int is_thr)
 		else prev[k].l = prev[k].u = n0 + k;
 		prev[k].c = 0;
 	}
-	mr_insert_multi_aux(mr->r[0], m, prev, is_comp); // insert the first (actually the last) column
+	mr_insert_multi_aux(mr->r[0], m, prev, is_comp, step); // insert the first (actually the last) column
 
 	if (is_thr) {
 		tid = alloca(4 * sizeof(pthread_t));
 		w = alloca(4 * sizeof(worker_t));
 		memset(w, 0, 4 * sizeof(worker_t));
 		for (b = 0; b < 4; ++b) {
-			w[b].mr = mr, w[b].b = b + 1, w[b].is_comp = is_comp;
+			w[b].mr = mr, w[b].b = b + 1, w[b].is_comp = is_comp, w[b].step = step;
 			w[b].n_fin_workers = &n_fin_workers;
 		}
 		for (b = 0; b < 4; ++b) pthread_create(&tid[b], 0, worker, &w[b]);
@@ -318,14 +322,14 @@ void mr_insert_multi(mrope_t *mr, int64_t len, const uint8_t *s, int is_thr)
 				if (stop_thr) w[b].to_exit = 1; // signal the workers to exit
 				while (!__sync_bool_compare_and_swap(&w[b].to_run, 0, 1)); // signal the workers to start
 			}
-			if (c[5]) mr_insert_multi_aux(mr->r[5], c[5], q[5], is_comp); // the master thread processes the "N" bucket
+			if (c[5]) mr_insert_multi_aux(mr->r[5], c[5], q[5], is_comp, step); // the master thread processes the "N" bucket
 			while (!__sync_bool_compare_and_swap(&n_fin_workers, 4, 0)) // wait until all 4 workers finish
 				nanosleep(&req, &rem);
 			//if (stop_thr && n0 < m)
 				//fprintf(stderr, "[M::%s] Turn off parallelization for this batch as too few strings are left.\n", __func__);
 		} else {
 			for (b = 1; b < 6; ++b)
-				if (c[b]) mr_insert_multi_aux(mr->r[b], c[b], q[b], is_comp);
+				if (c[b]) mr_insert_multi_aux(mr->r[b], c[b], q[b], is_comp, step);
 		}
 		if (n0 == m) break;
 
@@ -343,3 +347,13 @@ void mr_insert_multi(mrope_t *mr, int64_t len, const uint8_t *s, int is_thr)
 	if (is_thr) for (b = 0; b < 4; ++b) pthread_join(tid[b], 0);
 	free(a[0]); free(a[1]);
 }
+
+void mr_insert_multi(mrope_t *mr, int64_t len, const uint8_t *s, int is_thr)
+{
+	mr_insert_multi_core(mr, len, s, is_thr, 0);
+}
+
+void mr_insert_multi_rev(mrope_t *mr, int64_t len, const uint8_t *s, int is_thr)
+{
+	mr_insert_multi_core(mr, len, s, is_thr, 1);
+}
@@ -54,6 +54,18 @@ extern "C" {
 	 */
 	void mr_insert_multi(mrope_t *mr, int64_t len, const uint8_t *s, int is_thr);
 
+	/**
+	 * Insert multiple strings given in their input orientation. The buffer
+	 * is only read, so it can be shared with an mr_insert_multi() of the
+	 * same strings into the index of the reversed strings.
+	 *
+	 * @param mr       multi-rope
+	 * @param len      total length of $s
+	 * @param s        NULL, then the concatenated, NULL delimited input strings
+	 * @param is_thr   true to use 5 threads
+	 */
+	void mr_insert_multi_rev(mrope_t *mr, int64_t len, const uint8_t *s, int is_thr);
+
 	void mr_rank2a(const mrope_t *mr, int64_t x, int64_t y, int64_t *cx, int64_t *cy);
 	#define mr_rank1a(mr, x, cx) mr_rank2a(mr, x, -1, cx, 0)
 
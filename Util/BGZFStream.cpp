@@ -0,0 +1,322 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// BGZFStream - Output stream writing gzip files in
+// independently compressed blocks
+//
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <stdint.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "BGZFStream.h"
+
+// The uncompressed size of a block. A block that does not compress is
+// stored, which still fits the 64KB limit on the size of a BGZF block
+static const size_t BLOCK_SIZE = 0xff00;
+static const size_t MAX_BLOCK_SIZE = 0x10000;
+
+// The gzip header with the BGZF extra field holding the size of the block, and the footer
+static const size_t HEADER_SIZE = 18;
+static const size_t FOOTER_SIZE = 8;
+
+// The empty block that marks the end of a BGZF file
+static const unsigned char EOF_BLOCK[28] = { 0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43,
+                                             0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+
+// The number of threads compressing the blocks of all the streams
+static const int MAX_THREADS = 4;
+
+int BGZFStreamBuf::s_defaultLevel = Z_DEFAULT_COMPRESSION;
+
+size_t BGZFStreamBuf::s_numPoolThreads = 0;
+bool BGZFStreamBuf::s_isPoolStarted = false;
+std::deque<BGZFStreamBuf::Block*> BGZFStreamBuf::s_pendingBlocks;
+pthread_mutex_t BGZFStreamBuf::s_poolMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t BGZFStreamBuf::s_workCond = PTHREAD_COND_INITIALIZER;
+pthread_cond_t BGZFStreamBuf::s_doneCond = PTHREAD_COND_INITIALIZER;
+
+//
+static inline void packInt(char* pOut, uint32_t value, int numBytes)
+{
+    for(int i = 0; i < numBytes; ++i)
+        pOut[i] = (char)((value >> (8 * i)) & 0xff);
+}
+
+//
+BGZFStreamBuf::BGZFStreamBuf() : m_pFile(NULL), m_level(s_defaultLevel), m_isParallel(false)
+{
+
+}
+
+//
+BGZFStreamBuf::~BGZFStreamBuf()
+{
+    close();
+}
+
+//
+void BGZFStreamBuf::setDefaultLevel(int level)
+{
+    s_defaultLevel = level;
+}
+
+//
+int BGZFStreamBuf::getDefaultLevel()
+{
+    return s_defaultLevel;
+}
+
+//
+bool BGZFStreamBuf::open(const std::string& filename, int level)
+{
+    if(m_pFile != NULL)
+        return false;
+
+    m_pFile = fopen(filename.c_str(), "wb");
+    if(m_pFile == NULL)
+        return false;
+
+    m_filename = filename;
+    m_level = level;
+    m_buffer.resize(BLOCK_SIZE);
+    setp(&m_buffer[0], &m_buffer[0] + BLOCK_SIZE);
+    return true;
+}
+
+// Write the last block and the end of file marker
+void BGZFStreamBuf::close()
+{
+    if(m_pFile == NULL)
+        return;
+
+    submitBlock();
+    writeBlocks(true);
+    m_isParallel = false;
+
+    writeData(std::string((const char*)EOF_BLOCK, sizeof(EOF_BLOCK)));
+    if(fclose(m_pFile) != 0)
+    {
+        std::cerr << "Error: could not write " << m_filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+    m_pFile = NULL;
+    setp(NULL, NULL);
+}
+
+//
+int BGZFStreamBuf::overflow(int c)
+{
+    if(m_pFile == NULL)
+        return EOF;
+
+    submitBlock();
+    if(c != EOF)
+    {
+        *pptr() = (char)c;
+        pbump(1);
+    }
+    return c == EOF ? 0 : c;
+}
+
+// A flush does not end the block, which would ruin the compression of
+// streams flushed on every line. Only the blocks already compressed are written
+int BGZFStreamBuf::sync()
+{
+    if(m_pFile == NULL)
+        return -1;
+
+    writeBlocks(false);
+    return 0;
+}
+
+// The threads are detached and wait for blocks until the process exits
+size_t BGZFStreamBuf::startPool()
+{
+    pthread_mutex_lock(&s_poolMutex);
+    if(!s_isPoolStarted)
+    {
+        s_isPoolStarted = true;
+        long numCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+        int numThreads = std::min(MAX_THREADS, (int)numCPUs - 1);
+        for(int i = 0; i < numThreads; ++i)
+        {
+            pthread_t thread;
+            if(pthread_create(&thread, NULL, &BGZFStreamBuf::runCompress, NULL) != 0)
+                break;
+            pthread_detach(thread);
+            ++s_numPoolThreads;
+        }
+    }
+    size_t numThreads = s_numPoolThreads;
+    pthread_mutex_unlock(&s_poolMutex);
+    return numThreads;
+}
+
+// Hand the data written since the last block to the threads
+void BGZFStreamBuf::submitBlock()
+{
+    size_t size = pptr() - pbase();
+    if(size == 0)
+        return;
+
+    Block* pBlock = new Block(this);
+    m_buffer.resize(size);
+    pBlock->data.swap(m_buffer);
+    m_buffer.resize(BLOCK_SIZE);
+    setp(&m_buffer[0], &m_buffer[0] + BLOCK_SIZE);
+
+    // The pool is used once the first block is full so small files are compressed by the caller
+    if(!m_isParallel && size == BLOCK_SIZE)
+        m_isParallel = startPool() > 0;
+
+    if(!m_isParallel)
+    {
+        compressBlock(pBlock);
+        writeData(pBlock->compressedData);
+        delete pBlock;
+        return;
+    }
+
+    pthread_mutex_lock(&s_poolMutex);
+    m_blocks.push_back(pBlock);
+    s_pendingBlocks.push_back(pBlock);
+    pthread_cond_signal(&s_workCond);
+    pthread_mutex_unlock(&s_poolMutex);
+    writeBlocks(false);
+}
+
+// Write the compressed blocks at the front of the queue. If wait is
+// set every block is written, otherwise the caller only waits while
+// the threads are too far behind
+void BGZFStreamBuf::writeBlocks(bool wait)
+{
+    size_t maxQueued = 2 * s_numPoolThreads;
+    while(true)
+    {
+        Block* pBlock = NULL;
+        pthread_mutex_lock(&s_poolMutex);
+        while(!m_blocks.empty() && !m_blocks.front()->compressed && (wait || m_blocks.size() > maxQueued))
+            pthread_cond_wait(&s_doneCond, &s_poolMutex);
+
+        if(!m_blocks.empty() && m_blocks.front()->compressed)
+        {
+            pBlock = m_blocks.front();
+            m_blocks.pop_front();
+        }
+        pthread_mutex_unlock(&s_poolMutex);
+
+        if(pBlock == NULL)
+            return;
+
+        writeData(pBlock->compressedData);
+        delete pBlock;
+    }
+}
+
+//
+void BGZFStreamBuf::writeData(const std::string& data)
+{
+    if(fwrite(data.data(), 1, data.size(), m_pFile) != data.size())
+    {
+        std::cerr << "Error: could not write " << m_filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Compress the oldest block of any stream
+void* BGZFStreamBuf::runCompress(void* /*pArg*/)
+{
+    while(true)
+    {
+        pthread_mutex_lock(&s_poolMutex);
+        while(s_pendingBlocks.empty())
+            pthread_cond_wait(&s_workCond, &s_poolMutex);
+        Block* pBlock = s_pendingBlocks.front();
+        s_pendingBlocks.pop_front();
+        pthread_mutex_unlock(&s_poolMutex);
+
+        pBlock->pOwner->compressBlock(pBlock);
+
+        pthread_mutex_lock(&s_poolMutex);
+        pBlock->compressed = true;
+        pthread_cond_broadcast(&s_doneCond);
+        pthread_mutex_unlock(&s_poolMutex);
+    }
+    return NULL;
+}
+
+// Compress the block into a gzip member with the BGZF extra field
+void BGZFStreamBuf::compressBlock(Block* pBlock) const
+{
+    const std::string& in = pBlock->data;
+    std::string& out = pBlock->compressedData;
+    int level = m_level;
+    size_t compressedSize = 0;
+    while(true)
+    {
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        if(deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            std::cerr << "Error: could not initialize the compression of " << m_filename << "\n";
+            exit(EXIT_FAILURE);
+        }
+
+        size_t bound = deflateBound(&zs, in.size());
+        out.resize(HEADER_SIZE + bound + FOOTER_SIZE);
+        zs.next_in = (Bytef*)in.data();
+        zs.avail_in = in.size();
+        zs.next_out = (Bytef*)&out[HEADER_SIZE];
+        zs.avail_out = bound;
+        int ret = deflate(&zs, Z_FINISH);
+        compressedSize = zs.total_out;
+        deflateEnd(&zs);
+
+        if(ret != Z_STREAM_END)
+        {
+            std::cerr << "Error: could not compress the data of " << m_filename << "\n";
+            exit(EXIT_FAILURE);
+        }
+
+        // Store the data of a block that does not compress enough to fit
+        if(HEADER_SIZE + compressedSize + FOOTER_SIZE <= MAX_BLOCK_SIZE || level == 0)
+            break;
+        level = 0;
+    }
+
+    size_t blockSize = HEADER_SIZE + compressedSize + FOOTER_SIZE;
+    out.resize(blockSize);
+
+    static const unsigned char header[16] = { 0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00,
+                                              0x00, 0xff, 0x06, 0x00, 0x42, 0x43, 0x02, 0x00 };
+    memcpy(&out[0], header, sizeof(header));
+    packInt(&out[16], blockSize - 1, 2);
+
+    uint32_t crc = crc32(crc32(0L, NULL, 0), (const Bytef*)in.data(), in.size());
+    packInt(&out[HEADER_SIZE + compressedSize], crc, 4);
+    packInt(&out[HEADER_SIZE + compressedSize + 4], in.size(), 4);
+}
+
+//
+BGZFOutputStream::BGZFOutputStream(const std::string& filename, int level) : std::ostream(NULL)
+{
+    rdbuf(&m_buf);
+    if(!m_buf.open(filename, level))
+        setstate(std::ios::failbit);
+}
+
+//
+BGZFOutputStream::~BGZFOutputStream()
+{
+    m_buf.close();
+}
+
+//
+void BGZFOutputStream::close()
+{
+    m_buf.close();
+}
@@ -0,0 +1,103 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// BGZFStream - Output stream writing gzip files in
+// independently compressed blocks, in the layout of
+// BGZF. Each block is a complete gzip member so the
+// files are read by any gzip reader, including igzstream.
+// The blocks are compressed while the caller keeps writing,
+// on one small pool of threads shared by all the streams of
+// the process.
+//
+#ifndef BGZFSTREAM_H
+#define BGZFSTREAM_H
+
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <pthread.h>
+
+class BGZFStreamBuf : public std::streambuf
+{
+    public:
+        BGZFStreamBuf();
+        ~BGZFStreamBuf();
+
+        bool open(const std::string& filename, int level);
+        void close();
+        bool is_open() const { return m_pFile != NULL; }
+
+        // The compression level of the streams opened from now on, -1 for the zlib default
+        static void setDefaultLevel(int level);
+        static int getDefaultLevel();
+
+    protected:
+        virtual int overflow(int c);
+        virtual int sync();
+
+    private:
+
+        // A block of the file, compressed by one of the threads
+        struct Block
+        {
+            Block(const BGZFStreamBuf* pOwner) : pOwner(pOwner), compressed(false) {}
+
+            const BGZFStreamBuf* pOwner;
+            std::string data;
+            std::string compressedData;
+            bool compressed;
+        };
+
+        BGZFStreamBuf(const BGZFStreamBuf&);
+        BGZFStreamBuf& operator=(const BGZFStreamBuf&);
+
+        void submitBlock();
+        void writeBlocks(bool wait);
+        void writeData(const std::string& data);
+
+        // Start the pool on first use, returns its number of threads
+        static size_t startPool();
+        static void* runCompress(void* pArg);
+        void compressBlock(Block* pBlock) const;
+
+        static int s_defaultLevel;
+
+        // The compressor pool. The blocks of every stream wait in one queue,
+        // and the streams wait on s_doneCond for their blocks to finish
+        static size_t s_numPoolThreads;
+        static bool s_isPoolStarted;
+        static std::deque<Block*> s_pendingBlocks;
+        static pthread_mutex_t s_poolMutex;
+        static pthread_cond_t s_workCond;
+        static pthread_cond_t s_doneCond;
+
+        std::string m_filename;
+        FILE* m_pFile;
+        int m_level;
+        std::string m_buffer;
+
+        // The blocks are written in order once compressed. Until the first
+        // block is full, or without a pool, the caller compresses every block itself
+        std::deque<Block*> m_blocks;
+        bool m_isParallel;
+};
+
+//
+class BGZFOutputStream : public std::ostream
+{
+    public:
+        BGZFOutputStream(const std::string& filename, int level = BGZFStreamBuf::getDefaultLevel());
+        ~BGZFOutputStream();
+
+        bool is_open() const { return m_buf.is_open(); }
+        void close();
+
+    private:
+        BGZFStreamBuf m_buf;
+};
+
+#endif
@@ -44,6 +44,13 @@ DNAString& DNAString::operator=(const std::string& str)
     return *this;
 }
 
+//
+void DNAString::assign(const char* pData, size_t l)
+{
+    _dealloc();
+    _alloc(pData, l);
+}
+
 //
 bool DNAString::operator==(const DNAString& other)
 {
@@ -12,6 +12,7 @@
 #define DNASTRING_H
 #include <string.h>
 #include <string>
+#include <algorithm>
 #include <assert.h> 
 
 class DNAString
@@ -29,6 +30,16 @@ class DNAString
         DNAString& operator=(const std::string& str);
         bool operator==(const DNAString& other);
 
+        // Copy the l characters at pData into the string
+        void assign(const char* pData, size_t l);
+
+        // Exchange the contents of the strings without copying them
+        void swap(DNAString& other)
+        {
+            std::swap(m_len, other.m_len);
+            std::swap(m_data, other.m_data);
+        }
+
         size_t length() const
         {
             return m_len;
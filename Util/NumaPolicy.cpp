@@ -0,0 +1,227 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// NumaPolicy - Placement of the FM-index and the worker
+// threads on the NUMA nodes
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "NumaPolicy.h"
+
+// The memory policies of set_mempolicy(2), which glibc does not wrap
+static const int NUMA_MPOL_DEFAULT = 0;
+static const int NUMA_MPOL_INTERLEAVE = 3;
+
+static const char* NODE_SYSFS_PATH = "/sys/devices/system/node";
+
+namespace NumaPolicy
+{
+
+static bool s_isEnabled = false;
+static int s_hasWarned = 0;
+
+// The CPUs of each online node. The nodes are numbered in the order of their IDs
+struct Topology
+{
+    Topology();
+
+    std::vector<int> nodeIDs;
+    std::vector<std::vector<int> > nodeCPUs;
+    std::vector<size_t> cpuNodes;
+};
+
+// Parse a sysfs list such as 0-3,8-11
+static std::vector<int> parseList(const std::string& text)
+{
+    std::vector<int> out;
+    std::stringstream parser(text);
+    std::string range;
+    while(std::getline(parser, range, ','))
+    {
+        int first = -1, last = -1;
+        int numFields = sscanf(range.c_str(), "%d-%d", &first, &last);
+        if(numFields < 1 || first < 0)
+            continue;
+        if(numFields < 2)
+            last = first;
+        for(int i = first; i <= last; ++i)
+            out.push_back(i);
+    }
+    return out;
+}
+
+static std::string readLine(const std::string& filename)
+{
+    std::ifstream in(filename.c_str());
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+Topology::Topology()
+{
+    std::vector<int> online = parseList(readLine(std::string(NODE_SYSFS_PATH) + "/online"));
+    for(size_t i = 0; i < online.size(); ++i)
+    {
+        std::stringstream filename;
+        filename << NODE_SYSFS_PATH << "/node" << online[i] << "/cpulist";
+        std::vector<int> cpus = parseList(readLine(filename.str()));
+
+        // Nodes with memory only do not run threads
+        if(cpus.empty())
+            continue;
+        nodeIDs.push_back(online[i]);
+        nodeCPUs.push_back(cpus);
+    }
+
+    if(nodeCPUs.empty())
+    {
+        long numCPUs = sysconf(_SC_NPROCESSORS_CONF);
+        nodeIDs.push_back(0);
+        nodeCPUs.push_back(std::vector<int>());
+        for(long i = 0; i < numCPUs; ++i)
+            nodeCPUs.back().push_back(i);
+    }
+
+    for(size_t node = 0; node < nodeCPUs.size(); ++node)
+    {
+        for(size_t i = 0; i < nodeCPUs[node].size(); ++i)
+        {
+            size_t cpu = nodeCPUs[node][i];
+            if(cpu >= cpuNodes.size())
+                cpuNodes.resize(cpu + 1, 0);
+            cpuNodes[cpu] = node;
+        }
+    }
+}
+
+static const Topology& getTopology()
+{
+    static Topology topology;
+    return topology;
+}
+
+// Print a warning the first time the placement fails
+static void warnOnce(const char* what)
+{
+    if(__sync_bool_compare_and_swap(&s_hasWarned, 0, 1))
+        std::cerr << "Warning: " << what << " failed, the NUMA mode is not fully in effect\n";
+}
+
+//
+void enable()
+{
+    s_isEnabled = true;
+    printf("NUMA mode: %zu nodes, the index is interleaved and the workers are pinned\n", getNumNodes());
+}
+
+//
+bool isEnabled()
+{
+    return s_isEnabled;
+}
+
+//
+size_t getNumNodes()
+{
+    return getTopology().nodeCPUs.size();
+}
+
+//
+size_t getCurrentNode()
+{
+    const Topology& topology = getTopology();
+    int cpu = sched_getcpu();
+    return cpu >= 0 && (size_t)cpu < topology.cpuNodes.size() ? topology.cpuNodes[cpu] : 0;
+}
+
+//
+void pinWorker(size_t worker)
+{
+    if(!s_isEnabled)
+        return;
+
+    const std::vector<int>& cpus = getTopology().nodeCPUs[worker % getNumNodes()];
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for(size_t i = 0; i < cpus.size(); ++i)
+        CPU_SET(cpus[i], &cpuSet);
+    if(pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0)
+        warnOnce("pinning a worker thread");
+}
+
+//
+WorkerPinScope::WorkerPinScope(size_t worker) : m_isPinned(false)
+{
+    if(!s_isEnabled)
+        return;
+
+    if(pthread_getaffinity_np(pthread_self(), sizeof(m_previousCPUs), &m_previousCPUs) != 0)
+    {
+        warnOnce("reading the CPUs of a worker thread");
+        return;
+    }
+    pinWorker(worker);
+    m_isPinned = true;
+}
+
+//
+WorkerPinScope::~WorkerPinScope()
+{
+    if(m_isPinned && pthread_setaffinity_np(pthread_self(), sizeof(m_previousCPUs), &m_previousCPUs) != 0)
+        warnOnce("unpinning a worker thread");
+}
+
+//
+void touchPages(const void* ptr, size_t bytes)
+{
+    const volatile char* pData = static_cast<const volatile char*>(ptr);
+    size_t pageBytes = sysconf(_SC_PAGESIZE);
+    for(size_t i = 0; i < bytes; i += pageBytes)
+        (void)pData[i];
+}
+
+//
+InterleaveScope::InterleaveScope() : m_isActive(false)
+{
+    if(!s_isEnabled || getNumNodes() < 2)
+        return;
+
+    const std::vector<int>& nodeIDs = getTopology().nodeIDs;
+    size_t bitsPerWord = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> nodeMask(nodeIDs.back() / bitsPerWord + 1, 0);
+    for(size_t i = 0; i < nodeIDs.size(); ++i)
+        nodeMask[nodeIDs[i] / bitsPerWord] |= 1UL << (nodeIDs[i] % bitsPerWord);
+
+    m_isActive = syscall(SYS_set_mempolicy, NUMA_MPOL_INTERLEAVE, &nodeMask[0], nodeMask.size() * bitsPerWord + 1) == 0;
+    if(!m_isActive)
+        warnOnce("interleaving the index");
+}
+
+//
+InterleaveScope::~InterleaveScope()
+{
+    if(m_isActive)
+        syscall(SYS_set_mempolicy, NUMA_MPOL_DEFAULT, NULL, 0);
+}
+
+//
+void NodeCounts::print(const char* itemName, double wallTime) const
+{
+    const char* mode = s_isEnabled ? "pinned" : "unpinned";
+    for(size_t i = 0; i < m_counts.size(); ++i)
+        printf("NUMA node %zu (%s): %zu %s (%lf %s/s)\n", i, mode, m_counts[i], itemName,
+                wallTime > 0 ? m_counts[i] / wallTime : 0.0, itemName);
+}
+
+};
@@ -0,0 +1,100 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// NumaPolicy - Placement of the FM-index and the worker
+// threads on the NUMA nodes. In the NUMA mode the pages of
+// an index loaded within an InterleaveScope are spread over
+// the nodes, so the rank lookups of every socket are remote
+// in the same share instead of all but one socket paying for
+// them, and worker i is pinned to the CPUs of node i modulo
+// the number of nodes. The nodes are read from sysfs; without
+// it the machine is taken as a single node.
+//
+#ifndef NUMAPOLICY_H
+#define NUMAPOLICY_H
+
+#include <stddef.h>
+#include <sched.h>
+#include <vector>
+
+namespace NumaPolicy
+{
+
+// Turn on the NUMA mode for the indices loaded and the threads started from now on
+void enable();
+bool isEnabled();
+
+size_t getNumNodes();
+
+// The node of the CPU the calling thread runs on
+size_t getCurrentNode();
+
+// Pin the calling thread to the CPUs of node worker modulo the number of nodes. Does nothing
+// unless the NUMA mode is on. Threads created by the pinned thread inherit its CPUs, so this
+// is meant for worker threads that do not outlive their work
+void pinWorker(size_t worker);
+
+// Pin the calling thread as pinWorker does for the lifetime of the scope, then give it back the
+// CPUs it had before. For the threads of an OpenMP region, which include the calling thread
+// and are kept for later regions
+class WorkerPinScope
+{
+    public:
+        WorkerPinScope(size_t worker);
+        ~WorkerPinScope();
+
+    private:
+        WorkerPinScope(const WorkerPinScope&);
+        WorkerPinScope& operator=(const WorkerPinScope&);
+
+        bool m_isPinned;
+        cpu_set_t m_previousCPUs;
+};
+
+// Fault in the pages of a mapped file, so that they are placed by the current policy of the
+// calling thread instead of by the first worker touching them. Pages already in the page cache
+// stay where they are
+void touchPages(const void* ptr, size_t bytes);
+
+// In the NUMA mode, interleave the pages the calling thread allocates over the nodes for the
+// lifetime of the scope
+class InterleaveScope
+{
+    public:
+        InterleaveScope();
+        ~InterleaveScope();
+
+    private:
+        InterleaveScope(const InterleaveScope&);
+        InterleaveScope& operator=(const InterleaveScope&);
+
+        bool m_isActive;
+};
+
+// The work items processed on each node, to report the throughput per socket
+class NodeCounts
+{
+    public:
+        NodeCounts() : m_counts(getNumNodes(), 0) {}
+
+        void add(size_t node, size_t count) { m_counts[node] += count; }
+
+        NodeCounts& operator+=(const NodeCounts& other)
+        {
+            for(size_t i = 0; i < m_counts.size(); ++i)
+                m_counts[i] += other.m_counts[i];
+            return *this;
+        }
+
+        // Print the items and the items per second of each node over a run of wallTime seconds
+        void print(const char* itemName, double wallTime) const;
+
+    private:
+        std::vector<size_t> m_counts;
+};
+
+};
+
+#endif
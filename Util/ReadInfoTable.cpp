@@ -10,6 +10,7 @@
 //
 #include <iostream>
 #include <algorithm>
+#include <limits>
 #include "ReadInfoTable.h"
 #include "SeqReader.h"
 
@@ -99,9 +100,59 @@ size_t ReadInfoTable::countSumLengths() const
     return sum;
 }
 
+// Order read indices by the IDs of the reads
+struct ReadIDLess
+{
+    ReadIDLess(const ReadInfoTable* pTable, const std::vector<std::string>* pIDs) : pTable(pTable), pIDs(pIDs) {}
+
+    bool operator()(size_t a, size_t b) const
+    {
+        if(!pIDs->empty())
+            return (*pIDs)[a] < (*pIDs)[b];
+        return pTable->getReadID(a) < pTable->getReadID(b);
+    }
+
+    const ReadInfoTable* pTable;
+    const std::vector<std::string>* pIDs;
+};
+
+//
+void ReadInfoTable::buildNameRanks()
+{
+    size_t numReads = m_lengths.size();
+    if(numReads > std::numeric_limits<uint32_t>::max())
+    {
+        std::cerr << "Error: cannot rank more than " << std::numeric_limits<uint32_t>::max() << " read IDs\n";
+        exit(1);
+    }
+
+    std::vector<uint32_t> order(numReads);
+    for(size_t i = 0; i < numReads; ++i)
+        order[i] = i;
+    ReadIDLess idLess(this, &m_ids);
+    std::sort(order.begin(), order.end(), idLess);
+
+    m_nameRanks.resize(numReads);
+    uint32_t rank = 0;
+    for(size_t i = 0; i < numReads; ++i)
+    {
+        if(i > 0 && idLess(order[i - 1], order[i]))
+            ++rank;
+        m_nameRanks[order[i]] = rank;
+    }
+}
+
+//
+uint32_t ReadInfoTable::getNameRank(size_t idx) const
+{
+    assert(idx < m_nameRanks.size());
+    return m_nameRanks[idx];
+}
+
 //
 void ReadInfoTable::clear()
 {
     m_lengths.clear();
     m_ids.clear();
+    m_nameRanks.clear();
 }
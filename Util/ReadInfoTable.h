@@ -49,6 +49,11 @@ class ReadInfoTable
         size_t getCount() const;
         size_t countSumLengths() const;
         void clear();
+
+        // Rank the reads by ID, so that two reads can be ordered by name without comparing
+        // strings. Reads with the same ID share a rank
+        void buildNameRanks();
+        uint32_t getNameRank(size_t idx) const;
 		
 		//Contig ID methods
 		void addVertex(size_t idx, Vertex* pVertex, ReadOnContig roc) ;
@@ -58,6 +63,7 @@ class ReadInfoTable
 
         std::vector<int> m_lengths;
         std::vector<std::string> m_ids;
+        std::vector<uint32_t> m_nameRanks;
 		
         bool m_numericIDs;
 };
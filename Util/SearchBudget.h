@@ -0,0 +1,36 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// SearchBudget - The cost allowed for the search of one
+// work item, counted in the steps of the search engine,
+// such as the leaves expanded or the LF-mapping steps.
+// A limit of 0 does not bound the search.
+//
+#ifndef SEARCHBUDGET_H
+#define SEARCHBUDGET_H
+
+#include <stddef.h>
+
+class SearchBudget
+{
+    public:
+        SearchBudget(size_t limit) : m_limit(limit), m_used(0) {}
+
+        // Count steps of the search. Returns false once the budget is exceeded
+        bool spend(size_t steps)
+        {
+            m_used += steps;
+            return !isExceeded();
+        }
+
+        bool isExceeded() const { return m_limit != 0 && m_used > m_limit; }
+        size_t getUsed() const { return m_used; }
+
+    private:
+        size_t m_limit;
+        size_t m_used;
+};
+
+#endif
@@ -0,0 +1,604 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// SeqBlockReader - Parse fasta or fastq files in large
+// blocks on a pipeline of threads
+//
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include "SeqBlockReader.h"
+#include "SeqReader.h"
+
+// The size of the blocks read from the file
+static const size_t BLOCK_SIZE = 4 << 20;
+
+// The number of blocks read ahead of the splitter
+static const size_t MAX_BLOCKS = 4;
+
+// The number of threads parsing chunks
+static const int MAX_PARSE_THREADS = 4;
+
+// The warnings of malformed fastq records are shared by every reader
+static int fastq_warn_count = 0;
+static const int MAX_WARN = 10;
+
+enum ParseStatus
+{
+    PS_RECORD, // a record was parsed
+    PS_INVALID, // a malformed record was found, which ends the input
+    PS_INCOMPLETE, // the record continues past the end of the data
+    PS_END // there are no more records
+};
+
+// Find the next line in [p, end). A line is complete once its newline is in
+// the data, or at the end of the file. The newline is not part of the line
+static inline bool nextLine(const char*& p, const char* end, bool atEOF, const char*& lineBegin, const char*& lineEnd)
+{
+    if(p == end)
+        return false;
+
+    const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+    if(nl == NULL)
+    {
+        if(!atEOF)
+            return false;
+        nl = end;
+    }
+
+    lineBegin = p;
+    lineEnd = nl;
+    p = nl == end ? end : nl + 1;
+    return true;
+}
+
+// Parse one record from [pos, end), advancing pos past it. Lines that do not
+// start a record are skipped before it. A fasta record ends at the next line
+// starting with '>' or '@', or the end of the file. The fields are only
+// extracted if pOut is set, so the splitter uses this to find the boundaries
+static ParseStatus parseRecord(const char*& pos, const char* end, bool atEOF, SeqRecord* pOut, std::string* pSeq)
+{
+    const char* p = pos;
+    const char* headerBegin = NULL;
+    const char* headerEnd = NULL;
+    RecordType rt = RT_UNKNOWN;
+    while(rt == RT_UNKNOWN)
+    {
+        if(!nextLine(p, end, atEOF, headerBegin, headerEnd))
+            return atEOF ? PS_END : PS_INCOMPLETE;
+
+        if(headerBegin == headerEnd)
+            continue;
+        if(*headerBegin == '>')
+            rt = RT_FASTA;
+        else if(*headerBegin == '@')
+            rt = RT_FASTQ;
+    }
+
+    const char* lineBegin;
+    const char* lineEnd;
+    if(pSeq != NULL)
+        pSeq->clear();
+
+    if(rt == RT_FASTA)
+    {
+        size_t seqLen = 0;
+        while(p != end && *p != '>' && *p != '@')
+        {
+            if(!nextLine(p, end, atEOF, lineBegin, lineEnd))
+                return PS_INCOMPLETE;
+
+            seqLen += lineEnd - lineBegin;
+            if(pSeq != NULL)
+                pSeq->append(lineBegin, lineEnd - lineBegin);
+        }
+
+        if(p == end && !atEOF)
+            return PS_INCOMPLETE;
+
+        // The record is valid if we extracted at least 1 bp for the sequence
+        if(seqLen == 0)
+        {
+            pos = p;
+            return PS_INVALID;
+        }
+    }
+    else
+    {
+        const char* qualBegin;
+        const char* qualEnd;
+        if(!nextLine(p, end, atEOF, lineBegin, lineEnd) ||
+           !nextLine(p, end, atEOF, qualBegin, qualEnd) ||
+           !nextLine(p, end, atEOF, qualBegin, qualEnd))
+        {
+            // FASTQ is required to have 4 fields
+            return atEOF ? PS_INVALID : PS_INCOMPLETE;
+        }
+
+        if(pOut != NULL)
+        {
+            std::string header(headerBegin, headerEnd);
+            if(lineEnd - lineBegin != qualEnd - qualBegin && __sync_fetch_and_add(&fastq_warn_count, 1) < MAX_WARN)
+                std::cerr << "Warning, FASTQ quality string is not the same length as the sequence string for read " << header << "\n";
+
+            // Fix [Issue GH-3]: Handle FASTQ records that have no sequence or quality value. We only
+            // emit a warning here as long as the record is properly formed.
+            if(lineBegin == lineEnd || qualBegin == qualEnd)
+                std::cerr << "Warning, read " << header << " has no sequence or quality values\n";
+
+            pSeq->assign(lineBegin, lineEnd - lineBegin);
+            pOut->qual.assign(qualBegin, qualEnd - qualBegin);
+        }
+    }
+
+    if(pOut != NULL)
+    {
+        // Parse the id, the header up to the first space or tab
+        const char* idEnd = headerBegin + 1;
+        while(idEnd != headerEnd && *idEnd != ' ' && *idEnd != '\t')
+            ++idEnd;
+        pOut->id.assign(headerBegin + 1, idEnd);
+        if(rt == RT_FASTA)
+            pOut->qual.clear();
+    }
+
+    pos = p;
+    return PS_RECORD;
+}
+
+// Find the start of the last record in [begin, end) by looking back from the end, so only the
+// last few lines are read. In fasta every line starting with '>' or '@' starts a record. In fastq
+// a quality line may start with '@' too, so a header must also have the '+' line two lines below
+// it. Returns begin if no record starts past begin
+static const char* findLastRecordStart(const char* begin, const char* end, RecordType rt)
+{
+    // The starts of the two lines below the current one, nearest first
+    const char* below[2] = { NULL, NULL };
+    const char* p = end;
+    while(p > begin)
+    {
+        const char* nl = static_cast<const char*>(memrchr(begin, '\n', p - begin));
+        const char* lineBegin = nl == NULL ? begin : nl + 1;
+        if(lineBegin == begin)
+            break;
+
+        if(lineBegin != end)
+        {
+            char c = *lineBegin;
+            if(rt == RT_FASTA && (c == '>' || c == '@'))
+                return lineBegin;
+            if(rt == RT_FASTQ && c == '@' && below[1] != NULL && *below[1] == '+')
+                return lineBegin;
+
+            below[1] = below[0];
+            below[0] = lineBegin;
+        }
+        p = nl;
+    }
+    return begin;
+}
+
+//
+SeqBlockReader::SeqBlockReader(const std::string& filename, uint32_t flags) : m_filename(filename),
+                                                                              m_flags(flags),
+                                                                              m_serial(false),
+                                                                              m_started(false),
+                                                                              m_stop(false),
+                                                                              m_finished(false),
+                                                                              m_inflateDone(false),
+                                                                              m_splitDone(false)
+{
+    // gzread passes uncompressed files through unchanged
+    m_file = gzopen(filename.c_str(), "rb");
+    if(m_file == NULL)
+    {
+        std::cerr << "Error: could not open " << filename << " for read\n";
+        exit(EXIT_FAILURE);
+    }
+    gzbuffer(m_file, 1 << 20);
+
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_cond, NULL);
+}
+
+//
+SeqBlockReader::~SeqBlockReader()
+{
+    stop();
+
+    for(size_t i = 0; i < m_blocks.size(); ++i)
+        delete m_blocks[i];
+    for(size_t i = 0; i < m_chunks.size(); ++i)
+        delete m_chunks[i];
+
+    gzclose(m_file);
+    pthread_mutex_destroy(&m_mutex);
+    pthread_cond_destroy(&m_cond);
+}
+
+// The threads are started by the first request for records so
+// readers that are never read from do not cost any threads
+void SeqBlockReader::start()
+{
+    // Without a spare CPU the threads only add overhead, so the
+    // blocks are read and parsed in a single pass by the caller
+    long numCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+    m_started = true;
+    m_serial = numCPUs <= 1;
+    if(m_serial)
+        return;
+
+    int numParseThreads = std::max(1, std::min(MAX_PARSE_THREADS, (int)numCPUs / 2));
+    m_parseThreads.resize(numParseThreads);
+
+    int ret = pthread_create(&m_inflateThread, NULL, &SeqBlockReader::runInflate, this);
+    ret |= pthread_create(&m_splitThread, NULL, &SeqBlockReader::runSplit, this);
+    for(int i = 0; i < numParseThreads; ++i)
+        ret |= pthread_create(&m_parseThreads[i], NULL, &SeqBlockReader::runParse, this);
+
+    if(ret != 0)
+    {
+        std::cerr << "Error: could not start the threads reading " << m_filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+}
+
+//
+void SeqBlockReader::stop()
+{
+    if(!m_started || m_serial)
+        return;
+
+    pthread_mutex_lock(&m_mutex);
+    m_stop = true;
+    pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+
+    pthread_join(m_inflateThread, NULL);
+    pthread_join(m_splitThread, NULL);
+    for(size_t i = 0; i < m_parseThreads.size(); ++i)
+        pthread_join(m_parseThreads[i], NULL);
+    m_started = false;
+}
+
+//
+bool SeqBlockReader::getBatch(std::vector<SeqRecord>& batch)
+{
+    batch.clear();
+    if(!m_started && !m_finished)
+        start();
+
+    while(batch.empty() && !m_finished)
+    {
+        if(m_serial && m_chunks.empty() && !m_splitDone)
+            readChunk();
+
+        pthread_mutex_lock(&m_mutex);
+        while(!(m_splitDone && m_chunks.empty()) && (m_chunks.empty() || !m_chunks.front()->parsed))
+            pthread_cond_wait(&m_cond, &m_mutex);
+
+        if(m_chunks.empty())
+        {
+            pthread_mutex_unlock(&m_mutex);
+            m_finished = true;
+            break;
+        }
+
+        // Hand out the records before an invalid read first, so the
+        // error is raised once the reads before it have been processed
+        Chunk* pChunk = m_chunks.front();
+        if(pChunk->errorIdx != (size_t)-1 && pChunk->errorIdx > 0)
+        {
+            batch.assign(pChunk->records.begin(), pChunk->records.begin() + pChunk->errorIdx);
+            pChunk->records.erase(pChunk->records.begin(), pChunk->records.begin() + pChunk->errorIdx);
+            pChunk->errorIdx = 0;
+            pthread_mutex_unlock(&m_mutex);
+            break;
+        }
+        m_chunks.pop_front();
+        pthread_cond_broadcast(&m_cond);
+        pthread_mutex_unlock(&m_mutex);
+
+        if(pChunk->errorIdx == 0)
+        {
+            std::cerr << "Error: read " << pChunk->records.front().id << " contains non-ACGT characters.\n";
+            std::cerr << "Please run sga preprocess on the data first.\n";
+            exit(EXIT_FAILURE);
+        }
+
+        batch.swap(pChunk->records);
+        m_finished = pChunk->truncated;
+        delete pChunk;
+    }
+    return !batch.empty();
+}
+
+//
+void* SeqBlockReader::runInflate(void* pArg)
+{
+    static_cast<SeqBlockReader*>(pArg)->inflateBlocks();
+    return NULL;
+}
+
+//
+void* SeqBlockReader::runSplit(void* pArg)
+{
+    static_cast<SeqBlockReader*>(pArg)->splitBlocks();
+    return NULL;
+}
+
+//
+void* SeqBlockReader::runParse(void* pArg)
+{
+    static_cast<SeqBlockReader*>(pArg)->parseChunks();
+    return NULL;
+}
+
+// Read the next block of the file into block, returning its size
+size_t SeqBlockReader::readBlock(std::string& block)
+{
+    block.resize(BLOCK_SIZE);
+    int n = gzread(m_file, &block[0], BLOCK_SIZE);
+    if(n < 0)
+    {
+        int errnum;
+        std::cerr << "Error: could not read " << m_filename << ": " << gzerror(m_file, &errnum) << "\n";
+        exit(EXIT_FAILURE);
+    }
+    block.resize(n);
+    return n;
+}
+
+// Parse the records of the next block and the partial record
+// carried over from the previous one, without any threads
+void SeqBlockReader::readChunk()
+{
+    std::string block;
+    bool atEOF = readBlock(block) == 0;
+
+    Chunk* pChunk = new Chunk;
+    pChunk->text.swap(m_carry);
+    pChunk->text.append(block);
+    size_t used = parseChunk(pChunk, atEOF);
+    m_carry.assign(pChunk->text, used, std::string::npos);
+    std::string().swap(pChunk->text);
+    pChunk->claimed = pChunk->parsed = true;
+
+    m_chunks.push_back(pChunk);
+    m_splitDone = atEOF;
+}
+
+// Read the file in blocks, ahead of the splitter
+void SeqBlockReader::inflateBlocks()
+{
+    while(true)
+    {
+        std::string* pBlock = new std::string;
+        size_t n = readBlock(*pBlock);
+
+        pthread_mutex_lock(&m_mutex);
+        while(!m_stop && m_blocks.size() >= MAX_BLOCKS)
+            pthread_cond_wait(&m_cond, &m_mutex);
+
+        bool done = m_stop || n == 0;
+        if(n > 0 && !m_stop)
+            m_blocks.push_back(pBlock);
+        else
+            delete pBlock;
+
+        m_inflateDone = done;
+        pthread_cond_broadcast(&m_cond);
+        pthread_mutex_unlock(&m_mutex);
+
+        if(done)
+            return;
+    }
+}
+
+// Cut the blocks before their last record, which is found from the end of the block so
+// the splitter does not read the records the parse threads parse. The last record, whole
+// or not, is carried over to the chunk of the next block
+void SeqBlockReader::splitBlocks()
+{
+    size_t maxChunks = 2 * m_parseThreads.size() + 2;
+    std::string carry;
+    bool atEOF = false;
+
+    // The format of the file, taken from its first record
+    RecordType rt = RT_UNKNOWN;
+    while(!atEOF)
+    {
+        std::string* pBlock = NULL;
+        pthread_mutex_lock(&m_mutex);
+        while(!m_stop && m_blocks.empty() && !m_inflateDone)
+            pthread_cond_wait(&m_cond, &m_mutex);
+        if(m_stop)
+        {
+            pthread_mutex_unlock(&m_mutex);
+            return;
+        }
+
+        if(!m_blocks.empty())
+        {
+            pBlock = m_blocks.front();
+            m_blocks.pop_front();
+            pthread_cond_broadcast(&m_cond);
+        }
+        atEOF = pBlock == NULL;
+        pthread_mutex_unlock(&m_mutex);
+
+        if(pBlock != NULL)
+        {
+            if(carry.empty())
+                carry.swap(*pBlock);
+            else
+                carry.append(*pBlock);
+            delete pBlock;
+        }
+
+        const char* begin = carry.data();
+        const char* end = begin + carry.size();
+        if(rt == RT_UNKNOWN)
+        {
+            const char* p = begin;
+            const char* lineBegin;
+            const char* lineEnd;
+            while(rt == RT_UNKNOWN && nextLine(p, end, atEOF, lineBegin, lineEnd))
+            {
+                if(lineBegin != lineEnd && *lineBegin == '>')
+                    rt = RT_FASTA;
+                else if(lineBegin != lineEnd && *lineBegin == '@')
+                    rt = RT_FASTQ;
+            }
+        }
+
+        // Find the end of the records before the last one
+        const char* cut = begin;
+        if(atEOF)
+        {
+            cut = end;
+        }
+        else if(rt != RT_UNKNOWN)
+        {
+            cut = findLastRecordStart(begin, end, rt);
+
+            // Records of the other format in a fastq file are not found from the end. They
+            // are parsed through once the carry outgrows a block, so it cannot grow unbounded
+            if(cut == begin && rt == RT_FASTQ && carry.size() > BLOCK_SIZE)
+            {
+                const char* p = begin;
+                ParseStatus status;
+                while((status = parseRecord(p, end, false, NULL, NULL)) == PS_RECORD || status == PS_INVALID)
+                    cut = p;
+            }
+        }
+
+        if(cut == begin)
+            continue;
+
+        Chunk* pChunk = new Chunk;
+        pChunk->text.swap(carry);
+        carry.assign(pChunk->text, cut - begin, std::string::npos);
+        pChunk->text.resize(cut - begin);
+
+        pthread_mutex_lock(&m_mutex);
+        while(!m_stop && m_chunks.size() >= maxChunks)
+            pthread_cond_wait(&m_cond, &m_mutex);
+        if(m_stop)
+        {
+            pthread_mutex_unlock(&m_mutex);
+            delete pChunk;
+            return;
+        }
+        m_chunks.push_back(pChunk);
+        pthread_cond_broadcast(&m_cond);
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    m_splitDone = true;
+    pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+// Parse the oldest chunk that no other thread has taken
+void SeqBlockReader::parseChunks()
+{
+    while(true)
+    {
+        Chunk* pChunk = NULL;
+        pthread_mutex_lock(&m_mutex);
+        while(pChunk == NULL)
+        {
+            for(size_t i = 0; i < m_chunks.size() && pChunk == NULL; ++i)
+            {
+                if(!m_chunks[i]->claimed)
+                    pChunk = m_chunks[i];
+            }
+
+            if(pChunk != NULL || m_stop || m_splitDone)
+                break;
+            pthread_cond_wait(&m_cond, &m_mutex);
+        }
+
+        if(pChunk == NULL || m_stop)
+        {
+            pthread_mutex_unlock(&m_mutex);
+            return;
+        }
+        pChunk->claimed = true;
+        pthread_mutex_unlock(&m_mutex);
+
+        parseChunk(pChunk, true);
+        std::string().swap(pChunk->text);
+
+        pthread_mutex_lock(&m_mutex);
+        pChunk->parsed = true;
+        pthread_cond_broadcast(&m_cond);
+        pthread_mutex_unlock(&m_mutex);
+    }
+}
+
+// Move the fields of b to a and those of a to b
+static inline void swapRecords(SeqRecord& a, SeqRecord& b)
+{
+    a.id.swap(b.id);
+    a.seq.swap(b.seq);
+    a.qual.swap(b.qual);
+}
+
+// Parse the records of the text of the chunk. The chunk of a splitter holds
+// whole records only, so it is parsed as if it ended the file. Returns the
+// length of the text holding the parsed records
+size_t SeqBlockReader::parseChunk(Chunk* pChunk, bool atEOF)
+{
+    const char* begin = pChunk->text.data();
+    const char* p = begin;
+    const char* end = p + pChunk->text.size();
+    std::vector<SeqRecord>& records = pChunk->records;
+    std::string seq;
+    while(true)
+    {
+        // Copying a record copies its strings, so the records
+        // are swapped into the larger vector when it grows
+        if(records.size() == records.capacity())
+        {
+            std::vector<SeqRecord> larger;
+            larger.reserve(std::max((size_t)1024, 2 * records.size()));
+            larger.resize(records.size());
+            for(size_t i = 0; i < records.size(); ++i)
+                swapRecords(larger[i], records[i]);
+            records.swap(larger);
+        }
+
+        records.resize(records.size() + 1);
+        SeqRecord& record = records.back();
+        ParseStatus status = parseRecord(p, end, atEOF, &record, &seq);
+        if(status != PS_RECORD)
+        {
+            records.pop_back();
+            pChunk->truncated = status == PS_INVALID;
+            break;
+        }
+
+        if(!(m_flags & SRF_SKIP_ALL_CHECK))
+        {
+            // Convert the sequence string to upper case
+            if(!(m_flags & SRF_KEEP_CASE))
+                std::transform(seq.begin(), seq.end(), seq.begin(), ::toupper);
+
+            // If the validation flag is set, ensure that there aren't any non-ACGT bases
+            if(!(m_flags & SRF_NO_VALIDATION) && seq.find_first_not_of("ACGT") != std::string::npos)
+            {
+                record.seq.assign(seq.data(), seq.size());
+                pChunk->errorIdx = records.size() - 1;
+                break;
+            }
+        }
+        record.seq.assign(seq.data(), seq.size());
+    }
+    return p - begin;
+}
@@ -0,0 +1,97 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// SeqBlockReader - Parse fasta or fastq files in large
+// blocks on a pipeline of threads. One thread reads (and
+// inflates, for gzipped files) the file in blocks, one
+// splits the blocks at record boundaries into chunks holding
+// only whole records and a few threads parse the chunks into
+// records concurrently. The records are handed out in batches
+// of one chunk, in the order of the file.
+//
+#ifndef SEQBLOCKREADER_H
+#define SEQBLOCKREADER_H
+
+#include <deque>
+#include <pthread.h>
+#include <zlib.h>
+#include "Util.h"
+
+class SeqBlockReader
+{
+    public:
+        SeqBlockReader(const std::string& filename, uint32_t flags);
+        ~SeqBlockReader();
+
+        // Move the records of the next chunk of the file into batch.
+        // Returns false once every record has been handed out
+        bool getBatch(std::vector<SeqRecord>& batch);
+
+    private:
+
+        // A piece of the file holding whole records only
+        struct Chunk
+        {
+            Chunk() : claimed(false), parsed(false), truncated(false), errorIdx(-1) {}
+
+            std::string text;
+            std::vector<SeqRecord> records;
+            bool claimed;
+            bool parsed;
+
+            // Parsing stopped at a malformed record, which ends the input
+            bool truncated;
+
+            // The index of the first record with a base other than ACGT, if any
+            size_t errorIdx;
+        };
+
+        SeqBlockReader(const SeqBlockReader&);
+        SeqBlockReader& operator=(const SeqBlockReader&);
+
+        void start();
+        void stop();
+
+        static void* runInflate(void* pArg);
+        static void* runSplit(void* pArg);
+        static void* runParse(void* pArg);
+
+        void inflateBlocks();
+        void splitBlocks();
+        void parseChunks();
+        size_t parseChunk(Chunk* pChunk, bool atEOF);
+
+        size_t readBlock(std::string& block);
+        void readChunk();
+
+        std::string m_filename;
+        uint32_t m_flags;
+        gzFile m_file;
+
+        // Parse on the calling thread, as there is only one CPU
+        bool m_serial;
+        bool m_started;
+        bool m_stop;
+        bool m_finished;
+        pthread_t m_inflateThread;
+        pthread_t m_splitThread;
+        std::vector<pthread_t> m_parseThreads;
+
+        // Every queue is guarded by the one mutex. The threads only
+        // hold it to move blocks and chunks, never while working on them
+        pthread_mutex_t m_mutex;
+        pthread_cond_t m_cond;
+
+        std::deque<std::string*> m_blocks;
+        bool m_inflateDone;
+
+        std::deque<Chunk*> m_chunks;
+        bool m_splitDone;
+
+        // The partial record at the end of the last block read in serial mode
+        std::string m_carry;
+};
+
+#endif
@@ -9,7 +9,6 @@
 #ifndef SEQREADER_H
 #define SEQREADER_H
 
-#include <fstream>
 #include "Util.h"
 
 enum RecordType
@@ -23,7 +22,9 @@ static const uint32_t SRF_NO_VALIDATION = 1;
 static const uint32_t SRF_KEEP_CASE = 2;
 static const uint32_t SRF_SKIP_ALL_CHECK = 3;	//skip all checks
 
-//
+class SeqBlockReader;
+
+// The records are parsed ahead of the caller, in batches, by a SeqBlockReader
 class SeqReader
 {
     public:
@@ -32,8 +33,12 @@ class SeqReader
         bool get(SeqRecord& sr);
 
     private:
-        std::istream* m_pHandle;
-        uint32_t m_flags;
+        SeqReader(const SeqReader&);
+        SeqReader& operator=(const SeqReader&);
+
+        SeqBlockReader* m_pBlockReader;
+        std::vector<SeqRecord> m_batch;
+        size_t m_batchIdx;
 };
 
 #endif
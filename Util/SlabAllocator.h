@@ -0,0 +1,362 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// SlabAllocator - Thread-safe memory pool with free lists
+// for the vertices and edges of the string graph. Objects
+// are carved from aligned slabs mapped from the OS. The
+// head of each slab points to the allocator owning it, so
+// a class operator delete frees an object without knowing
+// its graph. Each thread using an allocator keeps a small
+// cache of free objects and exchanges batches with the
+// shared free list. The cache is found through a thread-local
+// pointer, so it does not matter whether the thread belongs
+// to an OpenMP team or to the pthread framework.
+//
+// compact() releases the slabs without live objects back to
+// the OS. Live objects are never moved, so the free list is
+// sorted to refill the lowest slabs first and let the others
+// drain.
+//
+#ifndef SLABALLOCATOR_H
+#define SLABALLOCATOR_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <omp.h>
+
+// The state of an allocator. The counts are exact only while no
+// other thread uses the allocator
+struct SlabAllocatorStats
+{
+    SlabAllocatorStats() : numSlabs(0), numLive(0), numFree(0), reservedBytes(0), peakReservedBytes(0), releasedBytes(0) {}
+
+    size_t numSlabs;
+    size_t numLive;
+    size_t numFree;
+    size_t reservedBytes;
+    size_t peakReservedBytes;
+
+    // The bytes returned to the OS by the last compaction
+    size_t releasedBytes;
+};
+
+template<class T>
+class SlabAllocator
+{
+    struct FreeNode
+    {
+        FreeNode* pNext;
+    };
+
+    struct SlabHeader
+    {
+        SlabAllocator* pOwner;
+    };
+
+    // The free objects cached by one thread. Padded to a cache line so the
+    // threads do not share the line of their caches
+    struct ThreadCache
+    {
+        ThreadCache(pthread_t thread) : pHead(NULL), count(0), owner(thread) {}
+
+        FreeNode* pHead;
+        size_t count;
+        pthread_t owner;
+        char padding[64 - sizeof(FreeNode*) - sizeof(size_t) - sizeof(pthread_t)];
+    };
+
+    public:
+        SlabAllocator() : m_id(__sync_add_and_fetch(&s_lastID, 1)), m_pBump(NULL), m_pBumpEnd(NULL), m_pSharedFree(NULL), m_numSharedFree(0),
+                          m_peakReservedBytes(0), m_releasedBytes(0)
+        {
+            omp_init_lock(&m_lock);
+        }
+
+        ~SlabAllocator()
+        {
+            for(size_t i = 0; i < m_slabs.size(); ++i)
+                munmap(m_slabs[i], SLAB_BYTES);
+            for(size_t i = 0; i < m_caches.size(); ++i)
+                delete m_caches[i];
+            omp_destroy_lock(&m_lock);
+        }
+
+        // Thread-safe
+        void* alloc()
+        {
+            ThreadCache& cache = getCache();
+            if(cache.pHead == NULL)
+                refill(cache);
+
+            FreeNode* pNode = cache.pHead;
+            cache.pHead = pNode->pNext;
+            --cache.count;
+            return pNode;
+        }
+
+        // Thread-safe
+        void dealloc(void* ptr)
+        {
+            FreeNode* pNode = static_cast<FreeNode*>(ptr);
+            ThreadCache& cache = getCache();
+            pNode->pNext = cache.pHead;
+            cache.pHead = pNode;
+            if(++cache.count >= 2 * CACHE_BATCH)
+                spill(cache);
+        }
+
+        // Free an object into the allocator owning its slab
+        static void deallocate(void* ptr)
+        {
+            if(ptr == NULL)
+                return;
+            SlabHeader* pHeader = reinterpret_cast<SlabHeader*>(reinterpret_cast<uintptr_t>(ptr) & ~(uintptr_t)(SLAB_BYTES - 1));
+            pHeader->pOwner->dealloc(ptr);
+        }
+
+        // Move the caches of the threads to the shared free list and release the slabs
+        // holding no live objects. Must not run while other threads use the allocator
+        void compact()
+        {
+            assert(!omp_in_parallel());
+            std::vector<FreeNode*> freeNodes;
+            freeNodes.reserve(m_numSharedFree);
+            for(FreeNode* pNode = m_pSharedFree; pNode != NULL; pNode = pNode->pNext)
+                freeNodes.push_back(pNode);
+            for(size_t i = 0; i < m_caches.size(); ++i)
+            {
+                for(FreeNode* pNode = m_caches[i]->pHead; pNode != NULL; pNode = pNode->pNext)
+                    freeNodes.push_back(pNode);
+                m_caches[i]->pHead = NULL;
+                m_caches[i]->count = 0;
+            }
+            std::sort(freeNodes.begin(), freeNodes.end());
+            std::sort(m_slabs.begin(), m_slabs.end());
+
+            // Count the free objects of each slab, including those never handed out
+            std::vector<size_t> slabFree(m_slabs.size(), 0);
+            for(size_t i = 0; i < freeNodes.size(); ++i)
+                ++slabFree[findSlab(freeNodes[i])];
+            size_t bumpSlab = m_slabs.size();
+            if(m_pBump != m_pBumpEnd)
+            {
+                bumpSlab = findSlab(m_pBump);
+                slabFree[bumpSlab] += (m_pBumpEnd - m_pBump) / OBJECT_BYTES;
+            }
+
+            std::vector<bool> isReleased(m_slabs.size(), false);
+            std::vector<char*> keptSlabs;
+            m_releasedBytes = 0;
+            for(size_t i = 0; i < m_slabs.size(); ++i)
+            {
+                if(slabFree[i] == OBJECTS_PER_SLAB)
+                {
+                    if(i == bumpSlab)
+                        m_pBump = m_pBumpEnd = NULL;
+                    munmap(m_slabs[i], SLAB_BYTES);
+                    isReleased[i] = true;
+                    m_releasedBytes += SLAB_BYTES;
+                }
+                else
+                {
+                    keptSlabs.push_back(m_slabs[i]);
+                }
+            }
+
+            // Rebuild the shared free list in address order
+            m_pSharedFree = NULL;
+            m_numSharedFree = 0;
+            for(size_t i = freeNodes.size(); i > 0; --i)
+            {
+                if(!isReleased[findSlab(freeNodes[i - 1])])
+                    pushShared(freeNodes[i - 1]);
+            }
+            m_slabs.swap(keptSlabs);
+        }
+
+        SlabAllocatorStats getStats() const
+        {
+            SlabAllocatorStats stats;
+            stats.numSlabs = m_slabs.size();
+            stats.numFree = m_numSharedFree;
+            for(size_t i = 0; i < m_caches.size(); ++i)
+                stats.numFree += m_caches[i]->count;
+            size_t numUnused = (m_pBumpEnd - m_pBump) / OBJECT_BYTES;
+            stats.numLive = stats.numSlabs * OBJECTS_PER_SLAB - stats.numFree - numUnused;
+            stats.reservedBytes = stats.numSlabs * SLAB_BYTES;
+            stats.peakReservedBytes = m_peakReservedBytes;
+            stats.releasedBytes = m_releasedBytes;
+            return stats;
+        }
+
+        // Print the stats on a single line
+        void printStats(const std::string& name, std::ostream& out) const
+        {
+            SlabAllocatorStats stats = getStats();
+            double MB = 1024.0 * 1024.0;
+            out << std::fixed << std::setprecision(1) << name << ": " << stats.numLive << " live, "
+                << stats.numFree << " free, " << stats.numSlabs << " slabs (" << stats.reservedBytes / MB
+                << " MB, peak " << stats.peakReservedBytes / MB << " MB, released " << stats.releasedBytes / MB << " MB)\n";
+            out.unsetf(std::ios::floatfield);
+        }
+
+    private:
+        SlabAllocator(const SlabAllocator&);
+        SlabAllocator& operator=(const SlabAllocator&);
+
+        // The cache of the calling thread. The thread remembers the cache it used last and the
+        // allocator owning it, by ID as an allocator may be created where a freed one was
+        ThreadCache& getCache()
+        {
+            if(s_cacheOwnerID == m_id)
+                return *s_pCache;
+
+            pthread_t self = pthread_self();
+            ThreadCache* pCache = NULL;
+            omp_set_lock(&m_lock);
+            for(size_t i = 0; i < m_caches.size() && pCache == NULL; ++i)
+            {
+                if(pthread_equal(m_caches[i]->owner, self))
+                    pCache = m_caches[i];
+            }
+            if(pCache == NULL)
+            {
+                pCache = new ThreadCache(self);
+                m_caches.push_back(pCache);
+            }
+            omp_unset_lock(&m_lock);
+
+            s_cacheOwnerID = m_id;
+            s_pCache = pCache;
+            return *pCache;
+        }
+
+        // Take a batch of objects from the shared free list
+        void refill(ThreadCache& cache)
+        {
+            omp_set_lock(&m_lock);
+            for(size_t i = 0; i < CACHE_BATCH; ++i)
+            {
+                FreeNode* pNode = static_cast<FreeNode*>(allocShared());
+                pNode->pNext = cache.pHead;
+                cache.pHead = pNode;
+            }
+            omp_unset_lock(&m_lock);
+            cache.count += CACHE_BATCH;
+        }
+
+        // Return a batch of objects to the shared free list
+        void spill(ThreadCache& cache)
+        {
+            omp_set_lock(&m_lock);
+            for(size_t i = 0; i < CACHE_BATCH; ++i)
+            {
+                FreeNode* pNode = cache.pHead;
+                cache.pHead = pNode->pNext;
+                pushShared(pNode);
+            }
+            omp_unset_lock(&m_lock);
+            cache.count -= CACHE_BATCH;
+        }
+
+        // The caller holds m_lock
+        void* allocShared()
+        {
+            if(m_pSharedFree != NULL)
+            {
+                FreeNode* pNode = m_pSharedFree;
+                m_pSharedFree = pNode->pNext;
+                --m_numSharedFree;
+                return pNode;
+            }
+
+            if(m_pBump == m_pBumpEnd)
+                addSlab();
+            void* ptr = m_pBump;
+            m_pBump += OBJECT_BYTES;
+            return ptr;
+        }
+
+        // The caller holds m_lock
+        void pushShared(FreeNode* pNode)
+        {
+            pNode->pNext = m_pSharedFree;
+            m_pSharedFree = pNode;
+            ++m_numSharedFree;
+        }
+
+        // Map a slab aligned to its size by trimming a mapping of twice the size
+        void addSlab()
+        {
+            void* pMap = mmap(NULL, 2 * SLAB_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(pMap == MAP_FAILED)
+            {
+                std::cerr << "SlabAllocator failed to allocate " << SLAB_BYTES << " bytes for a slab, exiting\n";
+                abort();
+            }
+
+            char* pStart = static_cast<char*>(pMap);
+            char* pSlab = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(pStart) + SLAB_BYTES - 1) & ~(uintptr_t)(SLAB_BYTES - 1));
+            if(pSlab > pStart)
+                munmap(pStart, pSlab - pStart);
+            if(pSlab + SLAB_BYTES < pStart + 2 * SLAB_BYTES)
+                munmap(pSlab + SLAB_BYTES, pStart + 2 * SLAB_BYTES - (pSlab + SLAB_BYTES));
+
+            reinterpret_cast<SlabHeader*>(pSlab)->pOwner = this;
+            m_slabs.push_back(pSlab);
+            m_pBump = pSlab + HEADER_BYTES;
+            m_pBumpEnd = m_pBump + OBJECTS_PER_SLAB * OBJECT_BYTES;
+            m_peakReservedBytes = std::max(m_peakReservedBytes, m_slabs.size() * SLAB_BYTES);
+        }
+
+        // The index of the slab holding ptr in the sorted slab list
+        size_t findSlab(const void* ptr) const
+        {
+            char* pSlab = reinterpret_cast<char*>(reinterpret_cast<uintptr_t>(ptr) & ~(uintptr_t)(SLAB_BYTES - 1));
+            typename std::vector<char*>::const_iterator iter = std::lower_bound(m_slabs.begin(), m_slabs.end(), pSlab);
+            assert(iter != m_slabs.end() && *iter == pSlab);
+            return iter - m_slabs.begin();
+        }
+
+        static const size_t SLAB_BYTES = 1 << 18;
+        static const size_t HEADER_BYTES = 64;
+        static const size_t OBJECT_BYTES = (sizeof(T) > sizeof(FreeNode) ? sizeof(T) + 7 : sizeof(FreeNode)) & ~(size_t)7;
+        static const size_t OBJECTS_PER_SLAB = (SLAB_BYTES - HEADER_BYTES) / OBJECT_BYTES;
+        static const size_t CACHE_BATCH = 64;
+
+        static uint64_t s_lastID;
+        static __thread uint64_t s_cacheOwnerID;
+        static __thread ThreadCache* s_pCache;
+
+        // Tells this allocator from those that were created at the same address before
+        const uint64_t m_id;
+
+        std::vector<char*> m_slabs;
+        std::vector<ThreadCache*> m_caches;
+
+        // The unused end of the newest slab
+        char* m_pBump;
+        char* m_pBumpEnd;
+
+        FreeNode* m_pSharedFree;
+        size_t m_numSharedFree;
+        size_t m_peakReservedBytes;
+        size_t m_releasedBytes;
+        omp_lock_t m_lock;
+};
+
+template<class T> uint64_t SlabAllocator<T>::s_lastID = 0;
+template<class T> __thread uint64_t SlabAllocator<T>::s_cacheOwnerID = 0;
+template<class T> __thread typename SlabAllocator<T>::ThreadCache* SlabAllocator<T>::s_pCache = NULL;
+
+#endif
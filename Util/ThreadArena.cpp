@@ -0,0 +1,121 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// ThreadArena - Bump allocator for the temporaries of a
+// single work item
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <iostream>
+#include "ThreadArena.h"
+#include "Timer.h"
+
+__thread ThreadArena* ThreadArena::s_pCurrent = NULL;
+
+// The allocations timed to estimate the cost of the heap, in rounds of a batch
+static const size_t CALIBRATION_ROUNDS = 256;
+static const size_t CALIBRATION_BATCH = 64;
+
+//
+ThreadArena::~ThreadArena()
+{
+    for(size_t i = 0; i < m_chunks.size(); ++i)
+        free(m_chunks[i].pStart);
+}
+
+//
+void ThreadArena::reset()
+{
+    for(size_t i = MAX_KEPT_CHUNKS; i < m_chunks.size(); ++i)
+        free(m_chunks[i].pStart);
+    if(m_chunks.size() > MAX_KEPT_CHUNKS)
+        m_chunks.resize(MAX_KEPT_CHUNKS);
+
+    m_currChunk = 0;
+    m_pBump = m_chunks.empty() ? NULL : m_chunks[0].pStart;
+    m_pEnd = m_chunks.empty() ? NULL : m_chunks[0].pEnd;
+    ++m_stats.numResets;
+}
+
+//
+void* ThreadArena::allocSlow(size_t bytes)
+{
+    size_t next = m_chunks.empty() ? 0 : m_currChunk + 1;
+    while(next < m_chunks.size() && (size_t)(m_chunks[next].pEnd - m_chunks[next].pStart) < bytes)
+        ++next;
+
+    if(next == m_chunks.size())
+    {
+        size_t chunkBytes = std::max(CHUNK_BYTES, bytes);
+        Chunk chunk;
+        chunk.pStart = static_cast<char*>(malloc(chunkBytes));
+        if(chunk.pStart == NULL)
+        {
+            std::cerr << "ThreadArena failed to allocate " << chunkBytes << " bytes for a chunk, exiting\n";
+            abort();
+        }
+        chunk.pEnd = chunk.pStart + chunkBytes;
+        m_chunks.push_back(chunk);
+
+        size_t footprint = 0;
+        for(size_t i = 0; i < m_chunks.size(); ++i)
+            footprint += m_chunks[i].pEnd - m_chunks[i].pStart;
+        m_stats.peakBytes = std::max(m_stats.peakBytes, footprint);
+    }
+
+    m_currChunk = next;
+    m_pBump = m_chunks[next].pStart + bytes;
+    m_pEnd = m_chunks[next].pEnd;
+    return m_chunks[next].pStart;
+}
+
+// The seconds per allocation of the given size from the heap, minus those from an arena.
+// The heap is timed on a single thread, so the contention of the workers for it is not counted
+static double calibrateSavedSecondsPerAlloc(size_t bytes)
+{
+    void* ptrs[CALIBRATION_BATCH];
+    volatile size_t checksum = 0;
+
+    Timer heapTimer("HeapCalibration", true);
+    for(size_t r = 0; r < CALIBRATION_ROUNDS; ++r)
+    {
+        for(size_t i = 0; i < CALIBRATION_BATCH; ++i)
+            ptrs[i] = ::operator new(bytes);
+        for(size_t i = 0; i < CALIBRATION_BATCH; ++i)
+        {
+            checksum += reinterpret_cast<size_t>(ptrs[i]);
+            ::operator delete(ptrs[i]);
+        }
+    }
+    double heapSecs = heapTimer.getElapsedWallTime();
+
+    ThreadArena arena;
+    Timer arenaTimer("ArenaCalibration", true);
+    for(size_t r = 0; r < CALIBRATION_ROUNDS; ++r)
+    {
+        for(size_t i = 0; i < CALIBRATION_BATCH; ++i)
+            ptrs[i] = arena.alloc(bytes);
+        for(size_t i = 0; i < CALIBRATION_BATCH; ++i)
+            checksum += reinterpret_cast<size_t>(ptrs[i]);
+        arena.reset();
+    }
+    double arenaSecs = arenaTimer.getElapsedWallTime();
+
+    double savedSecs = (heapSecs - arenaSecs) / (CALIBRATION_ROUNDS * CALIBRATION_BATCH);
+    return savedSecs > 0 ? savedSecs : 0;
+}
+
+//
+void ThreadArenaStats::print() const
+{
+    if(numAllocs == 0)
+        return;
+
+    double MB = 1024.0 * 1024.0;
+    double savedSecs = numAllocs * calibrateSavedSecondsPerAlloc(allocBytes / numAllocs);
+    printf("Thread arenas: %zu allocations (%.1lf MB) over %zu work items, peak %.1lf MB per thread, about %.2lfs of heap allocation saved\n",
+            numAllocs, allocBytes / MB, numResets, peakBytes / MB, savedSecs);
+}
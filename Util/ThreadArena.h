@@ -0,0 +1,217 @@
+//-----------------------------------------------
+// Copyright 2014 National Chung Cheng University
+// Released under the GPL
+//-----------------------------------------------
+//
+// ThreadArena - Bump allocator for the temporaries of a
+// single work item. The sequence process framework binds
+// an arena to a thread while it processes one item and
+// rewinds it afterwards, so the k-mer vectors, interval
+// tree nodes, overlap block lists and search seeds of a
+// read are neither freed one by one nor fought over in
+// the heap by the threads.
+//
+// Containers opt in with ArenaAllocator. It allocates from
+// the arena bound to the calling thread, or from the heap
+// when none is bound, and frees to the heap any memory the
+// arena does not own. Memory taken from an arena must not
+// outlive the work item.
+//
+#ifndef THREADARENA_H
+#define THREADARENA_H
+
+#include <stddef.h>
+#include <new>
+#include <vector>
+
+// The counts of one or more arenas
+struct ThreadArenaStats
+{
+    ThreadArenaStats() : numAllocs(0), allocBytes(0), numResets(0), peakBytes(0) {}
+
+    ThreadArenaStats& operator+=(const ThreadArenaStats& other)
+    {
+        numAllocs += other.numAllocs;
+        allocBytes += other.allocBytes;
+        numResets += other.numResets;
+        if(other.peakBytes > peakBytes)
+            peakBytes = other.peakBytes;
+        return *this;
+    }
+
+    // Print the counts and an estimate of the time the heap would have taken for the allocations
+    void print() const;
+
+    size_t numAllocs;
+    size_t allocBytes;
+
+    // The work items the arenas were rewound after
+    size_t numResets;
+
+    // The largest footprint of a single arena
+    size_t peakBytes;
+};
+
+class ThreadArena
+{
+    struct Chunk
+    {
+        char* pStart;
+        char* pEnd;
+    };
+
+    public:
+        ThreadArena() : m_currChunk(0), m_pBump(NULL), m_pEnd(NULL) {}
+        ~ThreadArena();
+
+        void* alloc(size_t bytes)
+        {
+            bytes = align(bytes);
+            ++m_stats.numAllocs;
+            m_stats.allocBytes += bytes;
+            if((size_t)(m_pEnd - m_pBump) < bytes)
+                return allocSlow(bytes);
+            void* ptr = m_pBump;
+            m_pBump += bytes;
+            return ptr;
+        }
+
+        // Only the latest allocation is given back, which lets a vector regrow in place
+        void dealloc(void* ptr, size_t bytes)
+        {
+            if(static_cast<char*>(ptr) + align(bytes) == m_pBump)
+                m_pBump = static_cast<char*>(ptr);
+        }
+
+        bool owns(const void* ptr) const
+        {
+            const char* p = static_cast<const char*>(ptr);
+            for(size_t i = 0; i < m_chunks.size(); ++i)
+            {
+                if(p >= m_chunks[i].pStart && p < m_chunks[i].pEnd)
+                    return true;
+            }
+            return false;
+        }
+
+        // Free everything allocated since the last reset. The chunks a large work item
+        // added beyond MAX_KEPT_CHUNKS are returned to the heap
+        void reset();
+
+        const ThreadArenaStats& getStats() const { return m_stats; }
+
+        // The arena bound to the calling thread, or NULL
+        static ThreadArena* getCurrent() { return s_pCurrent; }
+        static void setCurrent(ThreadArena* pArena) { s_pCurrent = pArena; }
+
+        // Allocate from the arena bound to the calling thread, or from the heap
+        static void* allocate(size_t bytes)
+        {
+            ThreadArena* pArena = s_pCurrent;
+            return pArena != NULL ? pArena->alloc(bytes) : ::operator new(bytes);
+        }
+
+        static void deallocate(void* ptr, size_t bytes)
+        {
+            ThreadArena* pArena = s_pCurrent;
+            if(pArena != NULL && pArena->owns(ptr))
+                pArena->dealloc(ptr, bytes);
+            else
+                ::operator delete(ptr);
+        }
+
+    private:
+        ThreadArena(const ThreadArena&);
+        ThreadArena& operator=(const ThreadArena&);
+
+        static size_t align(size_t bytes) { return (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+        // Move to the next chunk large enough for bytes, adding one if needed
+        void* allocSlow(size_t bytes);
+
+        static const size_t ALIGNMENT = 16;
+        static const size_t CHUNK_BYTES = 1 << 18;
+        static const size_t MAX_KEPT_CHUNKS = 4;
+
+        static __thread ThreadArena* s_pCurrent;
+
+        std::vector<Chunk> m_chunks;
+        size_t m_currChunk;
+
+        // The unused end of the current chunk
+        char* m_pBump;
+        char* m_pEnd;
+
+        ThreadArenaStats m_stats;
+};
+
+// Binds an arena to the calling thread for the processing of one work item
+// and rewinds it at the end of the scope
+class ThreadArenaScope
+{
+    public:
+        ThreadArenaScope(ThreadArena* pArena) : m_pArena(pArena), m_pPrevious(ThreadArena::getCurrent())
+        {
+            ThreadArena::setCurrent(pArena);
+        }
+
+        ~ThreadArenaScope()
+        {
+            ThreadArena::setCurrent(m_pPrevious);
+            m_pArena->reset();
+        }
+
+    private:
+        ThreadArenaScope(const ThreadArenaScope&);
+        ThreadArenaScope& operator=(const ThreadArenaScope&);
+
+        ThreadArena* m_pArena;
+        ThreadArena* m_pPrevious;
+};
+
+// STL allocator over the arena of the calling thread
+template<class T>
+class ArenaAllocator
+{
+    public:
+        typedef T value_type;
+        typedef T* pointer;
+        typedef const T* const_pointer;
+        typedef T& reference;
+        typedef const T& const_reference;
+        typedef size_t size_type;
+        typedef ptrdiff_t difference_type;
+
+        template<class U>
+        struct rebind
+        {
+            typedef ArenaAllocator<U> other;
+        };
+
+        ArenaAllocator() {}
+        template<class U> ArenaAllocator(const ArenaAllocator<U>&) {}
+
+        pointer address(reference x) const { return &x; }
+        const_pointer address(const_reference x) const { return &x; }
+
+        pointer allocate(size_type n, const void* /*hint*/ = 0)
+        {
+            return static_cast<pointer>(ThreadArena::allocate(n * sizeof(T)));
+        }
+
+        void deallocate(pointer p, size_type n) { ThreadArena::deallocate(p, n * sizeof(T)); }
+
+        size_type max_size() const { return (size_type)-1 / sizeof(T); }
+
+        void construct(pointer p, const T& value) { new(p) T(value); }
+        void destroy(pointer p) { p->~T(); }
+};
+
+// The allocators are stateless, so any of them frees the memory of another
+template<class T, class U>
+inline bool operator==(const ArenaAllocator<T>&, const ArenaAllocator<U>&) { return true; }
+
+template<class T, class U>
+inline bool operator!=(const ArenaAllocator<T>&, const ArenaAllocator<U>&) { return false; }
+
+#endif
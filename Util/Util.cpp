@@ -9,7 +9,9 @@
 #include <iostream>
 #include <math.h>
 #include <map>
+#include <sys/resource.h>
 #include "Util.h"
+#include "BGZFStream.h"
 
 //
 // Sequence operations
@@ -264,6 +266,19 @@ std::ifstream::pos_type getFilesize(const std::string& filename)
     return in.tellg();
 }
 
+// ru_maxrss is reported in kilobytes on Linux and in bytes on OSX
+size_t getPeakRSS()
+{
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+}
+
 // Open a file that may or may not be gzipped for reading
 // The caller is responsible for freeing the handle
 std::istream* createReader(const std::string& filename, std::ios_base::openmode mode)
@@ -287,10 +302,15 @@ std::istream* createReader(const std::string& filename, std::ios_base::openmode
 std::ostream* createWriter(const std::string& filename,
                            std::ios_base::openmode mode)
 {
+    // The gzipped files are compressed in blocks by a pool of threads
     if(isGzip(filename))
     {
-        ogzstream* pGZ = new ogzstream(filename.c_str(), mode);
-        assertGZOpen(*pGZ, filename);
+        BGZFOutputStream* pGZ = new BGZFOutputStream(filename);
+        if(!pGZ->is_open())
+        {
+            std::cerr << "Error: could not open " << filename << " for write\n";
+            exit(EXIT_FAILURE);
+        }
         return pGZ;
     }
     else
@@ -175,6 +175,9 @@ bool isGzip(const std::string& filename);
 bool isFastq(const std::string& filename);
 std::ifstream::pos_type getFilesize(const std::string& filename);
 
+// Return the peak resident set size of the process so far, in bytes
+size_t getPeakRSS();
+
 // Write out a fasta record
 void writeFastaRecord(std::ostream* pWriter, const std::string& id, const std::string& seq, size_t maxLength = 80);
 